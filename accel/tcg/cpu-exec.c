@@ -349,6 +349,115 @@ TranslationBlock *tb_htable_lookup(CPUState *cpu, target_ulong pc,
     return qht_lookup_custom(&tb_ctx.htable, &desc, h, tb_lookup_cmp);
 }
 
+/*
+ * The jump cache is resized after every TB_JMP_CACHE_WINDOW lookups:
+ * it grows when more than 1 / TB_JMP_CACHE_GROW_RATIO of them missed a
+ * TB that had already been translated, and shrinks again when fewer than
+ * 1 / TB_JMP_CACHE_SHRINK_RATIO of them did.
+ */
+#define TB_JMP_CACHE_WINDOW        (1 << 16)
+#define TB_JMP_CACHE_GROW_RATIO    8
+#define TB_JMP_CACHE_SHRINK_RATIO  256
+
+static void tb_jmp_cache_resize(CPUState *cpu, unsigned int bits)
+{
+    CPUJumpCache *old = cpu->tb_jmp_cache;
+    CPUJumpCache *new = cpu_tb_jmp_cache_new(bits);
+    unsigned int i;
+
+    /*
+     * Carry the current entries over.  A TB that is being invalidated by
+     * another thread may be copied after it has been cleared from the old
+     * table, but it is already marked CF_INVALID and will never match.
+     */
+    for (i = 0; i < (1u << old->bits); i++) {
+        TranslationBlock *tb = qatomic_read(&old->array[i]);
+
+        if (tb) {
+            new->array[tb_jmp_cache_hash_func(tb->pc, bits)] = tb;
+        }
+    }
+    qatomic_rcu_set(&cpu->tb_jmp_cache, new);
+    g_free_rcu(old, rcu);
+    cpu->tb_jmp_stats.resizes++;
+}
+
+static void tb_jmp_cache_account(CPUState *cpu)
+{
+    CPUJumpCacheStats *st = &cpu->tb_jmp_stats;
+    unsigned int bits = cpu->tb_jmp_cache->bits;
+    uint64_t misses = st->victim_hits + st->htable_hits;
+    uint64_t lookups = st->hits + misses + st->htable_misses;
+    uint64_t n = lookups - st->window_lookups;
+    uint64_t m = misses - st->window_misses;
+
+    if (n < TB_JMP_CACHE_WINDOW) {
+        return;
+    }
+    if (m * TB_JMP_CACHE_GROW_RATIO > n && bits < TB_JMP_CACHE_MAX_BITS) {
+        tb_jmp_cache_resize(cpu, bits + 1);
+    } else if (m * TB_JMP_CACHE_SHRINK_RATIO < n &&
+               bits > TB_JMP_CACHE_MIN_BITS) {
+        tb_jmp_cache_resize(cpu, bits - 1);
+    }
+    st->window_lookups = lookups;
+    st->window_misses = misses;
+}
+
+/* Called by the owning vCPU only.  */
+void tb_jmp_cache_insert(CPUState *cpu, target_ulong pc, TranslationBlock *tb)
+{
+    CPUJumpCache *jc = cpu->tb_jmp_cache;
+    uint32_t hash = tb_jmp_cache_hash_func(pc, jc->bits);
+    TranslationBlock *old = qatomic_read(&jc->array[hash]);
+
+    qatomic_set(&jc->array[hash], tb);
+
+    /* Keep the entry we displaced around in the victim cache.  */
+    if (old && old != tb && !(tb_cflags(old) & CF_INVALID)) {
+        unsigned int i = cpu->tb_jmp_victim_next;
+
+        qatomic_set(&cpu->tb_jmp_victim[i], old);
+        cpu->tb_jmp_victim_next = (i + 1) % TB_JMP_VICTIM_SIZE;
+    }
+}
+
+/* Look up a TB which missed the jump cache.  Called by the owning vCPU.  */
+TranslationBlock *tb_jmp_cache_lookup_slow(CPUState *cpu, target_ulong pc,
+                                           target_ulong cs_base,
+                                           uint32_t flags, uint32_t cf_mask)
+{
+    CPUJumpCacheStats *st = &cpu->tb_jmp_stats;
+    TranslationBlock *tb;
+    unsigned int i;
+
+    tb_jmp_cache_account(cpu);
+
+    for (i = 0; i < TB_JMP_VICTIM_SIZE; i++) {
+        tb = qatomic_rcu_read(&cpu->tb_jmp_victim[i]);
+        if (tb_jmp_cache_match(cpu, tb, pc, cs_base, flags, cf_mask)) {
+            CPUJumpCache *jc = cpu->tb_jmp_cache;
+            uint32_t hash = tb_jmp_cache_hash_func(pc, jc->bits);
+
+            /* Swap it with the entry it conflicted with.  */
+            qatomic_set(&cpu->tb_jmp_victim[i],
+                        qatomic_read(&jc->array[hash]));
+            qatomic_set(&jc->array[hash], tb);
+            st->victim_hits++;
+            return tb;
+        }
+    }
+
+    tb = tb_htable_lookup(cpu, pc, cs_base, flags, cf_mask);
+    if (tb == NULL) {
+        st->htable_misses++;
+        return NULL;
+    }
+    st->htable_hits++;
+    tb_jmp_cache_insert(cpu, pc, tb);
+    return tb;
+}
+
 void tb_set_jmp_target(TranslationBlock *tb, int n, uintptr_t addr)
 {
     if (TCG_TARGET_HAS_direct_jump) {
@@ -414,8 +523,10 @@ static inline TranslationBlock *tb_find(CPUState *cpu,
         tb = tb_gen_code(cpu, pc, cs_base, flags, cf_mask);
         mmap_unlock();
         /* We add the TB in the virtual pc hash table for the fast lookup */
-        qatomic_set(&cpu->tb_jmp_cache[tb_jmp_cache_hash_func(pc)], tb);
+        tb_jmp_cache_insert(cpu, pc, tb);
     }
+    /* Keep the region holding this TB from being reclaimed.  */
+    tcg_region_touch(tb->tc.ptr);
 #ifndef CONFIG_USER_ONLY
     /* We don't take care of direct jumps when address mapping changes in
      * system emulation. So it's not safe to make a direct jump to a TB
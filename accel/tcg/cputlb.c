@@ -214,12 +214,20 @@ static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
 
 static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
 {
+    int i;
+
     desc->n_used_entries = 0;
     desc->large_page_addr = -1;
     desc->large_page_mask = -1;
     desc->vindex = 0;
+    desc->lindex = 0;
     memset(fast->table, -1, sizeof_tlb(fast));
     memset(desc->vtable, -1, sizeof(desc->vtable));
+    for (i = 0; i < CPU_LTLB_SIZE; i++) {
+        /* A zero mask with a non-zero address never matches.  */
+        desc->ltable[i].addr = -1;
+        desc->ltable[i].mask = 0;
+    }
 }
 
 static void tlb_flush_one_mmuidx_locked(CPUArchState *env, int mmu_idx,
@@ -264,6 +272,9 @@ void tlb_init(CPUState *cpu)
 
     /* All tlbs are initialized flushed. */
     env_tlb(env)->c.dirty = 0;
+    env_tlb(env)->c.pending_queued = false;
+    env_tlb(env)->c.pending_full_idxmap = 0;
+    env_tlb(env)->c.n_pending = 0;
 
     for (i = 0; i < NB_MMU_MODES; i++) {
         tlb_mmu_init(&env_tlb(env)->d[i], &env_tlb(env)->f[i], now);
@@ -603,39 +614,16 @@ void tlb_flush_page(CPUState *cpu, target_ulong addr)
     tlb_flush_page_by_mmuidx(cpu, addr, ALL_MMUIDX_BITS);
 }
 
+/*
+ * The page flushes for all vCPUs go through the range code, so that
+ * tlb_queue_flush_range merges a burst of them (e.g. a guest invalidating
+ * a buffer page by page) into one work item per vCPU.
+ */
 void tlb_flush_page_by_mmuidx_all_cpus(CPUState *src_cpu, target_ulong addr,
                                        uint16_t idxmap)
 {
-    tlb_debug("addr: "TARGET_FMT_lx" mmu_idx:%"PRIx16"\n", addr, idxmap);
-
-    /* This should already be page aligned */
-    addr &= TARGET_PAGE_MASK;
-
-    /*
-     * Allocate memory to hold addr+idxmap only when needed.
-     * See tlb_flush_page_by_mmuidx for details.
-     */
-    if (idxmap < TARGET_PAGE_SIZE) {
-        flush_all_helper(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                         RUN_ON_CPU_TARGET_PTR(addr | idxmap));
-    } else {
-        CPUState *dst_cpu;
-
-        /* Allocate a separate data block for each destination cpu.  */
-        CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
-                TLBFlushPageByMMUIdxData *d
-                    = g_new(TLBFlushPageByMMUIdxData, 1);
-
-                d->addr = addr;
-                d->idxmap = idxmap;
-                async_run_on_cpu(dst_cpu, tlb_flush_page_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(d));
-            }
-        }
-    }
-
-    tlb_flush_page_by_mmuidx_async_0(src_cpu, addr, idxmap);
+    tlb_flush_range_by_mmuidx_all_cpus(src_cpu, addr, TARGET_PAGE_SIZE,
+                                       idxmap, TARGET_LONG_BITS);
 }
 
 void tlb_flush_page_all_cpus(CPUState *src, target_ulong addr)
@@ -647,41 +635,8 @@ void tlb_flush_page_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
                                               target_ulong addr,
                                               uint16_t idxmap)
 {
-    tlb_debug("addr: "TARGET_FMT_lx" mmu_idx:%"PRIx16"\n", addr, idxmap);
-
-    /* This should already be page aligned */
-    addr &= TARGET_PAGE_MASK;
-
-    /*
-     * Allocate memory to hold addr+idxmap only when needed.
-     * See tlb_flush_page_by_mmuidx for details.
-     */
-    if (idxmap < TARGET_PAGE_SIZE) {
-        flush_all_helper(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                         RUN_ON_CPU_TARGET_PTR(addr | idxmap));
-        async_safe_run_on_cpu(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                              RUN_ON_CPU_TARGET_PTR(addr | idxmap));
-    } else {
-        CPUState *dst_cpu;
-        TLBFlushPageByMMUIdxData *d;
-
-        /* Allocate a separate data block for each destination cpu.  */
-        CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
-                d = g_new(TLBFlushPageByMMUIdxData, 1);
-                d->addr = addr;
-                d->idxmap = idxmap;
-                async_run_on_cpu(dst_cpu, tlb_flush_page_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(d));
-            }
-        }
-
-        d = g_new(TLBFlushPageByMMUIdxData, 1);
-        d->addr = addr;
-        d->idxmap = idxmap;
-        async_safe_run_on_cpu(src_cpu, tlb_flush_page_by_mmuidx_async_2,
-                              RUN_ON_CPU_HOST_PTR(d));
-    }
+    tlb_flush_range_by_mmuidx_all_cpus_synced(src_cpu, addr, TARGET_PAGE_SIZE,
+                                              idxmap, TARGET_LONG_BITS);
 }
 
 void tlb_flush_page_all_cpus_synced(CPUState *src, target_ulong addr)
@@ -689,12 +644,15 @@ void tlb_flush_page_all_cpus_synced(CPUState *src, target_ulong addr)
     tlb_flush_page_by_mmuidx_all_cpus_synced(src, addr, ALL_MMUIDX_BITS);
 }
 
-static void tlb_flush_page_bits_locked(CPUArchState *env, int midx,
-                                       target_ulong page, unsigned bits)
+static void tlb_flush_range_locked(CPUArchState *env, int midx,
+                                   target_ulong addr, target_ulong len,
+                                   unsigned bits)
 {
     CPUTLBDesc *d = &env_tlb(env)->d[midx];
     CPUTLBDescFast *f = &env_tlb(env)->f[midx];
     target_ulong mask = MAKE_64BIT_MASK(0, bits);
+    target_ulong last = addr + len - 1;
+    target_ulong i;
 
     /*
      * If @bits is smaller than the tlb size, there may be multiple entries
@@ -703,17 +661,25 @@ static void tlb_flush_page_bits_locked(CPUArchState *env, int midx,
      *
      * TODO: Perhaps allow bits to be a few bits less than the size.
      * For now, just flush the entire TLB.
+     *
+     * If @len covers more pages than there are entries in the TLB,
+     * probing each page is slower than flushing everything.
      */
-    if (mask < f->mask) {
+    if (mask < f->mask || (len >> TARGET_PAGE_BITS) > tlb_n_entries(f)) {
         tlb_debug("forcing full flush midx %d ("
-                  TARGET_FMT_lx "/" TARGET_FMT_lx ")\n",
-                  midx, page, mask);
+                  TARGET_FMT_lx "/" TARGET_FMT_lx "+" TARGET_FMT_lx ")\n",
+                  midx, addr, mask, len);
         tlb_flush_one_mmuidx_locked(env, midx, get_clock_realtime());
         return;
     }
 
-    /* Check if we need to flush due to large pages.  */
-    if ((page & d->large_page_mask) == d->large_page_addr) {
+    /*
+     * Check if we need to flush due to large pages.  The region is
+     * an aligned block, so it overlaps the range iff it lies between
+     * the blocks containing the first and the last byte.
+     */
+    if ((addr & d->large_page_mask) <= d->large_page_addr &&
+        (last & d->large_page_mask) >= d->large_page_addr) {
         tlb_debug("forcing full flush midx %d ("
                   TARGET_FMT_lx "/" TARGET_FMT_lx ")\n",
                   midx, d->large_page_addr, d->large_page_mask);
@@ -721,85 +687,158 @@ static void tlb_flush_page_bits_locked(CPUArchState *env, int midx,
         return;
     }
 
-    if (tlb_flush_entry_mask_locked(tlb_entry(env, midx, page), page, mask)) {
-        tlb_n_used_entries_dec(env, midx);
+    for (i = 0; i < len; i += TARGET_PAGE_SIZE) {
+        target_ulong page = addr + i;
+
+        if (tlb_flush_entry_mask_locked(tlb_entry(env, midx, page),
+                                        page, mask)) {
+            tlb_n_used_entries_dec(env, midx);
+        }
+        tlb_flush_vtlb_page_mask_locked(env, midx, page, mask);
     }
-    tlb_flush_vtlb_page_mask_locked(env, midx, page, mask);
 }
 
-typedef struct {
-    target_ulong addr;
-    uint16_t idxmap;
-    uint16_t bits;
-} TLBFlushPageBitsByMMUIdxData;
+/*
+ * Above this many pages, clear the whole jump cache rather than
+ * probing it once per page.
+ */
+#define TB_JMP_FLUSH_RANGE_MAX_PAGES 64
 
-static void
-tlb_flush_page_bits_by_mmuidx_async_0(CPUState *cpu,
-                                      TLBFlushPageBitsByMMUIdxData d)
+static void tb_flush_range_jmp_cache(CPUState *cpu, target_ulong addr,
+                                     target_ulong len)
+{
+    target_ulong i;
+
+    if ((len >> TARGET_PAGE_BITS) > TB_JMP_FLUSH_RANGE_MAX_PAGES) {
+        cpu_tb_jmp_cache_clear(cpu);
+        return;
+    }
+    for (i = 0; i < len; i += TARGET_PAGE_SIZE) {
+        tb_flush_jmp_cache(cpu, addr + i);
+    }
+}
+
+static void tlb_flush_range_by_mmuidx_async_0(CPUState *cpu,
+                                              TLBFlushRange d)
 {
     CPUArchState *env = cpu->env_ptr;
     int mmu_idx;
 
     assert_cpu_is_self(cpu);
 
-    tlb_debug("page addr:" TARGET_FMT_lx "/%u mmu_map:0x%x\n",
-              d.addr, d.bits, d.idxmap);
+    tlb_debug("range:" TARGET_FMT_lx "/%u+" TARGET_FMT_lx " mmu_map:0x%x\n",
+              d.addr, d.bits, d.len, d.idxmap);
 
     qemu_spin_lock(&env_tlb(env)->c.lock);
     for (mmu_idx = 0; mmu_idx < NB_MMU_MODES; mmu_idx++) {
         if ((d.idxmap >> mmu_idx) & 1) {
-            tlb_flush_page_bits_locked(env, mmu_idx, d.addr, d.bits);
+            tlb_flush_range_locked(env, mmu_idx, d.addr, d.len, d.bits);
         }
     }
     qemu_spin_unlock(&env_tlb(env)->c.lock);
 
-    tb_flush_jmp_cache(cpu, d.addr);
+    tb_flush_range_jmp_cache(cpu, d.addr, d.len);
 }
 
-static bool encode_pbm_to_runon(run_on_cpu_data *out,
-                                TLBFlushPageBitsByMMUIdxData d)
+static void tlb_flush_range_by_mmuidx_async_1(CPUState *cpu,
+                                              run_on_cpu_data data)
 {
-    /* We need 6 bits to hold to hold @bits up to 63. */
-    if (d.idxmap <= MAKE_64BIT_MASK(0, TARGET_PAGE_BITS - 6)) {
-        *out = RUN_ON_CPU_TARGET_PTR(d.addr | (d.idxmap << 6) | d.bits);
-        return true;
-    }
-    return false;
+    TLBFlushRange *d = data.host_ptr;
+    tlb_flush_range_by_mmuidx_async_0(cpu, *d);
+    g_free(d);
 }
 
-static TLBFlushPageBitsByMMUIdxData
-decode_runon_to_pbm(run_on_cpu_data data)
+/*
+ * Perform the range flushes that other vCPUs have queued for @cpu
+ * with tlb_queue_flush_range, in a single work item.
+ */
+static void tlb_flush_pending_async_work(CPUState *cpu, run_on_cpu_data data)
 {
-    target_ulong addr_map_bits = (target_ulong) data.target_ptr;
-    return (TLBFlushPageBitsByMMUIdxData){
-        .addr = addr_map_bits & TARGET_PAGE_MASK,
-        .idxmap = (addr_map_bits & ~TARGET_PAGE_MASK) >> 6,
-        .bits = addr_map_bits & 0x3f
-    };
+    CPUArchState *env = cpu->env_ptr;
+    CPUTLBCommon *c = &env_tlb(env)->c;
+    TLBFlushRange pending[CPU_TLB_PENDING_FLUSHES];
+    uint16_t full;
+    unsigned int i, n;
+
+    qemu_spin_lock(&c->lock);
+    n = c->n_pending;
+    full = c->pending_full_idxmap;
+    memcpy(pending, c->pending, n * sizeof(TLBFlushRange));
+    c->n_pending = 0;
+    c->pending_full_idxmap = 0;
+    c->pending_queued = false;
+    qemu_spin_unlock(&c->lock);
+
+    if (full) {
+        tlb_flush_by_mmuidx_async_work(cpu, RUN_ON_CPU_HOST_INT(full));
+    }
+    for (i = 0; i < n; i++) {
+        pending[i].idxmap &= ~full;
+        if (pending[i].idxmap) {
+            tlb_flush_range_by_mmuidx_async_0(cpu, pending[i]);
+        }
+    }
 }
 
-static void tlb_flush_page_bits_by_mmuidx_async_1(CPUState *cpu,
-                                                  run_on_cpu_data runon)
+/*
+ * Queue a range flush on another vCPU.  Flushes that arrive before
+ * the destination has run the previous ones are merged into the same
+ * work item; when there are too many distinct ranges, the affected
+ * mmu indexes are flushed completely instead.
+ */
+static void tlb_queue_flush_range(CPUState *cpu, TLBFlushRange d)
 {
-    tlb_flush_page_bits_by_mmuidx_async_0(cpu, decode_runon_to_pbm(runon));
-}
+    CPUArchState *env = cpu->env_ptr;
+    CPUTLBCommon *c = &env_tlb(env)->c;
+    bool queue;
+    unsigned int i;
 
-static void tlb_flush_page_bits_by_mmuidx_async_2(CPUState *cpu,
-                                                  run_on_cpu_data data)
-{
-    TLBFlushPageBitsByMMUIdxData *d = data.host_ptr;
-    tlb_flush_page_bits_by_mmuidx_async_0(cpu, *d);
-    g_free(d);
+    qemu_spin_lock(&c->lock);
+    queue = !c->pending_queued;
+    c->pending_queued = true;
+
+    d.idxmap &= ~c->pending_full_idxmap;
+    if (d.idxmap == 0) {
+        goto done;
+    }
+    for (i = 0; i < c->n_pending; i++) {
+        TLBFlushRange *p = &c->pending[i];
+
+        /* Merge with an overlapping or adjacent range.  */
+        if (p->idxmap == d.idxmap && p->bits == d.bits &&
+            d.addr <= p->addr + p->len && p->addr <= d.addr + d.len) {
+            target_ulong end = MAX(p->addr + p->len, d.addr + d.len);
+
+            p->addr = MIN(p->addr, d.addr);
+            p->len = end - p->addr;
+            goto done;
+        }
+    }
+    if (c->n_pending < CPU_TLB_PENDING_FLUSHES) {
+        c->pending[c->n_pending++] = d;
+    } else {
+        c->pending_full_idxmap |= d.idxmap;
+    }
+
+ done:
+    qemu_spin_unlock(&c->lock);
+
+    if (queue) {
+        async_run_on_cpu(cpu, tlb_flush_pending_async_work, RUN_ON_CPU_NULL);
+    }
 }
 
-void tlb_flush_page_bits_by_mmuidx(CPUState *cpu, target_ulong addr,
-                                   uint16_t idxmap, unsigned bits)
+void tlb_flush_range_by_mmuidx(CPUState *cpu, target_ulong addr,
+                               target_ulong len, uint16_t idxmap,
+                               unsigned bits)
 {
-    TLBFlushPageBitsByMMUIdxData d;
-    run_on_cpu_data runon;
+    TLBFlushRange d;
 
-    /* If all bits are significant, this devolves to tlb_flush_page. */
-    if (bits >= TARGET_LONG_BITS) {
+    /*
+     * If all bits are significant, and len is small,
+     * this devolves to tlb_flush_page.
+     */
+    if (bits >= TARGET_LONG_BITS && len <= TARGET_PAGE_SIZE) {
         tlb_flush_page_by_mmuidx(cpu, addr, idxmap);
         return;
     }
@@ -811,37 +850,32 @@ void tlb_flush_page_bits_by_mmuidx(CPUState *cpu, target_ulong addr,
 
     /* This should already be page aligned */
     d.addr = addr & TARGET_PAGE_MASK;
+    d.len = len;
     d.idxmap = idxmap;
     d.bits = bits;
 
     if (qemu_cpu_is_self(cpu)) {
-        tlb_flush_page_bits_by_mmuidx_async_0(cpu, d);
-    } else if (encode_pbm_to_runon(&runon, d)) {
-        async_run_on_cpu(cpu, tlb_flush_page_bits_by_mmuidx_async_1, runon);
+        tlb_flush_range_by_mmuidx_async_0(cpu, d);
     } else {
-        TLBFlushPageBitsByMMUIdxData *p
-            = g_new(TLBFlushPageBitsByMMUIdxData, 1);
-
-        /* Otherwise allocate a structure, freed by the worker.  */
-        *p = d;
-        async_run_on_cpu(cpu, tlb_flush_page_bits_by_mmuidx_async_2,
-                         RUN_ON_CPU_HOST_PTR(p));
+        tlb_queue_flush_range(cpu, d);
     }
 }
 
-void tlb_flush_page_bits_by_mmuidx_all_cpus(CPUState *src_cpu,
-                                            target_ulong addr,
-                                            uint16_t idxmap,
-                                            unsigned bits)
+void tlb_flush_page_bits_by_mmuidx(CPUState *cpu, target_ulong addr,
+                                   uint16_t idxmap, unsigned bits)
 {
-    TLBFlushPageBitsByMMUIdxData d;
-    run_on_cpu_data runon;
+    tlb_flush_range_by_mmuidx(cpu, addr, TARGET_PAGE_SIZE, idxmap, bits);
+}
+
+void tlb_flush_range_by_mmuidx_all_cpus(CPUState *src_cpu,
+                                        target_ulong addr,
+                                        target_ulong len,
+                                        uint16_t idxmap,
+                                        unsigned bits)
+{
+    TLBFlushRange d;
+    CPUState *dst_cpu;
 
-    /* If all bits are significant, this devolves to tlb_flush_page. */
-    if (bits >= TARGET_LONG_BITS) {
-        tlb_flush_page_by_mmuidx_all_cpus(src_cpu, addr, idxmap);
-        return;
-    }
     /* If no page bits are significant, this devolves to tlb_flush. */
     if (bits < TARGET_PAGE_BITS) {
         tlb_flush_by_mmuidx_all_cpus(src_cpu, idxmap);
@@ -850,43 +884,36 @@ void tlb_flush_page_bits_by_mmuidx_all_cpus(CPUState *src_cpu,
 
     /* This should already be page aligned */
     d.addr = addr & TARGET_PAGE_MASK;
+    d.len = len;
     d.idxmap = idxmap;
     d.bits = bits;
 
-    if (encode_pbm_to_runon(&runon, d)) {
-        flush_all_helper(src_cpu, tlb_flush_page_bits_by_mmuidx_async_1, runon);
-    } else {
-        CPUState *dst_cpu;
-        TLBFlushPageBitsByMMUIdxData *p;
-
-        /* Allocate a separate data block for each destination cpu.  */
-        CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
-                p = g_new(TLBFlushPageBitsByMMUIdxData, 1);
-                *p = d;
-                async_run_on_cpu(dst_cpu,
-                                 tlb_flush_page_bits_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(p));
-            }
+    CPU_FOREACH(dst_cpu) {
+        if (dst_cpu != src_cpu) {
+            tlb_queue_flush_range(dst_cpu, d);
         }
     }
 
-    tlb_flush_page_bits_by_mmuidx_async_0(src_cpu, d);
+    tlb_flush_range_by_mmuidx_async_0(src_cpu, d);
 }
 
-void tlb_flush_page_bits_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
-                                                   target_ulong addr,
-                                                   uint16_t idxmap,
-                                                   unsigned bits)
+void tlb_flush_page_bits_by_mmuidx_all_cpus(CPUState *src_cpu,
+                                            target_ulong addr,
+                                            uint16_t idxmap, unsigned bits)
 {
-    TLBFlushPageBitsByMMUIdxData d;
-    run_on_cpu_data runon;
+    tlb_flush_range_by_mmuidx_all_cpus(src_cpu, addr, TARGET_PAGE_SIZE,
+                                       idxmap, bits);
+}
+
+void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
+                                               target_ulong addr,
+                                               target_ulong len,
+                                               uint16_t idxmap,
+                                               unsigned bits)
+{
+    TLBFlushRange d, *p;
+    CPUState *dst_cpu;
 
-    /* If all bits are significant, this devolves to tlb_flush_page. */
-    if (bits >= TARGET_LONG_BITS) {
-        tlb_flush_page_by_mmuidx_all_cpus_synced(src_cpu, addr, idxmap);
-        return;
-    }
     /* If no page bits are significant, this devolves to tlb_flush. */
     if (bits < TARGET_PAGE_BITS) {
         tlb_flush_by_mmuidx_all_cpus_synced(src_cpu, idxmap);
@@ -895,32 +922,29 @@ void tlb_flush_page_bits_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
 
     /* This should already be page aligned */
     d.addr = addr & TARGET_PAGE_MASK;
+    d.len = len;
     d.idxmap = idxmap;
     d.bits = bits;
 
-    if (encode_pbm_to_runon(&runon, d)) {
-        flush_all_helper(src_cpu, tlb_flush_page_bits_by_mmuidx_async_1, runon);
-        async_safe_run_on_cpu(src_cpu, tlb_flush_page_bits_by_mmuidx_async_1,
-                              runon);
-    } else {
-        CPUState *dst_cpu;
-        TLBFlushPageBitsByMMUIdxData *p;
-
-        /* Allocate a separate data block for each destination cpu.  */
-        CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
-                p = g_new(TLBFlushPageBitsByMMUIdxData, 1);
-                *p = d;
-                async_run_on_cpu(dst_cpu, tlb_flush_page_bits_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(p));
-            }
+    CPU_FOREACH(dst_cpu) {
+        if (dst_cpu != src_cpu) {
+            tlb_queue_flush_range(dst_cpu, d);
         }
-
-        p = g_new(TLBFlushPageBitsByMMUIdxData, 1);
-        *p = d;
-        async_safe_run_on_cpu(src_cpu, tlb_flush_page_bits_by_mmuidx_async_2,
-                              RUN_ON_CPU_HOST_PTR(p));
     }
+
+    p = g_new(TLBFlushRange, 1);
+    *p = d;
+    async_safe_run_on_cpu(src_cpu, tlb_flush_range_by_mmuidx_async_1,
+                          RUN_ON_CPU_HOST_PTR(p));
+}
+
+void tlb_flush_page_bits_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
+                                                   target_ulong addr,
+                                                   uint16_t idxmap,
+                                                   unsigned bits)
+{
+    tlb_flush_range_by_mmuidx_all_cpus_synced(src_cpu, addr, TARGET_PAGE_SIZE,
+                                              idxmap, bits);
 }
 
 /* update the TLBs so that writes to code in the virtual page 'addr'
@@ -1071,16 +1095,50 @@ static void tlb_add_large_page(CPUArchState *env, int mmu_idx,
     env_tlb(env)->d[mmu_idx].large_page_mask = lp_mask;
 }
 
+/* Remember the translation of a large page, so that its other pages
+   can be entered into the TLB without calling tlb_fill.  Entries are
+   dropped by any flush of the mmu_idx; a flush of a single page within
+   the large page region already turns into one.  */
+static void tlb_add_large_entry(CPUArchState *env, int mmu_idx,
+                                target_ulong vaddr, hwaddr paddr,
+                                MemTxAttrs attrs, int prot,
+                                target_ulong size)
+{
+    CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
+    target_ulong mask = ~(size - 1);
+    CPUTLBLargeEntry *le = NULL;
+    size_t i;
+
+    for (i = 0; i < CPU_LTLB_SIZE; i++) {
+        if (desc->ltable[i].addr == (vaddr & mask) &&
+            desc->ltable[i].mask == mask) {
+            le = &desc->ltable[i];
+            break;
+        }
+    }
+    if (le == NULL) {
+        le = &desc->ltable[desc->lindex++ % CPU_LTLB_SIZE];
+    }
+
+    le->addr = vaddr & mask;
+    le->mask = mask;
+    le->paddr_ofs = (paddr & TARGET_PAGE_MASK) - (vaddr & TARGET_PAGE_MASK);
+    le->attrs = attrs;
+    le->prot = prot;
+}
+
 /* Add a new TLB entry. At most one entry for a given virtual address
  * is permitted. Only a single TARGET_PAGE_SIZE region is mapped, the
- * supplied size is only used by tlb_flush_page.
+ * supplied size is used by tlb_flush_page and, if LINEAR, to map the
+ * other pages of a large page on demand.
  *
  * Called from TCG-generated code, which is under an RCU read-side
  * critical section.
  */
-void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
-                             hwaddr paddr, MemTxAttrs attrs, int prot,
-                             int mmu_idx, target_ulong size)
+static void tlb_set_page_internal(CPUState *cpu, target_ulong vaddr,
+                                  hwaddr paddr, MemTxAttrs attrs, int prot,
+                                  int mmu_idx, target_ulong size,
+                                  bool linear)
 {
     CPUArchState *env = cpu->env_ptr;
     CPUTLB *tlb = env_tlb(env);
@@ -1103,6 +1161,9 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
         sz = TARGET_PAGE_SIZE;
     } else {
         tlb_add_large_page(env, mmu_idx, vaddr, size);
+        if (linear) {
+            tlb_add_large_entry(env, mmu_idx, vaddr, paddr, attrs, prot, size);
+        }
         sz = size;
     }
     vaddr_page = vaddr & TARGET_PAGE_MASK;
@@ -1251,6 +1312,22 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
 /* Add a new TLB entry, but without specifying the memory
  * transaction attributes to be used.
  */
+void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
+                             hwaddr paddr, MemTxAttrs attrs, int prot,
+                             int mmu_idx, target_ulong size)
+{
+    tlb_set_page_internal(cpu, vaddr, paddr, attrs, prot, mmu_idx, size,
+                          false);
+}
+
+void tlb_set_page_linear(CPUState *cpu, target_ulong vaddr,
+                         hwaddr paddr, MemTxAttrs attrs, int prot,
+                         int mmu_idx, target_ulong size)
+{
+    tlb_set_page_internal(cpu, vaddr, paddr, attrs, prot, mmu_idx, size,
+                          true);
+}
+
 void tlb_set_page(CPUState *cpu, target_ulong vaddr,
                   hwaddr paddr, int prot,
                   int mmu_idx, target_ulong size)
@@ -1271,6 +1348,55 @@ static inline ram_addr_t qemu_ram_addr_from_host_nofail(void *ptr)
     return ram_addr;
 }
 
+/*
+ * Refill the TLB entry for ADDR from a large page previously installed
+ * by tlb_set_page_linear, without asking the target to walk its page tables again.
+ * Return false if there is no such page, or if it does not permit
+ * ACCESS_TYPE, in which case the target must be consulted.
+ */
+static bool large_tlb_hit(CPUState *cpu, target_ulong addr,
+                          MMUAccessType access_type, int mmu_idx)
+{
+    CPUArchState *env = cpu->env_ptr;
+    CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
+    size_t i;
+
+    for (i = 0; i < CPU_LTLB_SIZE; i++) {
+        CPUTLBLargeEntry *le = &desc->ltable[i];
+        target_ulong page;
+
+        if ((addr & le->mask) != le->addr) {
+            continue;
+        }
+        switch (access_type) {
+        case MMU_DATA_LOAD:
+            if (!(le->prot & PAGE_READ)) {
+                return false;
+            }
+            break;
+        case MMU_DATA_STORE:
+            /* PAGE_WRITE_INV asks for tlb_fill on every write.  */
+            if ((le->prot & (PAGE_WRITE | PAGE_WRITE_INV)) != PAGE_WRITE) {
+                return false;
+            }
+            break;
+        case MMU_INST_FETCH:
+            if (!(le->prot & PAGE_EXEC)) {
+                return false;
+            }
+            break;
+        default:
+            g_assert_not_reached();
+        }
+
+        page = addr & TARGET_PAGE_MASK;
+        tlb_set_page_internal(cpu, page, le->paddr_ofs + page, le->attrs,
+                              le->prot, mmu_idx, -le->mask, false);
+        return true;
+    }
+    return false;
+}
+
 /*
  * Note: tlb_fill() can trigger a resize of the TLB. This means that all of the
  * caller's prior references to the TLB table (e.g. CPUTLBEntry pointers) must
@@ -1282,6 +1408,10 @@ static void tlb_fill(CPUState *cpu, target_ulong addr, int size,
     CPUClass *cc = CPU_GET_CLASS(cpu);
     bool ok;
 
+    if (large_tlb_hit(cpu, addr, access_type, mmu_idx)) {
+        return;
+    }
+
     /*
      * This is not a probe, so only valid return is success; failure
      * should result in exception + longjmp to the cpu loop.
@@ -1557,7 +1687,8 @@ static int probe_access_internal(CPUArchState *env, target_ulong addr,
             CPUState *cs = env_cpu(env);
             CPUClass *cc = CPU_GET_CLASS(cs);
 
-            if (!cc->tlb_fill(cs, addr, fault_size, access_type,
+            if (!large_tlb_hit(cs, addr, access_type, mmu_idx) &&
+                !cc->tlb_fill(cs, addr, fault_size, access_type,
                               mmu_idx, nonfault, retaddr)) {
                 /* Non-faulting page table read failed.  */
                 *phost = NULL;
@@ -1809,6 +1940,60 @@ load_memop(const void *haddr, MemOp op)
     }
 }
 
+/*
+ * For a load of @size bytes at @addr that spans two pages, the first of
+ * which is RAM already present in the TLB: make sure the second page is
+ * in the TLB too and, if it is plain RAM as well, copy all the bytes
+ * into @buf and return true.  Otherwise return false, and the caller
+ * falls back to combining two aligned loads through the full helper.
+ */
+static bool __attribute__((noinline))
+load_helper_split(CPUArchState *env, target_ulong addr, uintptr_t mmu_idx,
+                  uintptr_t retaddr, size_t size, bool code_read,
+                  uint8_t *buf)
+{
+    const size_t tlb_off = code_read ?
+        offsetof(CPUTLBEntry, addr_code) : offsetof(CPUTLBEntry, addr_read);
+    const MMUAccessType access_type =
+        code_read ? MMU_INST_FETCH : MMU_DATA_LOAD;
+    uintptr_t index2;
+    CPUTLBEntry *entry, *entry2;
+    target_ulong page2, tlb_addr2;
+    size_t size2;
+
+    /*
+     * Ensure the second page is in the TLB.  As for stores, the second
+     * page cannot evict the first.
+     */
+    page2 = (addr + size) & TARGET_PAGE_MASK;
+    size2 = (addr + size) & ~TARGET_PAGE_MASK;
+    index2 = tlb_index(env, mmu_idx, page2);
+    entry2 = tlb_entry(env, mmu_idx, page2);
+
+    tlb_addr2 = code_read ? entry2->addr_code : entry2->addr_read;
+    if (!tlb_hit_page(tlb_addr2, page2)) {
+        if (!victim_tlb_hit(env, mmu_idx, index2, tlb_off, page2)) {
+            tlb_fill(env_cpu(env), page2, size2, access_type,
+                     mmu_idx, retaddr);
+            index2 = tlb_index(env, mmu_idx, page2);
+            entry2 = tlb_entry(env, mmu_idx, page2);
+        }
+        tlb_addr2 = code_read ? entry2->addr_code : entry2->addr_read;
+        tlb_addr2 &= ~TLB_INVALID_MASK;
+    }
+
+    /* Watchpoints, I/O, byte swapping: leave them to the full helper.  */
+    if (unlikely(tlb_addr2 & ~TARGET_PAGE_MASK)) {
+        return false;
+    }
+
+    entry = tlb_entry(env, mmu_idx, addr);
+    memcpy(buf, (void *)((uintptr_t)addr + entry->addend), size - size2);
+    memcpy(buf + size - size2, (void *)((uintptr_t)page2 + entry2->addend),
+           size2);
+    return true;
+}
+
 static inline uint64_t QEMU_ALWAYS_INLINE
 load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
             uintptr_t retaddr, MemOp op, bool code_read,
@@ -1892,7 +2077,14 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
                     >= TARGET_PAGE_SIZE)) {
         target_ulong addr1, addr2;
         uint64_t r1, r2;
+        uint8_t buf[8];
         unsigned shift;
+
+        /* Both pages plain RAM: read the bytes directly.  */
+        if (likely(load_helper_split(env, addr, mmu_idx, retaddr, size,
+                                     code_read, buf))) {
+            return load_memop(buf, op);
+        }
     do_unaligned_access:
         addr1 = addr & ~((target_ulong)size - 1);
         addr2 = addr1 + size;
@@ -2319,6 +2511,25 @@ store_helper_unaligned(CPUArchState *env, target_ulong addr, uint64_t val,
                              BP_MEM_WRITE, retaddr);
     }
 
+    /*
+     * If both pages are plain RAM, store the two parts directly.
+     * Any flag on either page, including TLB_NOTDIRTY for pages
+     * holding translated code, takes the byte-by-byte path below.
+     */
+    if (likely(!((tlb_addr | tlb_addr2) & ~TARGET_PAGE_MASK))) {
+        uint8_t buf[8];
+
+        if (big_endian) {
+            stn_be_p(buf, size, val);
+        } else {
+            stn_le_p(buf, size, val);
+        }
+        memcpy((void *)((uintptr_t)addr + entry->addend), buf, size - size2);
+        memcpy((void *)((uintptr_t)page2 + entry2->addend),
+               buf + size - size2, size2);
+        return;
+    }
+
     /*
      * XXX: not efficient, but simple.
      * This loop must go in the forward direction to avoid issues
@@ -2647,7 +2858,7 @@ void cpu_stq_le_data(CPUArchState *env, target_ulong ptr, uint64_t val)
 #include "atomic_template.h"
 #endif
 
-#if HAVE_CMPXCHG128 || HAVE_ATOMIC128
+#if MAYBE_CMPXCHG128 || MAYBE_ATOMIC128
 #define DATA_SIZE 16
 #include "atomic_template.h"
 #endif
@@ -0,0 +1,520 @@
+/*
+ * Profiling support for TCG generated code
+ *
+ * Without help, host profilers only see code_gen_buffer as one anonymous
+ * mapping.  This file can describe each translation block to perf, either
+ * as a perf map or as a jitdump, and also implements a small sampling
+ * profiler that attributes samples to guest code by itself.
+ *
+ * Copyright (c) 2021 The QEMU Project Developers
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "qemu/thread.h"
+#include "cpu.h"
+#include "disas/disas.h"
+#include "exec/exec-all.h"
+#include "exec/perf.h"
+#include "tcg/tcg.h"
+#include "elf.h"
+
+#ifdef CONFIG_LINUX
+#include <sys/mman.h>
+#include <ucontext.h>
+
+static QemuMutex perf_lock;
+static bool perf_initialized;
+static FILE *perfmap;
+static FILE *jitdump;
+static void *jitdump_marker;
+static uint64_t jitdump_index;
+
+/* jitdump file format, see tools/perf/Documentation/jitdump-specification */
+#define JITDUMP_MAGIC   0x4A695444
+#define JITDUMP_VERSION 1
+#define JIT_CODE_LOAD   0
+
+struct jitheader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+};
+
+struct jr_prefix {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+};
+
+struct jr_code_load {
+    struct jr_prefix p;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+};
+
+#if defined(__x86_64__)
+# define PERF_ELF_MACH EM_X86_64
+#elif defined(__i386__)
+# define PERF_ELF_MACH EM_386
+#elif defined(__aarch64__)
+# define PERF_ELF_MACH EM_AARCH64
+#elif defined(__arm__)
+# define PERF_ELF_MACH EM_ARM
+#elif defined(__powerpc64__)
+# define PERF_ELF_MACH EM_PPC64
+#elif defined(__s390x__)
+# define PERF_ELF_MACH EM_S390
+#elif defined(__riscv)
+# define PERF_ELF_MACH EM_RISCV
+#elif defined(__mips__)
+# define PERF_ELF_MACH EM_MIPS
+#elif defined(__sparc__)
+# define PERF_ELF_MACH EM_SPARCV9
+#else
+# define PERF_ELF_MACH 0
+#endif
+
+/* perf expects CLOCK_MONOTONIC timestamps ("perf record -k 1") */
+static uint64_t perf_timestamp(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void perf_init(void)
+{
+    if (!perf_initialized) {
+        qemu_mutex_init(&perf_lock);
+        atexit(perf_exit);
+        perf_initialized = true;
+    }
+}
+
+bool perf_enable_perfmap(Error **errp)
+{
+    g_autofree char *name = g_strdup_printf("/tmp/perf-%d.map", getpid());
+
+    perf_init();
+    perfmap = fopen(name, "w");
+    if (!perfmap) {
+        error_setg_errno(errp, errno, "Could not open %s", name);
+        return false;
+    }
+    return true;
+}
+
+bool perf_enable_jitdump(Error **errp)
+{
+    g_autofree char *name = g_strdup_printf("%s/jit-%d.dump",
+                                            g_get_tmp_dir(), getpid());
+    struct jitheader header = {
+        .magic = JITDUMP_MAGIC,
+        .version = JITDUMP_VERSION,
+        .total_size = sizeof(header),
+        .elf_mach = PERF_ELF_MACH,
+        .pid = getpid(),
+        .timestamp = perf_timestamp(),
+    };
+    int fd;
+
+    perf_init();
+    fd = open(name, O_CREAT | O_TRUNC | O_RDWR, 0666);
+    if (fd < 0) {
+        error_setg_errno(errp, errno, "Could not open %s", name);
+        return false;
+    }
+
+    /*
+     * perf finds the dump through an executable mapping of the file,
+     * which it sees as an mmap event while recording.
+     */
+    jitdump_marker = mmap(NULL, qemu_real_host_page_size,
+                          PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+    if (jitdump_marker == MAP_FAILED) {
+        error_setg_errno(errp, errno, "Could not map %s", name);
+        jitdump_marker = NULL;
+        close(fd);
+        return false;
+    }
+
+    jitdump = fdopen(fd, "w+");
+    if (!jitdump) {
+        error_setg_errno(errp, errno, "Could not open %s", name);
+        munmap(jitdump_marker, qemu_real_host_page_size);
+        jitdump_marker = NULL;
+        close(fd);
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, jitdump);
+    return true;
+}
+
+static void perf_tb_name(char *buf, size_t len, const TranslationBlock *tb)
+{
+    const char *sym = lookup_symbol(tb->pc);
+
+    if (sym[0]) {
+        snprintf(buf, len, "%s [guest 0x" TARGET_FMT_lx "]", sym, tb->pc);
+    } else {
+        snprintf(buf, len, "guest 0x" TARGET_FMT_lx, tb->pc);
+    }
+}
+
+void perf_report_code(const TranslationBlock *tb)
+{
+    char name[256];
+
+    if (likely(!perfmap && !jitdump)) {
+        return;
+    }
+
+    perf_tb_name(name, sizeof(name), tb);
+
+    qemu_mutex_lock(&perf_lock);
+    if (perfmap) {
+        fprintf(perfmap, "%" PRIxPTR " %zx %s\n",
+                (uintptr_t)tb->tc.ptr, tb->tc.size, name);
+    }
+    if (jitdump) {
+        struct jr_code_load rec = {
+            .p.id = JIT_CODE_LOAD,
+            .p.total_size = sizeof(rec) + strlen(name) + 1 + tb->tc.size,
+            .p.timestamp = perf_timestamp(),
+            .pid = getpid(),
+            .tid = qemu_get_thread_id(),
+            .vma = (uintptr_t)tb->tc.ptr,
+            .code_addr = (uintptr_t)tb->tc.ptr,
+            .code_size = tb->tc.size,
+            .code_index = jitdump_index++,
+        };
+
+        fwrite(&rec, sizeof(rec), 1, jitdump);
+        fwrite(name, strlen(name) + 1, 1, jitdump);
+        fwrite(tb->tc.ptr, tb->tc.size, 1, jitdump);
+    }
+    qemu_mutex_unlock(&perf_lock);
+}
+
+/*
+ * Sampling profiler
+ *
+ * The signal handler only records the interrupted host PC: looking up
+ * the TB takes locks, so it is deferred to perf_profile_fold().  Host
+ * PCs are counted in a fixed-size open-addressing table that is filled
+ * lock-free; samples that find no free slot are counted as lost.
+ */
+#define PROF_HZ         1000
+#define PROF_TABLE_BITS 16
+#define PROF_TABLE_SIZE (1 << PROF_TABLE_BITS)
+#define PROF_MAX_PROBE  16
+
+typedef struct ProfSlot {
+    uintptr_t pc;
+    unsigned long count;
+} ProfSlot;
+
+typedef struct ProfEntry {
+    uint64_t pc;    /* guest PC of the TB, also the hash table key */
+    uint64_t count;
+} ProfEntry;
+
+static ProfSlot *prof_table;
+static uintptr_t prof_code_start;
+static size_t prof_code_size;
+static unsigned long prof_outside;
+static unsigned long prof_lost;
+static uint64_t prof_unknown;
+static GHashTable *prof_entries;
+static char *prof_filename;
+static timer_t prof_timer;
+
+#if defined(__x86_64__)
+# define PROF_SIGNAL_PC(uc) ((uc)->uc_mcontext.gregs[REG_RIP])
+#elif defined(__i386__)
+# define PROF_SIGNAL_PC(uc) ((uc)->uc_mcontext.gregs[REG_EIP])
+#elif defined(__aarch64__)
+# define PROF_SIGNAL_PC(uc) ((uc)->uc_mcontext.pc)
+#endif
+
+#ifdef PROF_SIGNAL_PC
+static void prof_signal(int sig, siginfo_t *info, void *puc)
+{
+    ucontext_t *uc = puc;
+    uintptr_t pc = PROF_SIGNAL_PC(uc);
+    size_t size = qatomic_load_acquire(&prof_code_size);
+    uint32_t h;
+    unsigned i;
+
+    /*
+     * tcg_init_ctx.code_gen_buffer only describes the current region,
+     * and is rewritten when moving to the next one; use the bounds of
+     * the whole buffer, which never change once set.
+     */
+    if (pc - qatomic_read(&prof_code_start) >= size) {
+        qatomic_inc(&prof_outside);
+        return;
+    }
+
+    h = ((uint32_t)pc * 0x9e3779b1u) >> (32 - PROF_TABLE_BITS);
+    for (i = 0; i < PROF_MAX_PROBE; i++) {
+        ProfSlot *slot = &prof_table[(h + i) & (PROF_TABLE_SIZE - 1)];
+        uintptr_t old = qatomic_read(&slot->pc);
+
+        if (old == 0) {
+            old = qatomic_cmpxchg(&slot->pc, 0, pc);
+            if (old == 0) {
+                old = pc;
+            }
+        }
+        if (old == pc) {
+            qatomic_inc(&slot->count);
+            return;
+        }
+    }
+    qatomic_inc(&prof_lost);
+}
+#endif
+
+void perf_set_code_gen_buffer(const void *buf, size_t size)
+{
+    qatomic_set(&prof_code_start, (uintptr_t)buf);
+    qatomic_store_release(&prof_code_size, size);
+}
+
+bool perf_enable_profile(const char *filename, int sig, Error **errp)
+{
+#ifdef PROF_SIGNAL_PC
+    struct sigaction act;
+    struct sigevent sev = {
+        .sigev_notify = SIGEV_SIGNAL,
+        .sigev_signo = sig,
+    };
+    struct itimerspec it = {
+        .it_interval.tv_nsec = 1000000000 / PROF_HZ,
+        .it_value.tv_nsec = 1000000000 / PROF_HZ,
+    };
+
+    perf_init();
+    prof_table = g_new0(ProfSlot, PROF_TABLE_SIZE);
+    prof_entries = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                         NULL, g_free);
+    prof_filename = g_strdup(filename);
+
+    memset(&act, 0, sizeof(act));
+    act.sa_sigaction = prof_signal;
+    act.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&act.sa_mask);
+    if (sigaction(sig, &act, NULL) < 0 ||
+        timer_create(CLOCK_PROCESS_CPUTIME_ID, &sev, &prof_timer) < 0) {
+        error_setg_errno(errp, errno, "Could not start the TCG profiler");
+        g_free(prof_table);
+        prof_table = NULL;
+        return false;
+    }
+    if (timer_settime(prof_timer, 0, &it, NULL) < 0) {
+        error_setg_errno(errp, errno, "Could not start the TCG profiler");
+        timer_delete(prof_timer);
+        g_free(prof_table);
+        prof_table = NULL;
+        return false;
+    }
+    return true;
+#else
+    error_setg(errp, "The TCG profiler is not supported on this host");
+    return false;
+#endif
+}
+
+void perf_profile_fold(void)
+{
+    unsigned i;
+
+    if (!prof_table) {
+        return;
+    }
+
+    qemu_mutex_lock(&perf_lock);
+    for (i = 0; i < PROF_TABLE_SIZE; i++) {
+        ProfSlot *slot = &prof_table[i];
+        uintptr_t pc = qatomic_read(&slot->pc);
+        unsigned long count;
+        TranslationBlock *tb;
+        ProfEntry *e;
+        uint64_t key;
+
+        if (pc == 0) {
+            continue;
+        }
+        count = qatomic_xchg(&slot->count, 0);
+        if (count == 0) {
+            continue;
+        }
+
+        /* The prologue, epilogue and stubs do not belong to a TB.  */
+        tb = tcg_tb_lookup(pc);
+        if (tb == NULL) {
+            prof_unknown += count;
+            continue;
+        }
+
+        key = tb->pc;
+        e = g_hash_table_lookup(prof_entries, &key);
+        if (e == NULL) {
+            e = g_new0(ProfEntry, 1);
+            e->pc = tb->pc;
+            g_hash_table_insert(prof_entries, &e->pc, e);
+        }
+        e->count += count;
+    }
+
+    /*
+     * Folding happens before generated code is freed; once it is, the
+     * recorded host PCs may be reused by other TBs, so start afresh.
+     * Only code in the buffer is sampled, and no vCPU runs any while
+     * we are in an exclusive section.  At exit the timer is already
+     * stopped, so at worst a sample in flight is dropped.
+     */
+    memset(prof_table, 0, sizeof(ProfSlot) * PROF_TABLE_SIZE);
+    qemu_mutex_unlock(&perf_lock);
+}
+
+static gint prof_entry_cmp(gconstpointer a, gconstpointer b)
+{
+    const ProfEntry *ea = *(const ProfEntry **)a;
+    const ProfEntry *eb = *(const ProfEntry **)b;
+
+    return ea->count < eb->count ? 1 : ea->count > eb->count ? -1 : 0;
+}
+
+static void prof_add_entry(gpointer key, gpointer value, gpointer opaque)
+{
+    g_ptr_array_add(opaque, value);
+}
+
+static void perf_profile_dump(void)
+{
+    uint64_t in_code, total;
+    GPtrArray *sorted;
+    FILE *f;
+    guint i;
+
+    timer_delete(prof_timer);
+    perf_profile_fold();
+
+    sorted = g_ptr_array_new();
+    g_hash_table_foreach(prof_entries, prof_add_entry, sorted);
+    g_ptr_array_sort(sorted, prof_entry_cmp);
+
+    in_code = prof_unknown;
+    for (i = 0; i < sorted->len; i++) {
+        in_code += ((ProfEntry *)g_ptr_array_index(sorted, i))->count;
+    }
+    total = in_code + prof_outside + prof_lost;
+
+    if (strcmp(prof_filename, "-") == 0) {
+        f = stderr;
+    } else {
+        f = fopen(prof_filename, "w");
+        if (!f) {
+            fprintf(stderr, "qemu: could not write TCG profile to %s: %s\n",
+                    prof_filename, strerror(errno));
+            g_ptr_array_free(sorted, true);
+            return;
+        }
+    }
+
+    fprintf(f, "TCG profile: %" PRIu64 " samples at %d Hz\n", total, PROF_HZ);
+    fprintf(f, "  in generated code:     %" PRIu64 "\n", in_code);
+    fprintf(f, "  outside generated code: %lu\n", prof_outside);
+    fprintf(f, "  not in a TB:           %" PRIu64 "\n", prof_unknown);
+    fprintf(f, "  lost:                  %lu\n\n", prof_lost);
+    fprintf(f, "%8s %7s %18s  %s\n", "samples", "%", "guest pc", "symbol");
+    for (i = 0; i < sorted->len; i++) {
+        ProfEntry *e = g_ptr_array_index(sorted, i);
+
+        fprintf(f, "%8" PRIu64 " %6.2f%% %#18" PRIx64 "  %s\n",
+                e->count, total ? 100.0 * e->count / total : 0.0,
+                e->pc, lookup_symbol(e->pc));
+    }
+
+    if (f != stderr) {
+        fclose(f);
+    }
+    g_ptr_array_free(sorted, true);
+}
+
+void perf_exit(void)
+{
+    if (!perf_initialized) {
+        return;
+    }
+    if (prof_table) {
+        perf_profile_dump();
+        g_free(prof_table);
+        prof_table = NULL;
+    }
+
+    qemu_mutex_lock(&perf_lock);
+    if (perfmap) {
+        fclose(perfmap);
+        perfmap = NULL;
+    }
+    if (jitdump) {
+        munmap(jitdump_marker, qemu_real_host_page_size);
+        fclose(jitdump);
+        jitdump = NULL;
+    }
+    qemu_mutex_unlock(&perf_lock);
+}
+
+#else /* !CONFIG_LINUX */
+
+bool perf_enable_perfmap(Error **errp)
+{
+    error_setg(errp, "perf map support is only available on Linux hosts");
+    return false;
+}
+
+bool perf_enable_jitdump(Error **errp)
+{
+    error_setg(errp, "jitdump support is only available on Linux hosts");
+    return false;
+}
+
+bool perf_enable_profile(const char *filename, int sig, Error **errp)
+{
+    error_setg(errp, "The TCG profiler is only available on Linux hosts");
+    return false;
+}
+
+void perf_set_code_gen_buffer(const void *buf, size_t size)
+{
+}
+
+void perf_report_code(const TranslationBlock *tb)
+{
+}
+
+void perf_profile_fold(void)
+{
+}
+
+void perf_exit(void)
+{
+}
+
+#endif /* CONFIG_LINUX */
@@ -75,6 +75,8 @@ enum plugin_gen_from {
 enum plugin_gen_cb {
     PLUGIN_GEN_CB_UDATA,
     PLUGIN_GEN_CB_INLINE,
+    PLUGIN_GEN_CB_COND,
+    PLUGIN_GEN_CB_BUFFERED,
     PLUGIN_GEN_CB_MEM,
     PLUGIN_GEN_ENABLE_MEM_HELPER,
     PLUGIN_GEN_DISABLE_MEM_HELPER,
@@ -126,14 +128,36 @@ static void gen_empty_udata_cb(void)
 }
 
 /*
- * For now we only support addi_i64.
- * When we support more ops, we can generate one empty inline cb for each.
+ * Point @ptr to the running vCPU's entry, i.e. ptr += cpu_index * stride.
+ * The stride is overwritten later; pass one that is not a power of 2 so
+ * that we get a multiplication that can be filled in with any stride.
+ * Entries shared by all vCPUs skip these ops altogether.
+ */
+static void gen_empty_vcpu_entry(TCGv_ptr ptr)
+{
+    TCGv_i32 cpu_index = tcg_temp_new_i32();
+    TCGv_ptr offset = tcg_temp_new_ptr();
+
+    tcg_gen_ld_i32(cpu_index, cpu_env,
+                   -offsetof(ArchCPU, env) + offsetof(CPUState, cpu_index));
+    tcg_gen_ext_i32_ptr(offset, cpu_index);
+    tcg_gen_muli_ptr(offset, offset, 0xdead);
+    tcg_gen_add_ptr(ptr, ptr, offset);
+
+    tcg_temp_free_ptr(offset);
+    tcg_temp_free_i32(cpu_index);
+}
+
+/*
+ * All inline ops share this template: add_i64 is filled in as is, while
+ * for store_i64 we skip the load and turn the addition into a move.
  */
 static void gen_empty_inline_cb(void)
 {
     TCGv_i64 val = tcg_temp_new_i64();
     TCGv_ptr ptr = tcg_const_ptr(NULL); /* overwritten later */
 
+    gen_empty_vcpu_entry(ptr);
     tcg_gen_ld_i64(val, ptr, 0);
     /* pass an immediate != 0 so that it doesn't get optimized away */
     tcg_gen_addi_i64(val, val, 0xdeadface);
@@ -142,6 +166,93 @@ static void gen_empty_inline_cb(void)
     tcg_temp_free_i64(val);
 }
 
+/*
+ * The condition and immediate of the branch are overwritten later, and
+ * each copy gets a label of its own. Note that the branch ends the basic
+ * block, so the CPU index has to be reloaded for the call.
+ */
+static void gen_empty_cond_cb(void)
+{
+    TCGv_i64 val = tcg_temp_new_i64();
+    TCGv_ptr ptr = tcg_const_ptr(NULL); /* overwritten later */
+    TCGLabel *skip = gen_new_label();
+
+    gen_empty_vcpu_entry(ptr);
+    tcg_gen_ld_i64(val, ptr, 0);
+    tcg_gen_brcondi_i64(TCG_COND_EQ, val, 0xdeadface, skip);
+    tcg_temp_free_ptr(ptr);
+    tcg_temp_free_i64(val);
+
+    gen_empty_udata_cb();
+    gen_set_label(skip);
+}
+
+/*
+ * Placeholders for the PC of a trace record, and for the data stored in
+ * instruction records; see copy_buffered_const().
+ */
+#define PLUGIN_GEN_TRACE_PC 0xdeadbeefcafef00dULL
+#define PLUGIN_GEN_TRACE_DATA 0xfeedfacebaadf00dULL
+
+/*
+ * Append a record to the running vCPU's trace buffer, i.e. struct
+ * plugin_trace_buf. Only the buffer's address, the stride, the PC and
+ * the data are overwritten later; everything else is copied as is. Whether the buffer
+ * needs flushing is checked at the start of the instruction instead, since
+ * a branch here would end the basic block in the middle of it.
+ */
+static void do_gen_buffered_cb(TCGv vaddr, uint32_t info,
+                               enum qemu_plugin_trace_type type)
+{
+    TCGv_ptr buf = tcg_const_ptr(NULL); /* overwritten later */
+    TCGv_ptr rec = tcg_temp_new_ptr();
+    TCGv_i32 n = tcg_temp_new_i32();
+    TCGv_i32 val32 = tcg_temp_new_i32();
+    TCGv_i64 val = tcg_temp_new_i64();
+    size_t recs = offsetof(struct plugin_trace_buf, recs);
+
+    gen_empty_vcpu_entry(buf);
+    tcg_gen_ld_i32(n, buf, PLUGIN_TRACE_BUF_N_OFFSET);
+    tcg_gen_andi_i32(val32, n, PLUGIN_TRACE_BUF_SLOTS - 1);
+    tcg_gen_ext_i32_ptr(rec, val32);
+    tcg_gen_muli_ptr(rec, rec, sizeof(qemu_plugin_trace_record));
+    tcg_gen_add_ptr(rec, rec, buf);
+
+    tcg_gen_movi_i64(val, PLUGIN_GEN_TRACE_PC);
+    tcg_gen_st_i64(val, rec, recs + offsetof(qemu_plugin_trace_record, pc));
+    if (type == QEMU_PLUGIN_TRACE_MEM) {
+        tcg_gen_extu_tl_i64(val, vaddr);
+    } else {
+        tcg_gen_movi_i64(val, PLUGIN_GEN_TRACE_DATA);
+    }
+    tcg_gen_st_i64(val, rec, recs + offsetof(qemu_plugin_trace_record, vaddr));
+    tcg_gen_movi_i32(val32, info);
+    tcg_gen_st_i32(val32, rec,
+                   recs + offsetof(qemu_plugin_trace_record, info));
+    tcg_gen_movi_i32(val32, type);
+    tcg_gen_st_i32(val32, rec,
+                   recs + offsetof(qemu_plugin_trace_record, type));
+
+    tcg_gen_addi_i32(n, n, 1);
+    tcg_gen_st_i32(n, buf, PLUGIN_TRACE_BUF_N_OFFSET);
+
+    tcg_temp_free_i64(val);
+    tcg_temp_free_i32(val32);
+    tcg_temp_free_i32(n);
+    tcg_temp_free_ptr(rec);
+    tcg_temp_free_ptr(buf);
+}
+
+static void gen_empty_buffered_insn_cb(void)
+{
+    do_gen_buffered_cb(NULL, 0, QEMU_PLUGIN_TRACE_INSN);
+}
+
+static void gen_empty_buffered_mem_cb(TCGv addr, uint32_t info)
+{
+    do_gen_buffered_cb(addr, info, QEMU_PLUGIN_TRACE_MEM);
+}
+
 static void gen_empty_mem_cb(TCGv addr, uint32_t info)
 {
     do_gen_mem_cb(addr, info);
@@ -197,7 +308,12 @@ static inline void plugin_gen_empty_callback(enum plugin_gen_from from)
         /* fall through */
     case PLUGIN_GEN_FROM_TB:
         gen_wrapped(from, PLUGIN_GEN_CB_UDATA, gen_empty_udata_cb);
+        gen_wrapped(from, PLUGIN_GEN_CB_COND, gen_empty_cond_cb);
         gen_wrapped(from, PLUGIN_GEN_CB_INLINE, gen_empty_inline_cb);
+        if (from == PLUGIN_GEN_FROM_INSN) {
+            gen_wrapped(from, PLUGIN_GEN_CB_BUFFERED,
+                        gen_empty_buffered_insn_cb);
+        }
         break;
     default:
         g_assert_not_reached();
@@ -233,6 +349,9 @@ void plugin_gen_empty_mem_callback(TCGv addr, uint32_t info)
 
     fn.inline_fn = gen_empty_inline_cb;
     gen_mem_wrapped(PLUGIN_GEN_CB_INLINE, &fn, 0, info, false);
+
+    fn.mem_fn = gen_empty_buffered_mem_cb;
+    gen_mem_wrapped(PLUGIN_GEN_CB_BUFFERED, &fn, addr, info, true);
 }
 
 static TCGOp *find_op(TCGOp *op, TCGOpcode opc)
@@ -279,6 +398,12 @@ static TCGOp *copy_op(TCGOp **begin_op, TCGOp *op, TCGOpcode opc)
     return op;
 }
 
+static void skip_op(TCGOp **begin_op, TCGOpcode opc)
+{
+    *begin_op = QTAILQ_NEXT(*begin_op, link);
+    tcg_debug_assert(*begin_op && (*begin_op)->opc == opc);
+}
+
 static TCGOp *copy_extu_i32_i64(TCGOp **begin_op, TCGOp *op)
 {
     if (TCG_TARGET_REG_BITS == 32) {
@@ -391,6 +516,142 @@ static TCGOp *copy_add_i64(TCGOp **begin_op, TCGOp *op)
     return op;
 }
 
+/* for store_i64: turn the template's val = val + imm into val = imm */
+static TCGOp *copy_add_i64_as_mov(TCGOp **begin_op, TCGOp *op)
+{
+    TCGOp *add_op;
+
+    *begin_op = QTAILQ_NEXT(*begin_op, link);
+    add_op = *begin_op;
+    tcg_debug_assert(add_op);
+
+    if (TCG_TARGET_REG_BITS == 32) {
+        /* add2_i32 rl, rh, al, ah, bl, bh -> 2x mov_i32 */
+        tcg_debug_assert(add_op->opc == INDEX_op_add2_i32);
+        op = tcg_op_insert_after(tcg_ctx, op, INDEX_op_mov_i32);
+        op->args[0] = add_op->args[0];
+        op->args[1] = add_op->args[4];
+        op = tcg_op_insert_after(tcg_ctx, op, INDEX_op_mov_i32);
+        op->args[0] = add_op->args[1];
+        op->args[1] = add_op->args[5];
+    } else {
+        /* add_i64 r, a, b -> mov_i64 */
+        tcg_debug_assert(add_op->opc == INDEX_op_add_i64);
+        op = tcg_op_insert_after(tcg_ctx, op, INDEX_op_mov_i64);
+        op->args[0] = add_op->args[0];
+        op->args[1] = add_op->args[2];
+    }
+    return op;
+}
+
+static void skip_ld_i64(TCGOp **begin_op)
+{
+    if (TCG_TARGET_REG_BITS == 32) {
+        /* 2x ld_i32 */
+        skip_op(begin_op, INDEX_op_ld_i32);
+        skip_op(begin_op, INDEX_op_ld_i32);
+    } else {
+        /* ld_i64 */
+        skip_op(begin_op, INDEX_op_ld_i64);
+    }
+}
+
+static TCGOp *copy_ext_i32_ptr(TCGOp **begin_op, TCGOp *op)
+{
+    if (UINTPTR_MAX == UINT32_MAX) {
+        /* mov_i32 */
+        op = copy_op(begin_op, op, INDEX_op_mov_i32);
+    } else {
+        /* ext_i32_i64 */
+        op = copy_op(begin_op, op, INDEX_op_ext_i32_i64);
+    }
+    return op;
+}
+
+static TCGOp *copy_muli_ptr(TCGOp **begin_op, TCGOp *op, uintptr_t v)
+{
+    if (UINTPTR_MAX == UINT32_MAX) {
+        /* movi_i32 + mul_i32 */
+        op = copy_op(begin_op, op, INDEX_op_movi_i32);
+        op->args[1] = v;
+        op = copy_op(begin_op, op, INDEX_op_mul_i32);
+    } else {
+        /* movi_i64 + mul_i64 */
+        op = copy_op(begin_op, op, INDEX_op_movi_i64);
+        op->args[1] = v;
+        op = copy_op(begin_op, op, INDEX_op_mul_i64);
+    }
+    return op;
+}
+
+static TCGOp *copy_add_ptr(TCGOp **begin_op, TCGOp *op)
+{
+    if (UINTPTR_MAX == UINT32_MAX) {
+        /* add_i32 */
+        op = copy_op(begin_op, op, INDEX_op_add_i32);
+    } else {
+        /* add_i64 */
+        op = copy_op(begin_op, op, INDEX_op_add_i64);
+    }
+    return op;
+}
+
+/* see gen_empty_vcpu_entry() */
+static TCGOp *copy_vcpu_entry(TCGOp **begin_op, TCGOp *op, size_t stride)
+{
+    int i;
+
+    if (stride == 0) {
+        /* shared entry: skip ld_i32, ext_i32_ptr, movi, mul and add */
+        skip_op(begin_op, INDEX_op_ld_i32);
+        for (i = 0; i < 4; i++) {
+            *begin_op = QTAILQ_NEXT(*begin_op, link);
+        }
+        tcg_debug_assert((*begin_op)->opc == INDEX_op_add_i32 ||
+                         (*begin_op)->opc == INDEX_op_add_i64);
+        return op;
+    }
+
+    /* ld_i32 */
+    op = copy_op(begin_op, op, INDEX_op_ld_i32);
+
+    /* ext_i32_ptr */
+    op = copy_ext_i32_ptr(begin_op, op);
+
+    /* muli_ptr */
+    op = copy_muli_ptr(begin_op, op, stride);
+
+    /* add_ptr */
+    op = copy_add_ptr(begin_op, op);
+
+    return op;
+}
+
+static TCGOp *copy_brcond_i64(TCGOp **begin_op, TCGOp *op, TCGCond cond,
+                              TCGLabel *l)
+{
+    if (TCG_TARGET_REG_BITS == 32) {
+        /* brcond2_i32 al, ah, bl, bh, cond, label */
+        op = copy_op(begin_op, op, INDEX_op_brcond2_i32);
+        op->args[4] = cond;
+        op->args[5] = label_arg(l);
+    } else {
+        /* brcond_i64 a, b, cond, label */
+        op = copy_op(begin_op, op, INDEX_op_brcond_i64);
+        op->args[2] = cond;
+        op->args[3] = label_arg(l);
+    }
+    l->refs++;
+    return op;
+}
+
+static TCGOp *copy_set_label(TCGOp **begin_op, TCGOp *op, TCGLabel *l)
+{
+    op = copy_op(begin_op, op, INDEX_op_set_label);
+    op->args[0] = label_arg(l);
+    return op;
+}
+
 static TCGOp *copy_st_ptr(TCGOp **begin_op, TCGOp *op)
 {
     if (UINTPTR_MAX == UINT32_MAX) {
@@ -464,17 +725,135 @@ static TCGOp *append_inline_cb(const struct qemu_plugin_dyn_cb *cb,
     /* const_ptr */
     op = copy_const_ptr(&begin_op, op, cb->userp);
 
+    /* index the vCPU's entry, unless it is shared */
+    op = copy_vcpu_entry(&begin_op, op, cb->inline_insn.stride);
+
+    switch (cb->inline_insn.op) {
+    case QEMU_PLUGIN_INLINE_ADD_U64:
+        /* ld_i64 */
+        op = copy_ld_i64(&begin_op, op);
+
+        /* const_i64 */
+        op = copy_const_i64(&begin_op, op, cb->inline_insn.imm);
+
+        /* add_i64 */
+        op = copy_add_i64(&begin_op, op);
+        break;
+    case QEMU_PLUGIN_INLINE_STORE_U64:
+        skip_ld_i64(&begin_op);
+
+        /* const_i64 */
+        op = copy_const_i64(&begin_op, op, cb->inline_insn.imm);
+
+        /* mov_i64 */
+        op = copy_add_i64_as_mov(&begin_op, op);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+
+    /* st_i64 */
+    op = copy_st_i64(&begin_op, op);
+
+    return op;
+}
+
+static TCGCond plugin_cond_to_tcgcond(enum qemu_plugin_cond cond)
+{
+    switch (cond) {
+    case QEMU_PLUGIN_COND_EQ:
+        return TCG_COND_EQ;
+    case QEMU_PLUGIN_COND_NE:
+        return TCG_COND_NE;
+    case QEMU_PLUGIN_COND_LT:
+        return TCG_COND_LTU;
+    case QEMU_PLUGIN_COND_LE:
+        return TCG_COND_LEU;
+    case QEMU_PLUGIN_COND_GT:
+        return TCG_COND_GTU;
+    case QEMU_PLUGIN_COND_GE:
+        return TCG_COND_GEU;
+    default:
+        /* ALWAYS and NEVER are dealt with at registration time */
+        g_assert_not_reached();
+    }
+}
+
+static TCGOp *append_cond_cb(const struct qemu_plugin_dyn_cb *cb,
+                             TCGOp *begin_op, TCGOp *op, int *cb_idx)
+{
+    TCGLabel *skip = gen_new_label();
+    TCGCond cond = plugin_cond_to_tcgcond(cb->cond.cond);
+
+    /* const_ptr */
+    op = copy_const_ptr(&begin_op, op, cb->cond.entry);
+
+    /* index the vCPU's entry, unless it is shared */
+    op = copy_vcpu_entry(&begin_op, op, cb->cond.stride);
+
     /* ld_i64 */
     op = copy_ld_i64(&begin_op, op);
 
     /* const_i64 */
-    op = copy_const_i64(&begin_op, op, cb->inline_insn.imm);
+    op = copy_const_i64(&begin_op, op, cb->cond.imm);
 
-    /* add_i64 */
-    op = copy_add_i64(&begin_op, op);
+    /* brcond_i64: branch over the call unless the condition holds */
+    op = copy_brcond_i64(&begin_op, op, tcg_invert_cond(cond), skip);
 
-    /* st_i64 */
-    op = copy_st_i64(&begin_op, op);
+    /* const_ptr */
+    op = copy_const_ptr(&begin_op, op, cb->userp);
+
+    /* ld_i32: copy it every time, since the branch ended the basic block */
+    op = copy_op(&begin_op, op, INDEX_op_ld_i32);
+
+    /* call */
+    op = copy_call(&begin_op, op, HELPER(plugin_vcpu_udata_cb),
+                   cb->f.vcpu_udata, cb->tcg_flags, cb_idx);
+
+    /* set_label */
+    op = copy_set_label(&begin_op, op, skip);
+
+    return op;
+}
+
+/* fill in @v if @op is (half of) the movi of @placeholder */
+static bool copy_buffered_const(TCGOp *op, uint64_t placeholder, uint64_t v)
+{
+    if (TCG_TARGET_REG_BITS == 32) {
+        if (op->opc != INDEX_op_movi_i32) {
+            return false;
+        }
+        if ((uint32_t)op->args[1] == (uint32_t)placeholder) {
+            op->args[1] = (uint32_t)v;
+            return true;
+        }
+        if ((uint32_t)op->args[1] == placeholder >> 32) {
+            op->args[1] = v >> 32;
+            return true;
+        }
+    } else if (op->opc == INDEX_op_movi_i64 && op->args[1] == placeholder) {
+        op->args[1] = v;
+        return true;
+    }
+    return false;
+}
+
+static TCGOp *append_buffered_cb(const struct qemu_plugin_dyn_cb *cb,
+                                 TCGOp *begin_op, TCGOp *op, int *unused)
+{
+    /* const_ptr */
+    op = copy_const_ptr(&begin_op, op, cb->userp);
+
+    /* index the vCPU's buffer */
+    op = copy_vcpu_entry(&begin_op, op, cb->buffered.stride);
+
+    /* copy the rest of the record, filling in the PC and data */
+    while (QTAILQ_NEXT(begin_op, link)->opc != INDEX_op_plugin_cb_end) {
+        op = copy_op_nocheck(&begin_op, op);
+        if (!copy_buffered_const(op, PLUGIN_GEN_TRACE_PC, cb->buffered.pc)) {
+            copy_buffered_const(op, PLUGIN_GEN_TRACE_DATA, cb->buffered.data);
+        }
+    }
 
     return op;
 }
@@ -565,12 +944,36 @@ inject_udata_cb(const GArray *cbs, TCGOp *begin_op)
     inject_cb_type(cbs, begin_op, append_udata_cb, op_ok);
 }
 
+static void
+inject_cond_cb(const GArray *cbs, TCGOp *begin_op)
+{
+    TCGOp *br_op;
+
+    /* the template's branch is removed below along with the rest of it */
+    if (TCG_TARGET_REG_BITS == 32) {
+        br_op = find_op(begin_op, INDEX_op_brcond2_i32);
+        tcg_debug_assert(br_op);
+        arg_label(br_op->args[5])->refs--;
+    } else {
+        br_op = find_op(begin_op, INDEX_op_brcond_i64);
+        tcg_debug_assert(br_op);
+        arg_label(br_op->args[3])->refs--;
+    }
+    inject_cb_type(cbs, begin_op, append_cond_cb, op_ok);
+}
+
 static void
 inject_inline_cb(const GArray *cbs, TCGOp *begin_op, op_ok_fn ok)
 {
     inject_cb_type(cbs, begin_op, append_inline_cb, ok);
 }
 
+static void
+inject_buffered_cb(const GArray *cbs, TCGOp *begin_op, op_ok_fn ok)
+{
+    inject_cb_type(cbs, begin_op, append_buffered_cb, ok);
+}
+
 static void
 inject_mem_cb(const GArray *cbs, TCGOp *begin_op)
 {
@@ -611,12 +1014,13 @@ static void inject_mem_helper(TCGOp *begin_op, GArray *arr)
 static void inject_mem_enable_helper(struct qemu_plugin_insn *plugin_insn,
                                      TCGOp *begin_op)
 {
-    GArray *cbs[2];
+    GArray *cbs[3];
     GArray *arr;
     size_t n_cbs, i;
 
     cbs[0] = plugin_insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_REGULAR];
     cbs[1] = plugin_insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_INLINE];
+    cbs[2] = plugin_insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_BUFFERED];
 
     n_cbs = 0;
     for (i = 0; i < ARRAY_SIZE(cbs); i++) {
@@ -672,6 +1076,12 @@ static void plugin_gen_tb_udata(const struct qemu_plugin_tb *ptb,
     inject_udata_cb(ptb->cbs[PLUGIN_CB_REGULAR], begin_op);
 }
 
+static void plugin_gen_tb_cond(const struct qemu_plugin_tb *ptb,
+                               TCGOp *begin_op)
+{
+    inject_cond_cb(ptb->cbs[PLUGIN_CB_COND], begin_op);
+}
+
 static void plugin_gen_tb_inline(const struct qemu_plugin_tb *ptb,
                                  TCGOp *begin_op)
 {
@@ -686,6 +1096,14 @@ static void plugin_gen_insn_udata(const struct qemu_plugin_tb *ptb,
     inject_udata_cb(insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_REGULAR], begin_op);
 }
 
+static void plugin_gen_insn_cond(const struct qemu_plugin_tb *ptb,
+                                 TCGOp *begin_op, int insn_idx)
+{
+    struct qemu_plugin_insn *insn = g_ptr_array_index(ptb->insns, insn_idx);
+
+    inject_cond_cb(insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_COND], begin_op);
+}
+
 static void plugin_gen_insn_inline(const struct qemu_plugin_tb *ptb,
                                    TCGOp *begin_op, int insn_idx)
 {
@@ -694,6 +1112,15 @@ static void plugin_gen_insn_inline(const struct qemu_plugin_tb *ptb,
                      begin_op, op_ok);
 }
 
+static void plugin_gen_insn_buffered(const struct qemu_plugin_tb *ptb,
+                                     TCGOp *begin_op, int insn_idx)
+{
+    struct qemu_plugin_insn *insn = g_ptr_array_index(ptb->insns, insn_idx);
+
+    inject_buffered_cb(insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_BUFFERED],
+                       begin_op, op_ok);
+}
+
 static void plugin_gen_mem_regular(const struct qemu_plugin_tb *ptb,
                                    TCGOp *begin_op, int insn_idx)
 {
@@ -711,6 +1138,15 @@ static void plugin_gen_mem_inline(const struct qemu_plugin_tb *ptb,
     inject_inline_cb(cbs, begin_op, op_rw);
 }
 
+static void plugin_gen_mem_buffered(const struct qemu_plugin_tb *ptb,
+                                    TCGOp *begin_op, int insn_idx)
+{
+    struct qemu_plugin_insn *insn = g_ptr_array_index(ptb->insns, insn_idx);
+
+    inject_buffered_cb(insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_BUFFERED],
+                       begin_op, op_rw);
+}
+
 static void plugin_gen_enable_mem_helper(const struct qemu_plugin_tb *ptb,
                                          TCGOp *begin_op, int insn_idx)
 {
@@ -737,6 +1173,9 @@ static void plugin_inject_cb(const struct qemu_plugin_tb *ptb, TCGOp *begin_op,
         case PLUGIN_GEN_CB_UDATA:
             plugin_gen_tb_udata(ptb, begin_op);
             return;
+        case PLUGIN_GEN_CB_COND:
+            plugin_gen_tb_cond(ptb, begin_op);
+            return;
         case PLUGIN_GEN_CB_INLINE:
             plugin_gen_tb_inline(ptb, begin_op);
             return;
@@ -748,9 +1187,15 @@ static void plugin_inject_cb(const struct qemu_plugin_tb *ptb, TCGOp *begin_op,
         case PLUGIN_GEN_CB_UDATA:
             plugin_gen_insn_udata(ptb, begin_op, insn_idx);
             return;
+        case PLUGIN_GEN_CB_COND:
+            plugin_gen_insn_cond(ptb, begin_op, insn_idx);
+            return;
         case PLUGIN_GEN_CB_INLINE:
             plugin_gen_insn_inline(ptb, begin_op, insn_idx);
             return;
+        case PLUGIN_GEN_CB_BUFFERED:
+            plugin_gen_insn_buffered(ptb, begin_op, insn_idx);
+            return;
         case PLUGIN_GEN_ENABLE_MEM_HELPER:
             plugin_gen_enable_mem_helper(ptb, begin_op, insn_idx);
             return;
@@ -765,6 +1210,9 @@ static void plugin_inject_cb(const struct qemu_plugin_tb *ptb, TCGOp *begin_op,
         case PLUGIN_GEN_CB_INLINE:
             plugin_gen_mem_inline(ptb, begin_op, insn_idx);
             return;
+        case PLUGIN_GEN_CB_BUFFERED:
+            plugin_gen_mem_buffered(ptb, begin_op, insn_idx);
+            return;
         default:
             g_assert_not_reached();
         }
@@ -813,6 +1261,12 @@ static void pr_ops(void)
             case PLUGIN_GEN_CB_UDATA:
                 type = "udata";
                 break;
+            case PLUGIN_GEN_CB_COND:
+                type = "cond";
+                break;
+            case PLUGIN_GEN_CB_BUFFERED:
+                type = "buffered";
+                break;
             case PLUGIN_GEN_CB_INLINE:
                 type = "inline";
                 break;
@@ -32,6 +32,7 @@
 #include "qemu/error-report.h"
 #include "hw/boards.h"
 #include "qapi/qapi-builtin-visit.h"
+#include "exec/perf.h"
 #include "tcg-cpus.h"
 
 struct TCGState {
@@ -39,6 +40,9 @@ struct TCGState {
 
     bool mttcg_enabled;
     unsigned long tb_size;
+    bool perf_map;
+    bool jitdump;
+    char *profile;
 };
 typedef struct TCGState TCGState;
 
@@ -101,6 +105,15 @@ bool mttcg_enabled;
 static int tcg_init(MachineState *ms)
 {
     TCGState *s = TCG_STATE(current_accel());
+    Error *local_err = NULL;
+
+    if ((s->perf_map && !perf_enable_perfmap(&local_err)) ||
+        (s->jitdump && !perf_enable_jitdump(&local_err)) ||
+        (s->profile &&
+         !perf_enable_profile(s->profile, SIGPROF, &local_err))) {
+        error_report_err(local_err);
+        return -1;
+    }
 
     tcg_exec_init(s->tb_size * 1024 * 1024);
     mttcg_enabled = s->mttcg_enabled;
@@ -168,6 +181,39 @@ static void tcg_set_tb_size(Object *obj, Visitor *v,
     s->tb_size = value;
 }
 
+static bool tcg_get_perf_map(Object *obj, Error **errp)
+{
+    return TCG_STATE(obj)->perf_map;
+}
+
+static void tcg_set_perf_map(Object *obj, bool value, Error **errp)
+{
+    TCG_STATE(obj)->perf_map = value;
+}
+
+static bool tcg_get_jitdump(Object *obj, Error **errp)
+{
+    return TCG_STATE(obj)->jitdump;
+}
+
+static void tcg_set_jitdump(Object *obj, bool value, Error **errp)
+{
+    TCG_STATE(obj)->jitdump = value;
+}
+
+static char *tcg_get_profile(Object *obj, Error **errp)
+{
+    return g_strdup(TCG_STATE(obj)->profile);
+}
+
+static void tcg_set_profile(Object *obj, const char *value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+
+    g_free(s->profile);
+    s->profile = g_strdup(value);
+}
+
 static void tcg_accel_class_init(ObjectClass *oc, void *data)
 {
     AccelClass *ac = ACCEL_CLASS(oc);
@@ -185,6 +231,21 @@ static void tcg_accel_class_init(ObjectClass *oc, void *data)
     object_class_property_set_description(oc, "tb-size",
         "TCG translation block cache size");
 
+    object_class_property_add_bool(oc, "perf-map",
+                                   tcg_get_perf_map, tcg_set_perf_map);
+    object_class_property_set_description(oc, "perf-map",
+        "Write a perf map of the generated code to /tmp/perf-<pid>.map");
+
+    object_class_property_add_bool(oc, "jitdump",
+                                   tcg_get_jitdump, tcg_set_jitdump);
+    object_class_property_set_description(oc, "jitdump",
+        "Write a perf jitdump of the generated code");
+
+    object_class_property_add_str(oc, "profile",
+                                  tcg_get_profile, tcg_set_profile);
+    object_class_property_set_description(oc, "profile",
+        "Sample the generated code and write a flat profile to this file");
+
 }
 
 static const TypeInfo tcg_accel_type = {
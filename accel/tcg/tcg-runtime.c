@@ -145,7 +145,7 @@ uint64_t HELPER(ctpop_i64)(uint64_t arg)
     return ctpop64(arg);
 }
 
-void *HELPER(lookup_tb_ptr)(CPUArchState *env)
+static TranslationBlock *lookup_tb_for_ptr(CPUArchState *env)
 {
     CPUState *cpu = env_cpu(env);
     TranslationBlock *tb;
@@ -154,13 +154,88 @@ void *HELPER(lookup_tb_ptr)(CPUArchState *env)
 
     tb = tb_lookup__cpu_state(cpu, &pc, &cs_base, &flags, curr_cflags());
     if (tb == NULL) {
-        return tcg_ctx->code_gen_epilogue;
+        return NULL;
     }
+    tcg_region_touch(tb->tc.ptr);
     qemu_log_mask_and_addr(CPU_LOG_EXEC, pc,
                            "Chain %d: %p ["
                            TARGET_FMT_lx "/" TARGET_FMT_lx "/%#x] %s\n",
                            cpu->cpu_index, tb->tc.ptr, cs_base, pc, flags,
                            lookup_symbol(pc));
+    return tb;
+}
+
+void *HELPER(lookup_tb_ptr)(CPUArchState *env)
+{
+    TranslationBlock *tb = lookup_tb_for_ptr(env);
+
+    return tb ? tb->tc.ptr : tcg_ctx->code_gen_epilogue;
+}
+
+/*
+ * Return true if @tb, found as the target of the indirect branch ending
+ * @site, may be entered from an inline cache owned by @owner.  Generated
+ * code only compares the guest PC of the cached TB, and for returns its
+ * flags and cs_base, so everything else that tb_lookup compares must be
+ * checked here, including the trace dstate the TBs were translated for.
+ * For system emulation, restrict the cached TBs to the physical page of
+ * @owner as for direct jumps, since the mapping of other pages may change
+ * without the TBs being invalidated.
+ */
+static bool tb_ind_cacheable(TranslationBlock *site, TranslationBlock *owner,
+                             TranslationBlock *tb)
+{
+    if (tb->flags != site->flags || tb->cs_base != site->cs_base) {
+        return false;
+    }
+    if (tb->trace_vcpu_dstate != site->trace_vcpu_dstate ||
+        tb->trace_vcpu_dstate != owner->trace_vcpu_dstate) {
+        return false;
+    }
+#ifndef CONFIG_USER_ONLY
+    if (tb->page_addr[1] != -1 ||
+        tb->page_addr[0] != owner->page_addr[0] ||
+        (tb->pc & TARGET_PAGE_MASK) != (owner->pc & TARGET_PAGE_MASK)) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+void *HELPER(lookup_tb_ptr_ind)(CPUArchState *env, void *site_ptr)
+{
+    TranslationBlock *site = site_ptr;
+    TranslationBlock *tb = lookup_tb_for_ptr(env);
+    int i;
+
+    if (tb == NULL) {
+        return tcg_ctx->code_gen_epilogue;
+    }
+    if (tb_ind_cacheable(site, site, tb)) {
+        /* Insert as most recently used, dropping the oldest entry.  */
+        for (i = TB_IND_CACHE_SIZE - 1; i > 0; i--) {
+            qatomic_set(&site->ind_cache[i],
+                        qatomic_read(&site->ind_cache[i - 1]));
+        }
+        qatomic_set(&site->ind_cache[0], tb);
+    }
+    return tb->tc.ptr;
+}
+
+void *HELPER(lookup_tb_ptr_ret)(CPUArchState *env, void *site_ptr,
+                                void *caller_ptr)
+{
+    TranslationBlock *site = site_ptr;
+    TranslationBlock *caller = caller_ptr;
+    TranslationBlock *tb = lookup_tb_for_ptr(env);
+
+    if (tb == NULL) {
+        return tcg_ctx->code_gen_epilogue;
+    }
+    if (caller && tb->pc == caller->ret_pc &&
+        tb_ind_cacheable(site, caller, tb)) {
+        qatomic_set(&caller->ret_tb, tb);
+    }
     return tb->tc.ptr;
 }
 
@@ -49,6 +49,7 @@
 
 #include "exec/cputlb.h"
 #include "exec/tb-hash.h"
+#include "exec/perf.h"
 #include "translate-all.h"
 #include "qemu/bitmap.h"
 #include "qemu/error-report.h"
@@ -100,16 +101,19 @@
 #define assert_memory_lock() tcg_debug_assert(have_mmap_lock())
 #endif
 
-#define SMC_BITMAP_USE_THRESHOLD 10
-
 typedef struct PageDesc {
     /* list of TBs intersecting this ram page */
     uintptr_t first_tb;
 #ifdef CONFIG_SOFTMMU
-    /* in order to optimize self modifying code, we count the number
-       of lookups we do to a given page to use a bitmap */
+    /*
+     * Bitmap of the bytes of this page that translated code was read from,
+     * so that data writes to a page that also holds code only invalidate
+     * the TBs they actually hit.  Built on the first write to the page and
+     * then kept up to date as TBs are added.  Bits of TBs that are
+     * removed are left set (a conservative superset) and are cleared
+     * lazily, once a write to them has proved that no TB covers them.
+     */
     unsigned long *code_bitmap;
-    unsigned int code_write_count;
 #else
     unsigned long flags;
 #endif
@@ -222,6 +226,12 @@ __thread TCGContext *tcg_ctx;
 TBContext tb_ctx;
 bool parallel_cpus;
 
+/* Placeholder for empty indirect branch cache entries; never matches */
+TranslationBlock tb_ind_sentinel = {
+    .pc = -1,
+    .cflags = CF_INVALID,
+};
+
 static void page_table_config_init(void)
 {
     uint32_t v_l1_bits;
@@ -570,6 +580,16 @@ static inline PageDesc *page_find(tb_page_addr_t index)
     return page_find_alloc(index, 0);
 }
 
+/*
+ * Number of descriptors, starting at @index, that live in the same
+ * bottom-level array as @index's. Range walks can step through them
+ * with pointer arithmetic instead of descending the tree for each page.
+ */
+static inline tb_page_addr_t page_leaf_remaining(tb_page_addr_t index)
+{
+    return V_L2_SIZE - (index & (V_L2_SIZE - 1));
+}
+
 static void page_lock_pair(PageDesc **ret_p1, tb_page_addr_t phys1,
                            PageDesc **ret_p2, tb_page_addr_t phys2, int alloc);
 
@@ -1159,6 +1179,8 @@ void tcg_exec_init(unsigned long tb_size)
     page_init();
     tb_htable_init();
     code_gen_alloc(tb_size);
+    perf_set_code_gen_buffer(tcg_ctx->code_gen_buffer,
+                             tcg_ctx->code_gen_buffer_size);
 #if defined(CONFIG_SOFTMMU)
     /* There's no guest base to take into account, so go ahead and
        initialize the prologue now.  */
@@ -1173,7 +1195,6 @@ static inline void invalidate_page_bitmap(PageDesc *p)
 #ifdef CONFIG_SOFTMMU
     g_free(p->code_bitmap);
     p->code_bitmap = NULL;
-    p->code_write_count = 0;
 #endif
 }
 
@@ -1234,6 +1255,7 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
         goto done;
     }
     did_flush = true;
+    perf_profile_fold();
 
     if (DEBUG_TB_FLUSH_GATE) {
         size_t nb_tbs = tcg_nb_tbs();
@@ -1424,6 +1446,26 @@ static inline void tb_jmp_unlink(TranslationBlock *dest)
     qemu_spin_unlock(&dest->jmp_lock);
 }
 
+static void tb_jmp_cache_remove(CPUState *cpu, TranslationBlock *tb)
+{
+    CPUJumpCache *jc;
+    unsigned int i;
+    uint32_t h;
+
+    RCU_READ_LOCK_GUARD();
+
+    jc = qatomic_rcu_read(&cpu->tb_jmp_cache);
+    h = tb_jmp_cache_hash_func(tb->pc, jc->bits);
+    if (qatomic_read(&jc->array[h]) == tb) {
+        qatomic_set(&jc->array[h], NULL);
+    }
+    for (i = 0; i < TB_JMP_VICTIM_SIZE; i++) {
+        if (qatomic_read(&cpu->tb_jmp_victim[i]) == tb) {
+            qatomic_set(&cpu->tb_jmp_victim[i], NULL);
+        }
+    }
+}
+
 /*
  * In user-mode, call with mmap_lock held.
  * In !user-mode, if @rm_from_page_list is set, call with the TB's pages'
@@ -1456,20 +1498,15 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     if (rm_from_page_list) {
         p = page_find(tb->page_addr[0] >> TARGET_PAGE_BITS);
         tb_page_remove(p, tb);
-        invalidate_page_bitmap(p);
         if (tb->page_addr[1] != -1) {
             p = page_find(tb->page_addr[1] >> TARGET_PAGE_BITS);
             tb_page_remove(p, tb);
-            invalidate_page_bitmap(p);
         }
     }
 
     /* remove the TB from the hash list */
-    h = tb_jmp_cache_hash_func(tb->pc);
     CPU_FOREACH(cpu) {
-        if (qatomic_read(&cpu->tb_jmp_cache[h]) == tb) {
-            qatomic_set(&cpu->tb_jmp_cache[h], NULL);
-        }
+        tb_jmp_cache_remove(cpu, tb);
     }
 
     /* suppress this TB from the two jump lists */
@@ -1503,31 +1540,175 @@ void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr)
     }
 }
 
+static gboolean tb_reclaim_evict(gpointer key, gpointer value, gpointer data)
+{
+    TranslationBlock *tb = value;
+
+    /* invalid TBs have been unlinked from everything already */
+    if (!(tb_cflags(tb) & CF_INVALID)) {
+        tb_phys_invalidate(tb, -1);
+    }
+    return false;
+}
+
+static gboolean tb_reclaim_purge(gpointer key, gpointer value, gpointer data)
+{
+    TranslationBlock *tb = value;
+    int i;
+
+    for (i = 0; i < TB_IND_CACHE_SIZE; i++) {
+        if (tcg_tc_reclaimed(tb->ind_cache[i])) {
+            qatomic_set(&tb->ind_cache[i], &tb_ind_sentinel);
+        }
+    }
+    if (tcg_tc_reclaimed(tb->ret_tb)) {
+        qatomic_set(&tb->ret_tb, &tb_ind_sentinel);
+    }
+    return false;
+}
+
+static void tb_reclaim_visit(GHashTable *seen, GPtrArray *work,
+                             TranslationBlock *tb)
+{
+    if (tb && tb != &tb_ind_sentinel && !(tb_cflags(tb) & CF_INVALID) &&
+        g_hash_table_add(seen, tb)) {
+        g_ptr_array_add(work, tb);
+    }
+}
+
+/*
+ * Regions are only marked as in use when tb_find or lookup_tb_ptr return
+ * one of their TBs, which never happens for hot code that is reached
+ * through direct jumps or the inline caches of indirect branches.  So,
+ * before choosing the regions to free, mark everything reachable that
+ * way from the TBs looked up since the last reclaim: those are still in
+ * the jump caches, or on the return address stacks.
+ */
+static void tb_reclaim_touch_reachable(void)
+{
+    GHashTable *seen = g_hash_table_new(NULL, NULL);
+    GPtrArray *work = g_ptr_array_new();
+    CPUState *cpu;
+    unsigned int i;
+
+    RCU_READ_LOCK_GUARD();
+    CPU_FOREACH(cpu) {
+        CPUJumpCache *jc = qatomic_rcu_read(&cpu->tb_jmp_cache);
+
+        for (i = 0; i < (1u << jc->bits); i++) {
+            tb_reclaim_visit(seen, work, qatomic_read(&jc->array[i]));
+        }
+        for (i = 0; i < TB_JMP_VICTIM_SIZE; i++) {
+            tb_reclaim_visit(seen, work, qatomic_read(&cpu->tb_jmp_victim[i]));
+        }
+        for (i = 0; i < TB_RAS_SIZE; i++) {
+            tb_reclaim_visit(seen, work, qatomic_read(&cpu->tb_ras[i]));
+        }
+    }
+    while (work->len) {
+        TranslationBlock *tb = g_ptr_array_remove_index_fast(work,
+                                                             work->len - 1);
+
+        tcg_region_touch(tb->tc.ptr);
+        for (i = 0; i < 2; i++) {
+            uintptr_t dest = qatomic_read(&tb->jmp_dest[i]) & ~(uintptr_t)1;
+
+            tb_reclaim_visit(seen, work, (TranslationBlock *)dest);
+        }
+        for (i = 0; i < TB_IND_CACHE_SIZE; i++) {
+            tb_reclaim_visit(seen, work, qatomic_read(&tb->ind_cache[i]));
+        }
+        tb_reclaim_visit(seen, work, qatomic_read(&tb->ret_tb));
+    }
+    g_ptr_array_free(work, true);
+    g_hash_table_destroy(seen);
+}
+
+/*
+ * Free the code in the least recently used regions of code_gen_buffer.
+ * Unlike do_tb_flush, the TBs in the other regions stay valid and chained.
+ */
+static void do_tb_reclaim(CPUState *cpu, run_on_cpu_data tb_flush_count)
+{
+    CPUState *other;
+    int ret = 0;
+
+    mmap_lock();
+    /* If a flush happened since the request, there is room already. */
+    if (tb_ctx.tb_flush_count == tb_flush_count.host_int) {
+        perf_profile_fold();
+        tb_reclaim_touch_reachable();
+        ret = tcg_region_reclaim(tb_reclaim_evict, tb_reclaim_purge);
+    }
+    if (ret > 0) {
+        /*
+         * The jump caches may still hold TBs that were invalidated before
+         * they were evicted, and the return address stacks are not tracked
+         * per TB.  Both are cheap to refill, unlike the code we keep.
+         */
+        CPU_FOREACH(other) {
+            cpu_tb_jmp_cache_clear(other);
+        }
+        qatomic_set(&tb_ctx.tb_reclaim_count, tb_ctx.tb_reclaim_count + 1);
+    }
+    mmap_unlock();
+
+    if (ret > 0) {
+        qemu_plugin_flush_cb();
+    } else if (ret < 0) {
+        /* every region is being translated into */
+        do_tb_flush(cpu, tb_flush_count);
+    }
+}
+
+/*
+ * Make room in code_gen_buffer, flushing everything only when no region
+ * can be reclaimed.
+ */
+static void tb_reclaim(CPUState *cpu)
+{
+    unsigned tb_flush_count = qatomic_mb_read(&tb_ctx.tb_flush_count);
+
+    if (cpu_in_exclusive_context(cpu)) {
+        do_tb_reclaim(cpu, RUN_ON_CPU_HOST_INT(tb_flush_count));
+    } else {
+        async_safe_run_on_cpu(cpu, do_tb_reclaim,
+                              RUN_ON_CPU_HOST_INT(tb_flush_count));
+    }
+}
+
 #ifdef CONFIG_SOFTMMU
+/*
+ * Mark in @p's code bitmap the guest bytes that @tb, linked to @p as its
+ * page @n, was translated from.
+ * Call with @p->lock held.
+ */
+static void page_bitmap_add_tb(PageDesc *p, TranslationBlock *tb, int n)
+{
+    int tb_start, tb_end;
+
+    /* NOTE: this is subtle as a TB may span two physical pages */
+    if (n == 0) {
+        tb_start = tb->pc & ~TARGET_PAGE_MASK;
+        tb_end = MIN(tb_start + tb->size, TARGET_PAGE_SIZE);
+    } else {
+        tb_start = 0;
+        tb_end = ((tb->pc + tb->size) & ~TARGET_PAGE_MASK);
+    }
+    bitmap_set(p->code_bitmap, tb_start, tb_end - tb_start);
+}
+
 /* call with @p->lock held */
 static void build_page_bitmap(PageDesc *p)
 {
-    int n, tb_start, tb_end;
     TranslationBlock *tb;
+    int n;
 
     assert_page_locked(p);
     p->code_bitmap = bitmap_new(TARGET_PAGE_SIZE);
 
     PAGE_FOR_EACH_TB(p, tb, n) {
-        /* NOTE: this is subtle as a TB may span two physical pages */
-        if (n == 0) {
-            /* NOTE: tb_end may be after the end of the page, but
-               it is not a problem */
-            tb_start = tb->pc & ~TARGET_PAGE_MASK;
-            tb_end = tb_start + tb->size;
-            if (tb_end > TARGET_PAGE_SIZE) {
-                tb_end = TARGET_PAGE_SIZE;
-             }
-        } else {
-            tb_start = 0;
-            tb_end = ((tb->pc + tb->size) & ~TARGET_PAGE_MASK);
-        }
-        bitmap_set(p->code_bitmap, tb_start, tb_end - tb_start);
+        page_bitmap_add_tb(p, tb, n);
     }
 }
 #endif
@@ -1552,7 +1733,11 @@ static inline void tb_page_add(PageDesc *p, TranslationBlock *tb,
     page_already_protected = p->first_tb != (uintptr_t)NULL;
 #endif
     p->first_tb = (uintptr_t)tb | n;
-    invalidate_page_bitmap(p);
+#ifdef CONFIG_SOFTMMU
+    if (p->code_bitmap) {
+        page_bitmap_add_tb(p, tb, n);
+    }
+#endif
 
 #if defined(CONFIG_USER_ONLY)
     if (p->flags & PAGE_WRITE) {
@@ -1572,7 +1757,7 @@ static inline void tb_page_add(PageDesc *p, TranslationBlock *tb,
                 continue;
             }
             prot |= p2->flags;
-            p2->flags &= ~PAGE_WRITE;
+            qatomic_set(&p2->flags, p2->flags & ~PAGE_WRITE);
           }
         mprotect(g2h(page_addr), qemu_host_page_size,
                  (prot & PAGE_BITS) & ~PAGE_WRITE);
@@ -1648,10 +1833,8 @@ tb_link_page(TranslationBlock *tb, tb_page_addr_t phys_pc,
         /* remove TB from the page(s) if we couldn't insert it */
         if (unlikely(existing_tb)) {
             tb_page_remove(p, tb);
-            invalidate_page_bitmap(p);
             if (p2) {
                 tb_page_remove(p2, tb);
-                invalidate_page_bitmap(p2);
             }
             tb = existing_tb;
         }
@@ -1680,7 +1863,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb_page_addr_t phys_pc, phys_page2;
     target_ulong virt_page2;
     tcg_insn_unit *gen_code_buf;
-    int gen_code_size, search_size, max_insns;
+    int gen_code_size, search_size, max_insns, i;
 #ifdef CONFIG_PROFILER
     TCGProfile *prof = &tcg_ctx->prof;
     int64_t ti;
@@ -1713,8 +1896,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
  buffer_overflow:
     tb = tcg_tb_alloc(tcg_ctx);
     if (unlikely(!tb)) {
-        /* flush must be done */
-        tb_flush(cpu);
+        /* reclaim cold code, or flush if that is not possible */
+        tb_reclaim(cpu);
         mmap_unlock();
         /* Make the execution loop process the flush as soon as possible.  */
         cpu->exception_index = EXCP_INTERRUPT;
@@ -1729,6 +1912,11 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb->cflags = cflags;
     tb->orig_tb = NULL;
     tb->trace_vcpu_dstate = *cpu->trace_dstate;
+    for (i = 0; i < TB_IND_CACHE_SIZE; i++) {
+        tb->ind_cache[i] = &tb_ind_sentinel;
+    }
+    tb->ret_tb = &tb_ind_sentinel;
+    tb->ret_pc = -1;
     tcg_ctx->tb_cflags = cflags;
  tb_overflow:
 
@@ -1918,6 +2106,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         return existing_tb;
     }
     tcg_tb_insert(tb);
+    perf_report_code(tb);
     return tb;
 }
 
@@ -1999,6 +2188,13 @@ tb_invalidate_phys_page_range__locked(struct page_collection *pages,
     if (!p->first_tb) {
         invalidate_page_bitmap(p);
         tlb_unprotect_code(start);
+    } else if (p->code_bitmap) {
+        /*
+         * Every TB that overlapped [start, end[ is gone, so no remaining
+         * code was translated from these bytes: further writes to them
+         * can skip the TB walk.
+         */
+        bitmap_clear(p->code_bitmap, start & ~TARGET_PAGE_MASK, end - start);
     }
 #endif
 #ifdef TARGET_HAS_PRECISE_SMC
@@ -2084,6 +2280,7 @@ void tb_invalidate_phys_page_fast(struct page_collection *pages,
                                   uintptr_t retaddr)
 {
     PageDesc *p;
+    unsigned int nr;
 
     assert_memory_lock();
 
@@ -2093,21 +2290,11 @@ void tb_invalidate_phys_page_fast(struct page_collection *pages,
     }
 
     assert_page_locked(p);
-    if (!p->code_bitmap &&
-        ++p->code_write_count >= SMC_BITMAP_USE_THRESHOLD) {
+    if (!p->code_bitmap) {
         build_page_bitmap(p);
     }
-    if (p->code_bitmap) {
-        unsigned int nr;
-        unsigned long b;
-
-        nr = start & ~TARGET_PAGE_MASK;
-        b = p->code_bitmap[BIT_WORD(nr)] >> (nr & (BITS_PER_LONG - 1));
-        if (b & ((1 << len) - 1)) {
-            goto do_invalidate;
-        }
-    } else {
-    do_invalidate:
+    nr = start & ~TARGET_PAGE_MASK;
+    if (find_next_bit(p->code_bitmap, nr + len, nr) < nr + len) {
         tb_invalidate_phys_page_range__locked(pages, p, start, start + len,
                                               retaddr);
     }
@@ -2282,10 +2469,19 @@ void cpu_io_recompile(CPUState *cpu, uintptr_t retaddr)
 
 static void tb_jmp_cache_clear_page(CPUState *cpu, target_ulong page_addr)
 {
-    unsigned int i, i0 = tb_jmp_cache_hash_page(page_addr);
+    CPUJumpCache *jc = cpu->tb_jmp_cache;
+    unsigned int i, i0 = tb_jmp_cache_hash_page(page_addr, jc->bits);
+    unsigned int n = 1u << tb_jmp_cache_page_bits(jc->bits);
 
-    for (i = 0; i < TB_JMP_PAGE_SIZE; i++) {
-        qatomic_set(&cpu->tb_jmp_cache[i0 + i], NULL);
+    for (i = 0; i < n; i++) {
+        qatomic_set(&jc->array[i0 + i], NULL);
+    }
+    for (i = 0; i < TB_JMP_VICTIM_SIZE; i++) {
+        TranslationBlock *tb = qatomic_read(&cpu->tb_jmp_victim[i]);
+
+        if (tb && (tb->pc & TARGET_PAGE_MASK) == page_addr) {
+            qatomic_set(&cpu->tb_jmp_victim[i], NULL);
+        }
     }
 }
 
@@ -2295,6 +2491,8 @@ void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr)
        overlap the flushed page.  */
     tb_jmp_cache_clear_page(cpu, addr - TARGET_PAGE_SIZE);
     tb_jmp_cache_clear_page(cpu, addr);
+    /* The return address stack is not indexed by page; drop it all.  */
+    cpu_tb_ras_clear(cpu);
 }
 
 static void print_qht_statistics(struct qht_stats hst)
@@ -2367,6 +2565,35 @@ static gboolean tb_tree_stats_iter(gpointer key, gpointer value, gpointer data)
     return false;
 }
 
+static void dump_jmp_cache_info(void)
+{
+    CPUState *cpu;
+
+    RCU_READ_LOCK_GUARD();
+
+    CPU_FOREACH(cpu) {
+        /* Racy, but good enough for statistics */
+        CPUJumpCacheStats st = cpu->tb_jmp_stats;
+        uint64_t lookups = st.hits + st.victim_hits +
+                           st.htable_hits + st.htable_misses;
+
+        qemu_printf("\nJump cache of CPU %d:\n", cpu->cpu_index);
+        qemu_printf("size                %u entries (%" PRIu64 " resizes)\n",
+                    1u << qatomic_rcu_read(&cpu->tb_jmp_cache)->bits,
+                    st.resizes);
+        qemu_printf("lookups             %" PRIu64 "\n", lookups);
+        qemu_printf("hits                %" PRIu64 " (%0.2f%%)\n", st.hits,
+                    lookups ? (double)st.hits * 100 / lookups : 0);
+        qemu_printf("victim hits         %" PRIu64 " (%0.2f%%)\n",
+                    st.victim_hits,
+                    lookups ? (double)st.victim_hits * 100 / lookups : 0);
+        qemu_printf("hash table hits     %" PRIu64 " (%0.2f%%)\n",
+                    st.htable_hits,
+                    lookups ? (double)st.htable_hits * 100 / lookups : 0);
+        qemu_printf("hash table misses   %" PRIu64 "\n", st.htable_misses);
+    }
+}
+
 void dump_exec_info(void)
 {
     struct tb_tree_stats tst = {};
@@ -2406,6 +2633,8 @@ void dump_exec_info(void)
     qemu_printf("\nStatistics:\n");
     qemu_printf("TB flush count      %u\n",
                 qatomic_read(&tb_ctx.tb_flush_count));
+    qemu_printf("TB reclaim count    %u\n",
+                qatomic_read(&tb_ctx.tb_reclaim_count));
     qemu_printf("TB invalidate count %zu\n",
                 tcg_tb_phys_invalidate_count());
 
@@ -2413,6 +2642,7 @@ void dump_exec_info(void)
     qemu_printf("TLB full flushes    %zu\n", flush_full);
     qemu_printf("TLB partial flushes %zu\n", flush_part);
     qemu_printf("TLB elided flushes  %zu\n", flush_elide);
+    dump_jmp_cache_info();
     tcg_dump_info();
 }
 
@@ -2461,17 +2691,18 @@ static int walk_memory_regions_1(struct walk_memory_regions_data *data,
                                  target_ulong base, int level, void **lp)
 {
     target_ulong pa;
+    void *l = qatomic_rcu_read(lp);
     int i, rc;
 
-    if (*lp == NULL) {
+    if (l == NULL) {
         return walk_memory_regions_end(data, base, 0);
     }
 
     if (level == 0) {
-        PageDesc *pd = *lp;
+        PageDesc *pd = l;
 
         for (i = 0; i < V_L2_SIZE; ++i) {
-            int prot = pd[i].flags;
+            int prot = qatomic_read(&pd[i].flags);
 
             pa = base | (i << TARGET_PAGE_BITS);
             if (prot != data->prot) {
@@ -2482,7 +2713,7 @@ static int walk_memory_regions_1(struct walk_memory_regions_data *data,
             }
         }
     } else {
-        void **pp = *lp;
+        void **pp = l;
 
         for (i = 0; i < V_L2_SIZE; ++i) {
             pa = base | ((target_ulong)i <<
@@ -2542,6 +2773,13 @@ void page_dump(FILE *f)
     walk_memory_regions(f, dump_region);
 }
 
+/*
+ * The page descriptor table is a radix tree whose inner nodes and leaves
+ * are published with cmpxchg and never freed, so lookups need no lock.
+ * Flag updates are serialized by mmap_lock; readers such as
+ * page_get_flags() and page_check_range() only rely on each descriptor's
+ * flags being read and written atomically.
+ */
 int page_get_flags(target_ulong address)
 {
     PageDesc *p;
@@ -2550,7 +2788,7 @@ int page_get_flags(target_ulong address)
     if (!p) {
         return 0;
     }
-    return p->flags;
+    return qatomic_read(&p->flags);
 }
 
 /* Modify the flags of a page and invalidate the code if necessary.
@@ -2558,7 +2796,7 @@ int page_get_flags(target_ulong address)
    on PAGE_WRITE.  The mmap_lock should already be held.  */
 void page_set_flags(target_ulong start, target_ulong end, int flags)
 {
-    target_ulong addr, len;
+    tb_page_addr_t index, count;
 
     /* This function should never be called with addresses outside the
        guest address space.  If this assert fires, it probably indicates
@@ -2574,27 +2812,30 @@ void page_set_flags(target_ulong start, target_ulong end, int flags)
         flags |= PAGE_WRITE_ORG;
     }
 
-    for (addr = start, len = end - start;
-         len != 0;
-         len -= TARGET_PAGE_SIZE, addr += TARGET_PAGE_SIZE) {
-        PageDesc *p = page_find_alloc(addr >> TARGET_PAGE_BITS, 1);
-
-        /* If the write protection bit is set, then we invalidate
-           the code inside.  */
-        if (!(p->flags & PAGE_WRITE) &&
-            (flags & PAGE_WRITE) &&
-            p->first_tb) {
-            tb_invalidate_phys_page(addr, 0);
+    index = start >> TARGET_PAGE_BITS;
+    count = (end - start) >> TARGET_PAGE_BITS;
+    while (count != 0) {
+        PageDesc *p = page_find_alloc(index, 1);
+        tb_page_addr_t n = MIN(count, page_leaf_remaining(index));
+
+        count -= n;
+        for (; n != 0; n--, index++, p++) {
+            /* If the write protection bit is set, then we invalidate
+               the code inside.  */
+            if (!(p->flags & PAGE_WRITE) &&
+                (flags & PAGE_WRITE) &&
+                p->first_tb) {
+                tb_invalidate_phys_page(index << TARGET_PAGE_BITS, 0);
+            }
+            qatomic_set(&p->flags, flags);
         }
-        p->flags = flags;
     }
 }
 
 int page_check_range(target_ulong start, target_ulong len, int flags)
 {
-    PageDesc *p;
+    tb_page_addr_t index, count;
     target_ulong end;
-    target_ulong addr;
 
     /* This function should never be called with addresses outside the
        guest address space.  If this assert fires, it probably indicates
@@ -2615,30 +2856,37 @@ int page_check_range(target_ulong start, target_ulong len, int flags)
     end = TARGET_PAGE_ALIGN(start + len);
     start = start & TARGET_PAGE_MASK;
 
-    for (addr = start, len = end - start;
-         len != 0;
-         len -= TARGET_PAGE_SIZE, addr += TARGET_PAGE_SIZE) {
-        p = page_find(addr >> TARGET_PAGE_BITS);
+    index = start >> TARGET_PAGE_BITS;
+    count = (end - start) >> TARGET_PAGE_BITS;
+    while (count != 0) {
+        PageDesc *p = page_find(index);
+        tb_page_addr_t n = MIN(count, page_leaf_remaining(index));
+
         if (!p) {
             return -1;
         }
-        if (!(p->flags & PAGE_VALID)) {
-            return -1;
-        }
+        count -= n;
+        for (; n != 0; n--, index++, p++) {
+            int pflags = qatomic_read(&p->flags);
 
-        if ((flags & PAGE_READ) && !(p->flags & PAGE_READ)) {
-            return -1;
-        }
-        if (flags & PAGE_WRITE) {
-            if (!(p->flags & PAGE_WRITE_ORG)) {
+            if (!(pflags & PAGE_VALID)) {
                 return -1;
             }
-            /* unprotect the page if it was put read-only because it
-               contains translated code */
-            if (!(p->flags & PAGE_WRITE)) {
-                if (!page_unprotect(addr, 0)) {
+
+            if ((flags & PAGE_READ) && !(pflags & PAGE_READ)) {
+                return -1;
+            }
+            if (flags & PAGE_WRITE) {
+                if (!(pflags & PAGE_WRITE_ORG)) {
                     return -1;
                 }
+                /* unprotect the page if it was put read-only because it
+                   contains translated code */
+                if (!(pflags & PAGE_WRITE)) {
+                    if (!page_unprotect(index << TARGET_PAGE_BITS, 0)) {
+                        return -1;
+                    }
+                }
             }
         }
     }
@@ -2658,26 +2906,43 @@ int page_unprotect(target_ulong address, uintptr_t pc)
     PageDesc *p;
     target_ulong host_start, host_end, addr;
 
-    /* Technically this isn't safe inside a signal handler.  However we
-       know this only ever happens in a synchronous SEGV handler, so in
-       practice it seems to be ok.  */
-    mmap_lock();
-
     p = page_find(address >> TARGET_PAGE_BITS);
     if (!p) {
-        mmap_unlock();
         return 0;
     }
 
+    /*
+     * If the page is actually marked WRITE then assume this is because
+     * this thread raced with another one which got here first and
+     * did the TB invalidate for us.  The winner only publishes PAGE_WRITE
+     * once the invalidation and the mprotect are complete, so the acquire
+     * makes CF_INVALID visible for the check below.  Neither the lookup
+     * above nor this check needs mmap_lock, so the threads that lost the
+     * race do not serialize behind the winner.
+     */
+    if ((qatomic_load_acquire(&p->flags) & (PAGE_WRITE_ORG | PAGE_WRITE)) ==
+        (PAGE_WRITE_ORG | PAGE_WRITE)) {
+        current_tb_invalidated = false;
+#ifdef TARGET_HAS_PRECISE_SMC
+        TranslationBlock *current_tb = tcg_tb_lookup(pc);
+        if (current_tb) {
+            current_tb_invalidated = tb_cflags(current_tb) & CF_INVALID;
+        }
+#endif
+        return current_tb_invalidated ? 2 : 1;
+    }
+
+    /* Technically this isn't safe inside a signal handler.  However we
+       know this only ever happens in a synchronous SEGV handler, so in
+       practice it seems to be ok.  */
+    mmap_lock();
+
     /* if the page was really writable, then we change its
        protection back to writable */
     if (p->flags & PAGE_WRITE_ORG) {
         current_tb_invalidated = false;
         if (p->flags & PAGE_WRITE) {
-            /* If the page is actually marked WRITE then assume this is because
-             * this thread raced with another one which got here first and
-             * set the page to PAGE_WRITE and did the TB invalidate for us.
-             */
+            /* We lost the race against another thread after all.  */
 #ifdef TARGET_HAS_PRECISE_SMC
             TranslationBlock *current_tb = tcg_tb_lookup(pc);
             if (current_tb) {
@@ -2688,10 +2953,9 @@ int page_unprotect(target_ulong address, uintptr_t pc)
             host_start = address & qemu_host_page_mask;
             host_end = host_start + qemu_host_page_size;
 
-            prot = 0;
+            prot = PAGE_WRITE;
             for (addr = host_start; addr < host_end; addr += TARGET_PAGE_SIZE) {
                 p = page_find(addr >> TARGET_PAGE_BITS);
-                p->flags |= PAGE_WRITE;
                 prot |= p->flags;
 
                 /* and since the content will be modified, we must invalidate
@@ -2705,6 +2969,12 @@ int page_unprotect(target_ulong address, uintptr_t pc)
             }
             mprotect((void *)g2h(host_start), qemu_host_page_size,
                      prot & PAGE_BITS);
+
+            /* Only now may other threads skip the work above.  */
+            for (addr = host_start; addr < host_end; addr += TARGET_PAGE_SIZE) {
+                p = page_find(addr >> TARGET_PAGE_BITS);
+                qatomic_store_release(&p->flags, p->flags | PAGE_WRITE);
+            }
         }
         mmap_unlock();
         /* If current TB was invalidated return to main loop */
@@ -147,3 +147,164 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     }
 #endif
 }
+
+/*
+ * Offset from env of a field of CPUState.  Every ArchCPU starts with its
+ * CPUState, see env_cpu().
+ */
+#define CPU_STATE_OFS(field) \
+    (offsetof(ArchCPU, parent_obj.field) - offsetof(ArchCPU, env))
+
+static bool translator_use_ind_cache(DisasContextBase *db)
+{
+    return TCG_TARGET_HAS_goto_ptr
+        && !qemu_loglevel_mask(CPU_LOG_TB_NOCHAIN)
+        && !(tb_cflags(db->tb) & CF_NOCACHE);
+}
+
+/* Compute in @ptr the address of the return address stack slot @top.  */
+static void gen_ras_slot(TCGv_ptr ptr, TCGv_i32 top)
+{
+    TCGv_i32 t = tcg_temp_new_i32();
+
+    tcg_gen_shli_i32(t, top, ctz32(sizeof(void *)));
+    tcg_gen_ext_i32_ptr(ptr, t);
+    tcg_gen_add_ptr(ptr, ptr, cpu_env);
+    tcg_temp_free_i32(t);
+}
+
+/*
+ * Jump to the TB pointed to by @x if it is valid and starts at @pc.
+ * If @check_state, also require it to have the cs_base, flags and trace
+ * dstate of @site.  Otherwise, branch to @miss.
+ */
+static void gen_goto_cached_tb(TranslationBlock *site, TCGv_ptr x, TCGv pc,
+                               bool check_state, TCGLabel *miss)
+{
+    TCGv d = tcg_temp_new();
+    TCGv t = tcg_temp_new();
+    TCGv_i32 t32 = tcg_temp_new_i32();
+    TCGv_ptr host = tcg_temp_local_new_ptr();
+
+    /* Accumulate in D any difference from what we are looking for.  */
+    tcg_gen_ld_tl(d, x, offsetof(TranslationBlock, pc));
+    tcg_gen_xor_tl(d, d, pc);
+    if (check_state) {
+        tcg_gen_ld_tl(t, x, offsetof(TranslationBlock, cs_base));
+        tcg_gen_xori_tl(t, t, site->cs_base);
+        tcg_gen_or_tl(d, d, t);
+        tcg_gen_ld_i32(t32, x, offsetof(TranslationBlock, flags));
+        tcg_gen_xori_i32(t32, t32, site->flags);
+        tcg_gen_extu_i32_tl(t, t32);
+        tcg_gen_or_tl(d, d, t);
+        tcg_gen_ld_i32(t32, x, offsetof(TranslationBlock, trace_vcpu_dstate));
+        tcg_gen_xori_i32(t32, t32, site->trace_vcpu_dstate);
+        tcg_gen_extu_i32_tl(t, t32);
+        tcg_gen_or_tl(d, d, t);
+    }
+    tcg_gen_ld_i32(t32, x, offsetof(TranslationBlock, cflags));
+    tcg_gen_andi_i32(t32, t32, CF_INVALID);
+    tcg_gen_extu_i32_tl(t, t32);
+    tcg_gen_or_tl(d, d, t);
+    tcg_gen_ld_ptr(host, x, offsetof(TranslationBlock, tc.ptr));
+
+    tcg_gen_brcondi_tl(TCG_COND_NE, d, 0, miss);
+    tcg_gen_op1i(INDEX_op_goto_ptr, tcgv_ptr_arg(host));
+
+    tcg_temp_free(d);
+    tcg_temp_free(t);
+    tcg_temp_free_i32(t32);
+    tcg_temp_free_ptr(host);
+}
+
+void translator_push_return(DisasContextBase *db, target_ulong ret_pc)
+{
+    TranslationBlock *tb = db->tb;
+    TCGv_i32 top;
+    TCGv_ptr ptr, tb_ptr;
+
+    if (!translator_use_ind_cache(db)) {
+        return;
+    }
+    tb->ret_pc = ret_pc;
+
+    top = tcg_temp_new_i32();
+    tcg_gen_ld_i32(top, cpu_env, CPU_STATE_OFS(tb_ras_top));
+    tcg_gen_addi_i32(top, top, 1);
+    tcg_gen_andi_i32(top, top, TB_RAS_SIZE - 1);
+    tcg_gen_st_i32(top, cpu_env, CPU_STATE_OFS(tb_ras_top));
+
+    ptr = tcg_temp_new_ptr();
+    gen_ras_slot(ptr, top);
+    tcg_temp_free_i32(top);
+
+    tb_ptr = tcg_const_ptr(tb);
+    tcg_gen_st_ptr(tb_ptr, ptr, CPU_STATE_OFS(tb_ras[0]));
+    tcg_temp_free_ptr(tb_ptr);
+    tcg_temp_free_ptr(ptr);
+}
+
+void translator_lookup_and_goto_ptr(DisasContextBase *db, TCGv dest,
+                                    bool is_return)
+{
+    TranslationBlock *tb = db->tb;
+    TCGv pc;
+    TCGv_ptr x, tb_ptr, ret;
+    int i;
+
+    if (!translator_use_ind_cache(db)) {
+        tcg_gen_lookup_and_goto_ptr();
+        return;
+    }
+
+    plugin_gen_disable_mem_helpers();
+
+    pc = tcg_temp_local_new();
+    tcg_gen_mov_tl(pc, dest);
+    x = tcg_temp_new_ptr();
+
+    if (is_return) {
+        TCGLabel *miss = gen_new_label();
+        TCGv_ptr caller = tcg_temp_local_new_ptr();
+        TCGv_i32 top = tcg_temp_new_i32();
+
+        /* Pop the TB which made the call we are returning from.  */
+        tcg_gen_ld_i32(top, cpu_env, CPU_STATE_OFS(tb_ras_top));
+        gen_ras_slot(x, top);
+        tcg_gen_ld_ptr(caller, x, CPU_STATE_OFS(tb_ras[0]));
+        tcg_gen_subi_i32(top, top, 1);
+        tcg_gen_andi_i32(top, top, TB_RAS_SIZE - 1);
+        tcg_gen_st_i32(top, cpu_env, CPU_STATE_OFS(tb_ras_top));
+        tcg_temp_free_i32(top);
+
+        tcg_gen_brcondi_ptr(TCG_COND_EQ, caller, 0, miss);
+        tcg_gen_ld_ptr(x, caller, offsetof(TranslationBlock, ret_tb));
+        gen_goto_cached_tb(tb, x, pc, true, miss);
+
+        gen_set_label(miss);
+        ret = tcg_temp_new_ptr();
+        tb_ptr = tcg_const_ptr(tb);
+        gen_helper_lookup_tb_ptr_ret(ret, cpu_env, tb_ptr, caller);
+        tcg_temp_free_ptr(caller);
+    } else {
+        /* Most recently used targets first.  */
+        for (i = 0; i < TB_IND_CACHE_SIZE; i++) {
+            TCGLabel *next = gen_new_label();
+
+            tb_ptr = tcg_const_ptr(tb);
+            tcg_gen_ld_ptr(x, tb_ptr, offsetof(TranslationBlock, ind_cache[i]));
+            tcg_temp_free_ptr(tb_ptr);
+            gen_goto_cached_tb(tb, x, pc, false, next);
+            gen_set_label(next);
+        }
+        ret = tcg_temp_new_ptr();
+        tb_ptr = tcg_const_ptr(tb);
+        gen_helper_lookup_tb_ptr_ind(ret, cpu_env, tb_ptr);
+    }
+    tcg_gen_op1i(INDEX_op_goto_ptr, tcgv_ptr_arg(ret));
+
+    tcg_temp_free_ptr(tb_ptr);
+    tcg_temp_free_ptr(ret);
+    tcg_temp_free_ptr(x);
+    tcg_temp_free(pc);
+}
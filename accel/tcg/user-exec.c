@@ -1243,7 +1243,7 @@ static void *atomic_mmu_lookup(CPUArchState *env, target_ulong addr,
 /* The following is only callable from other helpers, and matches up
    with the softmmu version.  */
 
-#if HAVE_ATOMIC128 || HAVE_CMPXCHG128
+#if MAYBE_ATOMIC128 || MAYBE_CMPXCHG128
 
 #undef EXTRA_ARGS
 #undef ATOMIC_NAME
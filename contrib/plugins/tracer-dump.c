@@ -0,0 +1,94 @@
+/*
+ * Dump the traces written by the tracer plugin, or measure how fast
+ * they can be decoded
+ *
+ * Usage: tracer-dump [-s] <trace>
+ *   -s  only print statistics, including the decoding throughput
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "tracer.h"
+
+static void print_event(const TracerEvent *ev)
+{
+    if (ev->type == TRACER_EVENT_BLOCK) {
+        printf("%u: block 0x%016" PRIx64 " (%" PRIu32 " insns)\n",
+               ev->vcpu_index, ev->pc, ev->block->n_insns);
+    } else {
+        printf("%u: mem   0x%016" PRIx64 " vaddr 0x%016" PRIx64
+               " info 0x%08" PRIx32 "\n",
+               ev->vcpu_index, ev->pc, ev->vaddr, ev->info);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    g_autoptr(GTimer) timer = g_timer_new();
+    uint64_t n_block_events = 0;
+    uint64_t n_mem_events = 0;
+    uint64_t n_insns = 0;
+    bool stats = false;
+    const char *path;
+    TracerReader *r;
+    TracerEvent ev;
+    char *err = NULL;
+    double secs;
+
+    if (argc == 3 && !strcmp(argv[1], "-s")) {
+        stats = true;
+        path = argv[2];
+    } else if (argc == 2) {
+        path = argv[1];
+    } else {
+        fprintf(stderr, "Usage: %s [-s] <trace>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    r = tracer_reader_open(path, &err);
+    if (r == NULL) {
+        fprintf(stderr, "%s: %s\n", argv[0], err);
+        g_free(err);
+        return EXIT_FAILURE;
+    }
+
+    g_timer_start(timer);
+    while (tracer_reader_next(r, &ev, &err)) {
+        if (ev.type == TRACER_EVENT_BLOCK) {
+            n_block_events++;
+            n_insns += ev.block->n_insns;
+        } else {
+            n_mem_events++;
+        }
+        if (!stats) {
+            print_event(&ev);
+        }
+    }
+    secs = g_timer_elapsed(timer, NULL);
+
+    if (err) {
+        fprintf(stderr, "%s: %s\n", argv[0], err);
+        g_free(err);
+        tracer_reader_close(r);
+        return EXIT_FAILURE;
+    }
+
+    if (stats) {
+        printf("blocks defined:   %zu\n", tracer_reader_n_blocks(r));
+        printf("blocks executed:  %" PRIu64 "\n", n_block_events);
+        printf("insns executed:   %" PRIu64 "\n", n_insns);
+        printf("memory accesses:  %" PRIu64 "\n", n_mem_events);
+        printf("decoding time:    %.3f s (%.1f M events/s)\n", secs,
+               secs ? (n_block_events + n_mem_events) / secs / 1e6 : 0.0);
+    }
+    tracer_reader_close(r);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,266 @@
+/*
+ * Reader for the traces written by the tracer plugin
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#ifdef CONFIG_ZSTD
+#include <zstd.h>
+#endif
+
+#include "tracer.h"
+
+typedef struct {
+    const TracerBlock *block;
+    uint64_t last_vaddr;
+} VCPUState;
+
+struct TracerReader {
+    FILE *f;
+    bool zstd;
+    /* TracerBlock pointers, indexed by id */
+    GPtrArray *blocks;
+    uint64_t last_block_pc;
+    /* VCPUState, indexed by vCPU */
+    GArray *vcpus;
+    /* the current chunk, decompressed */
+    uint32_t stream;
+    uint8_t *chunk;
+    size_t len;
+    size_t pos;
+    uint8_t *zbuf;
+    size_t zbuf_size;
+};
+
+static bool get_varint(TracerReader *r, uint64_t *v, char **errp)
+{
+    unsigned int shift = 0;
+
+    *v = 0;
+    while (r->pos < r->len && shift < 64) {
+        uint8_t b = r->chunk[r->pos++];
+
+        *v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+        shift += 7;
+    }
+    *errp = g_strdup("truncated or corrupt chunk");
+    return false;
+}
+
+static bool read_blocks(TracerReader *r, char **errp)
+{
+    while (r->pos < r->len) {
+        TracerBlock *block;
+        uint64_t delta, n, size;
+        uint32_t *offsets;
+        GByteArray *data;
+        uint64_t i;
+
+        if (!get_varint(r, &delta, errp) || !get_varint(r, &n, errp)) {
+            return false;
+        }
+        if (n == 0 || n > r->len) {
+            *errp = g_strdup_printf("bad block with %" PRIu64 " insns", n);
+            return false;
+        }
+        offsets = g_new(uint32_t, n + 1);
+        data = g_byte_array_new();
+        offsets[0] = 0;
+        for (i = 0; i < n; i++) {
+            if (!get_varint(r, &size, errp) || size > r->len - r->pos) {
+                if (*errp == NULL) {
+                    *errp = g_strdup("truncated block");
+                }
+                g_free(offsets);
+                g_byte_array_unref(data);
+                return false;
+            }
+            g_byte_array_append(data, r->chunk + r->pos, size);
+            r->pos += size;
+            offsets[i + 1] = data->len;
+        }
+
+        block = g_new(TracerBlock, 1);
+        block->pc = r->last_block_pc + tracer_unzigzag(delta);
+        block->n_insns = n;
+        block->insn_offset = offsets;
+        block->data = g_byte_array_free(data, false);
+        r->last_block_pc = block->pc;
+        g_ptr_array_add(r->blocks, block);
+    }
+    return true;
+}
+
+/* returns false at the end of the file, or on error with @errp set */
+static bool read_chunk(TracerReader *r, char **errp)
+{
+    TracerChunkHeader hdr;
+    uint32_t size, raw_size;
+
+    if (fread(&hdr, sizeof(hdr), 1, r->f) != 1) {
+        if (ferror(r->f)) {
+            *errp = g_strdup("error reading chunk header");
+        }
+        return false;
+    }
+    size = GUINT32_FROM_LE(hdr.size);
+    raw_size = GUINT32_FROM_LE(hdr.raw_size);
+    if (raw_size > TRACER_CHUNK_SIZE ||
+        (!r->zstd && size != raw_size)) {
+        *errp = g_strdup("bad chunk header");
+        return false;
+    }
+
+    if (r->zstd) {
+#ifdef CONFIG_ZSTD
+        size_t ret;
+
+        if (size > r->zbuf_size) {
+            r->zbuf_size = size;
+            r->zbuf = g_realloc(r->zbuf, size);
+        }
+        if (fread(r->zbuf, size, 1, r->f) != 1) {
+            *errp = g_strdup("truncated chunk");
+            return false;
+        }
+        ret = ZSTD_decompress(r->chunk, TRACER_CHUNK_SIZE, r->zbuf, size);
+        if (ZSTD_isError(ret) || ret != raw_size) {
+            *errp = g_strdup("corrupt compressed chunk");
+            return false;
+        }
+#endif
+    } else if (raw_size && fread(r->chunk, raw_size, 1, r->f) != 1) {
+        *errp = g_strdup("truncated chunk");
+        return false;
+    }
+
+    r->stream = GUINT32_FROM_LE(hdr.stream);
+    r->len = raw_size;
+    r->pos = 0;
+    return true;
+}
+
+TracerReader *tracer_reader_open(const char *path, char **errp)
+{
+    TracerFileHeader hdr;
+    TracerReader *r;
+    FILE *f;
+
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        *errp = g_strdup_printf("cannot open %s", path);
+        return NULL;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+        memcmp(hdr.magic, TRACER_MAGIC, sizeof(TRACER_MAGIC)) ||
+        GUINT32_FROM_LE(hdr.version) != TRACER_VERSION) {
+        *errp = g_strdup_printf("%s is not a trace", path);
+        fclose(f);
+        return NULL;
+    }
+
+    r = g_new0(TracerReader, 1);
+    r->f = f;
+    r->zstd = GUINT32_FROM_LE(hdr.flags) & TRACER_FLAG_ZSTD;
+#ifndef CONFIG_ZSTD
+    if (r->zstd) {
+        *errp = g_strdup_printf("%s is compressed, but zstd is unavailable",
+                                path);
+        fclose(f);
+        g_free(r);
+        return NULL;
+    }
+#endif
+    r->blocks = g_ptr_array_new();
+    r->vcpus = g_array_new(false, true, sizeof(VCPUState));
+    r->chunk = g_malloc(TRACER_CHUNK_SIZE);
+    return r;
+}
+
+bool tracer_reader_next(TracerReader *r, TracerEvent *ev, char **errp)
+{
+    VCPUState *vcpu;
+    uint64_t tag;
+
+    *errp = NULL;
+    while (r->pos == r->len) {
+        if (!read_chunk(r, errp)) {
+            return false;
+        }
+        if (r->stream == TRACER_STREAM_BLOCKS && !read_blocks(r, errp)) {
+            return false;
+        }
+    }
+
+    if (r->stream >= r->vcpus->len) {
+        g_array_set_size(r->vcpus, r->stream + 1);
+    }
+    vcpu = &g_array_index(r->vcpus, VCPUState, r->stream);
+
+    if (!get_varint(r, &tag, errp)) {
+        return false;
+    }
+    ev->vcpu_index = r->stream;
+    if (!(tag & 1)) {
+        if (tag >> 1 >= r->blocks->len) {
+            *errp = g_strdup_printf("undefined block %" PRIu64, tag >> 1);
+            return false;
+        }
+        vcpu->block = g_ptr_array_index(r->blocks, tag >> 1);
+        ev->type = TRACER_EVENT_BLOCK;
+        ev->block = vcpu->block;
+        ev->pc = vcpu->block->pc;
+        ev->vaddr = 0;
+        ev->info = 0;
+    } else {
+        uint64_t delta, info;
+
+        if (vcpu->block == NULL) {
+            *errp = g_strdup("memory access outside of a block");
+            return false;
+        }
+        if (!get_varint(r, &delta, errp) || !get_varint(r, &info, errp)) {
+            return false;
+        }
+        vcpu->last_vaddr += tracer_unzigzag(delta);
+        ev->type = TRACER_EVENT_MEM;
+        ev->block = vcpu->block;
+        ev->pc = vcpu->block->pc + (tag >> 1);
+        ev->vaddr = vcpu->last_vaddr;
+        ev->info = info;
+    }
+    return true;
+}
+
+size_t tracer_reader_n_blocks(const TracerReader *r)
+{
+    return r->blocks->len;
+}
+
+void tracer_reader_close(TracerReader *r)
+{
+    guint i;
+
+    for (i = 0; i < r->blocks->len; i++) {
+        TracerBlock *block = g_ptr_array_index(r->blocks, i);
+
+        g_free((void *)block->insn_offset);
+        g_free((void *)block->data);
+        g_free(block);
+    }
+    g_ptr_array_free(r->blocks, true);
+    g_array_free(r->vcpus, true);
+    g_free(r->chunk);
+    g_free(r->zbuf);
+    fclose(r->f);
+    g_free(r);
+}
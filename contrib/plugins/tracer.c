@@ -0,0 +1,381 @@
+/*
+ * Execution trace recorder
+ *
+ * Records the blocks executed by each vCPU, and optionally their memory
+ * accesses, into a compact binary trace; see tracer.h for the format
+ * and for a reader. Events are collected with buffered records, encoded
+ * on the vCPU that produced them, and handed over to a background thread
+ * that compresses and writes them out.
+ *
+ * Usage:
+ *   -plugin libtracer.so,arg=file=<path>[,arg=mem=off][,arg=compress=off]
+ *                        [,arg=level=<zstd level>]
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#ifdef CONFIG_ZSTD
+#include <zstd.h>
+#endif
+
+#include <qemu-plugin.h>
+
+#include "tracer.h"
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+/* room needed to encode any one execution event */
+#define MAX_EVENT_SIZE 32
+
+/* chunks waiting for the writer before vCPUs have to wait for it */
+#define MAX_QUEUED_CHUNKS 64
+
+/* a chunk with NULL @data tells the writer to stop */
+typedef struct {
+    uint32_t stream;
+    uint8_t *data;
+    size_t len;
+} Chunk;
+
+/* encoder state of a stream; vCPUs keep theirs in a scoreboard */
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    /* pc of the current block, or of the last block defined */
+    uint64_t pc;
+    uint64_t last_vaddr;
+} Stream;
+
+typedef struct {
+    uint64_t pc;
+    uint64_t id;
+    size_t n_insns;
+    GByteArray *code;
+} Block;
+
+static struct qemu_plugin_trace *trace;
+static struct qemu_plugin_scoreboard *streams;
+static unsigned int n_vcpus;
+static bool trace_mem = true;
+static bool compress = true;
+static int level = 3;
+
+/* the latest block at each PC, so that retranslations keep their id */
+static GMutex blocks_lock;
+static GHashTable *blocks;
+static uint64_t n_blocks;
+
+/* block definitions not yet handed over to the writer */
+static GMutex defs_lock;
+static Stream defs;
+
+static GMutex queue_lock;
+static GCond queue_cond;
+static GQueue queue = G_QUEUE_INIT;
+
+/* only accessed by the writer thread until it is joined */
+static GThread *writer;
+static FILE *out;
+static uint64_t raw_bytes;
+static uint64_t stored_bytes;
+
+static void queue_chunk(uint32_t stream, uint8_t *data, size_t len)
+{
+    Chunk *c = g_new(Chunk, 1);
+
+    c->stream = stream;
+    c->data = data;
+    c->len = len;
+
+    g_mutex_lock(&queue_lock);
+    while (data && g_queue_get_length(&queue) >= MAX_QUEUED_CHUNKS) {
+        g_cond_wait(&queue_cond, &queue_lock);
+    }
+    g_queue_push_tail(&queue, c);
+    g_cond_broadcast(&queue_cond);
+    g_mutex_unlock(&queue_lock);
+}
+
+static void write_chunk(const Chunk *c, void *zbuf, size_t zbuf_size,
+                        void *cctx)
+{
+    TracerChunkHeader hdr = { 0 };
+    const void *payload = c->data;
+    size_t size = c->len;
+
+#ifdef CONFIG_ZSTD
+    if (compress) {
+        size = ZSTD_compressCCtx(cctx, zbuf, zbuf_size, c->data, c->len,
+                                 level);
+        g_assert(!ZSTD_isError(size));
+        payload = zbuf;
+    }
+#endif
+    hdr.stream = GUINT32_TO_LE(c->stream);
+    hdr.size = GUINT32_TO_LE(size);
+    hdr.raw_size = GUINT32_TO_LE(c->len);
+    fwrite(&hdr, sizeof(hdr), 1, out);
+    fwrite(payload, size, 1, out);
+
+    raw_bytes += c->len;
+    stored_bytes += sizeof(hdr) + size;
+}
+
+static gpointer writer_thread(gpointer opaque)
+{
+    void *zbuf = NULL;
+    size_t zbuf_size = 0;
+    void *cctx = NULL;
+
+#ifdef CONFIG_ZSTD
+    if (compress) {
+        zbuf_size = ZSTD_compressBound(TRACER_CHUNK_SIZE);
+        zbuf = g_malloc(zbuf_size);
+        cctx = ZSTD_createCCtx();
+    }
+#endif
+
+    for (;;) {
+        Chunk *c;
+
+        g_mutex_lock(&queue_lock);
+        while (g_queue_is_empty(&queue)) {
+            g_cond_wait(&queue_cond, &queue_lock);
+        }
+        c = g_queue_pop_head(&queue);
+        g_cond_broadcast(&queue_cond);
+        g_mutex_unlock(&queue_lock);
+
+        if (c->data == NULL) {
+            g_free(c);
+            break;
+        }
+        write_chunk(c, zbuf, zbuf_size, cctx);
+        g_free(c->data);
+        g_free(c);
+    }
+
+#ifdef CONFIG_ZSTD
+    ZSTD_freeCCtx(cctx);
+#endif
+    g_free(zbuf);
+    return NULL;
+}
+
+static void stream_put(Stream *s, uint64_t v)
+{
+    s->len += tracer_put_varint(s->buf + s->len, v);
+}
+
+/* make sure @s has room for @size more bytes, handing it over if needed */
+static void stream_reserve(Stream *s, uint32_t stream, size_t size)
+{
+    if (s->buf && s->len + size > TRACER_CHUNK_SIZE) {
+        queue_chunk(stream, s->buf, s->len);
+        s->buf = NULL;
+    }
+    if (s->buf == NULL) {
+        s->buf = g_malloc(TRACER_CHUNK_SIZE);
+        s->len = 0;
+    }
+}
+
+static void stream_flush(Stream *s, uint32_t stream)
+{
+    if (s->buf && s->len) {
+        queue_chunk(stream, s->buf, s->len);
+        s->buf = NULL;
+        s->len = 0;
+    }
+}
+
+/* the blocks a vCPU chunk refers to must be written before it */
+static void vcpu_stream_flush(Stream *s, unsigned int vcpu_index)
+{
+    g_mutex_lock(&defs_lock);
+    stream_flush(&defs, TRACER_STREAM_BLOCKS);
+    g_mutex_unlock(&defs_lock);
+
+    stream_flush(s, vcpu_index);
+}
+
+static void vcpu_trace_flush(unsigned int vcpu_index,
+                             const qemu_plugin_trace_record *records,
+                             size_t n, void *udata)
+{
+    Stream *s = qemu_plugin_scoreboard_find(streams, vcpu_index);
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        const qemu_plugin_trace_record *rec = &records[i];
+
+        if (s->buf == NULL || s->len + MAX_EVENT_SIZE > TRACER_CHUNK_SIZE) {
+            vcpu_stream_flush(s, vcpu_index);
+            stream_reserve(s, vcpu_index, MAX_EVENT_SIZE);
+        }
+
+        if (rec->type == QEMU_PLUGIN_TRACE_INSN) {
+            /* the block's id was registered as the record's data */
+            s->pc = rec->pc;
+            stream_put(s, rec->vaddr << 1);
+        } else {
+            stream_put(s, (rec->pc - s->pc) << 1 | 1);
+            stream_put(s, tracer_zigzag(rec->vaddr - s->last_vaddr));
+            stream_put(s, rec->info);
+            s->last_vaddr = rec->vaddr;
+        }
+    }
+}
+
+static void block_free(gpointer data)
+{
+    Block *block = data;
+
+    g_byte_array_unref(block->code);
+    g_free(block);
+}
+
+/* called with blocks_lock held */
+static void define_block(Block *block)
+{
+    g_mutex_lock(&defs_lock);
+    stream_reserve(&defs, TRACER_STREAM_BLOCKS,
+                   MAX_EVENT_SIZE + block->code->len);
+    stream_put(&defs, tracer_zigzag(block->pc - defs.pc));
+    stream_put(&defs, block->n_insns);
+    memcpy(defs.buf + defs.len, block->code->data, block->code->len);
+    defs.len += block->code->len;
+    defs.pc = block->pc;
+    g_mutex_unlock(&defs_lock);
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    uint64_t pc = qemu_plugin_tb_vaddr(tb);
+    size_t n = qemu_plugin_tb_n_insns(tb);
+    GByteArray *code = g_byte_array_new();
+    Block *block;
+    uint64_t block_id;
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        size_t size = qemu_plugin_insn_size(insn);
+        uint8_t v[10];
+
+        g_byte_array_append(code, v, tracer_put_varint(v, size));
+        g_byte_array_append(code, qemu_plugin_insn_data(insn), size);
+        if (trace_mem) {
+            qemu_plugin_register_vcpu_mem_buffered(insn, QEMU_PLUGIN_MEM_RW,
+                                                   trace);
+        }
+    }
+
+    g_mutex_lock(&blocks_lock);
+    block = g_hash_table_lookup(blocks, &pc);
+    if (block && block->n_insns == n && block->code->len == code->len &&
+        !memcmp(block->code->data, code->data, code->len)) {
+        g_byte_array_unref(code);
+    } else {
+        block = g_new(Block, 1);
+        block->pc = pc;
+        block->id = n_blocks++;
+        block->n_insns = n;
+        block->code = code;
+        g_hash_table_replace(blocks, &block->pc, block);
+        define_block(block);
+    }
+    block_id = block->id;
+    g_mutex_unlock(&blocks_lock);
+
+    qemu_plugin_register_vcpu_insn_exec_buffered(qemu_plugin_tb_get_insn(tb, 0),
+                                                 trace, block_id);
+}
+
+static void vcpu_init(qemu_plugin_id_t id, unsigned int vcpu_index)
+{
+    g_mutex_lock(&queue_lock);
+    n_vcpus = MAX(n_vcpus, vcpu_index + 1);
+    g_mutex_unlock(&queue_lock);
+}
+
+/* all buffered records have been flushed by the time we get here */
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_autoptr(GString) report = g_string_new("");
+    unsigned int i;
+
+    for (i = 0; i < n_vcpus; i++) {
+        vcpu_stream_flush(qemu_plugin_scoreboard_find(streams, i), i);
+    }
+    g_mutex_lock(&defs_lock);
+    stream_flush(&defs, TRACER_STREAM_BLOCKS);
+    g_mutex_unlock(&defs_lock);
+
+    queue_chunk(0, NULL, 0);
+    g_thread_join(writer);
+
+    if (fclose(out)) {
+        g_string_append(report, "tracer: error writing the trace\n");
+    }
+    g_string_append_printf(report, "tracer: %" PRIu64 " blocks, %" PRIu64
+                           " bytes of events, %" PRIu64 " bytes written\n",
+                           n_blocks, raw_bytes, stored_bytes);
+    qemu_plugin_outs(report->str);
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
+                                           const qemu_info_t *info,
+                                           int argc, char **argv)
+{
+    TracerFileHeader hdr = { TRACER_MAGIC };
+    const char *path = "qemu.trace";
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        char *opt = argv[i];
+
+        if (g_str_has_prefix(opt, "file=")) {
+            path = opt + strlen("file=");
+        } else if (!strcmp(opt, "mem=off")) {
+            trace_mem = false;
+        } else if (!strcmp(opt, "compress=off")) {
+            compress = false;
+        } else if (g_str_has_prefix(opt, "level=")) {
+            level = atoi(opt + strlen("level="));
+        } else {
+            fprintf(stderr, "tracer: unknown option %s\n", opt);
+            return -1;
+        }
+    }
+#ifndef CONFIG_ZSTD
+    compress = false;
+#endif
+
+    out = fopen(path, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "tracer: cannot open %s\n", path);
+        return -1;
+    }
+    hdr.version = GUINT32_TO_LE(TRACER_VERSION);
+    hdr.flags = GUINT32_TO_LE(compress ? TRACER_FLAG_ZSTD : 0);
+    fwrite(&hdr, sizeof(hdr), 1, out);
+
+    blocks = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL,
+                                   block_free);
+    streams = qemu_plugin_scoreboard_new(sizeof(Stream));
+    trace = qemu_plugin_trace_new(vcpu_trace_flush, NULL);
+    writer = g_thread_new("tracer-writer", writer_thread, NULL);
+
+    qemu_plugin_register_vcpu_init_cb(id, vcpu_init);
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
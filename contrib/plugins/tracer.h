@@ -0,0 +1,131 @@
+/*
+ * Execution trace format written by the tracer plugin, and a reader for it
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * A trace file is a header followed by chunks. Each chunk belongs to a
+ * stream: either the execution stream of one vCPU, or the block stream
+ * shared by all of them. All integers in headers are little-endian.
+ *
+ * The payload of a chunk, once decompressed if TRACER_FLAG_ZSTD is set,
+ * is a sequence of LEB128 varints. The block stream defines translation
+ * blocks, whose ids are implicitly 0, 1, 2... in order of definition:
+ *
+ *   zigzag(pc - previous block's pc), n_insns,
+ *   then for each instruction: size, followed by its bytes
+ *
+ * A block is always defined in an earlier chunk than any reference to it.
+ * A vCPU's execution stream is a sequence of events:
+ *
+ *   tag, with bit 0 clear: block (tag >> 1) starts executing
+ *   tag, with bit 0 set: the instruction at offset (tag >> 1) from the
+ *        start of the block accesses memory; followed by zigzag(address -
+ *        previous access' address) and the access' meminfo
+ *
+ * Blocks are recorded as they start executing; an exception part way
+ * through a block is not recorded as such.
+ */
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRACER_MAGIC "QEMUTRC"
+#define TRACER_VERSION 1
+
+#define TRACER_FLAG_ZSTD 1
+
+/* stream of a chunk holding block definitions */
+#define TRACER_STREAM_BLOCKS UINT32_MAX
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+} TracerFileHeader;
+
+typedef struct {
+    uint32_t stream;
+    /* sizes of the payload as stored, and once decompressed */
+    uint32_t size;
+    uint32_t raw_size;
+    uint32_t reserved;
+} TracerChunkHeader;
+
+/* chunks hold at most this many bytes once decompressed */
+#define TRACER_CHUNK_SIZE (1 << 20)
+
+static inline uint64_t tracer_zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t tracer_unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* returns the number of bytes written, at most 10 */
+static inline size_t tracer_put_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = v;
+    return n;
+}
+
+/*
+ * Reader
+ */
+typedef struct {
+    uint64_t pc;
+    uint32_t n_insns;
+    /* offsets of each instruction from @pc, with n_insns + 1 entries */
+    const uint32_t *insn_offset;
+    /* the instructions' bytes */
+    const uint8_t *data;
+} TracerBlock;
+
+typedef enum {
+    TRACER_EVENT_BLOCK,
+    TRACER_EVENT_MEM,
+} TracerEventType;
+
+typedef struct {
+    TracerEventType type;
+    unsigned int vcpu_index;
+    /* the block being executed */
+    const TracerBlock *block;
+    /* address of the block, or of the instruction accessing memory */
+    uint64_t pc;
+    /* memory accesses only */
+    uint64_t vaddr;
+    uint32_t info;
+} TracerEvent;
+
+typedef struct TracerReader TracerReader;
+
+/* returns NULL and sets @errp on error */
+TracerReader *tracer_reader_open(const char *path, char **errp);
+
+/*
+ * Fills in @ev with the next event in file order, i.e. each vCPU's events
+ * are in execution order. Returns false at the end of the trace, or on
+ * error, in which case @errp is set.
+ */
+bool tracer_reader_next(TracerReader *r, TracerEvent *ev, char **errp);
+
+size_t tracer_reader_n_blocks(const TracerReader *r);
+
+void tracer_reader_close(TracerReader *r);
+
+#endif /* TRACER_H */
@@ -22,6 +22,25 @@
 #include "disas/dis-asm.h"
 #include "tcg/tcg.h"
 
+/*
+ * Superinstructions formed by tcg_out_tb_finalize.  Only the opcode byte
+ * of the first half is rewritten, so their operands are those of @first;
+ * the second half follows as an ordinary instruction.
+ */
+static const struct {
+    const char *name;
+    TCGOpcode first;
+} tci_fused_ops[TCI_NB_OPS - NB_OPS] = {
+    [INDEX_op_tci_ld_add_i32 - NB_OPS] = { "tci_ld_add_i32", INDEX_op_ld_i32 },
+    [INDEX_op_tci_add_st_i32 - NB_OPS] = { "tci_add_st_i32", INDEX_op_add_i32 },
+    [INDEX_op_tci_brcondi_i32 - NB_OPS] = { "tci_brcondi_i32",
+                                            INDEX_op_brcond_i32 },
+    [INDEX_op_tci_ld_add_i64 - NB_OPS] = { "tci_ld_add_i64", INDEX_op_ld_i64 },
+    [INDEX_op_tci_add_st_i64 - NB_OPS] = { "tci_add_st_i64", INDEX_op_add_i64 },
+    [INDEX_op_tci_brcondi_i64 - NB_OPS] = { "tci_brcondi_i64",
+                                            INDEX_op_brcond_i64 },
+};
+
 /* Disassemble TCI bytecode. */
 int print_insn_tci(bfd_vma addr, disassemble_info *info)
 {
@@ -45,16 +64,25 @@ int print_insn_tci(bfd_vma addr, disassemble_info *info)
     }
     length = byte;
 
-    if (op >= tcg_op_defs_max) {
+    if (op >= TCI_NB_OPS) {
         info->fprintf_func(info->stream, "illegal opcode %d", op);
     } else {
-        const TCGOpDef *def = &tcg_op_defs[op];
-        int nb_oargs = def->nb_oargs;
-        int nb_iargs = def->nb_iargs;
-        int nb_cargs = def->nb_cargs;
+        const char *name = NULL;
+        const TCGOpDef *def;
+        int nb_oargs, nb_iargs, nb_cargs;
+
+        if (op >= tcg_op_defs_max) {
+            name = tci_fused_ops[op - NB_OPS].name;
+            op = tci_fused_ops[op - NB_OPS].first;
+        }
+        def = &tcg_op_defs[op];
+        nb_oargs = def->nb_oargs;
+        nb_iargs = def->nb_iargs;
+        nb_cargs = def->nb_cargs;
         /* TODO: Improve disassembler output. */
         info->fprintf_func(info->stream, "%s\to=%d i=%d c=%d",
-                           def->name, nb_oargs, nb_iargs, nb_cargs);
+                           name ? name : def->name,
+                           nb_oargs, nb_iargs, nb_cargs);
     }
 
     return length;
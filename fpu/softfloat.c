@@ -241,6 +241,23 @@ static inline bool can_use_fpu(const float_status *s)
                   s->float_rounding_mode == float_round_nearest_even);
 }
 
+/*
+ * Conversions to integer take their rounding mode as an argument.  The
+ * host always rounds to nearest-even, so rint() handles that mode and
+ * trunc() handles round-to-zero; the only flag either can raise on an
+ * in-range result is inexact, which must therefore already be set.
+ */
+static inline bool can_use_fpu_to_int(FloatRoundMode rmode,
+                                      const float_status *s)
+{
+    if (QEMU_NO_HARDFLOAT) {
+        return false;
+    }
+    return likely(s->float_exception_flags & float_flag_inexact &&
+                  (rmode == float_round_nearest_even ||
+                   rmode == float_round_to_zero));
+}
+
 /*
  * Hardfloat generation functions. Each operation can have two flavors:
  * either using softfloat primitives (e.g. float32_is_zero_or_normal) for
@@ -507,12 +524,28 @@ typedef struct {
 #define DECOMPOSED_IMPLICIT_BIT    (1ull << DECOMPOSED_BINARY_POINT)
 #define DECOMPOSED_OVERFLOW_BIT    (DECOMPOSED_IMPLICIT_BIT << 1)
 
+/*
+ * The same for float128, with a 128-bit fraction split in two words.
+ * The binary point is DECOMPOSED_BINARY_POINT bits into FRAC_HI, so the
+ * implicit and overflow bits are where they are in FloatParts and the
+ * bits to be rounded away are at the bottom of FRAC_LO.
+ */
+
+typedef struct {
+    uint64_t frac_hi;
+    uint64_t frac_lo;
+    int32_t  exp;
+    FloatClass cls;
+    bool sign;
+} FloatParts128;
+
 /* Structure holding all of the relevant parameters for a format.
  *   exp_size: the size of the exponent field
  *   exp_bias: the offset applied to the exponent field
  *   exp_max: the maximum normalised exponent
  *   frac_size: the size of the fraction field
  *   frac_shift: shift to normalise the fraction with DECOMPOSED_BINARY_POINT
+ *     (for float128, of the low word of the fraction)
  * The following are computed based the size of fraction
  *   frac_lsb: least significant bit of fraction
  *   frac_lsbm1: the bit below the least significant bit (for rounding)
@@ -534,16 +567,17 @@ typedef struct {
 } FloatFmt;
 
 /* Expand fields based on the size of exponent and fraction */
+#define FRAC_SHIFT(F)   ((DECOMPOSED_BINARY_POINT - (F)) & 63)
 #define FLOAT_PARAMS(E, F)                                           \
     .exp_size       = E,                                             \
     .exp_bias       = ((1 << E) - 1) >> 1,                           \
     .exp_max        = (1 << E) - 1,                                  \
     .frac_size      = F,                                             \
-    .frac_shift     = DECOMPOSED_BINARY_POINT - F,                   \
-    .frac_lsb       = 1ull << (DECOMPOSED_BINARY_POINT - F),         \
-    .frac_lsbm1     = 1ull << ((DECOMPOSED_BINARY_POINT - F) - 1),   \
-    .round_mask     = (1ull << (DECOMPOSED_BINARY_POINT - F)) - 1,   \
-    .roundeven_mask = (2ull << (DECOMPOSED_BINARY_POINT - F)) - 1
+    .frac_shift     = FRAC_SHIFT(F),                                 \
+    .frac_lsb       = 1ull << FRAC_SHIFT(F),                         \
+    .frac_lsbm1     = 1ull << (FRAC_SHIFT(F) - 1),                   \
+    .round_mask     = (1ull << FRAC_SHIFT(F)) - 1,                   \
+    .roundeven_mask = (2ull << FRAC_SHIFT(F)) - 1
 
 static const FloatFmt float16_params = {
     FLOAT_PARAMS(5, 10)
@@ -566,6 +600,10 @@ static const FloatFmt float64_params = {
     FLOAT_PARAMS(11, 52)
 };
 
+static const FloatFmt float128_params = {
+    FLOAT_PARAMS(15, 112)
+};
+
 /* Unpack a float to parts, but do not canonicalize.  */
 static inline FloatParts unpack_raw(FloatFmt fmt, uint64_t raw)
 {
@@ -599,6 +637,20 @@ static inline FloatParts float64_unpack_raw(float64 f)
     return unpack_raw(float64_params, f);
 }
 
+static inline FloatParts128 float128_unpack_raw(float128 f)
+{
+    const int f_size = float128_params.frac_size - 64;
+    const int e_size = float128_params.exp_size;
+
+    return (FloatParts128) {
+        .cls = float_class_unclassified,
+        .sign = extract64(f.high, f_size + e_size, 1),
+        .exp = extract64(f.high, f_size, e_size),
+        .frac_hi = extract64(f.high, 0, f_size),
+        .frac_lo = f.low,
+    };
+}
+
 /* Pack a float from parts, but do not canonicalize.  */
 static inline uint64_t pack_raw(FloatFmt fmt, FloatParts p)
 {
@@ -627,6 +679,17 @@ static inline float64 float64_pack_raw(FloatParts p)
     return make_float64(pack_raw(float64_params, p));
 }
 
+static inline float128 float128_pack_raw(FloatParts128 p)
+{
+    const int f_size = float128_params.frac_size - 64;
+    const int e_size = float128_params.exp_size;
+    uint64_t hi;
+
+    hi = deposit64(p.frac_hi, f_size, e_size, p.exp);
+    hi = deposit64(hi, f_size + e_size, 1, p.sign);
+    return make_float128(hi, p.frac_lo);
+}
+
 /*----------------------------------------------------------------------------
 | Functions and definitions to determine:  (1) whether tininess for underflow
 | is detected before or after rounding by default, (2) what (if anything)
@@ -670,6 +733,49 @@ static FloatParts sf_canonicalize(FloatParts part, const FloatFmt *parm,
     return part;
 }
 
+/* Count the leading zeros of the 128-bit value HI:LO.  */
+static inline int clz128(uint64_t hi, uint64_t lo)
+{
+    return hi ? clz64(hi) : 64 + clz64(lo);
+}
+
+static FloatParts128 sf_canonicalize128(FloatParts128 part,
+                                        const FloatFmt *parm,
+                                        float_status *status)
+{
+    if (part.exp == parm->exp_max) {
+        if ((part.frac_hi | part.frac_lo) == 0) {
+            part.cls = float_class_inf;
+        } else {
+            shortShift128Left(part.frac_hi, part.frac_lo, parm->frac_shift,
+                              &part.frac_hi, &part.frac_lo);
+            part.cls = (parts_is_snan_frac(part.frac_hi, status)
+                        ? float_class_snan : float_class_qnan);
+        }
+    } else if (part.exp == 0) {
+        /*
+         * Unlike the smaller formats, float128 has never honoured
+         * flush_inputs_to_zero, and no target relies on it doing so.
+         */
+        if (likely((part.frac_hi | part.frac_lo) == 0)) {
+            part.cls = float_class_zero;
+        } else {
+            int shift = clz128(part.frac_hi, part.frac_lo) - 1;
+            part.cls = float_class_normal;
+            part.exp = parm->frac_shift - parm->exp_bias - shift + 1;
+            shift128Left(part.frac_hi, part.frac_lo, shift,
+                         &part.frac_hi, &part.frac_lo);
+        }
+    } else {
+        part.cls = float_class_normal;
+        part.exp -= parm->exp_bias;
+        shortShift128Left(part.frac_hi, part.frac_lo, parm->frac_shift,
+                          &part.frac_hi, &part.frac_lo);
+        part.frac_hi |= DECOMPOSED_IMPLICIT_BIT;
+    }
+    return part;
+}
+
 /* Round and uncanonicalize a floating-point number by parts. There
  * are FRAC_SHIFT bits that may require rounding at the bottom of the
  * fraction; these bits will be removed. The exponent will be biased
@@ -822,6 +928,157 @@ static FloatParts round_canonical(FloatParts p, float_status *s,
     return p;
 }
 
+/*
+ * As round_canonical, for a 128-bit fraction.  The rounding bits all
+ * live in FRAC_LO, so the masks from PARM apply unchanged.
+ */
+
+static FloatParts128 round_canonical128(FloatParts128 p, float_status *s,
+                                        const FloatFmt *parm)
+{
+    const uint64_t frac_lsb = parm->frac_lsb;
+    const uint64_t frac_lsbm1 = parm->frac_lsbm1;
+    const uint64_t round_mask = parm->round_mask;
+    const uint64_t roundeven_mask = parm->roundeven_mask;
+    const int exp_max = parm->exp_max;
+    const int frac_shift = parm->frac_shift;
+    uint64_t frac_hi, frac_lo, inc;
+    int exp, flags = 0;
+    bool overflow_norm;
+
+    frac_hi = p.frac_hi;
+    frac_lo = p.frac_lo;
+    exp = p.exp;
+
+    switch (p.cls) {
+    case float_class_normal:
+        switch (s->float_rounding_mode) {
+        case float_round_nearest_even:
+            overflow_norm = false;
+            inc = ((frac_lo & roundeven_mask) != frac_lsbm1 ? frac_lsbm1 : 0);
+            break;
+        case float_round_ties_away:
+            overflow_norm = false;
+            inc = frac_lsbm1;
+            break;
+        case float_round_to_zero:
+            overflow_norm = true;
+            inc = 0;
+            break;
+        case float_round_up:
+            inc = p.sign ? 0 : round_mask;
+            overflow_norm = p.sign;
+            break;
+        case float_round_down:
+            inc = p.sign ? round_mask : 0;
+            overflow_norm = !p.sign;
+            break;
+        case float_round_to_odd:
+            overflow_norm = true;
+            inc = frac_lo & frac_lsb ? 0 : round_mask;
+            break;
+        default:
+            g_assert_not_reached();
+        }
+
+        exp += parm->exp_bias;
+        if (likely(exp > 0)) {
+            if (frac_lo & round_mask) {
+                flags |= float_flag_inexact;
+                add128(frac_hi, frac_lo, 0, inc, &frac_hi, &frac_lo);
+                if (frac_hi & DECOMPOSED_OVERFLOW_BIT) {
+                    shift128Right(frac_hi, frac_lo, 1, &frac_hi, &frac_lo);
+                    exp++;
+                }
+            }
+            shift128Right(frac_hi, frac_lo, frac_shift, &frac_hi, &frac_lo);
+
+            if (unlikely(exp >= exp_max)) {
+                flags |= float_flag_overflow | float_flag_inexact;
+                if (overflow_norm) {
+                    exp = exp_max - 1;
+                    frac_hi = -1;
+                    frac_lo = -1;
+                } else {
+                    p.cls = float_class_inf;
+                    goto do_inf;
+                }
+            }
+        } else if (s->flush_to_zero) {
+            flags |= float_flag_output_denormal;
+            p.cls = float_class_zero;
+            goto do_zero;
+        } else {
+            uint64_t t_hi, t_lo;
+            bool is_tiny;
+
+            add128(frac_hi, frac_lo, 0, inc, &t_hi, &t_lo);
+            is_tiny = s->tininess_before_rounding
+                      || (exp < 0)
+                      || !(t_hi & DECOMPOSED_OVERFLOW_BIT);
+
+            shift128RightJamming(frac_hi, frac_lo, 1 - exp,
+                                 &frac_hi, &frac_lo);
+            if (frac_lo & round_mask) {
+                /* Need to recompute round-to-even.  */
+                switch (s->float_rounding_mode) {
+                case float_round_nearest_even:
+                    inc = ((frac_lo & roundeven_mask) != frac_lsbm1
+                           ? frac_lsbm1 : 0);
+                    break;
+                case float_round_to_odd:
+                    inc = frac_lo & frac_lsb ? 0 : round_mask;
+                    break;
+                default:
+                    break;
+                }
+                flags |= float_flag_inexact;
+                add128(frac_hi, frac_lo, 0, inc, &frac_hi, &frac_lo);
+            }
+
+            exp = (frac_hi & DECOMPOSED_IMPLICIT_BIT ? 1 : 0);
+            shift128Right(frac_hi, frac_lo, frac_shift, &frac_hi, &frac_lo);
+
+            if (is_tiny && (flags & float_flag_inexact)) {
+                flags |= float_flag_underflow;
+            }
+            if (exp == 0 && (frac_hi | frac_lo) == 0) {
+                p.cls = float_class_zero;
+            }
+        }
+        break;
+
+    case float_class_zero:
+    do_zero:
+        exp = 0;
+        frac_hi = 0;
+        frac_lo = 0;
+        break;
+
+    case float_class_inf:
+    do_inf:
+        exp = exp_max;
+        frac_hi = 0;
+        frac_lo = 0;
+        break;
+
+    case float_class_qnan:
+    case float_class_snan:
+        exp = exp_max;
+        shift128Right(frac_hi, frac_lo, frac_shift, &frac_hi, &frac_lo);
+        break;
+
+    default:
+        g_assert_not_reached();
+    }
+
+    float_raise(flags, s);
+    p.exp = exp;
+    p.frac_hi = frac_hi;
+    p.frac_lo = frac_lo;
+    return p;
+}
+
 /* Explicit FloatFmt version */
 static FloatParts float16a_unpack_canonical(float16 f, float_status *s,
                                             const FloatFmt *params)
@@ -875,6 +1132,17 @@ static float64 float64_round_pack_canonical(FloatParts p, float_status *s)
     return float64_pack_raw(round_canonical(p, s, &float64_params));
 }
 
+static FloatParts128 float128_unpack_canonical(float128 f, float_status *s)
+{
+    return sf_canonicalize128(float128_unpack_raw(f), &float128_params, s);
+}
+
+static float128 float128_round_pack_canonical(FloatParts128 p,
+                                              float_status *s)
+{
+    return float128_pack_raw(round_canonical128(p, s, &float128_params));
+}
+
 static FloatParts return_nan(FloatParts a, float_status *s)
 {
     switch (a.cls) {
@@ -954,6 +1222,85 @@ static FloatParts pick_nan_muladd(FloatParts a, FloatParts b, FloatParts c,
     return a;
 }
 
+static FloatParts128 return_nan128(FloatParts128 a, float_status *s)
+{
+    switch (a.cls) {
+    case float_class_snan:
+        s->float_exception_flags |= float_flag_invalid;
+        a = parts128_silence_nan(a, s);
+        /* fall through */
+    case float_class_qnan:
+        if (s->default_nan_mode) {
+            return parts128_default_nan(s);
+        }
+        break;
+
+    default:
+        g_assert_not_reached();
+    }
+    return a;
+}
+
+static FloatParts128 pick_nan128(FloatParts128 a, FloatParts128 b,
+                                 float_status *s)
+{
+    if (is_snan(a.cls) || is_snan(b.cls)) {
+        s->float_exception_flags |= float_flag_invalid;
+    }
+
+    if (s->default_nan_mode) {
+        return parts128_default_nan(s);
+    } else {
+        if (pickNaN(a.cls, b.cls,
+                    lt128(b.frac_hi, b.frac_lo, a.frac_hi, a.frac_lo) ||
+                    (eq128(a.frac_hi, a.frac_lo, b.frac_hi, b.frac_lo) &&
+                     a.sign < b.sign), s)) {
+            a = b;
+        }
+        if (is_snan(a.cls)) {
+            return parts128_silence_nan(a, s);
+        }
+    }
+    return a;
+}
+
+static FloatParts128 pick_nan_muladd128(FloatParts128 a, FloatParts128 b,
+                                        FloatParts128 c, bool inf_zero,
+                                        float_status *s)
+{
+    int which;
+
+    if (is_snan(a.cls) || is_snan(b.cls) || is_snan(c.cls)) {
+        s->float_exception_flags |= float_flag_invalid;
+    }
+
+    which = pickNaNMulAdd(a.cls, b.cls, c.cls, inf_zero, s);
+
+    if (s->default_nan_mode) {
+        which = 3;
+    }
+
+    switch (which) {
+    case 0:
+        break;
+    case 1:
+        a = b;
+        break;
+    case 2:
+        a = c;
+        break;
+    case 3:
+        return parts128_default_nan(s);
+    default:
+        g_assert_not_reached();
+    }
+
+    if (is_snan(a.cls)) {
+        return parts128_silence_nan(a, s);
+    }
+    return a;
+}
+
 /*
  * Returns the result of adding or subtracting the values of the
  * floating-point values `a' and `b'. The operation is performed
@@ -1253,24 +1600,73 @@ static FloatParts mul_floats(FloatParts a, FloatParts b, float_status *s)
     g_assert_not_reached();
 }
 
-float16 QEMU_FLATTEN float16_mul(float16 a, float16 b, float_status *status)
+static FloatParts128 mul_floats128(FloatParts128 a, FloatParts128 b,
+                                   float_status *s)
 {
-    FloatParts pa = float16_unpack_canonical(a, status);
-    FloatParts pb = float16_unpack_canonical(b, status);
-    FloatParts pr = mul_floats(pa, pb, status);
+    bool sign = a.sign ^ b.sign;
 
-    return float16_round_pack_canonical(pr, status);
-}
+    if (a.cls == float_class_normal && b.cls == float_class_normal) {
+        uint64_t z0, z1, z2, z3;
+        int exp = a.exp + b.exp;
 
-static float32 QEMU_SOFTFLOAT_ATTR
-soft_f32_mul(float32 a, float32 b, float_status *status)
-{
-    FloatParts pa = float32_unpack_canonical(a, status);
-    FloatParts pb = float32_unpack_canonical(b, status);
-    FloatParts pr = mul_floats(pa, pb, status);
+        mul128To256(a.frac_hi, a.frac_lo, b.frac_hi, b.frac_lo,
+                    &z0, &z1, &z2, &z3);
+        /*
+         * The binary point is now at bit 252, and the product below
+         * bit 254: move it back to 126, jamming the low bits.
+         */
+        a.frac_hi = (z0 << 2) | (z1 >> 62);
+        a.frac_lo = (z1 << 2) | (z2 >> 62) | (((z2 << 2) | z3) != 0);
+        if (a.frac_hi & DECOMPOSED_OVERFLOW_BIT) {
+            shift128RightJamming(a.frac_hi, a.frac_lo, 1,
+                                 &a.frac_hi, &a.frac_lo);
+            exp += 1;
+        }
 
-    return float32_round_pack_canonical(pr, status);
-}
+        a.exp = exp;
+        a.sign = sign;
+        return a;
+    }
+    /* handle all the NaN cases */
+    if (is_nan(a.cls) || is_nan(b.cls)) {
+        return pick_nan128(a, b, s);
+    }
+    /* Inf * Zero == NaN */
+    if ((a.cls == float_class_inf && b.cls == float_class_zero) ||
+        (a.cls == float_class_zero && b.cls == float_class_inf)) {
+        s->float_exception_flags |= float_flag_invalid;
+        return parts128_default_nan(s);
+    }
+    /* Multiply by 0 or Inf */
+    if (a.cls == float_class_inf || a.cls == float_class_zero) {
+        a.sign = sign;
+        return a;
+    }
+    if (b.cls == float_class_inf || b.cls == float_class_zero) {
+        b.sign = sign;
+        return b;
+    }
+    g_assert_not_reached();
+}
+
+float16 QEMU_FLATTEN float16_mul(float16 a, float16 b, float_status *status)
+{
+    FloatParts pa = float16_unpack_canonical(a, status);
+    FloatParts pb = float16_unpack_canonical(b, status);
+    FloatParts pr = mul_floats(pa, pb, status);
+
+    return float16_round_pack_canonical(pr, status);
+}
+
+static float32 QEMU_SOFTFLOAT_ATTR
+soft_f32_mul(float32 a, float32 b, float_status *status)
+{
+    FloatParts pa = float32_unpack_canonical(a, status);
+    FloatParts pb = float32_unpack_canonical(b, status);
+    FloatParts pr = mul_floats(pa, pb, status);
+
+    return float32_round_pack_canonical(pr, status);
+}
 
 static float64 QEMU_SOFTFLOAT_ATTR
 soft_f64_mul(float64 a, float64 b, float_status *status)
@@ -1306,6 +1702,16 @@ float64_mul(float64 a, float64 b, float_status *s)
                         f64_is_zon2, f64_addsubmul_post);
 }
 
+float128 QEMU_FLATTEN
+float128_mul(float128 a, float128 b, float_status *status)
+{
+    FloatParts128 pa = float128_unpack_canonical(a, status);
+    FloatParts128 pb = float128_unpack_canonical(b, status);
+    FloatParts128 pr = mul_floats128(pa, pb, status);
+
+    return float128_round_pack_canonical(pr, status);
+}
+
 /*
  * Returns the result of multiplying the bfloat16
  * values `a' and `b'.
@@ -1523,6 +1929,279 @@ static FloatParts muladd_floats(FloatParts a, FloatParts b, FloatParts c,
     return a;
 }
 
+/*
+ * 256-bit helpers for muladd_floats128.  As in softfloat-macros.h the
+ * most significant word comes first.
+ */
+
+static void shift256RightJamming(uint64_t a[4], int count)
+{
+    bool sticky = false;
+
+    if (count >= 256) {
+        sticky = (a[0] | a[1] | a[2] | a[3]) != 0;
+        a[0] = a[1] = a[2] = 0;
+        a[3] = sticky;
+        return;
+    }
+    for (; count >= 64; count -= 64) {
+        sticky |= a[3] != 0;
+        a[3] = a[2];
+        a[2] = a[1];
+        a[1] = a[0];
+        a[0] = 0;
+    }
+    if (count) {
+        int neg = 64 - count;
+
+        sticky |= (a[3] << neg) != 0;
+        a[3] = (a[3] >> count) | (a[2] << neg);
+        a[2] = (a[2] >> count) | (a[1] << neg);
+        a[1] = (a[1] >> count) | (a[0] << neg);
+        a[0] >>= count;
+    }
+    a[3] |= sticky;
+}
+
+static void shift256Left(uint64_t a[4], int count)
+{
+    for (; count >= 64; count -= 64) {
+        a[0] = a[1];
+        a[1] = a[2];
+        a[2] = a[3];
+        a[3] = 0;
+    }
+    if (count) {
+        int neg = 64 - count;
+
+        a[0] = (a[0] << count) | (a[1] >> neg);
+        a[1] = (a[1] << count) | (a[2] >> neg);
+        a[2] = (a[2] << count) | (a[3] >> neg);
+        a[3] <<= count;
+    }
+}
+
+/* A += B */
+static void add256(uint64_t a[4], const uint64_t b[4])
+{
+    bool carry = false;
+    int i;
+
+    for (i = 3; i >= 0; i--) {
+        uint64_t t = a[i] + b[i];
+        bool c = t < a[i];
+
+        a[i] = t + carry;
+        carry = c || a[i] < t;
+    }
+}
+
+/* A -= B */
+static void sub256(uint64_t a[4], const uint64_t b[4])
+{
+    bool borrow = false;
+    int i;
+
+    for (i = 3; i >= 0; i--) {
+        uint64_t t = a[i] - b[i];
+        bool c = a[i] < b[i];
+
+        a[i] = t - borrow;
+        borrow = c || t < borrow;
+    }
+}
+
+static bool lt256(const uint64_t a[4], const uint64_t b[4])
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i];
+        }
+    }
+    return false;
+}
+
+static FloatParts128 muladd_floats128(FloatParts128 a, FloatParts128 b,
+                                      FloatParts128 c, int flags,
+                                      float_status *s)
+{
+    bool inf_zero = ((1 << a.cls) | (1 << b.cls)) ==
+                    ((1 << float_class_inf) | (1 << float_class_zero));
+    bool p_sign;
+    bool sign_flip = flags & float_muladd_negate_result;
+    FloatClass p_class;
+    uint64_t p[4], hi, lo;
+    int p_exp;
+
+    if (is_nan(a.cls) || is_nan(b.cls) || is_nan(c.cls)) {
+        return pick_nan_muladd128(a, b, c, inf_zero, s);
+    }
+
+    if (inf_zero) {
+        s->float_exception_flags |= float_flag_invalid;
+        return parts128_default_nan(s);
+    }
+
+    if (flags & float_muladd_negate_c) {
+        c.sign ^= 1;
+    }
+
+    p_sign = a.sign ^ b.sign;
+
+    if (flags & float_muladd_negate_product) {
+        p_sign ^= 1;
+    }
+
+    if (a.cls == float_class_inf || b.cls == float_class_inf) {
+        p_class = float_class_inf;
+    } else if (a.cls == float_class_zero || b.cls == float_class_zero) {
+        p_class = float_class_zero;
+    } else {
+        p_class = float_class_normal;
+    }
+
+    if (c.cls == float_class_inf) {
+        if (p_class == float_class_inf && p_sign != c.sign) {
+            s->float_exception_flags |= float_flag_invalid;
+            return parts128_default_nan(s);
+        } else {
+            a.cls = float_class_inf;
+            a.sign = c.sign ^ sign_flip;
+            return a;
+        }
+    }
+
+    if (p_class == float_class_inf) {
+        a.cls = float_class_inf;
+        a.sign = p_sign ^ sign_flip;
+        return a;
+    }
+
+    if (p_class == float_class_zero) {
+        if (c.cls == float_class_zero) {
+            if (p_sign != c.sign) {
+                p_sign = s->float_rounding_mode == float_round_down;
+            }
+            c.sign = p_sign;
+        } else if (flags & float_muladd_halve_result) {
+            c.exp -= 1;
+        }
+        c.sign ^= sign_flip;
+        return c;
+    }
+
+    /* a & b should be normals now... */
+    assert(a.cls == float_class_normal &&
+           b.cls == float_class_normal);
+
+    p_exp = a.exp + b.exp;
+
+    /*
+     * Multiply of 2 126-bit numbers produces a 252-bit result, which
+     * is kept whole until the addition is done.
+     */
+    mul128To256(a.frac_hi, a.frac_lo, b.frac_hi, b.frac_lo,
+                &p[0], &p[1], &p[2], &p[3]);
+
+    /* check for overflow */
+    if (p[0] & (1ULL << (DECOMPOSED_BINARY_POINT * 2 + 1 - 64))) {
+        shift256RightJamming(p, 1);
+        p_exp += 1;
+    }
+
+    /* + add/sub */
+    if (c.cls == float_class_zero) {
+        /* move binary point back to 126 */
+        shift256RightJamming(p, 64 + DECOMPOSED_BINARY_POINT);
+        hi = p[2];
+        lo = p[3];
+    } else {
+        int exp_diff = p_exp - c.exp;
+        /* c with the same binary point as the product (252) */
+        uint64_t cp[4] = {
+            c.frac_hi >> 2,
+            (c.frac_hi << 62) | (c.frac_lo >> 2),
+            c.frac_lo << 62,
+            0
+        };
+
+        if (p_sign == c.sign) {
+            /* Addition */
+            if (exp_diff <= 0) {
+                shift256RightJamming(p, 64 + DECOMPOSED_BINARY_POINT
+                                     - exp_diff);
+                add128(p[2], p[3], c.frac_hi, c.frac_lo, &hi, &lo);
+                p_exp = c.exp;
+            } else {
+                shift256RightJamming(cp, exp_diff);
+                add256(p, cp);
+                /* move binary point back to 126 */
+                shift256RightJamming(p, 64 + DECOMPOSED_BINARY_POINT);
+                hi = p[2];
+                lo = p[3];
+            }
+
+            if (hi & DECOMPOSED_OVERFLOW_BIT) {
+                shift128RightJamming(hi, lo, 1, &hi, &lo);
+                p_exp += 1;
+            }
+        } else {
+            /* Subtraction */
+            int shift;
+
+            if (exp_diff <= 0) {
+                shift256RightJamming(p, -exp_diff);
+                if (exp_diff == 0 && !lt256(p, cp)) {
+                    sub256(p, cp);
+                } else {
+                    sub256(cp, p);
+                    memcpy(p, cp, sizeof(p));
+                    p_sign ^= 1;
+                    p_exp = c.exp;
+                }
+            } else {
+                shift256RightJamming(cp, exp_diff);
+                sub256(p, cp);
+            }
+
+            if ((p[0] | p[1] | p[2] | p[3]) == 0) {
+                a.cls = float_class_zero;
+                a.sign = s->float_rounding_mode == float_round_down;
+                a.sign ^= sign_flip;
+                return a;
+            }
+
+            /*
+             * As in muladd_floats, normalize to a binary point of 254
+             * so that the high half is where we want it, but adjust
+             * the exponent as if for 252.
+             */
+            shift = p[0] ? clz64(p[0]) : p[1] ? 64 + clz64(p[1])
+                  : p[2] ? 128 + clz64(p[2]) : 192 + clz64(p[3]);
+            shift -= 1;
+            shift256Left(p, shift);
+            p_exp -= shift - 2;
+            hi = p[0];
+            lo = p[1] | ((p[2] | p[3]) != 0);
+        }
+    }
+
+    if (flags & float_muladd_halve_result) {
+        p_exp -= 1;
+    }
+
+    /* finally prepare our result */
+    a.cls = float_class_normal;
+    a.sign = p_sign ^ sign_flip;
+    a.exp = p_exp;
+    a.frac_hi = hi;
+    a.frac_lo = lo;
+
+    return a;
+}
+
 float16 QEMU_FLATTEN float16_muladd(float16 a, float16 b, float16 c,
                                                 int flags, float_status *status)
 {
@@ -1702,6 +2381,17 @@ float64_muladd(float64 xa, float64 xb, float64 xc, int flags, float_status *s)
     return soft_f64_muladd(ua.s, ub.s, uc.s, flags, s);
 }
 
+float128 QEMU_FLATTEN float128_muladd(float128 a, float128 b, float128 c,
+                                      int flags, float_status *status)
+{
+    FloatParts128 pa = float128_unpack_canonical(a, status);
+    FloatParts128 pb = float128_unpack_canonical(b, status);
+    FloatParts128 pc = float128_unpack_canonical(c, status);
+    FloatParts128 pr = muladd_floats128(pa, pb, pc, flags, status);
+
+    return float128_round_pack_canonical(pr, status);
+}
+
 /*
  * Returns the result of multiplying the bfloat16 values `a'
  * and `b' then adding 'c', with no intermediate rounding step after the
@@ -1798,41 +2488,126 @@ static FloatParts div_floats(FloatParts a, FloatParts b, float_status *s)
     g_assert_not_reached();
 }
 
-float16 float16_div(float16 a, float16 b, float_status *status)
-{
-    FloatParts pa = float16_unpack_canonical(a, status);
-    FloatParts pb = float16_unpack_canonical(b, status);
-    FloatParts pr = div_floats(pa, pb, status);
-
-    return float16_round_pack_canonical(pr, status);
-}
-
-static float32 QEMU_SOFTFLOAT_ATTR
-soft_f32_div(float32 a, float32 b, float_status *status)
+static FloatParts128 div_floats128(FloatParts128 a, FloatParts128 b,
+                                   float_status *s)
 {
-    FloatParts pa = float32_unpack_canonical(a, status);
-    FloatParts pb = float32_unpack_canonical(b, status);
-    FloatParts pr = div_floats(pa, pb, status);
-
-    return float32_round_pack_canonical(pr, status);
-}
+    bool sign = a.sign ^ b.sign;
 
-static float64 QEMU_SOFTFLOAT_ATTR
-soft_f64_div(float64 a, float64 b, float_status *status)
-{
-    FloatParts pa = float64_unpack_canonical(a, status);
-    FloatParts pb = float64_unpack_canonical(b, status);
-    FloatParts pr = div_floats(pa, pb, status);
+    if (a.cls == float_class_normal && b.cls == float_class_normal) {
+        uint64_t n0, n1, d0, d1, q0, q1;
+        uint64_t rem0, rem1, rem2, rem3, term0, term1, term2, term3;
+        int exp = a.exp - b.exp;
 
-    return float64_round_pack_canonical(pr, status);
-}
+        /*
+         * As in div_floats, arrange for A < B so that the quotient has
+         * exactly 128 bits, one more than we keep.  Shift the divisor
+         * left by one so that its msb is set, as estimateDiv128To64
+         * requires, and the dividend along with it when A < B already.
+         */
+        shortShift128Left(b.frac_hi, b.frac_lo, 1, &d0, &d1);
+        if (lt128(a.frac_hi, a.frac_lo, b.frac_hi, b.frac_lo)) {
+            exp -= 1;
+            shortShift128Left(a.frac_hi, a.frac_lo, 1, &n0, &n1);
+        } else {
+            n0 = a.frac_hi;
+            n1 = a.frac_lo;
+        }
 
-static float hard_f32_div(float a, float b)
-{
-    return a / b;
-}
+        /*
+         * Schoolbook division in two 64-bit digits.  Each estimate is
+         * at most 2 too large; the second one only needs correcting if
+         * that could change the rounding bits.
+         */
+        q0 = estimateDiv128To64(n0, n1, d0);
+        mul128By64To192(d0, d1, q0, &term0, &term1, &term2);
+        sub192(n0, n1, 0, term0, term1, term2, &rem0, &rem1, &rem2);
+        while ((int64_t)rem0 < 0) {
+            --q0;
+            add192(rem0, rem1, rem2, 0, d0, d1, &rem0, &rem1, &rem2);
+        }
+        q1 = estimateDiv128To64(rem1, rem2, d0);
+        if ((q1 & 0x3fff) <= 4) {
+            mul128By64To192(d0, d1, q1, &term1, &term2, &term3);
+            sub192(rem1, rem2, 0, term1, term2, term3, &rem1, &rem2, &rem3);
+            while ((int64_t)rem1 < 0) {
+                --q1;
+                add192(rem1, rem2, rem3, 0, d0, d1, &rem1, &rem2, &rem3);
+            }
+            q1 |= (rem1 | rem2 | rem3) != 0;
+        }
 
-static double hard_f64_div(double a, double b)
+        shift128RightJamming(q0, q1, 1, &a.frac_hi, &a.frac_lo);
+        a.sign = sign;
+        a.exp = exp;
+        return a;
+    }
+    /* handle all the NaN cases */
+    if (is_nan(a.cls) || is_nan(b.cls)) {
+        return pick_nan128(a, b, s);
+    }
+    /* 0/0 or Inf/Inf */
+    if (a.cls == b.cls
+        &&
+        (a.cls == float_class_inf || a.cls == float_class_zero)) {
+        s->float_exception_flags |= float_flag_invalid;
+        return parts128_default_nan(s);
+    }
+    /* Inf / x or 0 / x */
+    if (a.cls == float_class_inf || a.cls == float_class_zero) {
+        a.sign = sign;
+        return a;
+    }
+    /* Div 0 => Inf */
+    if (b.cls == float_class_zero) {
+        s->float_exception_flags |= float_flag_divbyzero;
+        a.cls = float_class_inf;
+        a.sign = sign;
+        return a;
+    }
+    /* Div by Inf */
+    if (b.cls == float_class_inf) {
+        a.cls = float_class_zero;
+        a.sign = sign;
+        return a;
+    }
+    g_assert_not_reached();
+}
+
+float16 float16_div(float16 a, float16 b, float_status *status)
+{
+    FloatParts pa = float16_unpack_canonical(a, status);
+    FloatParts pb = float16_unpack_canonical(b, status);
+    FloatParts pr = div_floats(pa, pb, status);
+
+    return float16_round_pack_canonical(pr, status);
+}
+
+static float32 QEMU_SOFTFLOAT_ATTR
+soft_f32_div(float32 a, float32 b, float_status *status)
+{
+    FloatParts pa = float32_unpack_canonical(a, status);
+    FloatParts pb = float32_unpack_canonical(b, status);
+    FloatParts pr = div_floats(pa, pb, status);
+
+    return float32_round_pack_canonical(pr, status);
+}
+
+static float64 QEMU_SOFTFLOAT_ATTR
+soft_f64_div(float64 a, float64 b, float_status *status)
+{
+    FloatParts pa = float64_unpack_canonical(a, status);
+    FloatParts pb = float64_unpack_canonical(b, status);
+    FloatParts pr = div_floats(pa, pb, status);
+
+    return float64_round_pack_canonical(pr, status);
+}
+
+static float hard_f32_div(float a, float b)
+{
+    return a / b;
+}
+
+static double hard_f64_div(double a, double b)
 {
     return a / b;
 }
@@ -1885,6 +2660,16 @@ float64_div(float64 a, float64 b, float_status *s)
                         f64_div_pre, f64_div_post);
 }
 
+float128 QEMU_FLATTEN
+float128_div(float128 a, float128 b, float_status *status)
+{
+    FloatParts128 pa = float128_unpack_canonical(a, status);
+    FloatParts128 pb = float128_unpack_canonical(b, status);
+    FloatParts128 pr = div_floats128(pa, pb, status);
+
+    return float128_round_pack_canonical(pr, status);
+}
+
 /*
  * Returns the result of dividing the bfloat16
  * value `a' by the corresponding value `b'.
@@ -2042,6 +2827,76 @@ bfloat16 float64_to_bfloat16(float64 a, float_status *s)
     return bfloat16_round_pack_canonical(pr, s);
 }
 
+/*
+ * Conversions between float128 and the smaller formats go through
+ * FloatParts: its fraction holds any float64 exactly, and with the low
+ * word of a float128 jammed into its lsb there are still enough bits
+ * below the float64 lsb to round correctly.
+ */
+
+static FloatParts128 float_to_float128(FloatParts a, float_status *s)
+{
+    FloatParts128 r = {
+        .cls = a.cls,
+        .sign = a.sign,
+        .exp = a.exp,
+        .frac_hi = a.frac,
+        .frac_lo = 0,
+    };
+
+    if (is_nan(a.cls)) {
+        if (is_snan(a.cls)) {
+            s->float_exception_flags |= float_flag_invalid;
+            r = parts128_silence_nan(r, s);
+        }
+        if (s->default_nan_mode) {
+            return parts128_default_nan(s);
+        }
+    }
+    return r;
+}
+
+static FloatParts float128_to_float(FloatParts128 a, const FloatFmt *dstf,
+                                    float_status *s)
+{
+    FloatParts r = {
+        .cls = a.cls,
+        .sign = a.sign,
+        .exp = a.exp,
+        .frac = a.frac_hi | (a.frac_lo != 0),
+    };
+
+    return float_to_float(r, dstf, s);
+}
+
+float128 float32_to_float128(float32 a, float_status *s)
+{
+    FloatParts p = float32_unpack_canonical(a, s);
+    FloatParts128 pr = float_to_float128(p, s);
+    return float128_round_pack_canonical(pr, s);
+}
+
+float128 float64_to_float128(float64 a, float_status *s)
+{
+    FloatParts p = float64_unpack_canonical(a, s);
+    FloatParts128 pr = float_to_float128(p, s);
+    return float128_round_pack_canonical(pr, s);
+}
+
+float32 float128_to_float32(float128 a, float_status *s)
+{
+    FloatParts128 p = float128_unpack_canonical(a, s);
+    FloatParts pr = float128_to_float(p, &float32_params, s);
+    return float32_round_pack_canonical(pr, s);
+}
+
+float64 float128_to_float64(float128 a, float_status *s)
+{
+    FloatParts128 p = float128_unpack_canonical(a, s);
+    FloatParts pr = float128_to_float(p, &float64_params, s);
+    return float64_round_pack_canonical(pr, s);
+}
+
 /*
  * Rounds the floating-point value `a' to an integer, and returns the
  * result as a floating-point value. The operation is performed
@@ -2157,16 +3012,45 @@ float16 float16_round_to_int(float16 a, float_status *s)
     return float16_round_pack_canonical(pr, s);
 }
 
-float32 float32_round_to_int(float32 a, float_status *s)
+float32 QEMU_FLATTEN float32_round_to_int(float32 a, float_status *s)
 {
-    FloatParts pa = float32_unpack_canonical(a, s);
+    FloatParts pa;
+
+    if (can_use_fpu(s)) {
+        union_float32 ua;
+
+        ua.s = a;
+        float32_input_flush1(&ua.s, s);
+        /* Infinities and NaNs need the soft path for their flags.  */
+        if (likely(isfinite(ua.h))) {
+            ua.h = rintf(ua.h);
+            return ua.s;
+        }
+        a = ua.s;
+    }
+
+    pa = float32_unpack_canonical(a, s);
     FloatParts pr = round_to_int(pa, s->float_rounding_mode, 0, s);
     return float32_round_pack_canonical(pr, s);
 }
 
-float64 float64_round_to_int(float64 a, float_status *s)
+float64 QEMU_FLATTEN float64_round_to_int(float64 a, float_status *s)
 {
-    FloatParts pa = float64_unpack_canonical(a, s);
+    FloatParts pa;
+
+    if (can_use_fpu(s)) {
+        union_float64 ua;
+
+        ua.s = a;
+        float64_input_flush1(&ua.s, s);
+        if (likely(isfinite(ua.h))) {
+            ua.h = rint(ua.h);
+            return ua.s;
+        }
+        a = ua.s;
+    }
+
+    pa = float64_unpack_canonical(a, s);
     FloatParts pr = round_to_int(pa, s->float_rounding_mode, 0, s);
     return float64_round_pack_canonical(pr, s);
 }
@@ -2240,6 +3124,50 @@ static int64_t round_to_int_and_pack(FloatParts in, FloatRoundMode rmode,
     }
 }
 
+/*
+ * Hardfloat conversions to int32 and int64.  @min is a power of two, so
+ * both it and -@min are exact as doubles; NaNs fail the range check.
+ */
+static int64_t QEMU_FLATTEN
+f32_to_int(float32 a, FloatRoundMode rmode, int scale,
+           int64_t min, int64_t max, float_status *s)
+{
+    if (scale == 0 && can_use_fpu_to_int(rmode, s)) {
+        union_float32 ua;
+        double r;
+
+        ua.s = a;
+        float32_input_flush1(&ua.s, s);
+        r = rmode == float_round_to_zero ? trunc(ua.h) : rint(ua.h);
+        if (likely(r >= (double)min && r < -(double)min)) {
+            return r;
+        }
+        a = ua.s;
+    }
+    return round_to_int_and_pack(float32_unpack_canonical(a, s),
+                                 rmode, scale, min, max, s);
+}
+
+static int64_t QEMU_FLATTEN
+f64_to_int(float64 a, FloatRoundMode rmode, int scale,
+           int64_t min, int64_t max, float_status *s)
+{
+    if (scale == 0 && can_use_fpu_to_int(rmode, s)) {
+        union_float64 ua;
+        double r;
+
+        ua.s = a;
+        float64_input_flush1(&ua.s, s);
+        r = rmode == float_round_to_zero ? trunc(ua.h) : rint(ua.h);
+        if (likely(r >= (double)min && r < -(double)min)) {
+            return r;
+        }
+        a = ua.s;
+    }
+    return round_to_int_and_pack(float64_unpack_canonical(a, s),
+                                 rmode, scale, min, max, s);
+}
+
 int8_t float16_to_int8_scalbn(float16 a, FloatRoundMode rmode, int scale,
                               float_status *s)
 {
@@ -2278,15 +3206,13 @@ int16_t float32_to_int16_scalbn(float32 a, FloatRoundMode rmode, int scale,
 int32_t float32_to_int32_scalbn(float32 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
-    return round_to_int_and_pack(float32_unpack_canonical(a, s),
-                                 rmode, scale, INT32_MIN, INT32_MAX, s);
+    return f32_to_int(a, rmode, scale, INT32_MIN, INT32_MAX, s);
 }
 
 int64_t float32_to_int64_scalbn(float32 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
-    return round_to_int_and_pack(float32_unpack_canonical(a, s),
-                                 rmode, scale, INT64_MIN, INT64_MAX, s);
+    return f32_to_int(a, rmode, scale, INT64_MIN, INT64_MAX, s);
 }
 
 int16_t float64_to_int16_scalbn(float64 a, FloatRoundMode rmode, int scale,
@@ -2299,15 +3225,13 @@ int16_t float64_to_int16_scalbn(float64 a, FloatRoundMode rmode, int scale,
 int32_t float64_to_int32_scalbn(float64 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
-    return round_to_int_and_pack(float64_unpack_canonical(a, s),
-                                 rmode, scale, INT32_MIN, INT32_MAX, s);
+    return f64_to_int(a, rmode, scale, INT32_MIN, INT32_MAX, s);
 }
 
 int64_t float64_to_int64_scalbn(float64 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
-    return round_to_int_and_pack(float64_unpack_canonical(a, s),
-                                 rmode, scale, INT64_MIN, INT64_MAX, s);
+    return f64_to_int(a, rmode, scale, INT64_MIN, INT64_MAX, s);
 }
 
 int8_t float16_to_int8(float16 a, float_status *s)
@@ -2405,6 +3329,181 @@ int64_t float64_to_int64_round_to_zero(float64 a, float_status *s)
     return float64_to_int64_scalbn(a, float_round_to_zero, 0, s);
 }
 
+/*
+ * Conversions from float128.  Round the fraction to an integer directly
+ * rather than through round_to_int, which would need a float128 result:
+ * return false if the magnitude does not fit in 64 bits, otherwise the
+ * rounded magnitude and whether it was inexact.
+ */
+
+static bool float128_round_to_uint64(FloatParts128 p, FloatRoundMode rmode,
+                                     uint64_t *ret, bool *inexact)
+{
+    const uint64_t half = 1ull << 63;
+    uint64_t z0, r, rem;
+    bool inc;
+
+    assert(p.cls == float_class_normal);
+    if (p.exp >= 64) {
+        return false;
+    }
+
+    /* Integer part to R, fraction to REM with its msb worth one half.  */
+    shift128ExtraRightJamming(p.frac_hi, p.frac_lo, 0,
+                              64 + DECOMPOSED_BINARY_POINT - p.exp,
+                              &z0, &r, &rem);
+
+    switch (rmode) {
+    case float_round_nearest_even:
+        inc = rem > half || (rem == half && (r & 1));
+        break;
+    case float_round_ties_away:
+        inc = rem >= half;
+        break;
+    case float_round_to_zero:
+        inc = false;
+        break;
+    case float_round_up:
+        inc = rem && !p.sign;
+        break;
+    case float_round_down:
+        inc = rem && p.sign;
+        break;
+    case float_round_to_odd:
+        inc = rem && !(r & 1);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+
+    r += inc;
+    if (inc && r == 0) {
+        return false;
+    }
+    *ret = r;
+    *inexact = rem != 0;
+    return true;
+}
+
+static int64_t float128_to_int_and_pack(float128 a, FloatRoundMode rmode,
+                                        int64_t min, int64_t max,
+                                        float_status *s)
+{
+    FloatParts128 p = float128_unpack_canonical(a, s);
+    uint64_t r;
+    bool inexact;
+
+    switch (p.cls) {
+    case float_class_snan:
+    case float_class_qnan:
+        float_raise(float_flag_invalid, s);
+        return max;
+    case float_class_inf:
+        float_raise(float_flag_invalid, s);
+        return p.sign ? min : max;
+    case float_class_zero:
+        return 0;
+    case float_class_normal:
+        if (!float128_round_to_uint64(p, rmode, &r, &inexact)
+            || r > (p.sign ? -(uint64_t)min : max)) {
+            float_raise(float_flag_invalid, s);
+            return p.sign ? min : max;
+        }
+        if (inexact) {
+            float_raise(float_flag_inexact, s);
+        }
+        return p.sign ? -r : r;
+    default:
+        g_assert_not_reached();
+    }
+}
+
+static uint64_t float128_to_uint_and_pack(float128 a, FloatRoundMode rmode,
+                                          uint64_t max, float_status *s)
+{
+    FloatParts128 p = float128_unpack_canonical(a, s);
+    uint64_t r;
+    bool inexact;
+
+    switch (p.cls) {
+    case float_class_snan:
+    case float_class_qnan:
+        float_raise(float_flag_invalid, s);
+        return max;
+    case float_class_inf:
+        float_raise(float_flag_invalid, s);
+        return p.sign ? 0 : max;
+    case float_class_zero:
+        return 0;
+    case float_class_normal:
+        if (!float128_round_to_uint64(p, rmode, &r, &inexact)) {
+            float_raise(float_flag_invalid, s);
+            return p.sign ? 0 : max;
+        }
+        if (r == 0) {
+            /* Rounded to zero: only inexact, whatever the sign.  */
+        } else if (p.sign) {
+            float_raise(float_flag_invalid, s);
+            return 0;
+        } else if (r > max) {
+            float_raise(float_flag_invalid, s);
+            return max;
+        }
+        if (inexact) {
+            float_raise(float_flag_inexact, s);
+        }
+        return r;
+    default:
+        g_assert_not_reached();
+    }
+}
+
+int32_t float128_to_int32(float128 a, float_status *s)
+{
+    return float128_to_int_and_pack(a, s->float_rounding_mode,
+                                    INT32_MIN, INT32_MAX, s);
+}
+
+int32_t float128_to_int32_round_to_zero(float128 a, float_status *s)
+{
+    return float128_to_int_and_pack(a, float_round_to_zero,
+                                    INT32_MIN, INT32_MAX, s);
+}
+
+int64_t float128_to_int64(float128 a, float_status *s)
+{
+    return float128_to_int_and_pack(a, s->float_rounding_mode,
+                                    INT64_MIN, INT64_MAX, s);
+}
+
+int64_t float128_to_int64_round_to_zero(float128 a, float_status *s)
+{
+    return float128_to_int_and_pack(a, float_round_to_zero,
+                                    INT64_MIN, INT64_MAX, s);
+}
+
+uint32_t float128_to_uint32(float128 a, float_status *s)
+{
+    return float128_to_uint_and_pack(a, s->float_rounding_mode,
+                                     UINT32_MAX, s);
+}
+
+uint32_t float128_to_uint32_round_to_zero(float128 a, float_status *s)
+{
+    return float128_to_uint_and_pack(a, float_round_to_zero, UINT32_MAX, s);
+}
+
+uint64_t float128_to_uint64(float128 a, float_status *s)
+{
+    return float128_to_uint_and_pack(a, s->float_rounding_mode,
+                                     UINT64_MAX, s);
+}
+
+uint64_t float128_to_uint64_round_to_zero(float128 a, float_status *s)
+{
+    return float128_to_uint_and_pack(a, float_round_to_zero, UINT64_MAX, s);
+}
+
 /*
  * Returns the result of converting the floating-point value `a' to
  * the two's complement integer format.
@@ -2813,7 +3912,21 @@ float16 int8_to_float16(int8_t a, float_status *status)
 
 float32 int64_to_float32_scalbn(int64_t a, int scale, float_status *status)
 {
-    FloatParts pa = int_to_float(a, scale, status);
+    FloatParts pa;
+
+    /*
+     * Integers that fit in the significand convert exactly, raising no
+     * flags regardless of the rounding mode.
+     */
+    if (!QEMU_NO_HARDFLOAT && scale == 0 &&
+        a >= -(INT64_C(1) << 24) && a <= (INT64_C(1) << 24)) {
+        union_float32 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = int_to_float(a, scale, status);
     return float32_round_pack_canonical(pa, status);
 }
 
@@ -2844,7 +3957,17 @@ float32 int16_to_float32(int16_t a, float_status *status)
 
 float64 int64_to_float64_scalbn(int64_t a, int scale, float_status *status)
 {
-    FloatParts pa = int_to_float(a, scale, status);
+    FloatParts pa;
+
+    if (!QEMU_NO_HARDFLOAT && scale == 0 &&
+        a >= -(INT64_C(1) << 53) && a <= (INT64_C(1) << 53)) {
+        union_float64 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = int_to_float(a, scale, status);
     return float64_round_pack_canonical(pa, status);
 }
 
@@ -2978,7 +4101,16 @@ float16 uint8_to_float16(uint8_t a, float_status *status)
 
 float32 uint64_to_float32_scalbn(uint64_t a, int scale, float_status *status)
 {
-    FloatParts pa = uint_to_float(a, scale, status);
+    FloatParts pa;
+
+    if (!QEMU_NO_HARDFLOAT && scale == 0 && a <= (UINT64_C(1) << 24)) {
+        union_float32 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = uint_to_float(a, scale, status);
     return float32_round_pack_canonical(pa, status);
 }
 
@@ -3009,7 +4141,16 @@ float32 uint16_to_float32(uint16_t a, float_status *status)
 
 float64 uint64_to_float64_scalbn(uint64_t a, int scale, float_status *status)
 {
-    FloatParts pa = uint_to_float(a, scale, status);
+    FloatParts pa;
+
+    if (!QEMU_NO_HARDFLOAT && scale == 0 && a <= (UINT64_C(1) << 53)) {
+        union_float64 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = uint_to_float(a, scale, status);
     return float64_round_pack_canonical(pa, status);
 }
 
@@ -3038,6 +4179,51 @@ float64 uint16_to_float64(uint16_t a, float_status *status)
     return uint64_to_float64_scalbn(a, 0, status);
 }
 
+/*
+ * Any 64-bit integer fits in the float128 significand, so these never
+ * need rounding.
+ */
+
+static FloatParts128 uint_to_float128(uint64_t a)
+{
+    FloatParts128 r = { .sign = false };
+
+    if (a == 0) {
+        r.cls = float_class_zero;
+    } else {
+        int shift = clz64(a);
+
+        r.cls = float_class_normal;
+        r.exp = 63 - shift;
+        shift128Left(0, a, 1 + DECOMPOSED_BINARY_POINT + shift,
+                     &r.frac_hi, &r.frac_lo);
+    }
+    return r;
+}
+
+static FloatParts128 int_to_float128(int64_t a)
+{
+    FloatParts128 r = uint_to_float128(a < 0 ? -(uint64_t)a : a);
+
+    r.sign = a < 0;
+    return r;
+}
+
+float128 int64_to_float128(int64_t a, float_status *status)
+{
+    return float128_round_pack_canonical(int_to_float128(a), status);
+}
+
+float128 int32_to_float128(int32_t a, float_status *status)
+{
+    return int64_to_float128(a, status);
+}
+
+float128 uint64_to_float128(uint64_t a, float_status *status)
+{
+    return float128_round_pack_canonical(uint_to_float128(a), status);
+}
+
 /*
  * Returns the result of converting the unsigned integer `a' to the
  * bfloat16 format.
@@ -3596,6 +4782,89 @@ bfloat16 QEMU_FLATTEN bfloat16_sqrt(bfloat16 a, float_status *status)
     return bfloat16_round_pack_canonical(pr, status);
 }
 
+/*
+ * Bit-by-bit iteration would take 113 steps for float128, so refine an
+ * estimate instead: 32 bits from estimateSqrt32, then two 64-bit digits
+ * by division, each corrected against the exact remainder.
+ */
+
+static FloatParts128 sqrt_float128(FloatParts128 a, float_status *s)
+{
+    uint64_t a0, a1, z0, z1, d0;
+    uint64_t rem0, rem1, rem2, rem3, term0, term1, term2, term3;
+    bool even;
+
+    if (is_nan(a.cls)) {
+        return return_nan128(a, s);
+    }
+    if (a.cls == float_class_zero) {
+        return a;  /* sqrt(+-0) = +-0 */
+    }
+    if (a.sign) {
+        s->float_exception_flags |= float_flag_invalid;
+        return parts128_default_nan(s);
+    }
+    if (a.cls == float_class_inf) {
+        return a;  /* sqrt(+inf) = +inf */
+    }
+
+    assert(a.cls == float_class_normal);
+
+    /*
+     * As in sqrt_float, halve the fraction for an even exponent so that
+     * the root comes out with its msb at the binary point; shift one
+     * more to leave room for the remainder's sign.
+     */
+    even = !(a.exp & 1);
+    z0 = estimateSqrt32(even, a.frac_hi >> 31);
+    shift128Right(a.frac_hi, a.frac_lo, 1 + even, &a0, &a1);
+    a.exp >>= 1;
+
+    z0 = estimateDiv128To64(a0, a1, z0 << 32) + (z0 << 30);
+    d0 = z0 << 1;
+    mul64To128(z0, z0, &term0, &term1);
+    sub128(a0, a1, term0, term1, &rem0, &rem1);
+    while ((int64_t)rem0 < 0) {
+        --z0;
+        d0 -= 2;
+        add128(rem0, rem1, z0 >> 63, d0 | 1, &rem0, &rem1);
+    }
+
+    /*
+     * The second digit is only uncertain when its low bits are near a
+     * rounding boundary; otherwise the bits below it are known non-zero.
+     */
+    z1 = estimateDiv128To64(rem1, 0, d0);
+    if ((z1 & 0x1fff) <= 5) {
+        if (z1 == 0) {
+            z1 = 1;
+        }
+        mul64To128(d0, z1, &term1, &term2);
+        sub128(rem1, 0, term1, term2, &rem1, &rem2);
+        mul64To128(z1, z1, &term2, &term3);
+        sub192(rem1, rem2, 0, 0, term2, term3, &rem1, &rem2, &rem3);
+        while ((int64_t)rem1 < 0) {
+            --z1;
+            shortShift128Left(0, z1, 1, &term2, &term3);
+            term3 |= 1;
+            term2 |= d0;
+            add192(rem1, rem2, rem3, 0, term2, term3, &rem1, &rem2, &rem3);
+        }
+        z1 |= (rem1 | rem2 | rem3) != 0;
+    }
+
+    a.frac_hi = z0;
+    a.frac_lo = z1;
+    return a;
+}
+
+float128 QEMU_FLATTEN float128_sqrt(float128 a, float_status *status)
+{
+    FloatParts128 pa = float128_unpack_canonical(a, status);
+    FloatParts128 pr = sqrt_float128(pa, status);
+    return float128_round_pack_canonical(pr, status);
+}
+
 /*----------------------------------------------------------------------------
 | The pattern for a default generated NaN.
 *----------------------------------------------------------------------------*/
@@ -3865,66 +5134,6 @@ static int64_t roundAndPackInt64(bool zSign, uint64_t absZ0, uint64_t absZ1,
 
 }
 
-/*----------------------------------------------------------------------------
-| Takes the 128-bit fixed-point value formed by concatenating `absZ0' and
-| `absZ1', with binary point between bits 63 and 64 (between the input words),
-| and returns the properly rounded 64-bit unsigned integer corresponding to the
-| input.  Ordinarily, the fixed-point input is simply rounded to an integer,
-| with the inexact exception raised if the input cannot be represented exactly
-| as an integer.  However, if the fixed-point input is too large, the invalid
-| exception is raised and the largest unsigned integer is returned.
-*----------------------------------------------------------------------------*/
-
-static int64_t roundAndPackUint64(bool zSign, uint64_t absZ0,
-                                uint64_t absZ1, float_status *status)
-{
-    int8_t roundingMode;
-    bool roundNearestEven, increment;
-
-    roundingMode = status->float_rounding_mode;
-    roundNearestEven = (roundingMode == float_round_nearest_even);
-    switch (roundingMode) {
-    case float_round_nearest_even:
-    case float_round_ties_away:
-        increment = ((int64_t)absZ1 < 0);
-        break;
-    case float_round_to_zero:
-        increment = 0;
-        break;
-    case float_round_up:
-        increment = !zSign && absZ1;
-        break;
-    case float_round_down:
-        increment = zSign && absZ1;
-        break;
-    case float_round_to_odd:
-        increment = !(absZ0 & 1) && absZ1;
-        break;
-    default:
-        abort();
-    }
-    if (increment) {
-        ++absZ0;
-        if (absZ0 == 0) {
-            float_raise(float_flag_invalid, status);
-            return UINT64_MAX;
-        }
-        if (!(absZ1 << 1) && roundNearestEven) {
-            absZ0 &= ~1;
-        }
-    }
-
-    if (zSign && absZ0) {
-        float_raise(float_flag_invalid, status);
-        return 0;
-    }
-
-    if (absZ1) {
-        status->float_exception_flags |= float_flag_inexact;
-    }
-    return absZ0;
-}
-
 /*----------------------------------------------------------------------------
 | Normalizes the subnormal single-precision floating-point value represented
 | by the denormalized significand `aSig'.  The normalized exponent and
@@ -4779,28 +5988,6 @@ floatx80 int32_to_floatx80(int32_t a, float_status *status)
 
 }
 
-/*----------------------------------------------------------------------------
-| Returns the result of converting the 32-bit two's complement integer `a' to
-| the quadruple-precision floating-point format.  The conversion is performed
-| according to the IEC/IEEE Standard for Binary Floating-Point Arithmetic.
-*----------------------------------------------------------------------------*/
-
-float128 int32_to_float128(int32_t a, float_status *status)
-{
-    bool zSign;
-    uint32_t absA;
-    int8_t shiftCount;
-    uint64_t zSig0;
-
-    if ( a == 0 ) return packFloat128( 0, 0, 0, 0 );
-    zSign = ( a < 0 );
-    absA = zSign ? - a : a;
-    shiftCount = clz32(absA) + 17;
-    zSig0 = absA;
-    return packFloat128( zSign, 0x402E - shiftCount, zSig0<<shiftCount, 0 );
-
-}
-
 /*----------------------------------------------------------------------------
 | Returns the result of converting the 64-bit two's complement integer `a'
 | to the extended double-precision floating-point format.  The conversion
@@ -4822,53 +6009,6 @@ floatx80 int64_to_floatx80(int64_t a, float_status *status)
 
 }
 
-/*----------------------------------------------------------------------------
-| Returns the result of converting the 64-bit two's complement integer `a' to
-| the quadruple-precision floating-point format.  The conversion is performed
-| according to the IEC/IEEE Standard for Binary Floating-Point Arithmetic.
-*----------------------------------------------------------------------------*/
-
-float128 int64_to_float128(int64_t a, float_status *status)
-{
-    bool zSign;
-    uint64_t absA;
-    int8_t shiftCount;
-    int32_t zExp;
-    uint64_t zSig0, zSig1;
-
-    if ( a == 0 ) return packFloat128( 0, 0, 0, 0 );
-    zSign = ( a < 0 );
-    absA = zSign ? - a : a;
-    shiftCount = clz64(absA) + 49;
-    zExp = 0x406E - shiftCount;
-    if ( 64 <= shiftCount ) {
-        zSig1 = 0;
-        zSig0 = absA;
-        shiftCount -= 64;
-    }
-    else {
-        zSig1 = absA;
-        zSig0 = 0;
-    }
-    shortShift128Left( zSig0, zSig1, shiftCount, &zSig0, &zSig1 );
-    return packFloat128( zSign, zExp, zSig0, zSig1 );
-
-}
-
-/*----------------------------------------------------------------------------
-| Returns the result of converting the 64-bit unsigned integer `a'
-| to the quadruple-precision floating-point format.  The conversion is performed
-| according to the IEC/IEEE Standard for Binary Floating-Point Arithmetic.
-*----------------------------------------------------------------------------*/
-
-float128 uint64_to_float128(uint64_t a, float_status *status)
-{
-    if (a == 0) {
-        return float128_zero;
-    }
-    return normalizeRoundAndPackFloat128(0, 0x406E, 0, a, status);
-}
-
 /*----------------------------------------------------------------------------
 | Returns the result of converting the single-precision floating-point value
 | `a' to the extended double-precision floating-point format.  The conversion
@@ -4905,38 +6045,6 @@ floatx80 float32_to_floatx80(float32 a, float_status *status)
 
 }
 
-/*----------------------------------------------------------------------------
-| Returns the result of converting the single-precision floating-point value
-| `a' to the double-precision floating-point format.  The conversion is
-| performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic.
-*----------------------------------------------------------------------------*/
-
-float128 float32_to_float128(float32 a, float_status *status)
-{
-    bool aSign;
-    int aExp;
-    uint32_t aSig;
-
-    a = float32_squash_input_denormal(a, status);
-    aSig = extractFloat32Frac( a );
-    aExp = extractFloat32Exp( a );
-    aSign = extractFloat32Sign( a );
-    if ( aExp == 0xFF ) {
-        if (aSig) {
-            return commonNaNToFloat128(float32ToCommonNaN(a, status), status);
-        }
-        return packFloat128( aSign, 0x7FFF, 0, 0 );
-    }
-    if ( aExp == 0 ) {
-        if ( aSig == 0 ) return packFloat128( aSign, 0, 0, 0 );
-        normalizeFloat32Subnormal( aSig, &aExp, &aSig );
-        --aExp;
-    }
-    return packFloat128( aSign, aExp + 0x3F80, ( (uint64_t) aSig )<<25, 0 );
-
-}
-
 /*----------------------------------------------------------------------------
 | Returns the remainder of the single-precision floating-point value `a'
 | with respect to the corresponding value `b'.  The operation is performed
@@ -5210,39 +6318,6 @@ floatx80 float64_to_floatx80(float64 a, float_status *status)
 
 }
 
-/*----------------------------------------------------------------------------
-| Returns the result of converting the double-precision floating-point value
-| `a' to the quadruple-precision floating-point format.  The conversion is
-| performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic.
-*----------------------------------------------------------------------------*/
-
-float128 float64_to_float128(float64 a, float_status *status)
-{
-    bool aSign;
-    int aExp;
-    uint64_t aSig, zSig0, zSig1;
-
-    a = float64_squash_input_denormal(a, status);
-    aSig = extractFloat64Frac( a );
-    aExp = extractFloat64Exp( a );
-    aSign = extractFloat64Sign( a );
-    if ( aExp == 0x7FF ) {
-        if (aSig) {
-            return commonNaNToFloat128(float64ToCommonNaN(a, status), status);
-        }
-        return packFloat128( aSign, 0x7FFF, 0, 0 );
-    }
-    if ( aExp == 0 ) {
-        if ( aSig == 0 ) return packFloat128( aSign, 0, 0, 0 );
-        normalizeFloat64Subnormal( aSig, &aExp, &aSig );
-        --aExp;
-    }
-    shift128Right( aSig, 0, 4, &zSig0, &zSig1 );
-    return packFloat128( aSign, aExp + 0x3C00, zSig0, zSig1 );
-
-}
-
 
 /*----------------------------------------------------------------------------
 | Returns the remainder of the double-precision floating-point value `a'
@@ -6255,462 +7330,93 @@ floatx80 floatx80_modrem(floatx80 a, floatx80 b, bool mod, uint64_t *quotient,
 | according to the IEC/IEEE Standard for Binary Floating-Point Arithmetic.
 *----------------------------------------------------------------------------*/
 
-floatx80 floatx80_rem(floatx80 a, floatx80 b, float_status *status)
-{
-    uint64_t quotient;
-    return floatx80_modrem(a, b, false, &quotient, status);
-}
-
-/*----------------------------------------------------------------------------
-| Returns the remainder of the extended double-precision floating-point value
-| `a' with respect to the corresponding value `b', with the quotient truncated
-| toward zero.
-*----------------------------------------------------------------------------*/
-
-floatx80 floatx80_mod(floatx80 a, floatx80 b, float_status *status)
-{
-    uint64_t quotient;
-    return floatx80_modrem(a, b, true, &quotient, status);
-}
-
-/*----------------------------------------------------------------------------
-| Returns the square root of the extended double-precision floating-point
-| value `a'.  The operation is performed according to the IEC/IEEE Standard
-| for Binary Floating-Point Arithmetic.
-*----------------------------------------------------------------------------*/
-
-floatx80 floatx80_sqrt(floatx80 a, float_status *status)
-{
-    bool aSign;
-    int32_t aExp, zExp;
-    uint64_t aSig0, aSig1, zSig0, zSig1, doubleZSig0;
-    uint64_t rem0, rem1, rem2, rem3, term0, term1, term2, term3;
-
-    if (floatx80_invalid_encoding(a)) {
-        float_raise(float_flag_invalid, status);
-        return floatx80_default_nan(status);
-    }
-    aSig0 = extractFloatx80Frac( a );
-    aExp = extractFloatx80Exp( a );
-    aSign = extractFloatx80Sign( a );
-    if ( aExp == 0x7FFF ) {
-        if ((uint64_t)(aSig0 << 1)) {
-            return propagateFloatx80NaN(a, a, status);
-        }
-        if ( ! aSign ) return a;
-        goto invalid;
-    }
-    if ( aSign ) {
-        if ( ( aExp | aSig0 ) == 0 ) return a;
- invalid:
-        float_raise(float_flag_invalid, status);
-        return floatx80_default_nan(status);
-    }
-    if ( aExp == 0 ) {
-        if ( aSig0 == 0 ) return packFloatx80( 0, 0, 0 );
-        normalizeFloatx80Subnormal( aSig0, &aExp, &aSig0 );
-    }
-    zExp = ( ( aExp - 0x3FFF )>>1 ) + 0x3FFF;
-    zSig0 = estimateSqrt32( aExp, aSig0>>32 );
-    shift128Right( aSig0, 0, 2 + ( aExp & 1 ), &aSig0, &aSig1 );
-    zSig0 = estimateDiv128To64( aSig0, aSig1, zSig0<<32 ) + ( zSig0<<30 );
-    doubleZSig0 = zSig0<<1;
-    mul64To128( zSig0, zSig0, &term0, &term1 );
-    sub128( aSig0, aSig1, term0, term1, &rem0, &rem1 );
-    while ( (int64_t) rem0 < 0 ) {
-        --zSig0;
-        doubleZSig0 -= 2;
-        add128( rem0, rem1, zSig0>>63, doubleZSig0 | 1, &rem0, &rem1 );
-    }
-    zSig1 = estimateDiv128To64( rem1, 0, doubleZSig0 );
-    if ( ( zSig1 & UINT64_C(0x3FFFFFFFFFFFFFFF) ) <= 5 ) {
-        if ( zSig1 == 0 ) zSig1 = 1;
-        mul64To128( doubleZSig0, zSig1, &term1, &term2 );
-        sub128( rem1, 0, term1, term2, &rem1, &rem2 );
-        mul64To128( zSig1, zSig1, &term2, &term3 );
-        sub192( rem1, rem2, 0, 0, term2, term3, &rem1, &rem2, &rem3 );
-        while ( (int64_t) rem1 < 0 ) {
-            --zSig1;
-            shortShift128Left( 0, zSig1, 1, &term2, &term3 );
-            term3 |= 1;
-            term2 |= doubleZSig0;
-            add192( rem1, rem2, rem3, 0, term2, term3, &rem1, &rem2, &rem3 );
-        }
-        zSig1 |= ( ( rem1 | rem2 | rem3 ) != 0 );
-    }
-    shortShift128Left( 0, zSig1, 1, &zSig0, &zSig1 );
-    zSig0 |= doubleZSig0;
-    return roundAndPackFloatx80(status->floatx80_rounding_precision,
-                                0, zExp, zSig0, zSig1, status);
-}
-
-/*----------------------------------------------------------------------------
-| Returns the result of converting the quadruple-precision floating-point
-| value `a' to the 32-bit two's complement integer format.  The conversion
-| is performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic---which means in particular that the conversion is rounded
-| according to the current rounding mode.  If `a' is a NaN, the largest
-| positive integer is returned.  Otherwise, if the conversion overflows, the
-| largest integer with the same sign as `a' is returned.
-*----------------------------------------------------------------------------*/
-
-int32_t float128_to_int32(float128 a, float_status *status)
-{
-    bool aSign;
-    int32_t aExp, shiftCount;
-    uint64_t aSig0, aSig1;
-
-    aSig1 = extractFloat128Frac1( a );
-    aSig0 = extractFloat128Frac0( a );
-    aExp = extractFloat128Exp( a );
-    aSign = extractFloat128Sign( a );
-    if ( ( aExp == 0x7FFF ) && ( aSig0 | aSig1 ) ) aSign = 0;
-    if ( aExp ) aSig0 |= UINT64_C(0x0001000000000000);
-    aSig0 |= ( aSig1 != 0 );
-    shiftCount = 0x4028 - aExp;
-    if ( 0 < shiftCount ) shift64RightJamming( aSig0, shiftCount, &aSig0 );
-    return roundAndPackInt32(aSign, aSig0, status);
-
-}
-
-/*----------------------------------------------------------------------------
-| Returns the result of converting the quadruple-precision floating-point
-| value `a' to the 32-bit two's complement integer format.  The conversion
-| is performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic, except that the conversion is always rounded toward zero.  If
-| `a' is a NaN, the largest positive integer is returned.  Otherwise, if the
-| conversion overflows, the largest integer with the same sign as `a' is
-| returned.
-*----------------------------------------------------------------------------*/
-
-int32_t float128_to_int32_round_to_zero(float128 a, float_status *status)
-{
-    bool aSign;
-    int32_t aExp, shiftCount;
-    uint64_t aSig0, aSig1, savedASig;
-    int32_t z;
-
-    aSig1 = extractFloat128Frac1( a );
-    aSig0 = extractFloat128Frac0( a );
-    aExp = extractFloat128Exp( a );
-    aSign = extractFloat128Sign( a );
-    aSig0 |= ( aSig1 != 0 );
-    if ( 0x401E < aExp ) {
-        if ( ( aExp == 0x7FFF ) && aSig0 ) aSign = 0;
-        goto invalid;
-    }
-    else if ( aExp < 0x3FFF ) {
-        if (aExp || aSig0) {
-            status->float_exception_flags |= float_flag_inexact;
-        }
-        return 0;
-    }
-    aSig0 |= UINT64_C(0x0001000000000000);
-    shiftCount = 0x402F - aExp;
-    savedASig = aSig0;
-    aSig0 >>= shiftCount;
-    z = aSig0;
-    if ( aSign ) z = - z;
-    if ( ( z < 0 ) ^ aSign ) {
- invalid:
-        float_raise(float_flag_invalid, status);
-        return aSign ? INT32_MIN : INT32_MAX;
-    }
-    if ( ( aSig0<<shiftCount ) != savedASig ) {
-        status->float_exception_flags |= float_flag_inexact;
-    }
-    return z;
-
-}
-
-/*----------------------------------------------------------------------------
-| Returns the result of converting the quadruple-precision floating-point
-| value `a' to the 64-bit two's complement integer format.  The conversion
-| is performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic---which means in particular that the conversion is rounded
-| according to the current rounding mode.  If `a' is a NaN, the largest
-| positive integer is returned.  Otherwise, if the conversion overflows, the
-| largest integer with the same sign as `a' is returned.
-*----------------------------------------------------------------------------*/
-
-int64_t float128_to_int64(float128 a, float_status *status)
-{
-    bool aSign;
-    int32_t aExp, shiftCount;
-    uint64_t aSig0, aSig1;
-
-    aSig1 = extractFloat128Frac1( a );
-    aSig0 = extractFloat128Frac0( a );
-    aExp = extractFloat128Exp( a );
-    aSign = extractFloat128Sign( a );
-    if ( aExp ) aSig0 |= UINT64_C(0x0001000000000000);
-    shiftCount = 0x402F - aExp;
-    if ( shiftCount <= 0 ) {
-        if ( 0x403E < aExp ) {
-            float_raise(float_flag_invalid, status);
-            if (    ! aSign
-                 || (    ( aExp == 0x7FFF )
-                      && ( aSig1 || ( aSig0 != UINT64_C(0x0001000000000000) ) )
-                    )
-               ) {
-                return INT64_MAX;
-            }
-            return INT64_MIN;
-        }
-        shortShift128Left( aSig0, aSig1, - shiftCount, &aSig0, &aSig1 );
-    }
-    else {
-        shift64ExtraRightJamming( aSig0, aSig1, shiftCount, &aSig0, &aSig1 );
-    }
-    return roundAndPackInt64(aSign, aSig0, aSig1, status);
-
-}
-
-/*----------------------------------------------------------------------------
-| Returns the result of converting the quadruple-precision floating-point
-| value `a' to the 64-bit two's complement integer format.  The conversion
-| is performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic, except that the conversion is always rounded toward zero.
-| If `a' is a NaN, the largest positive integer is returned.  Otherwise, if
-| the conversion overflows, the largest integer with the same sign as `a' is
-| returned.
-*----------------------------------------------------------------------------*/
-
-int64_t float128_to_int64_round_to_zero(float128 a, float_status *status)
-{
-    bool aSign;
-    int32_t aExp, shiftCount;
-    uint64_t aSig0, aSig1;
-    int64_t z;
-
-    aSig1 = extractFloat128Frac1( a );
-    aSig0 = extractFloat128Frac0( a );
-    aExp = extractFloat128Exp( a );
-    aSign = extractFloat128Sign( a );
-    if ( aExp ) aSig0 |= UINT64_C(0x0001000000000000);
-    shiftCount = aExp - 0x402F;
-    if ( 0 < shiftCount ) {
-        if ( 0x403E <= aExp ) {
-            aSig0 &= UINT64_C(0x0000FFFFFFFFFFFF);
-            if (    ( a.high == UINT64_C(0xC03E000000000000) )
-                 && ( aSig1 < UINT64_C(0x0002000000000000) ) ) {
-                if (aSig1) {
-                    status->float_exception_flags |= float_flag_inexact;
-                }
-            }
-            else {
-                float_raise(float_flag_invalid, status);
-                if ( ! aSign || ( ( aExp == 0x7FFF ) && ( aSig0 | aSig1 ) ) ) {
-                    return INT64_MAX;
-                }
-            }
-            return INT64_MIN;
-        }
-        z = ( aSig0<<shiftCount ) | ( aSig1>>( ( - shiftCount ) & 63 ) );
-        if ( (uint64_t) ( aSig1<<shiftCount ) ) {
-            status->float_exception_flags |= float_flag_inexact;
-        }
-    }
-    else {
-        if ( aExp < 0x3FFF ) {
-            if ( aExp | aSig0 | aSig1 ) {
-                status->float_exception_flags |= float_flag_inexact;
-            }
-            return 0;
-        }
-        z = aSig0>>( - shiftCount );
-        if (    aSig1
-             || ( shiftCount && (uint64_t) ( aSig0<<( shiftCount & 63 ) ) ) ) {
-            status->float_exception_flags |= float_flag_inexact;
-        }
-    }
-    if ( aSign ) z = - z;
-    return z;
-
-}
-
-/*----------------------------------------------------------------------------
-| Returns the result of converting the quadruple-precision floating-point value
-| `a' to the 64-bit unsigned integer format.  The conversion is
-| performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic---which means in particular that the conversion is rounded
-| according to the current rounding mode.  If `a' is a NaN, the largest
-| positive integer is returned.  If the conversion overflows, the
-| largest unsigned integer is returned.  If 'a' is negative, the value is
-| rounded and zero is returned; negative values that do not round to zero
-| will raise the inexact exception.
-*----------------------------------------------------------------------------*/
-
-uint64_t float128_to_uint64(float128 a, float_status *status)
-{
-    bool aSign;
-    int aExp;
-    int shiftCount;
-    uint64_t aSig0, aSig1;
-
-    aSig0 = extractFloat128Frac0(a);
-    aSig1 = extractFloat128Frac1(a);
-    aExp = extractFloat128Exp(a);
-    aSign = extractFloat128Sign(a);
-    if (aSign && (aExp > 0x3FFE)) {
-        float_raise(float_flag_invalid, status);
-        if (float128_is_any_nan(a)) {
-            return UINT64_MAX;
-        } else {
-            return 0;
-        }
-    }
-    if (aExp) {
-        aSig0 |= UINT64_C(0x0001000000000000);
-    }
-    shiftCount = 0x402F - aExp;
-    if (shiftCount <= 0) {
-        if (0x403E < aExp) {
-            float_raise(float_flag_invalid, status);
-            return UINT64_MAX;
-        }
-        shortShift128Left(aSig0, aSig1, -shiftCount, &aSig0, &aSig1);
-    } else {
-        shift64ExtraRightJamming(aSig0, aSig1, shiftCount, &aSig0, &aSig1);
-    }
-    return roundAndPackUint64(aSign, aSig0, aSig1, status);
-}
-
-uint64_t float128_to_uint64_round_to_zero(float128 a, float_status *status)
-{
-    uint64_t v;
-    signed char current_rounding_mode = status->float_rounding_mode;
-
-    set_float_rounding_mode(float_round_to_zero, status);
-    v = float128_to_uint64(a, status);
-    set_float_rounding_mode(current_rounding_mode, status);
-
-    return v;
-}
-
-/*----------------------------------------------------------------------------
-| Returns the result of converting the quadruple-precision floating-point
-| value `a' to the 32-bit unsigned integer format.  The conversion
-| is performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic except that the conversion is always rounded toward zero.
-| If `a' is a NaN, the largest positive integer is returned.  Otherwise,
-| if the conversion overflows, the largest unsigned integer is returned.
-| If 'a' is negative, the value is rounded and zero is returned; negative
-| values that do not round to zero will raise the inexact exception.
-*----------------------------------------------------------------------------*/
-
-uint32_t float128_to_uint32_round_to_zero(float128 a, float_status *status)
-{
-    uint64_t v;
-    uint32_t res;
-    int old_exc_flags = get_float_exception_flags(status);
-
-    v = float128_to_uint64_round_to_zero(a, status);
-    if (v > 0xffffffff) {
-        res = 0xffffffff;
-    } else {
-        return v;
-    }
-    set_float_exception_flags(old_exc_flags, status);
-    float_raise(float_flag_invalid, status);
-    return res;
-}
-
-/*----------------------------------------------------------------------------
-| Returns the result of converting the quadruple-precision floating-point value
-| `a' to the 32-bit unsigned integer format.  The conversion is
-| performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic---which means in particular that the conversion is rounded
-| according to the current rounding mode.  If `a' is a NaN, the largest
-| positive integer is returned.  If the conversion overflows, the
-| largest unsigned integer is returned.  If 'a' is negative, the value is
-| rounded and zero is returned; negative values that do not round to zero
-| will raise the inexact exception.
-*----------------------------------------------------------------------------*/
-
-uint32_t float128_to_uint32(float128 a, float_status *status)
-{
-    uint64_t v;
-    uint32_t res;
-    int old_exc_flags = get_float_exception_flags(status);
-
-    v = float128_to_uint64(a, status);
-    if (v > 0xffffffff) {
-        res = 0xffffffff;
-    } else {
-        return v;
-    }
-    set_float_exception_flags(old_exc_flags, status);
-    float_raise(float_flag_invalid, status);
-    return res;
-}
-
-/*----------------------------------------------------------------------------
-| Returns the result of converting the quadruple-precision floating-point
-| value `a' to the single-precision floating-point format.  The conversion
-| is performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic.
-*----------------------------------------------------------------------------*/
-
-float32 float128_to_float32(float128 a, float_status *status)
-{
-    bool aSign;
-    int32_t aExp;
-    uint64_t aSig0, aSig1;
-    uint32_t zSig;
-
-    aSig1 = extractFloat128Frac1( a );
-    aSig0 = extractFloat128Frac0( a );
-    aExp = extractFloat128Exp( a );
-    aSign = extractFloat128Sign( a );
-    if ( aExp == 0x7FFF ) {
-        if ( aSig0 | aSig1 ) {
-            return commonNaNToFloat32(float128ToCommonNaN(a, status), status);
-        }
-        return packFloat32( aSign, 0xFF, 0 );
-    }
-    aSig0 |= ( aSig1 != 0 );
-    shift64RightJamming( aSig0, 18, &aSig0 );
-    zSig = aSig0;
-    if ( aExp || zSig ) {
-        zSig |= 0x40000000;
-        aExp -= 0x3F81;
-    }
-    return roundAndPackFloat32(aSign, aExp, zSig, status);
+floatx80 floatx80_rem(floatx80 a, floatx80 b, float_status *status)
+{
+    uint64_t quotient;
+    return floatx80_modrem(a, b, false, &quotient, status);
+}
+
+/*----------------------------------------------------------------------------
+| Returns the remainder of the extended double-precision floating-point value
+| `a' with respect to the corresponding value `b', with the quotient truncated
+| toward zero.
+*----------------------------------------------------------------------------*/
 
+floatx80 floatx80_mod(floatx80 a, floatx80 b, float_status *status)
+{
+    uint64_t quotient;
+    return floatx80_modrem(a, b, true, &quotient, status);
 }
 
 /*----------------------------------------------------------------------------
-| Returns the result of converting the quadruple-precision floating-point
-| value `a' to the double-precision floating-point format.  The conversion
-| is performed according to the IEC/IEEE Standard for Binary Floating-Point
-| Arithmetic.
+| Returns the square root of the extended double-precision floating-point
+| value `a'.  The operation is performed according to the IEC/IEEE Standard
+| for Binary Floating-Point Arithmetic.
 *----------------------------------------------------------------------------*/
 
-float64 float128_to_float64(float128 a, float_status *status)
+floatx80 floatx80_sqrt(floatx80 a, float_status *status)
 {
     bool aSign;
-    int32_t aExp;
-    uint64_t aSig0, aSig1;
+    int32_t aExp, zExp;
+    uint64_t aSig0, aSig1, zSig0, zSig1, doubleZSig0;
+    uint64_t rem0, rem1, rem2, rem3, term0, term1, term2, term3;
 
-    aSig1 = extractFloat128Frac1( a );
-    aSig0 = extractFloat128Frac0( a );
-    aExp = extractFloat128Exp( a );
-    aSign = extractFloat128Sign( a );
+    if (floatx80_invalid_encoding(a)) {
+        float_raise(float_flag_invalid, status);
+        return floatx80_default_nan(status);
+    }
+    aSig0 = extractFloatx80Frac( a );
+    aExp = extractFloatx80Exp( a );
+    aSign = extractFloatx80Sign( a );
     if ( aExp == 0x7FFF ) {
-        if ( aSig0 | aSig1 ) {
-            return commonNaNToFloat64(float128ToCommonNaN(a, status), status);
+        if ((uint64_t)(aSig0 << 1)) {
+            return propagateFloatx80NaN(a, a, status);
         }
-        return packFloat64( aSign, 0x7FF, 0 );
+        if ( ! aSign ) return a;
+        goto invalid;
     }
-    shortShift128Left( aSig0, aSig1, 14, &aSig0, &aSig1 );
-    aSig0 |= ( aSig1 != 0 );
-    if ( aExp || aSig0 ) {
-        aSig0 |= UINT64_C(0x4000000000000000);
-        aExp -= 0x3C01;
+    if ( aSign ) {
+        if ( ( aExp | aSig0 ) == 0 ) return a;
+ invalid:
+        float_raise(float_flag_invalid, status);
+        return floatx80_default_nan(status);
     }
-    return roundAndPackFloat64(aSign, aExp, aSig0, status);
-
+    if ( aExp == 0 ) {
+        if ( aSig0 == 0 ) return packFloatx80( 0, 0, 0 );
+        normalizeFloatx80Subnormal( aSig0, &aExp, &aSig0 );
+    }
+    zExp = ( ( aExp - 0x3FFF )>>1 ) + 0x3FFF;
+    zSig0 = estimateSqrt32( aExp, aSig0>>32 );
+    shift128Right( aSig0, 0, 2 + ( aExp & 1 ), &aSig0, &aSig1 );
+    zSig0 = estimateDiv128To64( aSig0, aSig1, zSig0<<32 ) + ( zSig0<<30 );
+    doubleZSig0 = zSig0<<1;
+    mul64To128( zSig0, zSig0, &term0, &term1 );
+    sub128( aSig0, aSig1, term0, term1, &rem0, &rem1 );
+    while ( (int64_t) rem0 < 0 ) {
+        --zSig0;
+        doubleZSig0 -= 2;
+        add128( rem0, rem1, zSig0>>63, doubleZSig0 | 1, &rem0, &rem1 );
+    }
+    zSig1 = estimateDiv128To64( rem1, 0, doubleZSig0 );
+    if ( ( zSig1 & UINT64_C(0x3FFFFFFFFFFFFFFF) ) <= 5 ) {
+        if ( zSig1 == 0 ) zSig1 = 1;
+        mul64To128( doubleZSig0, zSig1, &term1, &term2 );
+        sub128( rem1, 0, term1, term2, &rem1, &rem2 );
+        mul64To128( zSig1, zSig1, &term2, &term3 );
+        sub192( rem1, rem2, 0, 0, term2, term3, &rem1, &rem2, &rem3 );
+        while ( (int64_t) rem1 < 0 ) {
+            --zSig1;
+            shortShift128Left( 0, zSig1, 1, &term2, &term3 );
+            term3 |= 1;
+            term2 |= doubleZSig0;
+            add192( rem1, rem2, rem3, 0, term2, term3, &rem1, &rem2, &rem3 );
+        }
+        zSig1 |= ( ( rem1 | rem2 | rem3 ) != 0 );
+    }
+    shortShift128Left( 0, zSig1, 1, &zSig0, &zSig1 );
+    zSig0 |= doubleZSig0;
+    return roundAndPackFloatx80(status->floatx80_rounding_precision,
+                                0, zExp, zSig0, zSig1, status);
 }
 
 /*----------------------------------------------------------------------------
@@ -7131,156 +7837,6 @@ float128 float128_sub(float128 a, float128 b, float_status *status)
 
 }
 
-/*----------------------------------------------------------------------------
-| Returns the result of multiplying the quadruple-precision floating-point
-| values `a' and `b'.  The operation is performed according to the IEC/IEEE
-| Standard for Binary Floating-Point Arithmetic.
-*----------------------------------------------------------------------------*/
-
-float128 float128_mul(float128 a, float128 b, float_status *status)
-{
-    bool aSign, bSign, zSign;
-    int32_t aExp, bExp, zExp;
-    uint64_t aSig0, aSig1, bSig0, bSig1, zSig0, zSig1, zSig2, zSig3;
-
-    aSig1 = extractFloat128Frac1( a );
-    aSig0 = extractFloat128Frac0( a );
-    aExp = extractFloat128Exp( a );
-    aSign = extractFloat128Sign( a );
-    bSig1 = extractFloat128Frac1( b );
-    bSig0 = extractFloat128Frac0( b );
-    bExp = extractFloat128Exp( b );
-    bSign = extractFloat128Sign( b );
-    zSign = aSign ^ bSign;
-    if ( aExp == 0x7FFF ) {
-        if (    ( aSig0 | aSig1 )
-             || ( ( bExp == 0x7FFF ) && ( bSig0 | bSig1 ) ) ) {
-            return propagateFloat128NaN(a, b, status);
-        }
-        if ( ( bExp | bSig0 | bSig1 ) == 0 ) goto invalid;
-        return packFloat128( zSign, 0x7FFF, 0, 0 );
-    }
-    if ( bExp == 0x7FFF ) {
-        if (bSig0 | bSig1) {
-            return propagateFloat128NaN(a, b, status);
-        }
-        if ( ( aExp | aSig0 | aSig1 ) == 0 ) {
- invalid:
-            float_raise(float_flag_invalid, status);
-            return float128_default_nan(status);
-        }
-        return packFloat128( zSign, 0x7FFF, 0, 0 );
-    }
-    if ( aExp == 0 ) {
-        if ( ( aSig0 | aSig1 ) == 0 ) return packFloat128( zSign, 0, 0, 0 );
-        normalizeFloat128Subnormal( aSig0, aSig1, &aExp, &aSig0, &aSig1 );
-    }
-    if ( bExp == 0 ) {
-        if ( ( bSig0 | bSig1 ) == 0 ) return packFloat128( zSign, 0, 0, 0 );
-        normalizeFloat128Subnormal( bSig0, bSig1, &bExp, &bSig0, &bSig1 );
-    }
-    zExp = aExp + bExp - 0x4000;
-    aSig0 |= UINT64_C(0x0001000000000000);
-    shortShift128Left( bSig0, bSig1, 16, &bSig0, &bSig1 );
-    mul128To256( aSig0, aSig1, bSig0, bSig1, &zSig0, &zSig1, &zSig2, &zSig3 );
-    add128( zSig0, zSig1, aSig0, aSig1, &zSig0, &zSig1 );
-    zSig2 |= ( zSig3 != 0 );
-    if (UINT64_C( 0x0002000000000000) <= zSig0 ) {
-        shift128ExtraRightJamming(
-            zSig0, zSig1, zSig2, 1, &zSig0, &zSig1, &zSig2 );
-        ++zExp;
-    }
-    return roundAndPackFloat128(zSign, zExp, zSig0, zSig1, zSig2, status);
-
-}
-
-/*----------------------------------------------------------------------------
-| Returns the result of dividing the quadruple-precision floating-point value
-| `a' by the corresponding value `b'.  The operation is performed according to
-| the IEC/IEEE Standard for Binary Floating-Point Arithmetic.
-*----------------------------------------------------------------------------*/
-
-float128 float128_div(float128 a, float128 b, float_status *status)
-{
-    bool aSign, bSign, zSign;
-    int32_t aExp, bExp, zExp;
-    uint64_t aSig0, aSig1, bSig0, bSig1, zSig0, zSig1, zSig2;
-    uint64_t rem0, rem1, rem2, rem3, term0, term1, term2, term3;
-
-    aSig1 = extractFloat128Frac1( a );
-    aSig0 = extractFloat128Frac0( a );
-    aExp = extractFloat128Exp( a );
-    aSign = extractFloat128Sign( a );
-    bSig1 = extractFloat128Frac1( b );
-    bSig0 = extractFloat128Frac0( b );
-    bExp = extractFloat128Exp( b );
-    bSign = extractFloat128Sign( b );
-    zSign = aSign ^ bSign;
-    if ( aExp == 0x7FFF ) {
-        if (aSig0 | aSig1) {
-            return propagateFloat128NaN(a, b, status);
-        }
-        if ( bExp == 0x7FFF ) {
-            if (bSig0 | bSig1) {
-                return propagateFloat128NaN(a, b, status);
-            }
-            goto invalid;
-        }
-        return packFloat128( zSign, 0x7FFF, 0, 0 );
-    }
-    if ( bExp == 0x7FFF ) {
-        if (bSig0 | bSig1) {
-            return propagateFloat128NaN(a, b, status);
-        }
-        return packFloat128( zSign, 0, 0, 0 );
-    }
-    if ( bExp == 0 ) {
-        if ( ( bSig0 | bSig1 ) == 0 ) {
-            if ( ( aExp | aSig0 | aSig1 ) == 0 ) {
- invalid:
-                float_raise(float_flag_invalid, status);
-                return float128_default_nan(status);
-            }
-            float_raise(float_flag_divbyzero, status);
-            return packFloat128( zSign, 0x7FFF, 0, 0 );
-        }
-        normalizeFloat128Subnormal( bSig0, bSig1, &bExp, &bSig0, &bSig1 );
-    }
-    if ( aExp == 0 ) {
-        if ( ( aSig0 | aSig1 ) == 0 ) return packFloat128( zSign, 0, 0, 0 );
-        normalizeFloat128Subnormal( aSig0, aSig1, &aExp, &aSig0, &aSig1 );
-    }
-    zExp = aExp - bExp + 0x3FFD;
-    shortShift128Left(
-        aSig0 | UINT64_C(0x0001000000000000), aSig1, 15, &aSig0, &aSig1 );
-    shortShift128Left(
-        bSig0 | UINT64_C(0x0001000000000000), bSig1, 15, &bSig0, &bSig1 );
-    if ( le128( bSig0, bSig1, aSig0, aSig1 ) ) {
-        shift128Right( aSig0, aSig1, 1, &aSig0, &aSig1 );
-        ++zExp;
-    }
-    zSig0 = estimateDiv128To64( aSig0, aSig1, bSig0 );
-    mul128By64To192( bSig0, bSig1, zSig0, &term0, &term1, &term2 );
-    sub192( aSig0, aSig1, 0, term0, term1, term2, &rem0, &rem1, &rem2 );
-    while ( (int64_t) rem0 < 0 ) {
-        --zSig0;
-        add192( rem0, rem1, rem2, 0, bSig0, bSig1, &rem0, &rem1, &rem2 );
-    }
-    zSig1 = estimateDiv128To64( rem1, rem2, bSig0 );
-    if ( ( zSig1 & 0x3FFF ) <= 4 ) {
-        mul128By64To192( bSig0, bSig1, zSig1, &term1, &term2, &term3 );
-        sub192( rem1, rem2, 0, term1, term2, term3, &rem1, &rem2, &rem3 );
-        while ( (int64_t) rem1 < 0 ) {
-            --zSig1;
-            add192( rem1, rem2, rem3, 0, bSig0, bSig1, &rem1, &rem2, &rem3 );
-        }
-        zSig1 |= ( ( rem1 | rem2 | rem3 ) != 0 );
-    }
-    shift128ExtraRightJamming( zSig0, zSig1, 0, 15, &zSig0, &zSig1, &zSig2 );
-    return roundAndPackFloat128(zSign, zExp, zSig0, zSig1, zSig2, status);
-
-}
-
 /*----------------------------------------------------------------------------
 | Returns the remainder of the quadruple-precision floating-point value `a'
 | with respect to the corresponding value `b'.  The operation is performed
@@ -7388,74 +7944,6 @@ float128 float128_rem(float128 a, float128 b, float_status *status)
                                          status);
 }
 
-/*----------------------------------------------------------------------------
-| Returns the square root of the quadruple-precision floating-point value `a'.
-| The operation is performed according to the IEC/IEEE Standard for Binary
-| Floating-Point Arithmetic.
-*----------------------------------------------------------------------------*/
-
-float128 float128_sqrt(float128 a, float_status *status)
-{
-    bool aSign;
-    int32_t aExp, zExp;
-    uint64_t aSig0, aSig1, zSig0, zSig1, zSig2, doubleZSig0;
-    uint64_t rem0, rem1, rem2, rem3, term0, term1, term2, term3;
-
-    aSig1 = extractFloat128Frac1( a );
-    aSig0 = extractFloat128Frac0( a );
-    aExp = extractFloat128Exp( a );
-    aSign = extractFloat128Sign( a );
-    if ( aExp == 0x7FFF ) {
-        if (aSig0 | aSig1) {
-            return propagateFloat128NaN(a, a, status);
-        }
-        if ( ! aSign ) return a;
-        goto invalid;
-    }
-    if ( aSign ) {
-        if ( ( aExp | aSig0 | aSig1 ) == 0 ) return a;
- invalid:
-        float_raise(float_flag_invalid, status);
-        return float128_default_nan(status);
-    }
-    if ( aExp == 0 ) {
-        if ( ( aSig0 | aSig1 ) == 0 ) return packFloat128( 0, 0, 0, 0 );
-        normalizeFloat128Subnormal( aSig0, aSig1, &aExp, &aSig0, &aSig1 );
-    }
-    zExp = ( ( aExp - 0x3FFF )>>1 ) + 0x3FFE;
-    aSig0 |= UINT64_C(0x0001000000000000);
-    zSig0 = estimateSqrt32( aExp, aSig0>>17 );
-    shortShift128Left( aSig0, aSig1, 13 - ( aExp & 1 ), &aSig0, &aSig1 );
-    zSig0 = estimateDiv128To64( aSig0, aSig1, zSig0<<32 ) + ( zSig0<<30 );
-    doubleZSig0 = zSig0<<1;
-    mul64To128( zSig0, zSig0, &term0, &term1 );
-    sub128( aSig0, aSig1, term0, term1, &rem0, &rem1 );
-    while ( (int64_t) rem0 < 0 ) {
-        --zSig0;
-        doubleZSig0 -= 2;
-        add128( rem0, rem1, zSig0>>63, doubleZSig0 | 1, &rem0, &rem1 );
-    }
-    zSig1 = estimateDiv128To64( rem1, 0, doubleZSig0 );
-    if ( ( zSig1 & 0x1FFF ) <= 5 ) {
-        if ( zSig1 == 0 ) zSig1 = 1;
-        mul64To128( doubleZSig0, zSig1, &term1, &term2 );
-        sub128( rem1, 0, term1, term2, &rem1, &rem2 );
-        mul64To128( zSig1, zSig1, &term2, &term3 );
-        sub192( rem1, rem2, 0, 0, term2, term3, &rem1, &rem2, &rem3 );
-        while ( (int64_t) rem1 < 0 ) {
-            --zSig1;
-            shortShift128Left( 0, zSig1, 1, &term2, &term3 );
-            term3 |= 1;
-            term2 |= doubleZSig0;
-            add192( rem1, rem2, rem3, 0, term2, term3, &rem1, &rem2, &rem3 );
-        }
-        zSig1 |= ( ( rem1 | rem2 | rem3 ) != 0 );
-    }
-    shift128ExtraRightJamming( zSig0, zSig1, 0, 14, &zSig0, &zSig1, &zSig2 );
-    return roundAndPackFloat128(0, zExp, zSig0, zSig1, zSig2, status);
-
-}
-
 static inline FloatRelation
 floatx80_compare_internal(floatx80 a, floatx80 b, bool is_quiet,
                           float_status *status)
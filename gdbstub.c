@@ -920,7 +920,7 @@ static const char *get_feature_xml(const char *p, const char **newp,
     return name ? xml_builtin[i][1] : NULL;
 }
 
-static int gdb_read_register(CPUState *cpu, GByteArray *buf, int reg)
+int gdb_read_register(CPUState *cpu, GByteArray *buf, int reg)
 {
     CPUClass *cc = CPU_GET_CLASS(cpu);
     CPUArchState *env = cpu->env_ptr;
@@ -956,6 +956,118 @@ static int gdb_write_register(CPUState *cpu, uint8_t *mem_buf, int reg)
     return 0;
 }
 
+static const char *gdb_find_feature_xml(CPUState *cpu, const char *name)
+{
+    CPUClass *cc = CPU_GET_CLASS(cpu);
+    int i;
+
+    if (cc->gdb_get_dynamic_xml) {
+        const char *xml = cc->gdb_get_dynamic_xml(cpu, name);
+
+        if (xml) {
+            return xml;
+        }
+    }
+    for (i = 0; xml_builtin[i][0]; i++) {
+        if (strcmp(xml_builtin[i][0], name) == 0) {
+            return xml_builtin[i][1];
+        }
+    }
+    return NULL;
+}
+
+/* Value of @attr in the XML element between @elem and @end, interned */
+static const char *gdb_xml_attr(const char *elem, const char *end,
+                                const char *attr)
+{
+    g_autofree char *pattern = g_strdup_printf(" %s=\"", attr);
+    g_autofree char *val = NULL;
+    const char *start, *stop;
+
+    start = g_strstr_len(elem, end - elem, pattern);
+    if (!start) {
+        return NULL;
+    }
+    start += strlen(pattern);
+    stop = memchr(start, '"', end - start);
+    if (!stop) {
+        return NULL;
+    }
+    val = g_strndup(start, stop - start);
+    return g_intern_string(val);
+}
+
+/*
+ * Number the registers of a feature the way gdb does, which is also how
+ * the 'p' packet numbers them: each <reg> takes the number given by its
+ * regnum attribute, or the one after the previous register, starting at
+ * @base_reg.
+ */
+static void gdb_append_feature_regs(GArray *regs, const char *xml,
+                                    int base_reg, int num_regs)
+{
+    const char *feature = NULL;
+    const char *p;
+    int reg = base_reg;
+    int n = 0;
+
+    for (p = strchr(xml, '<'); p && n < num_regs; p = strchr(p + 1, '<')) {
+        const char *end;
+
+        if (g_str_has_prefix(p, "<!--")) {
+            p = strstr(p, "-->");
+            if (!p) {
+                break;
+            }
+            continue;
+        }
+        end = strchr(p, '>');
+        if (!end) {
+            break;
+        }
+        if (g_str_has_prefix(p, "<feature ")) {
+            feature = gdb_xml_attr(p, end, "name");
+        } else if (g_str_has_prefix(p, "<reg ")) {
+            const char *regnum = gdb_xml_attr(p, end, "regnum");
+            GDBRegDesc desc = {
+                .name = gdb_xml_attr(p, end, "name"),
+                .feature_name = feature,
+            };
+
+            if (regnum) {
+                reg = atoi(regnum);
+            }
+            desc.gdb_reg = reg++;
+            if (desc.name) {
+                g_array_append_val(regs, desc);
+            }
+            n++;
+        }
+    }
+}
+
+GArray *gdb_get_register_list(CPUState *cpu)
+{
+    CPUClass *cc = CPU_GET_CLASS(cpu);
+    GArray *regs = g_array_new(false, false, sizeof(GDBRegDesc));
+    GDBRegisterState *r;
+    const char *xml;
+
+    if (cc->gdb_core_xml_file) {
+        xml = gdb_find_feature_xml(cpu, cc->gdb_core_xml_file);
+        if (xml) {
+            gdb_append_feature_regs(regs, xml, 0, cc->gdb_num_core_regs);
+        }
+    }
+    for (r = cpu->gdb_regs; r; r = r->next) {
+        xml = gdb_find_feature_xml(cpu, r->xml);
+        if (xml) {
+            gdb_append_feature_regs(regs, xml, r->base_reg, r->num_regs);
+        }
+    }
+    return regs;
+}
+
 /* Register a supplemental set of CPU registers.  If g_pos is nonzero it
    specifies the first register number and these registers are included in
    a standard "g" packet.  Direction is relative to gdb, i.e. get_reg is
@@ -372,6 +372,7 @@ static void cpu_common_initfn(Object *obj)
     QSIMPLEQ_INIT(&cpu->work_list);
     QTAILQ_INIT(&cpu->breakpoints);
     QTAILQ_INIT(&cpu->watchpoints);
+    cpu->tb_jmp_cache = cpu_tb_jmp_cache_new(TB_JMP_CACHE_BITS);
 
     cpu_exec_initfn(cpu);
 }
@@ -381,6 +382,7 @@ static void cpu_common_finalize(Object *obj)
     CPUState *cpu = CPU(obj);
 
     qemu_mutex_destroy(&cpu->work_mutex);
+    g_free(cpu->tb_jmp_cache);
 }
 
 static int64_t cpu_common_get_arch_id(CPUState *cpu)
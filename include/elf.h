@@ -1734,6 +1734,7 @@ struct elf32_fdpic_loadmap {
 #define elf_note	elf32_note
 #define elf_shdr	elf32_shdr
 #define elf_sym		elf32_sym
+#define elf_dyn		Elf32_Dyn
 #define elf_addr_t	Elf32_Off
 #define elf_rela  elf32_rela
 
@@ -1750,6 +1751,7 @@ struct elf32_fdpic_loadmap {
 #define elf_note	elf64_note
 #define elf_shdr	elf64_shdr
 #define elf_sym		elf64_sym
+#define elf_dyn		Elf64_Dyn
 #define elf_addr_t	Elf64_Off
 #define elf_rela  elf64_rela
 
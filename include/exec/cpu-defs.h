@@ -82,6 +82,12 @@ typedef uint64_t target_ulong;
 /* use a fully associative victim tlb of 8 entries */
 #define CPU_VTLB_SIZE 8
 
+/* use a fully associative tlb of 8 entries for large pages */
+#define CPU_LTLB_SIZE 8
+
+/* coalesce up to 8 distinct ranges flushed by other vCPUs */
+#define CPU_TLB_PENDING_FLUSHES 8
+
 #if HOST_LONG_BITS == 32 && TARGET_LONG_BITS == 32
 #define CPU_TLB_ENTRY_BITS 4
 #else
@@ -153,6 +159,22 @@ typedef struct CPUIOTLBEntry {
     MemTxAttrs attrs;
 } CPUIOTLBEntry;
 
+/*
+ * A translation for a page larger than TARGET_PAGE_SIZE, as reported
+ * to tlb_set_page_with_attrs.  It is not used by the fast path, but
+ * allows the slow path to refill any TARGET_PAGE_SIZE page covered by
+ * the large page without walking the guest page tables again.
+ */
+typedef struct CPUTLBLargeEntry {
+    /* The page is matched if (vaddr & mask) == addr.  */
+    target_ulong addr;
+    target_ulong mask;
+    /* Added to a page-aligned virtual address to obtain the physical one */
+    hwaddr paddr_ofs;
+    MemTxAttrs attrs;
+    int prot;
+} CPUTLBLargeEntry;
+
 /*
  * Data elements that are per MMU mode, minus the bits accessed by
  * the TCG fast path.
@@ -176,6 +198,10 @@ typedef struct CPUTLBDesc {
     /* The tlb victim table, in two parts.  */
     CPUTLBEntry vtable[CPU_VTLB_SIZE];
     CPUIOTLBEntry viotlb[CPU_VTLB_SIZE];
+    /* The next index to use in the large page table.  */
+    size_t lindex;
+    /* The large page table.  */
+    CPUTLBLargeEntry ltable[CPU_LTLB_SIZE];
     /* The iotlb.  */
     CPUIOTLBEntry *iotlb;
 } CPUTLBDesc;
@@ -191,6 +217,17 @@ typedef struct CPUTLBDescFast {
     CPUTLBEntry *table;
 } CPUTLBDescFast QEMU_ALIGNED(2 * sizeof(void *));
 
+/*
+ * A range of pages to be flushed from the TLB of the mmu indexes
+ * in @idxmap; only the low @bits of the addresses are significant.
+ */
+typedef struct TLBFlushRange {
+    target_ulong addr;
+    target_ulong len;
+    uint16_t idxmap;
+    uint16_t bits;
+} TLBFlushRange;
+
 /*
  * Data elements that are shared between all MMU modes.
  */
@@ -203,6 +240,18 @@ typedef struct CPUTLBCommon {
      * Protected by tlb_c.lock.
      */
     uint16_t dirty;
+    /*
+     * Range flushes requested by other vCPUs and not yet performed.
+     * They are all performed by one work item, queued when
+     * @pending_queued becomes true.  If more than
+     * CPU_TLB_PENDING_FLUSHES distinct ranges are requested, the mmu
+     * indexes in @pending_full_idxmap are flushed entirely instead.
+     * Protected by tlb_c.lock.
+     */
+    bool pending_queued;
+    uint16_t pending_full_idxmap;
+    unsigned int n_pending;
+    TLBFlushRange pending[CPU_TLB_PENDING_FLUSHES];
     /*
      * Statistics.  These are not lock protected, but are read and
      * written atomically.  This allows the monitor to print a snapshot
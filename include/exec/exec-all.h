@@ -270,6 +270,33 @@ void tlb_flush_page_bits_by_mmuidx_all_cpus(CPUState *cpu, target_ulong addr,
 void tlb_flush_page_bits_by_mmuidx_all_cpus_synced
     (CPUState *cpu, target_ulong addr, uint16_t idxmap, unsigned bits);
 
+/**
+ * tlb_flush_range_by_mmuidx
+ * @cpu: CPU whose TLB should be flushed
+ * @addr: virtual address of the start of the range to be flushed
+ * @len: length of range to be flushed
+ * @idxmap: bitmap of mmu indexes to flush
+ * @bits: number of significant bits in address
+ *
+ * For each mmuidx in @idxmap, flush all pages within [@addr,@addr+@len),
+ * comparing only the low @bits worth of each virtual page.  Each vCPU
+ * receives a single work item for the whole range, and flushes that
+ * reach a vCPU before it has performed the previous ones are merged.
+ */
+void tlb_flush_range_by_mmuidx(CPUState *cpu, target_ulong addr,
+                               target_ulong len, uint16_t idxmap,
+                               unsigned bits);
+
+/* Similarly, with broadcast and syncing. */
+void tlb_flush_range_by_mmuidx_all_cpus(CPUState *cpu, target_ulong addr,
+                                        target_ulong len, uint16_t idxmap,
+                                        unsigned bits);
+void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *cpu,
+                                               target_ulong addr,
+                                               target_ulong len,
+                                               uint16_t idxmap,
+                                               unsigned bits);
+
 /**
  * tlb_set_page_with_attrs:
  * @cpu: CPU to add this TLB entry for
@@ -295,6 +322,22 @@ void tlb_flush_page_bits_by_mmuidx_all_cpus_synced
 void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
                              hwaddr paddr, MemTxAttrs attrs,
                              int prot, int mmu_idx, target_ulong size);
+/**
+ * tlb_set_page_linear:
+ *
+ * Like tlb_set_page_with_attrs(), but the caller also guarantees that
+ * the whole @size aligned region containing @vaddr maps linearly onto
+ * the @size aligned region containing @paddr, with the same @attrs and
+ * @prot throughout.  The other TARGET_PAGE_SIZE pages of the region can
+ * then be entered into the TLB without calling tlb_fill again.
+ *
+ * This is not the case, for example, when @size is that of a second
+ * stage of translation, or when each page goes through a nested page
+ * table whose mappings may be smaller or have other permissions.
+ */
+void tlb_set_page_linear(CPUState *cpu, target_ulong vaddr,
+                         hwaddr paddr, MemTxAttrs attrs,
+                         int prot, int mmu_idx, target_ulong size);
 /* tlb_set_page:
  *
  * This function is equivalent to calling tlb_set_page_with_attrs()
@@ -373,6 +416,25 @@ tlb_flush_page_bits_by_mmuidx_all_cpus_synced(CPUState *cpu, target_ulong addr,
                                               uint16_t idxmap, unsigned bits)
 {
 }
+static inline void tlb_flush_range_by_mmuidx(CPUState *cpu, target_ulong addr,
+                                             target_ulong len, uint16_t idxmap,
+                                             unsigned bits)
+{
+}
+static inline void tlb_flush_range_by_mmuidx_all_cpus(CPUState *cpu,
+                                                      target_ulong addr,
+                                                      target_ulong len,
+                                                      uint16_t idxmap,
+                                                      unsigned bits)
+{
+}
+static inline void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *cpu,
+                                                             target_ulong addr,
+                                                             target_ulong len,
+                                                             uint16_t idxmap,
+                                                             unsigned bits)
+{
+}
 #endif
 /**
  * probe_access:
@@ -452,6 +514,9 @@ struct tb_tc {
     size_t size;
 };
 
+/* Number of targets cached for each indirect branch site */
+#define TB_IND_CACHE_SIZE 4
+
 struct TranslationBlock {
     target_ulong pc;   /* simulated PC corresponding to this block (EIP + CS base) */
     target_ulong cs_base; /* CS base for this block */
@@ -519,9 +584,25 @@ struct TranslationBlock {
     uintptr_t jmp_list_head;
     uintptr_t jmp_list_next[2];
     uintptr_t jmp_dest[2];
+
+    /*
+     * Inline caches consulted by the code generated by
+     * translator_lookup_and_goto_ptr() before calling into the runtime.
+     *
+     * ind_cache[] holds the most recent targets of the indirect branch(es)
+     * ending this TB, most recently used first.  For a TB ending in a call
+     * recorded with translator_push_return(), ret_pc is the return address
+     * and ret_tb the TB found there.  Unused entries point to
+     * tb_ind_sentinel, which never matches.  All entries are filled by
+     * the lookup helpers and read concurrently by generated code.
+     */
+    struct TranslationBlock *ind_cache[TB_IND_CACHE_SIZE];
+    struct TranslationBlock *ret_tb;
+    target_ulong ret_pc;
 };
 
 extern bool parallel_cpus;
+extern TranslationBlock tb_ind_sentinel;
 
 /* Hide the qatomic_read to make code a little easier on the eyes */
 static inline uint32_t tb_cflags(const TranslationBlock *tb)
@@ -548,6 +629,10 @@ void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr);
 TranslationBlock *tb_htable_lookup(CPUState *cpu, target_ulong pc,
                                    target_ulong cs_base, uint32_t flags,
                                    uint32_t cf_mask);
+TranslationBlock *tb_jmp_cache_lookup_slow(CPUState *cpu, target_ulong pc,
+                                           target_ulong cs_base,
+                                           uint32_t flags, uint32_t cf_mask);
+void tb_jmp_cache_insert(CPUState *cpu, target_ulong pc, TranslationBlock *tb);
 void tb_set_jmp_target(TranslationBlock *tb, int n, uintptr_t addr);
 
 /* GETPC is the true target of the return instruction that we'll execute.  */
@@ -74,6 +74,31 @@ void gdb_register_coprocessor(CPUState *cpu,
                               gdb_get_reg_cb get_reg, gdb_set_reg_cb set_reg,
                               int num_regs, const char *xml, int g_pos);
 
+/**
+ * gdb_read_register: read a register as gdb would
+ * @cpu: the CPU to read from
+ * @buf: array the value is appended to, in target byte order
+ * @reg: gdb register number
+ *
+ * Returns the size of the register, or 0 if @reg does not exist.
+ */
+int gdb_read_register(CPUState *cpu, GByteArray *buf, int reg);
+
+typedef struct GDBRegDesc {
+    int gdb_reg;
+    const char *name;
+    const char *feature_name;
+} GDBRegDesc;
+
+/**
+ * gdb_get_register_list: describe the registers of a CPU
+ * @cpu: the CPU to describe
+ *
+ * Returns an array of #GDBRegDesc built from the CPU's gdb XML, which
+ * the caller must free. The names are interned strings.
+ */
+GArray *gdb_get_register_list(CPUState *cpu);
+
 /*
  * The GDB remote protocol transfers values in target byte order. As
  * the gdbstub may be batching up several register values we always
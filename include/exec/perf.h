@@ -0,0 +1,81 @@
+/*
+ * Profiling support for TCG generated code
+ *
+ * Copyright (c) 2021 The QEMU Project Developers
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef EXEC_PERF_H
+#define EXEC_PERF_H
+
+#include "exec/exec-all.h"
+
+/*
+ * perf_enable_perfmap:
+ *
+ * Start writing /tmp/perf-<pid>.map, which tells the perf tool which
+ * guest code each translation block in the code buffer belongs to.
+ * Entries cannot be retracted, so after the code buffer has been
+ * flushed or one of its regions reclaimed, addresses may resolve to a
+ * stale name: prefer the jitdump for long runs.
+ */
+bool perf_enable_perfmap(Error **errp);
+
+/*
+ * perf_enable_jitdump:
+ *
+ * Start writing a jit-<pid>.dump file in the perf jitdump format,
+ * including the generated code, for use with "perf record -k 1" and
+ * "perf inject --jit".  Its records are timestamped, so code buffer
+ * reuse is attributed correctly.
+ */
+bool perf_enable_jitdump(Error **errp);
+
+/*
+ * perf_enable_profile:
+ * @filename: where to write the profile at exit, or "-" for stderr
+ * @sig: host signal to sample with
+ *
+ * Start the built-in sampling profiler: a process CPU-time timer
+ * delivers @sig, the host PC it interrupts is attributed to the
+ * translation block it hit, and a flat profile by guest PC is written
+ * out at exit.  The profiler installs its own handler for @sig, so the
+ * caller must keep it from any other use.
+ */
+bool perf_enable_profile(const char *filename, int sig, Error **errp);
+
+/*
+ * perf_set_code_gen_buffer:
+ * @buf: start of code_gen_buffer
+ * @size: size of code_gen_buffer, including all regions
+ *
+ * Tell the profiler where generated code lives.  Called once, when the
+ * buffer is allocated and before it is split into regions.
+ */
+void perf_set_code_gen_buffer(const void *buf, size_t size);
+
+/*
+ * perf_report_code:
+ *
+ * Record a newly generated translation block.
+ */
+void perf_report_code(const TranslationBlock *tb);
+
+/*
+ * perf_profile_fold:
+ *
+ * Attribute the samples taken so far to their translation blocks.
+ * Called before generated code is freed, while all TBs still exist,
+ * from an exclusive context.
+ */
+void perf_profile_fold(void);
+
+/*
+ * perf_exit:
+ *
+ * Write out the profile and close the perf files.
+ */
+void perf_exit(void);
+
+#endif /* EXEC_PERF_H */
@@ -35,6 +35,7 @@ struct TBContext {
 
     /* statistics */
     unsigned tb_flush_count;
+    unsigned tb_reclaim_count;
 };
 
 extern TBContext tb_ctx;
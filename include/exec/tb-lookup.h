@@ -16,36 +16,40 @@
 #include "exec/exec-all.h"
 #include "exec/tb-hash.h"
 
+static inline bool tb_jmp_cache_match(CPUState *cpu, TranslationBlock *tb,
+                                      target_ulong pc, target_ulong cs_base,
+                                      uint32_t flags, uint32_t cf_mask)
+{
+    return tb &&
+           tb->pc == pc &&
+           tb->cs_base == cs_base &&
+           tb->flags == flags &&
+           tb->trace_vcpu_dstate == *cpu->trace_dstate &&
+           (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask;
+}
+
 /* Might cause an exception, so have a longjmp destination ready */
 static inline TranslationBlock *
 tb_lookup__cpu_state(CPUState *cpu, target_ulong *pc, target_ulong *cs_base,
                      uint32_t *flags, uint32_t cf_mask)
 {
     CPUArchState *env = (CPUArchState *)cpu->env_ptr;
+    CPUJumpCache *jc = cpu->tb_jmp_cache;
     TranslationBlock *tb;
     uint32_t hash;
 
     cpu_get_tb_cpu_state(env, pc, cs_base, flags);
-    hash = tb_jmp_cache_hash_func(*pc);
-    tb = qatomic_rcu_read(&cpu->tb_jmp_cache[hash]);
+    hash = tb_jmp_cache_hash_func(*pc, jc->bits);
+    tb = qatomic_rcu_read(&jc->array[hash]);
 
     cf_mask &= ~CF_CLUSTER_MASK;
     cf_mask |= cpu->cluster_index << CF_CLUSTER_SHIFT;
 
-    if (likely(tb &&
-               tb->pc == *pc &&
-               tb->cs_base == *cs_base &&
-               tb->flags == *flags &&
-               tb->trace_vcpu_dstate == *cpu->trace_dstate &&
-               (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask)) {
+    if (likely(tb_jmp_cache_match(cpu, tb, *pc, *cs_base, *flags, cf_mask))) {
+        cpu->tb_jmp_stats.hits++;
         return tb;
     }
-    tb = tb_htable_lookup(cpu, *pc, *cs_base, *flags, cf_mask);
-    if (tb == NULL) {
-        return NULL;
-    }
-    qatomic_set(&cpu->tb_jmp_cache[hash], tb);
-    return tb;
+    return tb_jmp_cache_lookup_slow(cpu, *pc, *cs_base, *flags, cf_mask);
 }
 
 #endif /* EXEC_TB_LOOKUP_H */
@@ -145,6 +145,36 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
 
 void translator_loop_temp_check(DisasContextBase *db);
 
+/**
+ * translator_lookup_and_goto_ptr:
+ * @db: Disassembly context.
+ * @dest: Guest PC of the branch target, in the form used for tb->pc.
+ * @is_return: The branch returns from a call recorded with
+ *             translator_push_return().
+ *
+ * Like tcg_gen_lookup_and_goto_ptr(), but try first to find the target TB
+ * without leaving generated code: returns are predicted with a per-vCPU
+ * return address stack, other indirect branches with a small cache of the
+ * most recent targets of the TB.
+ *
+ * The cached TBs are only checked against @dest, so the caller must
+ * guarantee that the branch does not change the cs_base or flags returned
+ * by cpu_get_tb_cpu_state() relative to those of the current TB.
+ */
+void translator_lookup_and_goto_ptr(DisasContextBase *db, TCGv dest,
+                                    bool is_return);
+
+/**
+ * translator_push_return:
+ * @db: Disassembly context.
+ * @ret_pc: Guest PC of the return address, in the form used for tb->pc.
+ *
+ * Record that the TB ends with a call which will return to @ret_pc, for
+ * the benefit of a later translator_lookup_and_goto_ptr() with
+ * @is_return set.  At most one call may be recorded per TB.
+ */
+void translator_push_return(DisasContextBase *db, target_ulong ret_pc);
+
 /*
  * Translator Load Functions
  *
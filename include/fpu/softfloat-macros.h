@@ -407,12 +407,19 @@ static inline void
  add128(
      uint64_t a0, uint64_t a1, uint64_t b0, uint64_t b1, uint64_t *z0Ptr, uint64_t *z1Ptr )
 {
+#ifdef CONFIG_INT128
+    unsigned __int128 z = ((unsigned __int128)a0 << 64 | a1)
+                        + ((unsigned __int128)b0 << 64 | b1);
+
+    *z1Ptr = z;
+    *z0Ptr = z >> 64;
+#else
     uint64_t z1;
 
     z1 = a1 + b1;
     *z1Ptr = z1;
     *z0Ptr = a0 + b0 + ( z1 < a1 );
-
+#endif
 }
 
 /*----------------------------------------------------------------------------
@@ -465,10 +472,16 @@ static inline void
  sub128(
      uint64_t a0, uint64_t a1, uint64_t b0, uint64_t b1, uint64_t *z0Ptr, uint64_t *z1Ptr )
 {
+#ifdef CONFIG_INT128
+    unsigned __int128 z = ((unsigned __int128)a0 << 64 | a1)
+                        - ((unsigned __int128)b0 << 64 | b1);
 
+    *z1Ptr = z;
+    *z0Ptr = z >> 64;
+#else
     *z1Ptr = a1 - b1;
     *z0Ptr = a0 - b0 - ( a1 < b1 );
-
+#endif
 }
 
 /*----------------------------------------------------------------------------
@@ -517,6 +530,12 @@ static inline void
 
 static inline void mul64To128( uint64_t a, uint64_t b, uint64_t *z0Ptr, uint64_t *z1Ptr )
 {
+#ifdef CONFIG_INT128
+    unsigned __int128 z = (unsigned __int128)a * b;
+
+    *z1Ptr = z;
+    *z0Ptr = z >> 64;
+#else
     uint32_t aHigh, aLow, bHigh, bLow;
     uint64_t z0, zMiddleA, zMiddleB, z1;
 
@@ -535,7 +554,7 @@ static inline void mul64To128( uint64_t a, uint64_t b, uint64_t *z0Ptr, uint64_t
     z0 += ( z1 < zMiddleA );
     *z1Ptr = z1;
     *z0Ptr = z0;
-
+#endif
 }
 
 /*----------------------------------------------------------------------------
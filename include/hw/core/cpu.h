@@ -288,6 +288,55 @@ struct hax_vcpu_state;
 #define TB_JMP_CACHE_BITS 12
 #define TB_JMP_CACHE_SIZE (1 << TB_JMP_CACHE_BITS)
 
+/* The jump cache is resized within these bounds based on its miss rate */
+#define TB_JMP_CACHE_MIN_BITS TB_JMP_CACHE_BITS
+#define TB_JMP_CACHE_MAX_BITS 16
+
+/* Number of entries in the fully associative victim cache */
+#define TB_JMP_VICTIM_SIZE 8
+
+/* Depth of the return address stack, must be a power of 2 */
+#define TB_RAS_SIZE 16
+
+/**
+ * CPUJumpCache:
+ * @rcu: Used to free the table after it has been replaced by a resize.
+ * @bits: log2 of the number of entries in @array.
+ * @array: Translation blocks indexed by the hash of their virtual PC.
+ *
+ * Only the owning vCPU replaces its table, but other threads may clear
+ * entries of it at any time; they must hold the RCU read lock.
+ */
+typedef struct CPUJumpCache {
+    struct rcu_head rcu;
+    unsigned int bits;
+    struct TranslationBlock *array[];
+} CPUJumpCache;
+
+/**
+ * CPUJumpCacheStats:
+ * @hits: Lookups satisfied by the jump cache.
+ * @victim_hits: Lookups satisfied by the victim cache.
+ * @htable_hits: Lookups satisfied by the global TB hash table.
+ * @htable_misses: Lookups for code that has not been translated yet.
+ * @resizes: Number of times the jump cache has been resized.
+ * @window_lookups: Value of the lookup count when the current sampling
+ *                  window started.
+ * @window_misses: Value of the miss count when the current sampling
+ *                 window started.
+ *
+ * Only updated by the owning vCPU; readers get approximate values.
+ */
+typedef struct CPUJumpCacheStats {
+    uint64_t hits;
+    uint64_t victim_hits;
+    uint64_t htable_hits;
+    uint64_t htable_misses;
+    uint64_t resizes;
+    uint64_t window_lookups;
+    uint64_t window_misses;
+} CPUJumpCacheStats;
+
 /* work queue */
 
 /* The union type allows passing of 64 bit target pointers on 32 bit
@@ -345,6 +394,12 @@ struct qemu_work_item;
  *      only have a single AddressSpace
  * @env_ptr: Pointer to subclass-specific CPUArchState field.
  * @icount_decr_ptr: Pointer to IcountDecr field within subclass.
+ * @tb_jmp_cache: Virtual PC to TB lookup table.
+ * @tb_jmp_victim: Recently evicted @tb_jmp_cache entries.
+ * @tb_jmp_victim_next: Next @tb_jmp_victim slot to replace.
+ * @tb_jmp_stats: Jump cache statistics, also used for resizing it.
+ * @tb_ras: Return address stack of TBs ending in a call.
+ * @tb_ras_top: Index of the top of @tb_ras.
  * @gdb_regs: Additional GDB registers.
  * @gdb_num_regs: Number of total registers accessible to GDB.
  * @gdb_num_g_regs: Number of registers in GDB 'g' packets.
@@ -412,7 +467,14 @@ struct CPUState {
     IcountDecr *icount_decr_ptr;
 
     /* Accessed in parallel; all accesses must be atomic */
-    struct TranslationBlock *tb_jmp_cache[TB_JMP_CACHE_SIZE];
+    CPUJumpCache *tb_jmp_cache;
+    struct TranslationBlock *tb_jmp_victim[TB_JMP_VICTIM_SIZE];
+    unsigned int tb_jmp_victim_next;
+    CPUJumpCacheStats tb_jmp_stats;
+
+    /* Accessed by generated code of the owning vCPU */
+    struct TranslationBlock *tb_ras[TB_RAS_SIZE];
+    uint32_t tb_ras_top;
 
     struct GDBRegisterState *gdb_regs;
     int gdb_num_regs;
@@ -484,13 +546,39 @@ extern CPUTailQ cpus;
 
 extern __thread CPUState *current_cpu;
 
+static inline CPUJumpCache *cpu_tb_jmp_cache_new(unsigned int bits)
+{
+    CPUJumpCache *jc;
+
+    jc = g_malloc0(sizeof(*jc) + (sizeof(jc->array[0]) << bits));
+    jc->bits = bits;
+    return jc;
+}
+
+static inline void cpu_tb_ras_clear(CPUState *cpu)
+{
+    unsigned int i;
+
+    for (i = 0; i < TB_RAS_SIZE; i++) {
+        qatomic_set(&cpu->tb_ras[i], NULL);
+    }
+}
+
 static inline void cpu_tb_jmp_cache_clear(CPUState *cpu)
 {
+    CPUJumpCache *jc;
     unsigned int i;
 
-    for (i = 0; i < TB_JMP_CACHE_SIZE; i++) {
-        qatomic_set(&cpu->tb_jmp_cache[i], NULL);
+    RCU_READ_LOCK_GUARD();
+
+    jc = qatomic_rcu_read(&cpu->tb_jmp_cache);
+    for (i = 0; i < (1u << jc->bits); i++) {
+        qatomic_set(&jc->array[i], NULL);
+    }
+    for (i = 0; i < TB_JMP_VICTIM_SIZE; i++) {
+        qatomic_set(&cpu->tb_jmp_victim[i], NULL);
     }
+    cpu_tb_ras_clear(cpu);
 }
 
 /**
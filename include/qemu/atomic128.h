@@ -53,6 +53,23 @@ static inline Int128 atomic16_cmpxchg(Int128 *ptr, Int128 cmp, Int128 new)
     return __sync_val_compare_and_swap_16(ptr, cmp, new);
 }
 # define HAVE_CMPXCHG128 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_ATOMICS)
+/* With LSE, CASP does the whole job; it needs even/odd register pairs.  */
+static inline Int128 atomic16_cmpxchg(Int128 *ptr, Int128 cmp, Int128 new)
+{
+    register uint64_t oldl asm("x0") = int128_getlo(cmp);
+    register uint64_t oldh asm("x1") = int128_gethi(cmp);
+    register uint64_t newl asm("x2") = int128_getlo(new);
+    register uint64_t newh asm("x3") = int128_gethi(new);
+
+    asm("caspal %[oldl], %[oldh], %[newl], %[newh], %[mem]"
+        : [mem] "+Q"(*ptr), [oldl] "+r"(oldl), [oldh] "+r"(oldh)
+        : [newl] "r"(newl), [newh] "r"(newh)
+        : "memory");
+
+    return int128_make128(oldl, oldh);
+}
+# define HAVE_CMPXCHG128 1
 #elif defined(__aarch64__)
 /* Through gcc 8, aarch64 has no support for 128-bit at all.  */
 static inline Int128 atomic16_cmpxchg(Int128 *ptr, Int128 cmp, Int128 new)
@@ -78,6 +95,31 @@ static inline Int128 atomic16_cmpxchg(Int128 *ptr, Int128 cmp, Int128 new)
     return int128_make128(oldl, oldh);
 }
 # define HAVE_CMPXCHG128 1
+#elif defined(__x86_64__) && defined(CONFIG_CPUID_H)
+/*
+ * Without -mcx16 the compiler will not emit CMPXCHG16B, and the very
+ * first AMD64 parts do not implement it.  util/atomic128.c checks CPUID
+ * at startup; without the instruction, HAVE_CMPXCHG128 is false and the
+ * front ends take the exclusive path, as on hosts with no 128-bit
+ * compare-and-swap at all.
+ */
+# define ATOMIC128_CPUID_CX16 1
+extern bool atomic128_have_cx16;
+
+static inline Int128 atomic16_cmpxchg(Int128 *ptr, Int128 cmp, Int128 new)
+{
+    uint64_t oldl = int128_getlo(cmp), oldh = int128_gethi(cmp);
+    uint64_t newl = int128_getlo(new), newh = int128_gethi(new);
+
+    asm("lock cmpxchg16b %[mem]"
+        : [mem] "+m"(*ptr), "+a"(oldl), "+d"(oldh)
+        : "b"(newl), "c"(newh)
+        : "memory", "cc");
+
+    return int128_make128(oldl, oldh);
+}
+# define HAVE_CMPXCHG128 likely(atomic128_have_cx16)
+# define MAYBE_CMPXCHG128 1
 #else
 /* Fallback definition that must be optimized away, or error.  */
 Int128 QEMU_ERROR("unsupported atomic")
@@ -85,6 +127,15 @@ Int128 QEMU_ERROR("unsupported atomic")
 # define HAVE_CMPXCHG128 0
 #endif /* Some definition for HAVE_CMPXCHG128 */
 
+/*
+ * HAVE_CMPXCHG128 may be a run-time test.  MAYBE_CMPXCHG128 is its
+ * compile-time counterpart for #if: it is true whenever atomic16_cmpxchg
+ * may be used, i.e. whenever code calling it has to be built.
+ */
+#ifndef MAYBE_CMPXCHG128
+# define MAYBE_CMPXCHG128 HAVE_CMPXCHG128
+#endif
+
 
 #if defined(CONFIG_ATOMIC128)
 static inline Int128 atomic16_read(Int128 *ptr)
@@ -128,7 +179,7 @@ static inline void atomic16_set(Int128 *ptr, Int128 val)
 }
 
 # define HAVE_ATOMIC128 1
-#elif !defined(CONFIG_USER_ONLY) && HAVE_CMPXCHG128
+#elif !defined(CONFIG_USER_ONLY) && MAYBE_CMPXCHG128
 static inline Int128 atomic16_read(Int128 *ptr)
 {
     /* Maybe replace 0 with 0, returning the old value.  */
@@ -144,7 +195,8 @@ static inline void atomic16_set(Int128 *ptr, Int128 val)
     } while (old != cmp);
 }
 
-# define HAVE_ATOMIC128 1
+# define HAVE_ATOMIC128 HAVE_CMPXCHG128
+# define MAYBE_ATOMIC128 1
 #else
 /* Fallback definitions that must be optimized away, or error.  */
 Int128 QEMU_ERROR("unsupported atomic") atomic16_read(Int128 *ptr);
@@ -152,4 +204,9 @@ void QEMU_ERROR("unsupported atomic") atomic16_set(Int128 *ptr, Int128 val);
 # define HAVE_ATOMIC128 0
 #endif /* Some definition for HAVE_ATOMIC128 */
 
+/* As for MAYBE_CMPXCHG128, a compile-time counterpart for #if.  */
+#ifndef MAYBE_ATOMIC128
+# define MAYBE_ATOMIC128 HAVE_ATOMIC128
+#endif
+
 #endif /* QEMU_ATOMIC128_H */
@@ -68,6 +68,8 @@ enum plugin_dyn_cb_type {
 enum plugin_dyn_cb_subtype {
     PLUGIN_CB_REGULAR,
     PLUGIN_CB_INLINE,
+    PLUGIN_CB_COND,
+    PLUGIN_CB_BUFFERED,
     PLUGIN_N_CB_SUBTYPES,
 };
 
@@ -85,13 +87,57 @@ struct qemu_plugin_dyn_cb {
     enum qemu_plugin_mem_rw rw;
     /* fields specific to each dyn_cb type go here */
     union {
+        /*
+         * Inline ops apply to userp + vcpu_index * stride; @stride is 0
+         * for ops on a single location shared by all vCPUs.
+         */
         struct {
             enum qemu_plugin_op op;
             uint64_t imm;
+            size_t stride;
         } inline_insn;
+        /* @f.vcpu_udata is called with @userp when @entry @cond @imm */
+        struct {
+            enum qemu_plugin_cond cond;
+            void *entry;
+            size_t stride;
+            uint64_t imm;
+        } cond;
+        /*
+         * Records for @pc go to @trace's buffer at userp + vcpu * stride;
+         * @data is the vaddr of instruction records.
+         */
+        struct {
+            struct qemu_plugin_trace *trace;
+            size_t stride;
+            uint64_t pc;
+            uint64_t data;
+        } buffered;
     };
 };
 
+/*
+ * A vCPU's trace buffer. Translated code only checks whether the buffer
+ * needs flushing at instruction boundaries, so the slots past
+ * PLUGIN_TRACE_BUF_FLUSH are slack for the records of one instruction.
+ * The slot index is masked nevertheless, so that an instruction with
+ * even more memory accesses overwrites records rather than memory.
+ */
+#define PLUGIN_TRACE_BUF_SLOTS 1024
+#define PLUGIN_TRACE_BUF_FLUSH (PLUGIN_TRACE_BUF_SLOTS - 128)
+
+struct plugin_trace_buf {
+    uint64_t n;
+    qemu_plugin_trace_record recs[PLUGIN_TRACE_BUF_SLOTS];
+};
+
+/* translated code only updates the low 32 bits of @n */
+#ifdef HOST_WORDS_BIGENDIAN
+#define PLUGIN_TRACE_BUF_N_OFFSET (offsetof(struct plugin_trace_buf, n) + 4)
+#else
+#define PLUGIN_TRACE_BUF_N_OFFSET offsetof(struct plugin_trace_buf, n)
+#endif
+
 struct qemu_plugin_insn {
     GByteArray *data;
     uint64_t vaddr;
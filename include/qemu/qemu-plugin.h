@@ -10,6 +10,7 @@
 #ifndef QEMU_PLUGIN_API_H
 #define QEMU_PLUGIN_API_H
 
+#include <glib.h>
 #include <inttypes.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -52,7 +53,7 @@ typedef uint64_t qemu_plugin_id_t;
 
 extern QEMU_PLUGIN_EXPORT int qemu_plugin_version;
 
-#define QEMU_PLUGIN_VERSION 0
+#define QEMU_PLUGIN_VERSION 1
 
 typedef struct {
     /* string describing architecture */
@@ -233,6 +234,87 @@ void qemu_plugin_register_vcpu_tb_exec_cb(struct qemu_plugin_tb *tb,
 
 enum qemu_plugin_op {
     QEMU_PLUGIN_INLINE_ADD_U64,
+    QEMU_PLUGIN_INLINE_STORE_U64,
+};
+
+/*
+ * Scoreboards
+ *
+ * A scoreboard is an array of plugin-defined elements with one element
+ * per vCPU. It grows automatically as vCPUs are created, so that inline
+ * ops and callbacks can update the running vCPU's element without any
+ * locking and without racing with other vCPUs.
+ */
+struct qemu_plugin_scoreboard;
+
+/**
+ * typedef qemu_plugin_u64 - uint64_t member of a scoreboard element
+ * @score: the scoreboard
+ * @offset: offset of the uint64_t within each element
+ */
+typedef struct {
+    struct qemu_plugin_scoreboard *score;
+    size_t offset;
+} qemu_plugin_u64;
+
+/* entry for a scoreboard whose elements are a single uint64_t */
+#define qemu_plugin_scoreboard_u64(score) \
+    ((qemu_plugin_u64) { (score), 0 })
+
+/* entry for the uint64_t @member of a scoreboard whose elements are @type */
+#define qemu_plugin_scoreboard_u64_in_struct(score, type, member) \
+    ((qemu_plugin_u64) { (score), offsetof(type, member) })
+
+/**
+ * qemu_plugin_scoreboard_new() - allocate a new scoreboard
+ * @element_size: size in bytes of each vCPU's element
+ *
+ * Returns a scoreboard whose elements are zero-initialised.
+ */
+struct qemu_plugin_scoreboard *qemu_plugin_scoreboard_new(size_t element_size);
+
+/**
+ * qemu_plugin_scoreboard_free() - free a scoreboard
+ * @score: scoreboard to free
+ *
+ * The caller must ensure no inline op or callback registered against
+ * @score can execute any longer, e.g. by only freeing it at exit.
+ */
+void qemu_plugin_scoreboard_free(struct qemu_plugin_scoreboard *score);
+
+/**
+ * qemu_plugin_scoreboard_find() - get a vCPU's element
+ * @score: scoreboard to query
+ * @vcpu_index: index of the vCPU
+ *
+ * The returned pointer is only valid until the next vCPU is created,
+ * since that may reallocate the scoreboard.
+ */
+void *qemu_plugin_scoreboard_find(struct qemu_plugin_scoreboard *score,
+                                  unsigned int vcpu_index);
+
+/* Helpers to access a qemu_plugin_u64 of a given vCPU, or of all of them */
+void qemu_plugin_u64_add(qemu_plugin_u64 entry, unsigned int vcpu_index,
+                         uint64_t added);
+uint64_t qemu_plugin_u64_get(qemu_plugin_u64 entry, unsigned int vcpu_index);
+void qemu_plugin_u64_set(qemu_plugin_u64 entry, unsigned int vcpu_index,
+                         uint64_t val);
+uint64_t qemu_plugin_u64_sum(qemu_plugin_u64 entry);
+
+/*
+ * Conditions for conditional callbacks. Operands are compared as
+ * unsigned 64-bit values: the scoreboard entry on the left-hand side,
+ * the immediate on the right-hand side.
+ */
+enum qemu_plugin_cond {
+    QEMU_PLUGIN_COND_NEVER,
+    QEMU_PLUGIN_COND_ALWAYS,
+    QEMU_PLUGIN_COND_EQ,
+    QEMU_PLUGIN_COND_NE,
+    QEMU_PLUGIN_COND_LT,
+    QEMU_PLUGIN_COND_LE,
+    QEMU_PLUGIN_COND_GT,
+    QEMU_PLUGIN_COND_GE,
 };
 
 /**
@@ -250,6 +332,46 @@ void qemu_plugin_register_vcpu_tb_exec_inline(struct qemu_plugin_tb *tb,
                                               enum qemu_plugin_op op,
                                               void *ptr, uint64_t imm);
 
+/**
+ * qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu() - per-vCPU inline op
+ * @tb: the opaque qemu_plugin_tb handle for the translation
+ * @op: the type of qemu_plugin_op (e.g. ADD_U64)
+ * @entry: the scoreboard entry to operate on
+ * @imm: the op data (e.g. 1)
+ *
+ * As qemu_plugin_register_vcpu_tb_exec_inline(), but the op is applied
+ * to the executing vCPU's element of @entry's scoreboard, so that
+ * concurrent vCPUs do not race with each other.
+ */
+void qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
+    struct qemu_plugin_tb *tb,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    uint64_t imm);
+
+/**
+ * qemu_plugin_register_vcpu_tb_exec_cond_cb() - conditional execution cb
+ * @tb: the opaque qemu_plugin_tb handle for the translation
+ * @cb: callback function
+ * @flags: does the plugin read or write the CPU's registers?
+ * @cond: condition to check
+ * @entry: the scoreboard entry compared against @imm
+ * @imm: the immediate compared against @entry
+ * @userdata: any plugin data to pass to the @cb?
+ *
+ * The @cb function is called every time a translated unit executes and
+ * @cond holds for the executing vCPU's @entry and @imm, e.g. when a
+ * counter updated by an inline op reaches a threshold. The check is
+ * done inline, so the cost of a call is only paid when it is taken.
+ */
+void qemu_plugin_register_vcpu_tb_exec_cond_cb(struct qemu_plugin_tb *tb,
+                                               qemu_plugin_vcpu_udata_cb_t cb,
+                                               enum qemu_plugin_cb_flags flags,
+                                               enum qemu_plugin_cond cond,
+                                               qemu_plugin_u64 entry,
+                                               uint64_t imm,
+                                               void *userdata);
+
 /**
  * qemu_plugin_register_vcpu_insn_exec_cb() - register insn execution cb
  * @insn: the opaque qemu_plugin_insn handle for an instruction
@@ -279,6 +401,44 @@ void qemu_plugin_register_vcpu_insn_exec_inline(struct qemu_plugin_insn *insn,
                                                 enum qemu_plugin_op op,
                                                 void *ptr, uint64_t imm);
 
+/**
+ * qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu() - per-vCPU inline op
+ * @insn: the opaque qemu_plugin_insn handle for an instruction
+ * @op: the type of qemu_plugin_op (e.g. ADD_U64)
+ * @entry: the scoreboard entry to operate on
+ * @imm: the op data (e.g. 1)
+ *
+ * As qemu_plugin_register_vcpu_insn_exec_inline(), but the op is
+ * applied to the executing vCPU's element of @entry's scoreboard.
+ */
+void qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu(
+    struct qemu_plugin_insn *insn,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    uint64_t imm);
+
+/**
+ * qemu_plugin_register_vcpu_insn_exec_cond_cb() - conditional insn cb
+ * @insn: the opaque qemu_plugin_insn handle for an instruction
+ * @cb: callback function
+ * @flags: does the plugin read or write the CPU's registers?
+ * @cond: condition to check
+ * @entry: the scoreboard entry compared against @imm
+ * @imm: the immediate compared against @entry
+ * @userdata: any plugin data to pass to the @cb?
+ *
+ * The @cb function is called every time an instruction is executed and
+ * @cond holds for the executing vCPU's @entry and @imm.
+ */
+void qemu_plugin_register_vcpu_insn_exec_cond_cb(
+    struct qemu_plugin_insn *insn,
+    qemu_plugin_vcpu_udata_cb_t cb,
+    enum qemu_plugin_cb_flags flags,
+    enum qemu_plugin_cond cond,
+    qemu_plugin_u64 entry,
+    uint64_t imm,
+    void *userdata);
+
 /*
  * Helpers to query information about the instructions in a block
  */
@@ -351,6 +511,84 @@ void qemu_plugin_register_vcpu_mem_inline(struct qemu_plugin_insn *insn,
                                           enum qemu_plugin_op op, void *ptr,
                                           uint64_t imm);
 
+void qemu_plugin_register_vcpu_mem_inline_per_vcpu(
+    struct qemu_plugin_insn *insn,
+    enum qemu_plugin_mem_rw rw,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    uint64_t imm);
+
+/*
+ * Buffered events
+ *
+ * Instead of calling into the plugin for every instruction or memory
+ * access, translated code can append a compact record of the event to
+ * a per-vCPU buffer using a handful of inline stores. The plugin is then
+ * handed the records in batches: whenever a vCPU's buffer fills up, when
+ * the vCPU exits, and right before the atexit callbacks are called.
+ */
+enum qemu_plugin_trace_type {
+    QEMU_PLUGIN_TRACE_INSN,
+    QEMU_PLUGIN_TRACE_MEM,
+};
+
+/**
+ * typedef qemu_plugin_trace_record - a buffered event
+ * @pc: address of the instruction
+ * @vaddr: virtual address of the access, or for instruction records the
+ *         data passed at registration
+ * @info: the access' meminfo; 0 for instruction records
+ * @type: an enum qemu_plugin_trace_type
+ *
+ * An instruction's record precedes the records of its memory accesses.
+ */
+typedef struct {
+    uint64_t pc;
+    uint64_t vaddr;
+    qemu_plugin_meminfo_t info;
+    uint32_t type;
+} qemu_plugin_trace_record;
+
+struct qemu_plugin_trace;
+
+typedef void
+(*qemu_plugin_vcpu_trace_flush_cb_t)(unsigned int vcpu_index,
+                                     const qemu_plugin_trace_record *records,
+                                     size_t n, void *userdata);
+
+/**
+ * qemu_plugin_trace_new() - allocate a set of per-vCPU trace buffers
+ * @cb: called with each vCPU's records, in execution order
+ * @userdata: any plugin data to pass to the @cb?
+ *
+ * @cb is called from the vCPU whose buffer is flushed, except at exit.
+ * The records are only valid for the duration of the callback. A trace
+ * cannot be freed; it lives until QEMU exits.
+ */
+struct qemu_plugin_trace *
+qemu_plugin_trace_new(qemu_plugin_vcpu_trace_flush_cb_t cb, void *userdata);
+
+/**
+ * qemu_plugin_register_vcpu_insn_exec_buffered() - buffer insn execution
+ * @insn: the opaque qemu_plugin_insn handle for an instruction
+ * @trace: the trace to append a QEMU_PLUGIN_TRACE_INSN record to
+ * @data: stored in the record's @vaddr, e.g. to identify the block
+ */
+void qemu_plugin_register_vcpu_insn_exec_buffered(
+    struct qemu_plugin_insn *insn,
+    struct qemu_plugin_trace *trace,
+    uint64_t data);
+
+/**
+ * qemu_plugin_register_vcpu_mem_buffered() - buffer memory accesses
+ * @insn: the opaque qemu_plugin_insn handle for an instruction
+ * @rw: monitor reads, writes or both
+ * @trace: the trace to append QEMU_PLUGIN_TRACE_MEM records to
+ */
+void qemu_plugin_register_vcpu_mem_buffered(struct qemu_plugin_insn *insn,
+                                            enum qemu_plugin_mem_rw rw,
+                                            struct qemu_plugin_trace *trace);
+
 
 
 typedef void
@@ -380,6 +618,62 @@ qemu_plugin_register_vcpu_syscall_ret_cb(qemu_plugin_id_t id,
 
 char *qemu_plugin_insn_disas(const struct qemu_plugin_insn *insn);
 
+/*
+ * Register and memory access
+ *
+ * The following may only be called from a vCPU's translation or
+ * execution callbacks, and act on that vCPU. Callbacks that read
+ * registers must be registered with QEMU_PLUGIN_CB_R_REGS or
+ * QEMU_PLUGIN_CB_RW_REGS, otherwise values may be stale. Note that the
+ * PC is only guaranteed to be up to date at the start of a block.
+ */
+struct qemu_plugin_register;
+
+/**
+ * typedef qemu_plugin_reg_descriptor - register descriptions
+ * @handle: opaque handle for qemu_plugin_read_register()
+ * @name: register name, as in gdb's target description
+ * @feature: name of the gdb feature the register belongs to, or NULL
+ */
+typedef struct {
+    struct qemu_plugin_register *handle;
+    const char *name;
+    const char *feature;
+} qemu_plugin_reg_descriptor;
+
+/**
+ * qemu_plugin_get_registers() - describe the registers of the vCPU
+ *
+ * Returns a GArray of qemu_plugin_reg_descriptor, to be freed with
+ * g_array_free() by the caller. The strings it points to remain valid
+ * for the lifetime of QEMU. Plugins typically look up the handles they
+ * need once, e.g. when translating the first block.
+ */
+GArray *qemu_plugin_get_registers(void);
+
+/**
+ * qemu_plugin_read_register() - read a register of the vCPU
+ * @handle: a handle from qemu_plugin_get_registers()
+ * @buf: array the value is appended to, in target byte order
+ *
+ * Returns the size of the value read in bytes, or 0 on error.
+ */
+int qemu_plugin_read_register(struct qemu_plugin_register *handle,
+                              GByteArray *buf);
+
+/**
+ * qemu_plugin_read_memory_vaddr() - read guest virtual memory
+ * @addr: virtual address of the first byte
+ * @data: array resized to @len and filled with the bytes read
+ * @len: number of bytes to read
+ *
+ * The access goes through the vCPU's current page tables but does not
+ * fault, and is not itself reported to memory callbacks. Returns false
+ * if any part of the range is not mapped.
+ */
+bool qemu_plugin_read_memory_vaddr(uint64_t addr, GByteArray *data,
+                                   size_t len);
+
 /**
  * qemu_plugin_vcpu_for_each() - iterate over the existing vCPU
  * @id: plugin ID
@@ -175,7 +175,8 @@ typedef uint64_t TCGRegSet;
 
 #if !defined(TCG_TARGET_HAS_v64) \
     && !defined(TCG_TARGET_HAS_v128) \
-    && !defined(TCG_TARGET_HAS_v256)
+    && !defined(TCG_TARGET_HAS_v256) \
+    && !defined(TCG_TARGET_HAS_v512)
 #define TCG_TARGET_MAYBE_vec            0
 #define TCG_TARGET_HAS_abs_vec          0
 #define TCG_TARGET_HAS_neg_vec          0
@@ -205,6 +206,9 @@ typedef uint64_t TCGRegSet;
 #ifndef TCG_TARGET_HAS_v256
 #define TCG_TARGET_HAS_v256             0
 #endif
+#ifndef TCG_TARGET_HAS_v512
+#define TCG_TARGET_HAS_v512             0
+#endif
 
 #ifndef TARGET_INSN_START_EXTRA_WORDS
 # define TARGET_INSN_START_WORDS 1
@@ -289,6 +293,7 @@ typedef enum TCGType {
     TCG_TYPE_V64,
     TCG_TYPE_V128,
     TCG_TYPE_V256,
+    TCG_TYPE_V512,
 
     TCG_TYPE_COUNT, /* number of different types */
 
@@ -836,6 +841,9 @@ TranslationBlock *tcg_tb_alloc(TCGContext *s);
 void tcg_region_init(void);
 void tb_destroy(TranslationBlock *tb);
 void tcg_region_reset_all(void);
+void tcg_region_touch(const void *tc_ptr);
+int tcg_region_reclaim(GTraverseFunc evict, GTraverseFunc purge);
+bool tcg_tc_reclaimed(const void *p);
 
 size_t tcg_code_size(void);
 size_t tcg_code_capacity(void);
@@ -1403,9 +1411,9 @@ GEN_ATOMIC_HELPER_ALL(xchg)
  * These aren't really a "proper" helpers because TCG cannot manage Int128.
  * However, use the same format as the others, for use by the backends.
  *
- * The cmpxchg functions are only defined if HAVE_CMPXCHG128;
- * the ld/st functions are only defined if HAVE_ATOMIC128,
- * as defined by <qemu/atomic128.h>.
+ * The cmpxchg functions are only defined if MAYBE_CMPXCHG128, and may
+ * only be called if HAVE_CMPXCHG128; the ld/st functions likewise with
+ * MAYBE_ATOMIC128 and HAVE_ATOMIC128, as defined by <qemu/atomic128.h>.
  */
 Int128 helper_atomic_cmpxchgo_le_mmu(CPUArchState *env, target_ulong addr,
                                      Int128 cmpv, Int128 newv,
@@ -200,6 +200,53 @@ static void elf_core_copy_regs(target_elf_gregset_t *regs, const CPUX86State *en
     (*regs)[26] = env->segs[R_GS].selector & 0xffff;
 }
 
+#ifdef TARGET_VSYSCALL_PAGE
+/*
+ * The vDSO entry points are tiny "mov $nr, %eax; syscall; ret" stubs
+ * preceded by a nop, whose address the translator recognizes so that
+ * helper_vdso can answer without a round trip through the syscall path.
+ */
+#define HAVE_ELF_VDSO
+#define VDSO_TEXT        X86_VDSO_TEXT
+#define VDSO_ENTRY_SIZE  X86_VDSO_ENTRY_SIZE
+#define VDSO_NB_ENTRIES  X86_VDSO_NB_ENTRIES
+
+static const char * const vdso_symbols[VDSO_NB_ENTRIES] = {
+    [X86_VDSO_CLOCK_GETTIME] = "__vdso_clock_gettime",
+    [X86_VDSO_GETTIMEOFDAY] = "__vdso_gettimeofday",
+    [X86_VDSO_TIME] = "__vdso_time",
+    [X86_VDSO_GETCPU] = "__vdso_getcpu",
+    [X86_VDSO_CLOCK_GETRES] = "__vdso_clock_getres",
+};
+
+static void vdso_init_entry(uint8_t *code, int entry)
+{
+    static const uint32_t nr[VDSO_NB_ENTRIES] = {
+        [X86_VDSO_CLOCK_GETTIME] = TARGET_NR_clock_gettime,
+        [X86_VDSO_GETTIMEOFDAY] = TARGET_NR_gettimeofday,
+        [X86_VDSO_TIME] = TARGET_NR_time,
+        [X86_VDSO_GETCPU] = TARGET_NR_getcpu,
+        [X86_VDSO_CLOCK_GETRES] = TARGET_NR_clock_getres,
+    };
+
+    memset(code, 0xcc, VDSO_ENTRY_SIZE);   /* int3 */
+    code[0] = 0x90;                         /* nop */
+    code[1] = 0xb8;                         /* mov $nr, %eax */
+    stl_le_p(code + 2, nr[entry]);
+    code[6] = 0x0f;                         /* syscall */
+    code[7] = 0x05;
+    code[8] = 0xc3;                         /* ret */
+}
+
+static void vdso_loaded(abi_ulong addr)
+{
+    x86_vdso_page = addr;
+}
+
+#define DLINFO_ARCH_ITEMS 1
+#define ARCH_DLINFO NEW_AUX_ENT(AT_SYSINFO_EHDR, info->vdso)
+#endif
+
 #else
 
 #define ELF_START_MMAP 0x80000000
@@ -1683,6 +1730,156 @@ static inline void bswap_mips_abiflags(Mips_elf_abiflags_v0 *abiflags) { }
 #endif
 #endif
 
+#ifdef HAVE_ELF_VDSO
+/*
+ * A one page ET_DYN image for the vDSO: the headers, a sysv hash table,
+ * the dynamic symbols and their strings, all below VDSO_TEXT, followed
+ * by VDSO_NB_ENTRIES entry points of VDSO_ENTRY_SIZE bytes each.
+ */
+struct vdso_image {
+    struct elfhdr ehdr;
+    struct elf_phdr phdr[2];
+    struct elf_shdr shdr[7];
+    elf_dyn dyn[7];
+    struct elf_sym sym[VDSO_NB_ENTRIES + 1];
+    uint32_t hash[3 + VDSO_NB_ENTRIES + 1];
+    char str[256];
+    char shstr[48];
+};
+
+static void vdso_shdr(struct elf_shdr *shdr, uint32_t name, uint32_t type,
+                      abi_ulong flags, abi_ulong offset, abi_ulong size,
+                      uint32_t link, abi_ulong entsize)
+{
+    shdr->sh_name = name;
+    shdr->sh_type = type;
+    shdr->sh_flags = flags;
+    shdr->sh_addr = flags & SHF_ALLOC ? offset : 0;
+    shdr->sh_offset = offset;
+    shdr->sh_size = size;
+    shdr->sh_link = link;
+    shdr->sh_info = type == SHT_DYNSYM;
+    shdr->sh_addralign = entsize ? entsize : 1;
+    shdr->sh_entsize = entsize;
+}
+
+static void load_elf_vdso(struct image_info *info)
+{
+    static const char soname[] = "linux-vdso.so.1";
+    struct vdso_image *img;
+    abi_ulong text_end = VDSO_TEXT + VDSO_NB_ENTRIES * VDSO_ENTRY_SIZE;
+    abi_ulong addr;
+    size_t strsz;
+    uint8_t *page;
+    int i;
+
+    QEMU_BUILD_BUG_ON(sizeof(struct vdso_image) > VDSO_TEXT);
+    QEMU_BUILD_BUG_ON(VDSO_TEXT + VDSO_NB_ENTRIES * VDSO_ENTRY_SIZE
+                      > TARGET_PAGE_SIZE);
+
+    page = g_malloc0(TARGET_PAGE_SIZE);
+    img = (struct vdso_image *)page;
+
+    memcpy(img->ehdr.e_ident, ELFMAG, SELFMAG);
+    img->ehdr.e_ident[EI_CLASS] = ELF_CLASS;
+    img->ehdr.e_ident[EI_DATA] = ELF_DATA;
+    img->ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+    img->ehdr.e_type = ET_DYN;
+    img->ehdr.e_machine = ELF_MACHINE;
+    img->ehdr.e_version = EV_CURRENT;
+    img->ehdr.e_phoff = offsetof(struct vdso_image, phdr);
+    img->ehdr.e_shoff = offsetof(struct vdso_image, shdr);
+    img->ehdr.e_ehsize = sizeof(struct elfhdr);
+    img->ehdr.e_phentsize = sizeof(struct elf_phdr);
+    img->ehdr.e_phnum = ARRAY_SIZE(img->phdr);
+    img->ehdr.e_shentsize = sizeof(struct elf_shdr);
+    img->ehdr.e_shnum = ARRAY_SIZE(img->shdr);
+    img->ehdr.e_shstrndx = 6;
+
+    img->phdr[0].p_type = PT_LOAD;
+    img->phdr[0].p_flags = PF_R | PF_X;
+    img->phdr[0].p_filesz = text_end;
+    img->phdr[0].p_memsz = text_end;
+    img->phdr[0].p_align = TARGET_PAGE_SIZE;
+    img->phdr[1].p_type = PT_DYNAMIC;
+    img->phdr[1].p_flags = PF_R;
+    img->phdr[1].p_offset = offsetof(struct vdso_image, dyn);
+    img->phdr[1].p_vaddr = img->phdr[1].p_offset;
+    img->phdr[1].p_paddr = img->phdr[1].p_offset;
+    img->phdr[1].p_filesz = sizeof(img->dyn);
+    img->phdr[1].p_memsz = sizeof(img->dyn);
+    img->phdr[1].p_align = sizeof(abi_ulong);
+
+    /* One bucket, chaining all symbols; string 0 is the empty name.  */
+    strsz = 1;
+    img->hash[0] = tswap32(1);
+    img->hash[1] = tswap32(VDSO_NB_ENTRIES + 1);
+    img->hash[2] = tswap32(VDSO_NB_ENTRIES);
+    for (i = 0; i < VDSO_NB_ENTRIES; i++) {
+        size_t len = strlen(vdso_symbols[i]) + 1;
+
+        img->hash[3 + i + 1] = tswap32(i);
+        img->sym[i + 1].st_name = strsz;
+        img->sym[i + 1].st_info = ELF_ST_INFO(STB_GLOBAL, STT_FUNC);
+        img->sym[i + 1].st_shndx = 1;
+        img->sym[i + 1].st_value = VDSO_TEXT + i * VDSO_ENTRY_SIZE;
+        img->sym[i + 1].st_size = VDSO_ENTRY_SIZE;
+        bswap_sym(&img->sym[i + 1]);
+        memcpy(img->str + strsz, vdso_symbols[i], len);
+        strsz += len;
+        vdso_init_entry(page + VDSO_TEXT + i * VDSO_ENTRY_SIZE, i);
+    }
+    assert(strsz + sizeof(soname) <= sizeof(img->str));
+    memcpy(img->str + strsz, soname, sizeof(soname));
+
+#define VDSO_DYN(n, tag, val) do {             \
+        img->dyn[n].d_tag = tswapal(tag);      \
+        img->dyn[n].d_un.d_val = tswapal(val); \
+    } while (0)
+
+    VDSO_DYN(0, DT_HASH, offsetof(struct vdso_image, hash));
+    VDSO_DYN(1, DT_STRTAB, offsetof(struct vdso_image, str));
+    VDSO_DYN(2, DT_SYMTAB, offsetof(struct vdso_image, sym));
+    VDSO_DYN(3, DT_STRSZ, strsz + sizeof(soname));
+    VDSO_DYN(4, DT_SYMENT, sizeof(struct elf_sym));
+    VDSO_DYN(5, DT_SONAME, strsz);
+    VDSO_DYN(6, DT_NULL, 0);
+#undef VDSO_DYN
+
+    /* Only for the benefit of debuggers; the loader uses DT_* alone.  */
+    memcpy(img->shstr, "\0.text\0.hash\0.dynsym\0.dynstr\0.dynamic"
+           "\0.shstrtab", 48);
+    vdso_shdr(&img->shdr[1], 1, SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR,
+              VDSO_TEXT, text_end - VDSO_TEXT, 0, 0);
+    vdso_shdr(&img->shdr[2], 7, SHT_HASH, SHF_ALLOC,
+              offsetof(struct vdso_image, hash), sizeof(img->hash), 3, 4);
+    vdso_shdr(&img->shdr[3], 13, SHT_DYNSYM, SHF_ALLOC,
+              offsetof(struct vdso_image, sym), sizeof(img->sym), 4,
+              sizeof(struct elf_sym));
+    vdso_shdr(&img->shdr[4], 21, SHT_STRTAB, SHF_ALLOC,
+              offsetof(struct vdso_image, str), strsz + sizeof(soname), 0, 0);
+    vdso_shdr(&img->shdr[5], 29, SHT_DYNAMIC, SHF_ALLOC,
+              offsetof(struct vdso_image, dyn), sizeof(img->dyn), 4,
+              sizeof(elf_dyn));
+    vdso_shdr(&img->shdr[6], 38, SHT_STRTAB, 0,
+              offsetof(struct vdso_image, shstr), sizeof(img->shstr), 0, 0);
+
+    bswap_ehdr(&img->ehdr);
+    bswap_phdr(img->phdr, ARRAY_SIZE(img->phdr));
+    bswap_shdr(img->shdr, ARRAY_SIZE(img->shdr));
+
+    addr = target_mmap(0, TARGET_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr != -1) {
+        memcpy_to_target(addr, page, TARGET_PAGE_SIZE);
+        target_mprotect(addr, TARGET_PAGE_SIZE, PROT_READ | PROT_EXEC);
+        info->vdso = addr;
+        vdso_loaded(addr);
+    }
+    g_free(page);
+}
+#endif
+
 #ifdef USE_ELF_CORE_DUMP
 static int elf_core_dump(int, const CPUArchState *);
 #endif /* USE_ELF_CORE_DUMP */
@@ -2957,54 +3154,73 @@ static int symcmp(const void *s0, const void *s1)
         : ((sym0->st_value > sym1->st_value) ? 1 : 0);
 }
 
-/* Best attempt to load symbols from this ELF object. */
-static void load_symbols(struct elfhdr *hdr, int fd, abi_ulong load_bias)
+/* Find the section headers of the symbol table and its string table. */
+static bool find_symtab(struct elfhdr *hdr, int fd, struct elf_shdr *symtab,
+                        struct elf_shdr *strtab)
 {
-    int i, shnum, nsyms, sym_idx = 0, str_idx = 0;
-    uint64_t segsz;
+    int i, shnum;
     struct elf_shdr *shdr;
-    char *strings = NULL;
-    struct syminfo *s = NULL;
-    struct elf_sym *new_syms, *syms = NULL;
 
     shnum = hdr->e_shnum;
     i = shnum * sizeof(struct elf_shdr);
     shdr = (struct elf_shdr *)alloca(i);
     if (pread(fd, shdr, i, hdr->e_shoff) != i) {
-        return;
+        return false;
     }
 
     bswap_shdr(shdr, shnum);
     for (i = 0; i < shnum; ++i) {
-        if (shdr[i].sh_type == SHT_SYMTAB) {
-            sym_idx = i;
-            str_idx = shdr[i].sh_link;
-            goto found;
+        if (shdr[i].sh_type == SHT_SYMTAB && shdr[i].sh_link < shnum) {
+            *symtab = shdr[i];
+            *strtab = shdr[shdr[i].sh_link];
+            return true;
         }
     }
 
     /* There will be no symbol table if the file was stripped.  */
-    return;
+    return false;
+}
 
- found:
-    /* Now know where the strtab and symtab are.  Snarf them.  */
-    s = g_try_new(struct syminfo, 1);
-    if (!s) {
-        goto give_up;
-    }
+/* Read the symbol table and its string table from the image.  */
+static bool read_symtab(struct elf_shdr *symtab, struct elf_shdr *strtab,
+                        int fd, char **strings, struct elf_sym **syms)
+{
+    uint64_t segsz;
 
-    segsz = shdr[str_idx].sh_size;
-    s->disas_strtab = strings = g_try_malloc(segsz);
-    if (!strings ||
-        pread(fd, strings, segsz, shdr[str_idx].sh_offset) != segsz) {
+    *syms = NULL;
+    segsz = strtab->sh_size;
+    *strings = g_try_malloc(segsz);
+    if (!*strings || pread(fd, *strings, segsz, strtab->sh_offset) != segsz) {
         goto give_up;
     }
 
-    segsz = shdr[sym_idx].sh_size;
-    syms = g_try_malloc(segsz);
-    if (!syms || pread(fd, syms, segsz, shdr[sym_idx].sh_offset) != segsz) {
+    segsz = symtab->sh_size;
+    *syms = g_try_malloc(segsz);
+    if (!*syms || pread(fd, *syms, segsz, symtab->sh_offset) != segsz) {
         goto give_up;
     }
+    return true;
+
+give_up:
+    g_free(*strings);
+    g_free(*syms);
+    *strings = NULL;
+    *syms = NULL;
+    return false;
+}
+
+/*
+ * Best attempt to turn the tables read by read_symtab into the symbols
+ * of S.  Takes ownership of STRINGS and SYMS.
+ */
+static bool parse_symbols(struct syminfo *s, char *strings,
+                          struct elf_sym *syms, uint64_t segsz,
+                          abi_ulong load_bias)
+{
+    int i, nsyms;
+    struct elf_sym *new_syms;
+
+    s->disas_strtab = strings;
 
     if (segsz / sizeof(struct elf_sym) > INT_MAX) {
         /* Implausibly large symbol table: give up rather than ploughing
@@ -3056,15 +3272,63 @@ static void load_symbols(struct elfhdr *hdr, int fd, abi_ulong load_bias)
     s->disas_symtab.elf64 = syms;
 #endif
     s->lookup_symbol = lookup_symbolxx;
-    s->next = syminfos;
-    syminfos = s;
-
-    return;
+    return true;
 
 give_up:
-    g_free(s);
+    s->disas_strtab = NULL;
     g_free(strings);
     g_free(syms);
+    return false;
+}
+
+/*
+ * Symbols are only wanted for the "IN:" lines of -d in_asm and friends,
+ * so parsing and sorting them is deferred to the first lookup: most
+ * logging runs, and all short-lived processes, never get that far.
+ * The raw tables are read while the image is open, so that no
+ * descriptor has to be kept in the guest's file descriptor space.
+ */
+struct lazy_syminfo {
+    struct syminfo s;
+    char *strings;
+    struct elf_sym *syms;
+    uint64_t syms_size;
+    abi_ulong load_bias;
+};
+
+static const char *lookup_symbol_none(struct syminfo *s, target_ulong addr)
+{
+    return "";
+}
+
+static const char *lookup_symbol_lazy(struct syminfo *s, target_ulong addr)
+{
+    struct lazy_syminfo *l = container_of(s, struct lazy_syminfo, s);
+
+    s->lookup_symbol = lookup_symbol_none;
+    parse_symbols(s, l->strings, l->syms, l->syms_size, l->load_bias);
+    l->strings = NULL;
+    l->syms = NULL;
+
+    return s->lookup_symbol(s, addr);
+}
+
+static void load_symbols(struct elfhdr *hdr, int fd, abi_ulong load_bias)
+{
+    struct lazy_syminfo *l = g_new0(struct lazy_syminfo, 1);
+    struct elf_shdr symtab, strtab;
+
+    if (!find_symtab(hdr, fd, &symtab, &strtab) ||
+        !read_symtab(&symtab, &strtab, fd, &l->strings, &l->syms)) {
+        g_free(l);
+        return;
+    }
+
+    l->syms_size = symtab.sh_size;
+    l->load_bias = load_bias;
+    l->s.lookup_symbol = lookup_symbol_lazy;
+    l->s.next = syminfos;
+    syminfos = &l->s;
 }
 
 uint32_t get_elf_eflags(int fd)
@@ -3180,6 +3444,10 @@ int load_elf_binary(struct linux_binprm *bprm, struct image_info *info)
 #endif
     }
 
+#ifdef HAVE_ELF_VDSO
+    load_elf_vdso(info);
+#endif
+
     bprm->p = create_elf_tables(bprm->p, bprm->argc, bprm->envc, &elf_ex,
                                 info, (elf_interpreter ? &interp_info : NULL));
     info->start_stack = bprm->p;
@@ -38,6 +38,7 @@
 #include "qemu/plugin.h"
 #include "cpu.h"
 #include "exec/exec-all.h"
+#include "exec/perf.h"
 #include "tcg/tcg.h"
 #include "qemu/timer.h"
 #include "qemu/envlist.h"
@@ -57,6 +58,7 @@ static envlist_t *envlist;
 static const char *cpu_model;
 static const char *cpu_type;
 static const char *seed_optarg;
+static const char *tcg_profile;
 unsigned long mmap_min_addr;
 unsigned long guest_base;
 bool have_guest_base;
@@ -379,6 +381,21 @@ static void handle_arg_strace(const char *arg)
     enable_strace = true;
 }
 
+static void handle_arg_perfmap(const char *arg)
+{
+    perf_enable_perfmap(&error_fatal);
+}
+
+static void handle_arg_jitdump(const char *arg)
+{
+    perf_enable_jitdump(&error_fatal);
+}
+
+static void handle_arg_tcg_profile(const char *arg)
+{
+    tcg_profile = arg;
+}
+
 static void handle_arg_version(const char *arg)
 {
     printf("qemu-" TARGET_NAME " version " QEMU_FULL_VERSION
@@ -454,6 +471,12 @@ static const struct qemu_argument arg_table[] = {
      "",           "run in singlestep mode"},
     {"strace",     "QEMU_STRACE",      false, handle_arg_strace,
      "",           "log system calls"},
+    {"perfmap",    "QEMU_PERFMAP",     false, handle_arg_perfmap,
+     "",           "write a perf map of the generated code"},
+    {"jitdump",    "QEMU_JITDUMP",     false, handle_arg_jitdump,
+     "",           "write a perf jitdump of the generated code"},
+    {"tcg-profile", "QEMU_TCG_PROFILE", true, handle_arg_tcg_profile,
+     "file",       "write a sampled profile of the generated code to 'file'"},
     {"seed",       "QEMU_RAND_SEED",   true,  handle_arg_seed,
      "",           "Seed for pseudo-random number generator"},
     {"trace",      "QEMU_TRACE",       true,  handle_arg_trace,
@@ -840,7 +863,14 @@ int main(int argc, char **argv, char **envp)
 
     target_set_brk(info->brk);
     syscall_init();
-    signal_init();
+    /*
+     * The guest owns SIGPROF and ITIMER_PROF, so the profiler samples
+     * with a host signal that the guest cannot see or take over.
+     */
+    signal_init(tcg_profile != NULL);
+    if (tcg_profile) {
+        perf_enable_profile(tcg_profile, host_reserved_signal, &error_fatal);
+    }
 
     /* Now that we've loaded the binary, GUEST_BASE is fixed.  Delay
        generating the prologue until now so that the prologue can take
@@ -49,6 +49,7 @@ struct image_info {
         abi_ulong       arg_strings;
         abi_ulong       env_strings;
         abi_ulong       file_string;
+        abi_ulong       vdso;
         uint32_t        elf_flags;
         int		personality;
         abi_ulong       alignment;
@@ -422,8 +423,9 @@ void print_syscall_ret(void *cpu_env, int num, abi_long ret,
 void print_taken_signal(int target_signum, const target_siginfo_t *tinfo);
 
 /* signal.c */
+extern int host_reserved_signal;
 void process_pending_signals(CPUArchState *cpu_env);
-void signal_init(void);
+void signal_init(bool reserve_signal);
 int queue_signal(CPUArchState *env, int sig, int si_type,
                  target_siginfo_t *info);
 void host_to_target_siginfo(target_siginfo_t *tinfo, const siginfo_t *info);
@@ -687,6 +689,30 @@ static inline void *lock_user_string(abi_ulong guest_addr)
 #define unlock_user_struct(host_ptr, guest_addr, copy)		\
     unlock_user(host_ptr, guest_addr, (copy) ? sizeof(*host_ptr) : 0)
 
+/*
+ * Layout identity between a target struct and its host counterpart.
+ * When a target struct has the same size as the host one, and each
+ * field has the same offset and size, a locked target struct can be
+ * handed to the host as is, instead of being converted field by field.
+ * These are integer constant expressions, so that the conversion code
+ * can be dropped at compile time: TARGET_FIELD_SAME(a, b, f) checks
+ * field f of struct a and b, and TARGET_STRUCT_SAME(a, b, cond) checks
+ * the sizes, endianness and the field checks in cond.  Only use them
+ * for fields that hold plain integers; guest addresses need g2h().
+ */
+#if defined(HOST_WORDS_BIGENDIAN) == defined(TARGET_WORDS_BIGENDIAN)
+#define TARGET_SAME_ENDIAN 1
+#else
+#define TARGET_SAME_ENDIAN 0
+#endif
+
+#define TARGET_FIELD_SAME(ttype, htype, field)                  \
+    (offsetof(ttype, field) == offsetof(htype, field) &&        \
+     sizeof_field(ttype, field) == sizeof_field(htype, field))
+
+#define TARGET_STRUCT_SAME(ttype, htype, cond)                  \
+    (TARGET_SAME_ENDIAN && sizeof(ttype) == sizeof(htype) && (cond))
+
 #include <pthread.h>
 
 static inline int is_error(abi_long ret)
@@ -79,6 +79,12 @@ static uint8_t host_to_target_signal_table[_NSIG] = {
 
 static uint8_t target_to_host_signal_table[TARGET_NSIG + 1];
 
+/*
+ * Host signal that is not mapped to any guest signal, so that QEMU can
+ * use it for itself; 0 if signal_init() was not asked for one.
+ */
+int host_reserved_signal;
+
 /* valid sig is between 1 and _NSIG - 1 */
 int host_to_target_signal(int sig)
 {
@@ -496,10 +502,18 @@ static int core_dump_signal(int sig)
     }
 }
 
-static void signal_table_init(void)
+static void signal_table_init(bool reserve_signal)
 {
     int host_sig, target_sig, count;
 
+    /*
+     * The highest host RT signal backs the highest guest RT signal that
+     * fits, which is the least likely to be used.
+     */
+    if (reserve_signal) {
+        host_reserved_signal = SIGRTMAX;
+    }
+
     /*
      * Signals are supported starting from TARGET_SIGRTMIN and going up
      * until we run out of host realtime signals.
@@ -512,6 +526,9 @@ static void signal_table_init(void)
      * silently ignored.
      */
     for (host_sig = SIGRTMIN; host_sig <= SIGRTMAX; host_sig++) {
+        if (host_sig == host_reserved_signal) {
+            continue;
+        }
         target_sig = host_sig - SIGRTMIN + TARGET_SIGRTMIN;
         if (target_sig <= TARGET_NSIG) {
             host_to_target_signal_table[host_sig] = target_sig;
@@ -523,6 +540,9 @@ static void signal_table_init(void)
         target_to_host_signal_table[target_sig] = _NSIG; /* poison */
     }
     for (host_sig = 1; host_sig < _NSIG; host_sig++) {
+        if (host_sig == host_reserved_signal) {
+            continue;
+        }
         if (host_to_target_signal_table[host_sig] == 0) {
             host_to_target_signal_table[host_sig] = host_sig;
         }
@@ -542,7 +562,7 @@ static void signal_table_init(void)
     }
 }
 
-void signal_init(void)
+void signal_init(bool reserve_signal)
 {
     TaskState *ts = (TaskState *)thread_cpu->opaque;
     struct sigaction act;
@@ -551,7 +571,7 @@ void signal_init(void)
     int host_sig;
 
     /* initialize signal conversion tables */
-    signal_table_init();
+    signal_table_init(reserve_signal);
 
     /* Set the signal mask from the host mask. */
     sigprocmask(0, 0, &ts->signal_mask);
@@ -3453,6 +3453,12 @@ if( cmd == val ) { \
 #endif
 #ifdef FUTEX_WAKE_BITSET
     print_op(FUTEX_WAKE_BITSET)
+#endif
+#ifdef FUTEX_WAIT_REQUEUE_PI
+    print_op(FUTEX_WAIT_REQUEUE_PI)
+#endif
+#ifdef FUTEX_CMP_REQUEUE_PI
+    print_op(FUTEX_CMP_REQUEUE_PI)
 #endif
     /* unknown values */
     qemu_log("%d", cmd);
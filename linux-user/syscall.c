@@ -22,6 +22,7 @@
 #include "qemu/path.h"
 #include "qemu/memfd.h"
 #include "qemu/queue.h"
+#include "qemu/units.h"
 #include <elf.h>
 #include <endian.h>
 #include <grp.h>
@@ -67,6 +68,10 @@
 #ifdef CONFIG_EPOLL
 #include <sys/epoll.h>
 #endif
+#ifdef CONFIG_IO_URING_SYSCALLS
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#endif
 #ifdef CONFIG_ATTR
 #include "qemu/xattr.h"
 #endif
@@ -740,6 +745,20 @@ safe_syscall5(int, ppoll, struct pollfd *, ufds, unsigned int, nfds,
 safe_syscall6(int, epoll_pwait, int, epfd, struct epoll_event *, events,
               int, maxevents, int, timeout, const sigset_t *, sigmask,
               size_t, sigsetsize)
+#if defined(TARGET_NR_io_uring_enter) && defined(CONFIG_IO_URING_SYSCALLS)
+safe_syscall6(int, io_uring_enter, unsigned int, fd, unsigned int, to_submit,
+              unsigned int, min_complete, unsigned int, flags,
+              const sigset_t *, sig, size_t, sigsz)
+#endif
+#ifdef CONFIG_EPOLL
+/* epoll_data_t is opaque to the kernel, so it can be shared whatever it is */
+#define TARGET_EPOLL_EVENT_SAME                                         \
+    TARGET_STRUCT_SAME(struct target_epoll_event, struct epoll_event,   \
+        TARGET_FIELD_SAME(struct target_epoll_event, struct epoll_event, \
+                          events) &&                                    \
+        TARGET_FIELD_SAME(struct target_epoll_event, struct epoll_event, \
+                          data))
+#endif
 #if defined(__NR_futex)
 safe_syscall6(int,futex,int *,uaddr,int,op,int,val, \
               const struct timespec *,timeout,int *,uaddr2,int,val3)
@@ -766,6 +785,18 @@ safe_syscall6(ssize_t, recvfrom, int, fd, void *, buf, size_t, len,
               int, flags, struct sockaddr *, addr, socklen_t *, addrlen)
 safe_syscall3(ssize_t, sendmsg, int, fd, const struct msghdr *, msg, int, flags)
 safe_syscall3(ssize_t, recvmsg, int, fd, struct msghdr *, msg, int, flags)
+#if defined(__NR_sendmmsg) && defined(__NR_recvmmsg)
+/* We don't rely on the C library to have sendmmsg/recvmmsg support.  */
+struct host_mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+};
+safe_syscall4(int, sendmmsg, int, fd, struct host_mmsghdr *, msgvec,
+              unsigned int, vlen, unsigned int, flags)
+safe_syscall5(int, recvmmsg, int, fd, struct host_mmsghdr *, msgvec,
+              unsigned int, vlen, unsigned int, flags,
+              struct timespec *, timeout)
+#endif
 safe_syscall2(int, flock, int, fd, int, operation)
 #if defined(TARGET_NR_rt_sigtimedwait) || defined(TARGET_NR_rt_sigtimedwait_time64)
 safe_syscall4(int, rt_sigtimedwait, const sigset_t *, these, siginfo_t *, uinfo,
@@ -1241,6 +1272,18 @@ static inline abi_long target_to_host_timespec(struct timespec *host_ts,
 }
 #endif
 
+/*
+ * With a 32-bit ABI, the upper half of tv_nsec is padding that the host
+ * must not see, so only 64-bit ABIs can share the host's layout.
+ */
+#define TARGET_TIMESPEC64_SAME                                          \
+    (TARGET_ABI_BITS == 64 &&                                           \
+     TARGET_STRUCT_SAME(struct target__kernel_timespec, struct timespec, \
+        TARGET_FIELD_SAME(struct target__kernel_timespec,               \
+                          struct timespec, tv_sec) &&                   \
+        TARGET_FIELD_SAME(struct target__kernel_timespec,               \
+                          struct timespec, tv_nsec)))
+
 #if defined(TARGET_NR_clock_settime64) || defined(TARGET_NR_futex_time64) || \
     defined(TARGET_NR_timer_settime64) || \
     defined(TARGET_NR_mq_timedsend_time64) || \
@@ -1260,6 +1303,11 @@ static inline abi_long target_to_host_timespec64(struct timespec *host_ts,
     if (!lock_user_struct(VERIFY_READ, target_ts, target_addr, 1)) {
         return -TARGET_EFAULT;
     }
+    if (TARGET_TIMESPEC64_SAME) {
+        memcpy(host_ts, target_ts, sizeof(*host_ts));
+        unlock_user_struct(target_ts, target_addr, 0);
+        return 0;
+    }
     __get_user(host_ts->tv_sec, &target_ts->tv_sec);
     __get_user(host_ts->tv_nsec, &target_ts->tv_nsec);
     /* in 32bit mode, this drops the padding */
@@ -1291,8 +1339,12 @@ static inline abi_long host_to_target_timespec64(abi_ulong target_addr,
     if (!lock_user_struct(VERIFY_WRITE, target_ts, target_addr, 0)) {
         return -TARGET_EFAULT;
     }
-    __put_user(host_ts->tv_sec, &target_ts->tv_sec);
-    __put_user(host_ts->tv_nsec, &target_ts->tv_nsec);
+    if (TARGET_TIMESPEC64_SAME) {
+        memcpy(target_ts, host_ts, sizeof(*target_ts));
+    } else {
+        __put_user(host_ts->tv_sec, &target_ts->tv_sec);
+        __put_user(host_ts->tv_nsec, &target_ts->tv_nsec);
+    }
     unlock_user_struct(target_ts, target_addr, 1);
     return 0;
 }
@@ -1583,6 +1635,12 @@ static abi_long do_pselect6(abi_long arg1, abi_long arg2, abi_long arg3,
 
 #if defined(TARGET_NR_poll) || defined(TARGET_NR_ppoll) || \
     defined(TARGET_NR_ppoll_time64)
+#define TARGET_POLLFD_SAME                                              \
+    TARGET_STRUCT_SAME(struct target_pollfd, struct pollfd,             \
+        TARGET_FIELD_SAME(struct target_pollfd, struct pollfd, fd) &&   \
+        TARGET_FIELD_SAME(struct target_pollfd, struct pollfd, events) && \
+        TARGET_FIELD_SAME(struct target_pollfd, struct pollfd, revents))
+
 static abi_long do_ppoll(abi_long arg1, abi_long arg2, abi_long arg3,
                          abi_long arg4, abi_long arg5, bool ppoll, bool time64)
 {
@@ -1604,10 +1662,15 @@ static abi_long do_ppoll(abi_long arg1, abi_long arg2, abi_long arg3,
             return -TARGET_EFAULT;
         }
 
-        pfd = alloca(sizeof(struct pollfd) * nfds);
-        for (i = 0; i < nfds; i++) {
-            pfd[i].fd = tswap32(target_pfd[i].fd);
-            pfd[i].events = tswap16(target_pfd[i].events);
+        if (TARGET_POLLFD_SAME) {
+            /* the host writes revents straight into guest memory */
+            pfd = (struct pollfd *)target_pfd;
+        } else {
+            pfd = alloca(sizeof(struct pollfd) * nfds);
+            for (i = 0; i < nfds; i++) {
+                pfd[i].fd = tswap32(target_pfd[i].fd);
+                pfd[i].events = tswap16(target_pfd[i].events);
+            }
         }
     }
     if (ppoll) {
@@ -1680,7 +1743,7 @@ static abi_long do_ppoll(abi_long arg1, abi_long arg2, abi_long arg3,
           ret = get_errno(safe_ppoll(pfd, nfds, pts, NULL, 0));
     }
 
-    if (!is_error(ret)) {
+    if (!is_error(ret) && !TARGET_POLLFD_SAME) {
         for (i = 0; i < nfds; i++) {
             target_pfd[i].revents = tswap16(pfd[i].revents);
         }
@@ -3051,36 +3114,104 @@ static void target_to_host_low_high(abi_ulong tlow,
     *hhigh = (off >> HOST_LONG_BITS / 2) >> HOST_LONG_BITS / 2;
 }
 
-static struct iovec *lock_iovec(int type, abi_ulong target_addr,
-                                abi_ulong count, int copy)
+/*
+ * Per-thread scratch memory for host copies of guest structures that
+ * only live for the duration of one syscall, so that those do not go
+ * through the allocator (or the stack) on every call.  Requests larger
+ * than SCRATCH_MAX are allocated and freed as usual.
+ */
+#define SCRATCH_MAX (256 * KiB)
+
+static __thread void *scratch_buf;
+static __thread size_t scratch_size;
+
+static void *scratch_get(size_t size)
+{
+    if (size > SCRATCH_MAX) {
+        return g_try_malloc(size);
+    }
+    if (size > scratch_size || !scratch_buf) {
+        g_free(scratch_buf);
+        scratch_size = MAX(size, 4 * KiB);
+        scratch_buf = g_try_malloc(scratch_size);
+        if (!scratch_buf) {
+            scratch_size = 0;
+        }
+    }
+    return scratch_buf;
+}
+
+static void scratch_put(void *p)
+{
+    if (p != scratch_buf) {
+        g_free(p);
+    }
+}
+
+/*
+ * lock_iovec likewise keeps one array per thread.  Arrays that a caller
+ * holds beyond the syscall, or frees with g_free, just leave the cache
+ * empty until the next unlock_iovec.
+ */
+static __thread struct iovec *iovec_cache;
+static __thread abi_ulong iovec_cache_count;
+
+static void free_thread_scratch(void)
+{
+    g_free(scratch_buf);
+    scratch_buf = NULL;
+    scratch_size = 0;
+    g_free(iovec_cache);
+    iovec_cache = NULL;
+    iovec_cache_count = 0;
+}
+
+#ifndef DEBUG_REMAP
+/*
+ * Return the guest end of the run of buffers starting at entry I that
+ * are contiguous in guest memory, and the first entry past it in *NEXT.
+ */
+static abi_ulong iovec_run(struct target_iovec *target_vec, int i,
+                           abi_ulong count, int *next)
+{
+    abi_ulong end = tswapal(target_vec[i].iov_base) +
+                    tswapal(target_vec[i].iov_len);
+
+    for (i++; i < count; i++) {
+        abi_long len = tswapal(target_vec[i].iov_len);
+
+        if (tswapal(target_vec[i].iov_base) != end || len <= 0 ||
+            end + len < end) {
+            break;
+        }
+        end += len;
+    }
+    *next = i;
+    return end;
+}
+#endif
+
+/*
+ * Fill VEC, which has room for COUNT entries, from the guest's iovec
+ * array at TARGET_ADDR.  Returns 0 or a host errno value.
+ */
+static int lock_iovec_into(struct iovec *vec, int type, abi_ulong target_addr,
+                           abi_ulong count, int copy)
 {
     struct target_iovec *target_vec;
-    struct iovec *vec;
     abi_ulong total_len, max_len;
     int i;
     int err = 0;
     bool bad_address = false;
-
-    if (count == 0) {
-        errno = 0;
-        return NULL;
-    }
-    if (count > IOV_MAX) {
-        errno = EINVAL;
-        return NULL;
-    }
-
-    vec = g_try_new0(struct iovec, count);
-    if (vec == NULL) {
-        errno = ENOMEM;
-        return NULL;
-    }
+#ifndef DEBUG_REMAP
+    int run_next = 0;
+    bool run_ok = false;
+#endif
 
     target_vec = lock_user(VERIFY_READ, target_addr,
                            count * sizeof(struct target_iovec), 1);
     if (target_vec == NULL) {
-        err = EFAULT;
-        goto fail2;
+        return EFAULT;
     }
 
     /* ??? If host page size > target page size, this will result in a
@@ -3099,7 +3230,24 @@ static struct iovec *lock_iovec(int type, abi_ulong target_addr,
             /* Zero length pointer is ignored.  */
             vec[i].iov_base = 0;
         } else {
-            vec[i].iov_base = lock_user(type, base, len, copy);
+#ifndef DEBUG_REMAP
+            /*
+             * lock_user is only a range check here, so check each run
+             * of buffers that are contiguous in guest memory just once,
+             * as scatter/gather users tend to split a single buffer.
+             */
+            if (i >= run_next) {
+                abi_ulong end = iovec_run(target_vec, i, count, &run_next);
+
+                run_ok = run_next > i + 1 && access_ok(type, base, end - base);
+            }
+            if (run_ok) {
+                vec[i].iov_base = g2h(base);
+            } else
+#endif
+            {
+                vec[i].iov_base = lock_user(type, base, len, copy);
+            }
             /* If the first buffer pointer is bad, this is a fault.  But
              * subsequent bad buffers will result in a partial write; this
              * is realized by filling the vector with null pointers and
@@ -3119,47 +3267,885 @@ static struct iovec *lock_iovec(int type, abi_ulong target_addr,
                 len = max_len - total_len;
             }
         }
-        vec[i].iov_len = len;
-        total_len += len;
+        vec[i].iov_len = len;
+        total_len += len;
+    }
+
+    unlock_user(target_vec, target_addr, 0);
+    return 0;
+
+ fail:
+    while (--i >= 0) {
+        if (tswapal(target_vec[i].iov_len) > 0) {
+            unlock_user(vec[i].iov_base, tswapal(target_vec[i].iov_base), 0);
+        }
+    }
+    unlock_user(target_vec, target_addr, 0);
+    return err;
+}
+
+static void unlock_iovec_into(struct iovec *vec, abi_ulong target_addr,
+                              abi_ulong count, int copy)
+{
+#ifdef DEBUG_REMAP
+    struct target_iovec *target_vec;
+    int i;
+
+    target_vec = lock_user(VERIFY_READ, target_addr,
+                           count * sizeof(struct target_iovec), 1);
+    if (target_vec) {
+        for (i = 0; i < count; i++) {
+            abi_ulong base = tswapal(target_vec[i].iov_base);
+            abi_long len = tswapal(target_vec[i].iov_len);
+            if (len < 0) {
+                break;
+            }
+            unlock_user(vec[i].iov_base, base, copy ? vec[i].iov_len : 0);
+        }
+        unlock_user(target_vec, target_addr, 0);
+    }
+#endif
+}
+
+static struct iovec *lock_iovec(int type, abi_ulong target_addr,
+                                abi_ulong count, int copy)
+{
+    struct iovec *vec;
+    int err;
+
+    if (count == 0) {
+        errno = 0;
+        return NULL;
+    }
+    if (count > IOV_MAX) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (iovec_cache && iovec_cache_count >= count) {
+        vec = iovec_cache;
+        iovec_cache = NULL;
+        memset(vec, 0, count * sizeof(struct iovec));
+    } else {
+        vec = g_try_new0(struct iovec, count);
+        if (vec == NULL) {
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    err = lock_iovec_into(vec, type, target_addr, count, copy);
+    if (err) {
+        g_free(vec);
+        errno = err;
+        return NULL;
+    }
+    return vec;
+}
+
+static void unlock_iovec(struct iovec *vec, abi_ulong target_addr,
+                         abi_ulong count, int copy)
+{
+    unlock_iovec_into(vec, target_addr, count, copy);
+
+    if (!iovec_cache) {
+        iovec_cache = vec;
+        iovec_cache_count = count;
+    } else if (iovec_cache_count < count) {
+        g_free(iovec_cache);
+        iovec_cache = vec;
+        iovec_cache_count = count;
+    } else {
+        g_free(vec);
+    }
+}
+
+#if defined(TARGET_NR_io_uring_setup) && defined(CONFIG_IO_URING_SYSCALLS)
+/*
+ * io_uring
+ *
+ * The host cannot use the guest's rings directly: SQEs hold guest
+ * addresses, and all fields may need byte-swapping.  Instead, each guest
+ * io_uring is backed by a host one, whose file descriptor is the one the
+ * guest sees, and by a memfd holding rings in the guest's format.  The
+ * guest's mmap of the ring file descriptor maps the memfd instead.
+ *
+ * io_uring_enter translates the new SQEs into the host's ring, where they
+ * run asynchronously, and copies the host's completions back.  Since that
+ * only happens in io_uring_enter, IORING_SQ_CQ_OVERFLOW is kept set while
+ * requests are in flight: this makes liburing enter the kernel rather
+ * than conclude that no completion is available.
+ */
+typedef struct {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t flags;
+    uint32_t dropped;
+    uint32_t array[];
+} TargetUringSQ;
+
+typedef struct {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t overflow;
+    uint32_t flags;
+    uint64_t pad;
+    struct target_io_uring_cqe cqes[];
+} TargetUringCQ;
+
+typedef struct UringReq {
+    /* the guest's user_data; the host's is the UringReq itself */
+    uint64_t user_data;
+    struct iovec *iov;
+    struct __kernel_timespec ts;
+    QLIST_ENTRY(UringReq) next;
+} UringReq;
+
+typedef struct TargetUring {
+    int fd;
+    unsigned int refcnt;
+    QemuMutex lock;
+
+    /* the guest's rings, as laid out in the memfd */
+    int memfd;
+    void *mem;
+    size_t sq_size, cq_size, sqes_size;
+    TargetUringSQ *sq;
+    TargetUringCQ *cq;
+    struct target_io_uring_sqe *sqes;
+    uint32_t sq_head;
+    uint32_t cq_tail;
+
+    /* the host's rings */
+    struct io_uring_params p;
+    void *host_sq;
+    void *host_cq;
+    size_t host_sq_size, host_cq_size;
+    struct io_uring_sqe *host_sqes;
+
+    QLIST_HEAD(, UringReq) reqs;
+} TargetUring;
+
+#ifndef IORING_CQE_F_MORE
+#define IORING_CQE_F_MORE (1U << 1)
+#endif
+
+#define URING_HOST_SQ(u, field) \
+    ((uint32_t *)((char *)(u)->host_sq + (u)->p.sq_off.field))
+#define URING_HOST_CQ(u, field) \
+    ((uint32_t *)((char *)(u)->host_cq + (u)->p.cq_off.field))
+
+static const bitmask_transtbl iosqe_flags_tbl[] = {
+    { TARGET_IOSQE_FIXED_FILE, TARGET_IOSQE_FIXED_FILE,
+      IOSQE_FIXED_FILE, IOSQE_FIXED_FILE },
+    { TARGET_IOSQE_IO_DRAIN, TARGET_IOSQE_IO_DRAIN,
+      IOSQE_IO_DRAIN, IOSQE_IO_DRAIN },
+    { TARGET_IOSQE_IO_LINK, TARGET_IOSQE_IO_LINK,
+      IOSQE_IO_LINK, IOSQE_IO_LINK },
+    { TARGET_IOSQE_IO_HARDLINK, TARGET_IOSQE_IO_HARDLINK,
+      IOSQE_IO_HARDLINK, IOSQE_IO_HARDLINK },
+    { TARGET_IOSQE_ASYNC, TARGET_IOSQE_ASYNC, IOSQE_ASYNC, IOSQE_ASYNC },
+    { 0, 0, 0, 0 }
+};
+
+#define TARGET_IOSQE_ALL                                        \
+    (TARGET_IOSQE_FIXED_FILE | TARGET_IOSQE_IO_DRAIN |          \
+     TARGET_IOSQE_IO_LINK | TARGET_IOSQE_IO_HARDLINK |          \
+     TARGET_IOSQE_ASYNC)
+
+static pthread_mutex_t uring_table_lock = PTHREAD_MUTEX_INITIALIZER;
+static GHashTable *uring_table;
+
+static TargetUring *uring_lookup(int fd)
+{
+    TargetUring *u = NULL;
+
+    pthread_mutex_lock(&uring_table_lock);
+    if (uring_table) {
+        u = g_hash_table_lookup(uring_table, GINT_TO_POINTER(fd));
+        if (u) {
+            u->refcnt++;
+        }
+    }
+    pthread_mutex_unlock(&uring_table_lock);
+    return u;
+}
+
+static void uring_free(TargetUring *u)
+{
+    UringReq *req, *next;
+
+    QLIST_FOREACH_SAFE(req, &u->reqs, next, next) {
+        g_free(req->iov);
+        g_free(req);
+    }
+    if (u->host_sqes) {
+        munmap(u->host_sqes, u->p.sq_entries * sizeof(struct io_uring_sqe));
+    }
+    if (u->host_cq) {
+        munmap(u->host_cq, u->host_cq_size);
+    }
+    if (u->host_sq) {
+        munmap(u->host_sq, u->host_sq_size);
+    }
+    if (u->mem) {
+        qemu_memfd_free(u->mem, u->sq_size + u->cq_size + u->sqes_size,
+                        u->memfd);
+    }
+    qemu_mutex_destroy(&u->lock);
+    g_free(u);
+}
+
+static void uring_unref(TargetUring *u)
+{
+    bool last;
+
+    pthread_mutex_lock(&uring_table_lock);
+    last = --u->refcnt == 0;
+    pthread_mutex_unlock(&uring_table_lock);
+    if (last) {
+        uring_free(u);
+    }
+}
+
+/* Forget about the guest io_uring on @fd, which is being closed.  */
+static void uring_close(int fd)
+{
+    TargetUring *u = NULL;
+
+    pthread_mutex_lock(&uring_table_lock);
+    if (uring_table) {
+        u = g_hash_table_lookup(uring_table, GINT_TO_POINTER(fd));
+        g_hash_table_remove(uring_table, GINT_TO_POINTER(fd));
+    }
+    pthread_mutex_unlock(&uring_table_lock);
+    if (u) {
+        uring_unref(u);
+    }
+}
+
+static TargetUring *uring_new(int fd, const struct io_uring_params *p)
+{
+    size_t page = MAX(qemu_real_host_page_size, TARGET_PAGE_SIZE);
+    TargetUring *u = g_new0(TargetUring, 1);
+
+    u->fd = fd;
+    u->refcnt = 1;
+    u->p = *p;
+    qemu_mutex_init(&u->lock);
+    QLIST_INIT(&u->reqs);
+
+    u->host_sq_size = p->sq_off.array + p->sq_entries * sizeof(uint32_t);
+    u->host_sq = mmap(NULL, u->host_sq_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    u->host_cq_size = p->cq_off.cqes +
+                      p->cq_entries * sizeof(struct io_uring_cqe);
+    u->host_cq = mmap(NULL, u->host_cq_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    u->host_sqes = mmap(NULL, p->sq_entries * sizeof(struct io_uring_sqe),
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        fd, IORING_OFF_SQES);
+    if (u->host_sq == MAP_FAILED || u->host_cq == MAP_FAILED ||
+        u->host_sqes == MAP_FAILED) {
+        u->host_sq = u->host_sq == MAP_FAILED ? NULL : u->host_sq;
+        u->host_cq = u->host_cq == MAP_FAILED ? NULL : u->host_cq;
+        u->host_sqes = u->host_sqes == MAP_FAILED ? NULL : u->host_sqes;
+        uring_free(u);
+        return NULL;
+    }
+
+    u->sq_size = ROUND_UP(sizeof(TargetUringSQ) +
+                          p->sq_entries * sizeof(uint32_t), page);
+    u->cq_size = ROUND_UP(sizeof(TargetUringCQ) +
+                          p->cq_entries * sizeof(struct target_io_uring_cqe),
+                          page);
+    u->sqes_size = ROUND_UP(p->sq_entries *
+                            sizeof(struct target_io_uring_sqe), page);
+    u->mem = qemu_memfd_alloc("io_uring", u->sq_size + u->cq_size +
+                              u->sqes_size, 0, &u->memfd, NULL);
+    if (!u->mem) {
+        uring_free(u);
+        return NULL;
+    }
+    u->sq = u->mem;
+    u->cq = (TargetUringCQ *)((char *)u->mem + u->sq_size);
+    u->sqes = (struct target_io_uring_sqe *)((char *)u->mem + u->sq_size +
+                                             u->cq_size);
+    u->sq->ring_mask = tswap32(p->sq_entries - 1);
+    u->sq->ring_entries = tswap32(p->sq_entries);
+    u->cq->ring_mask = tswap32(p->cq_entries - 1);
+    u->cq->ring_entries = tswap32(p->cq_entries);
+    return u;
+}
+
+static abi_long do_io_uring_setup(abi_ulong entries, abi_ulong target_addr)
+{
+    struct target_io_uring_params *target_p;
+    struct io_uring_params p;
+    TargetUring *u;
+    uint32_t flags;
+    int fd;
+
+    if (!lock_user_struct(VERIFY_WRITE, target_p, target_addr, 1)) {
+        return -TARGET_EFAULT;
+    }
+    flags = tswap32(target_p->flags);
+    /* In particular, SQPOLL would have the host read the guest's rings. */
+    if (flags & ~(TARGET_IORING_SETUP_CQSIZE | TARGET_IORING_SETUP_CLAMP)) {
+        unlock_user_struct(target_p, target_addr, 0);
+        return -TARGET_EINVAL;
+    }
+
+    memset(&p, 0, sizeof(p));
+    if (flags & TARGET_IORING_SETUP_CQSIZE) {
+        p.flags |= IORING_SETUP_CQSIZE;
+        p.cq_entries = tswap32(target_p->cq_entries);
+    }
+    if (flags & TARGET_IORING_SETUP_CLAMP) {
+        p.flags |= IORING_SETUP_CLAMP;
+    }
+    fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0) {
+        unlock_user_struct(target_p, target_addr, 0);
+        return get_errno(fd);
+    }
+    u = uring_new(fd, &p);
+    if (!u) {
+        close(fd);
+        unlock_user_struct(target_p, target_addr, 0);
+        return -TARGET_ENOMEM;
+    }
+
+    memset(target_p, 0, sizeof(*target_p));
+    target_p->sq_entries = tswap32(p.sq_entries);
+    target_p->cq_entries = tswap32(p.cq_entries);
+    target_p->flags = tswap32(flags);
+    /* SQEs are copied when submitted, and offsets of -1 are passed on */
+    target_p->features = tswap32(TARGET_IORING_FEAT_SUBMIT_STABLE |
+                                 TARGET_IORING_FEAT_RW_CUR_POS);
+    target_p->sq_off.head = tswap32(offsetof(TargetUringSQ, head));
+    target_p->sq_off.tail = tswap32(offsetof(TargetUringSQ, tail));
+    target_p->sq_off.ring_mask = tswap32(offsetof(TargetUringSQ, ring_mask));
+    target_p->sq_off.ring_entries =
+        tswap32(offsetof(TargetUringSQ, ring_entries));
+    target_p->sq_off.flags = tswap32(offsetof(TargetUringSQ, flags));
+    target_p->sq_off.dropped = tswap32(offsetof(TargetUringSQ, dropped));
+    target_p->sq_off.array = tswap32(offsetof(TargetUringSQ, array));
+    target_p->cq_off.head = tswap32(offsetof(TargetUringCQ, head));
+    target_p->cq_off.tail = tswap32(offsetof(TargetUringCQ, tail));
+    target_p->cq_off.ring_mask = tswap32(offsetof(TargetUringCQ, ring_mask));
+    target_p->cq_off.ring_entries =
+        tswap32(offsetof(TargetUringCQ, ring_entries));
+    target_p->cq_off.overflow = tswap32(offsetof(TargetUringCQ, overflow));
+    target_p->cq_off.cqes = tswap32(offsetof(TargetUringCQ, cqes));
+    target_p->cq_off.flags = tswap32(offsetof(TargetUringCQ, flags));
+    unlock_user_struct(target_p, target_addr, 1);
+
+    pthread_mutex_lock(&uring_table_lock);
+    if (!uring_table) {
+        uring_table = g_hash_table_new(NULL, NULL);
+    }
+    g_hash_table_insert(uring_table, GINT_TO_POINTER(fd), u);
+    pthread_mutex_unlock(&uring_table_lock);
+    return fd;
+}
+
+/*
+ * Replace @fd and @offset if they refer to the rings of a guest io_uring.
+ * Returns false if they do, but @offset and @len are not valid.
+ */
+static bool uring_mmap_fd(int *fd, abi_ulong *offset, abi_ulong len)
+{
+    TargetUring *u = uring_lookup(*fd);
+    size_t start, size;
+
+    if (!u) {
+        return true;
+    }
+    switch (*offset) {
+    case TARGET_IORING_OFF_SQ_RING:
+        start = 0;
+        size = u->sq_size;
+        break;
+    case TARGET_IORING_OFF_CQ_RING:
+        start = u->sq_size;
+        size = u->cq_size;
+        break;
+    case TARGET_IORING_OFF_SQES:
+        start = u->sq_size + u->cq_size;
+        size = u->sqes_size;
+        break;
+    default:
+        uring_unref(u);
+        return false;
+    }
+    /* the memfd stays open as long as it is mapped */
+    *fd = u->memfd;
+    *offset = start;
+    uring_unref(u);
+    return len <= size;
+}
+
+/*
+ * Post a completion to the guest's ring.  As for the kernel, completions
+ * that do not fit are counted in the overflow field and dropped.
+ */
+static bool uring_post(TargetUring *u, uint64_t user_data, int32_t res,
+                       uint32_t flags)
+{
+    struct target_io_uring_cqe *cqe;
+    uint32_t head = tswap32(qatomic_load_acquire(&u->cq->head));
+
+    if (u->cq_tail - head >= u->p.cq_entries) {
+        return false;
+    }
+    cqe = &u->cq->cqes[u->cq_tail & (u->p.cq_entries - 1)];
+    cqe->user_data = tswap64(user_data);
+    cqe->res = tswap32(res);
+    cqe->flags = tswap32(flags);
+    u->cq_tail++;
+    qatomic_store_release(&u->cq->tail, tswap32(u->cq_tail));
+    return true;
+}
+
+static void uring_post_error(TargetUring *u, uint64_t user_data, int32_t res)
+{
+    if (!uring_post(u, user_data, res, 0)) {
+        qatomic_set(&u->cq->overflow,
+                    tswap32(tswap32(qatomic_read(&u->cq->overflow)) + 1));
+    }
+}
+
+/* Copy the host's completions to the guest's ring, as long as they fit.  */
+static void uring_reap(TargetUring *u)
+{
+    struct io_uring_cqe *cqes =
+        (struct io_uring_cqe *)((char *)u->host_cq + u->p.cq_off.cqes);
+    uint32_t mask = *URING_HOST_CQ(u, ring_mask);
+    uint32_t head = *URING_HOST_CQ(u, head);
+    uint32_t tail = qatomic_load_acquire(URING_HOST_CQ(u, tail));
+
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &cqes[head & mask];
+        UringReq *req = (UringReq *)(uintptr_t)cqe->user_data;
+        int32_t res = cqe->res;
+
+        if (res < 0) {
+            res = -host_to_target_errno(-res);
+        }
+        if (!uring_post(u, req->user_data, res, cqe->flags)) {
+            break;
+        }
+        /* more completions will follow for the same request */
+        if (cqe->flags & IORING_CQE_F_MORE) {
+            continue;
+        }
+        QLIST_REMOVE(req, next);
+        g_free(req->iov);
+        g_free(req);
+    }
+    qatomic_store_release(URING_HOST_CQ(u, head), head);
+}
+
+static uint32_t uring_cq_ready(TargetUring *u)
+{
+    return u->cq_tail - tswap32(qatomic_load_acquire(&u->cq->head));
+}
+
+/* Cancellations refer to the guest's user_data; find the host's.  */
+static uint64_t uring_find(TargetUring *u, uint64_t user_data)
+{
+    UringReq *req;
+
+    QLIST_FOREACH(req, &u->reqs, next) {
+        if (req->user_data == user_data) {
+            return (uintptr_t)req;
+        }
+    }
+    /* no request has this user_data on the host, so the kernel fails it */
+    return 0;
+}
+
+/*
+ * Check the fields whose meaning uring_prep does not translate.  Newer
+ * kernels give their unused bits other meanings, for example to make a
+ * request complete more than once or to take a user_data from another
+ * field, so only accept the values that the opcode has always had.
+ */
+static bool uring_sqe_valid(uint8_t opcode, uint16_t ioprio, uint64_t off,
+                            uint32_t len, uint32_t op_flags)
+{
+    switch (opcode) {
+    case TARGET_IORING_OP_NOP:
+        return !op_flags;
+    case TARGET_IORING_OP_READV:
+    case TARGET_IORING_OP_WRITEV:
+    case TARGET_IORING_OP_READ_FIXED:
+    case TARGET_IORING_OP_WRITE_FIXED:
+    case TARGET_IORING_OP_READ:
+    case TARGET_IORING_OP_WRITE:
+        /* ioprio is the I/O priority of the request */
+        return !(op_flags & ~TARGET_IORING_RWF_ALL);
+    case TARGET_IORING_OP_FSYNC:
+        return !ioprio && !(op_flags & ~TARGET_IORING_FSYNC_DATASYNC);
+    case TARGET_IORING_OP_SYNC_FILE_RANGE:
+        return !ioprio && !(op_flags & ~TARGET_IORING_SYNC_RANGE_ALL);
+    case TARGET_IORING_OP_FALLOCATE:
+    case TARGET_IORING_OP_SEND:
+    case TARGET_IORING_OP_RECV:
+        return !ioprio;
+    case TARGET_IORING_OP_POLL_ADD:
+        return !ioprio && !off && !len;
+    case TARGET_IORING_OP_CLOSE:
+    case TARGET_IORING_OP_POLL_REMOVE:
+    case TARGET_IORING_OP_TIMEOUT_REMOVE:
+    case TARGET_IORING_OP_ASYNC_CANCEL:
+        return !ioprio && !off && !len && !op_flags;
+    case TARGET_IORING_OP_TIMEOUT:
+    case TARGET_IORING_OP_LINK_TIMEOUT:
+        return !ioprio && len == 1 &&
+               !(op_flags & ~TARGET_IORING_TIMEOUT_ABS);
+    default:
+        return true;
+    }
+}
+
+/* Translate @target_sqe into @sqe, returning 0 or a target errno.  */
+static int uring_prep(TargetUring *u, struct target_io_uring_sqe *target_sqe,
+                      struct io_uring_sqe *sqe)
+{
+    uint8_t opcode = target_sqe->opcode;
+    uint8_t flags = target_sqe->flags;
+    uint64_t addr = tswap64(target_sqe->addr);
+    uint32_t len = tswap32(target_sqe->len);
+    uint32_t op_flags = tswap32(target_sqe->op_flags);
+    uint16_t ioprio = tswap16(target_sqe->ioprio);
+    uint64_t off = tswap64(target_sqe->off);
+    struct target__kernel_timespec *target_ts;
+    UringReq *req;
+    int type;
+
+    if ((flags & ~TARGET_IOSQE_ALL) ||
+        !uring_sqe_valid(opcode, ioprio, off, len, op_flags)) {
+        return -TARGET_EINVAL;
+    }
+
+    memset(sqe, 0, sizeof(*sqe));
+    /* opcode numbers are not architecture-specific */
+    sqe->opcode = opcode;
+    sqe->flags = target_to_host_bitmask(flags, iosqe_flags_tbl);
+    sqe->ioprio = ioprio;
+    sqe->fd = tswap32(target_sqe->fd);
+    sqe->off = off;
+    sqe->addr = addr;
+    sqe->len = len;
+    sqe->rw_flags = op_flags;
+    sqe->buf_index = tswap16(target_sqe->buf_index);
+    sqe->personality = tswap16(target_sqe->personality);
+
+    req = g_new0(UringReq, 1);
+    req->user_data = tswap64(target_sqe->user_data);
+
+    switch (opcode) {
+    case TARGET_IORING_OP_NOP:
+    case TARGET_IORING_OP_FSYNC:
+    case TARGET_IORING_OP_SYNC_FILE_RANGE:
+    case TARGET_IORING_OP_FALLOCATE:
+    case TARGET_IORING_OP_CLOSE:
+        break;
+    case TARGET_IORING_OP_READV:
+    case TARGET_IORING_OP_WRITEV:
+        if (len) {
+            bool readv = opcode == TARGET_IORING_OP_READV;
+
+            req->iov = lock_iovec(readv ? VERIFY_WRITE : VERIFY_READ,
+                                  addr, len, !readv);
+            if (!req->iov) {
+                int err = host_to_target_errno(errno);
+
+                g_free(req);
+                return -err;
+            }
+        }
+        sqe->addr = (uintptr_t)req->iov;
+        break;
+    case TARGET_IORING_OP_READ_FIXED:
+    case TARGET_IORING_OP_READ:
+    case TARGET_IORING_OP_RECV:
+    case TARGET_IORING_OP_WRITE_FIXED:
+    case TARGET_IORING_OP_WRITE:
+    case TARGET_IORING_OP_SEND:
+        type = opcode == TARGET_IORING_OP_READ_FIXED ||
+               opcode == TARGET_IORING_OP_READ ||
+               opcode == TARGET_IORING_OP_RECV ? VERIFY_WRITE : VERIFY_READ;
+        if (!access_ok(type, addr, len)) {
+            g_free(req);
+            return -TARGET_EFAULT;
+        }
+        sqe->addr = (uintptr_t)g2h(addr);
+        break;
+    case TARGET_IORING_OP_POLL_ADD:
+        /*
+         * On big-endian hosts, the kernel swaps the halves of
+         * poll32_events, so that the 16-bit poll_events of older
+         * ABIs still lands in the low half.
+         */
+#ifdef TARGET_WORDS_BIGENDIAN
+        op_flags = rol32(op_flags, 16);
+#endif
+#ifdef HOST_WORDS_BIGENDIAN
+        op_flags = rol32(op_flags, 16);
+#endif
+        sqe->poll32_events = op_flags;
+        break;
+    case TARGET_IORING_OP_POLL_REMOVE:
+    case TARGET_IORING_OP_TIMEOUT_REMOVE:
+    case TARGET_IORING_OP_ASYNC_CANCEL:
+        sqe->addr = uring_find(u, addr);
+        break;
+    case TARGET_IORING_OP_TIMEOUT:
+    case TARGET_IORING_OP_LINK_TIMEOUT:
+        if (!lock_user_struct(VERIFY_READ, target_ts, addr, 1)) {
+            g_free(req);
+            return -TARGET_EFAULT;
+        }
+        __get_user(req->ts.tv_sec, &target_ts->tv_sec);
+        __get_user(req->ts.tv_nsec, &target_ts->tv_nsec);
+        unlock_user_struct(target_ts, addr, 0);
+        sqe->addr = (uintptr_t)&req->ts;
+        break;
+    case TARGET_IORING_OP_MADVISE:
+        /* ignored, like the madvise syscall */
+        sqe->opcode = IORING_OP_NOP;
+        break;
+    default:
+        g_free(req);
+        return -TARGET_EINVAL;
+    }
+
+    sqe->user_data = (uintptr_t)req;
+    QLIST_INSERT_HEAD(&u->reqs, req, next);
+    return 0;
+}
+
+/*
+ * Move up to @to_submit SQEs from the guest's ring to the host's, and
+ * submit them.  Returns the number of SQEs consumed, or a target errno.
+ */
+static abi_long uring_submit(TargetUring *u, uint32_t to_submit)
+{
+    uint32_t tail = tswap32(qatomic_load_acquire(&u->sq->tail));
+    uint32_t mask = u->p.sq_entries - 1;
+    uint32_t host_mask = *URING_HOST_SQ(u, ring_mask);
+    uint32_t host_tail = *URING_HOST_SQ(u, tail);
+    uint32_t *host_array = URING_HOST_SQ(u, array);
+    struct io_uring_sqe *prev = NULL;
+    uint32_t dropped = 0;
+    bool cancel = false;
+    uint32_t host_head;
+    uint32_t n;
+    int ret;
+
+    to_submit = MIN(to_submit, tail - u->sq_head);
+    for (n = 0; n < to_submit; n++) {
+        struct target_io_uring_sqe *target_sqe;
+        struct io_uring_sqe *sqe = NULL;
+        uint32_t idx;
+        int err;
+
+        host_head = qatomic_load_acquire(URING_HOST_SQ(u, head));
+        if (host_tail - host_head >= u->p.sq_entries) {
+            break;
+        }
+        idx = tswap32(u->sq->array[(u->sq_head + n) & mask]);
+        if (idx >= u->p.sq_entries) {
+            dropped++;
+            continue;
+        }
+        target_sqe = &u->sqes[idx];
+
+        /*
+         * If an SQE of a chain cannot be translated, fail the rest of
+         * the chain as the kernel would, and end it before the failure.
+         */
+        if (cancel) {
+            err = -TARGET_ECANCELED;
+        } else {
+            sqe = &u->host_sqes[host_tail & host_mask];
+            err = uring_prep(u, target_sqe, sqe);
+        }
+        if (err) {
+            uring_post_error(u, tswap64(target_sqe->user_data), err);
+            if (prev) {
+                prev->flags &= ~(IOSQE_IO_LINK | IOSQE_IO_HARDLINK);
+                prev = NULL;
+            }
+            cancel = target_sqe->flags &
+                     (TARGET_IOSQE_IO_LINK | TARGET_IOSQE_IO_HARDLINK);
+            continue;
+        }
+        prev = sqe->flags & (IOSQE_IO_LINK | IOSQE_IO_HARDLINK) ? sqe : NULL;
+        host_array[host_tail & host_mask] = host_tail & host_mask;
+        host_tail++;
     }
 
-    unlock_user(target_vec, target_addr, 0);
-    return vec;
+    u->sq_head += n;
+    qatomic_store_release(&u->sq->head, tswap32(u->sq_head));
+    if (dropped) {
+        qatomic_set(&u->sq->dropped,
+                    tswap32(tswap32(qatomic_read(&u->sq->dropped)) + dropped));
+    }
+    qatomic_store_release(URING_HOST_SQ(u, tail), host_tail);
 
- fail:
-    while (--i >= 0) {
-        if (tswapal(target_vec[i].iov_len) > 0) {
-            unlock_user(vec[i].iov_base, tswapal(target_vec[i].iov_base), 0);
+    /* this also retries SQEs the host could not take last time */
+    host_head = qatomic_load_acquire(URING_HOST_SQ(u, head));
+    if (host_tail != host_head) {
+        ret = syscall(__NR_io_uring_enter, u->fd, host_tail - host_head,
+                      0, 0, NULL, 0);
+        if (ret < 0 && n == 0) {
+            return get_errno(ret);
         }
     }
-    unlock_user(target_vec, target_addr, 0);
- fail2:
-    g_free(vec);
-    errno = err;
-    return NULL;
+    return n;
 }
 
-static void unlock_iovec(struct iovec *vec, abi_ulong target_addr,
-                         abi_ulong count, int copy)
+static abi_long do_io_uring_enter(int fd, abi_ulong to_submit,
+                                  abi_ulong min_complete, abi_ulong flags,
+                                  abi_ulong target_sig, abi_ulong sigsz)
 {
-    struct target_iovec *target_vec;
-    int i;
+    sigset_t _set, *set = NULL;
+    target_sigset_t *target_set;
+    TargetUring *u;
+    abi_long ret;
 
-    target_vec = lock_user(VERIFY_READ, target_addr,
-                           count * sizeof(struct target_iovec), 1);
-    if (target_vec) {
-        for (i = 0; i < count; i++) {
-            abi_ulong base = tswapal(target_vec[i].iov_base);
-            abi_long len = tswapal(target_vec[i].iov_len);
-            if (len < 0) {
+    if (flags & ~TARGET_IORING_ENTER_GETEVENTS) {
+        return -TARGET_EINVAL;
+    }
+    if (target_sig) {
+        if (sigsz != sizeof(target_sigset_t)) {
+            return -TARGET_EINVAL;
+        }
+        target_set = lock_user(VERIFY_READ, target_sig,
+                               sizeof(target_sigset_t), 1);
+        if (!target_set) {
+            return -TARGET_EFAULT;
+        }
+        set = &_set;
+        target_to_host_sigset(set, target_set);
+        unlock_user(target_set, target_sig, 0);
+    }
+
+    u = uring_lookup(fd);
+    if (!u) {
+        return -TARGET_EOPNOTSUPP;
+    }
+
+    qemu_mutex_lock(&u->lock);
+    ret = uring_submit(u, to_submit);
+    uring_reap(u);
+    if (!is_error(ret) && (flags & TARGET_IORING_ENTER_GETEVENTS)) {
+        while (uring_cq_ready(u) < min_complete) {
+            abi_long err;
+
+            qemu_mutex_unlock(&u->lock);
+            err = get_errno(safe_io_uring_enter(u->fd, 0, 1,
+                                                IORING_ENTER_GETEVENTS,
+                                                set, SIGSET_T_SIZE));
+            qemu_mutex_lock(&u->lock);
+            if (is_error(err)) {
+                ret = ret ? ret : err;
                 break;
             }
-            unlock_user(vec[i].iov_base, base, copy ? vec[i].iov_len : 0);
+            uring_reap(u);
         }
-        unlock_user(target_vec, target_addr, 0);
     }
+    qatomic_set(&u->sq->flags,
+                tswap32(QLIST_EMPTY(&u->reqs) ?
+                        0 : TARGET_IORING_SQ_CQ_OVERFLOW));
+    qemu_mutex_unlock(&u->lock);
+    uring_unref(u);
+    return ret;
+}
+
+static abi_long do_io_uring_register(int fd, unsigned int opcode,
+                                     abi_ulong arg, unsigned int nr_args)
+{
+    TargetUring *u = uring_lookup(fd);
+    struct iovec *vec;
+    int32_t *target_fds, *fds;
+    abi_long ret;
+    unsigned int i;
+
+    if (!u) {
+        return -TARGET_EOPNOTSUPP;
+    }
+    uring_unref(u);
+
+    switch (opcode) {
+    case TARGET_IORING_REGISTER_BUFFERS:
+        /* the host pins the guest's pages, whose addresses do not change */
+        vec = lock_iovec(VERIFY_WRITE, arg, nr_args, 0);
+        if (!vec) {
+            return -host_to_target_errno(errno);
+        }
+        ret = get_errno(syscall(__NR_io_uring_register, fd,
+                                IORING_REGISTER_BUFFERS, vec, nr_args));
+        unlock_iovec(vec, arg, nr_args, 0);
+        return ret;
+    case TARGET_IORING_REGISTER_FILES:
+        if (nr_args == 0 || nr_args > INT_MAX / sizeof(int32_t)) {
+            return -TARGET_EINVAL;
+        }
+        target_fds = lock_user(VERIFY_READ, arg, nr_args * sizeof(int32_t), 1);
+        if (!target_fds) {
+            return -TARGET_EFAULT;
+        }
+        fds = g_new(int32_t, nr_args);
+        for (i = 0; i < nr_args; i++) {
+            fds[i] = tswap32(target_fds[i]);
+        }
+        unlock_user(target_fds, arg, 0);
+        ret = get_errno(syscall(__NR_io_uring_register, fd,
+                                IORING_REGISTER_FILES, fds, nr_args));
+        g_free(fds);
+        return ret;
+    case TARGET_IORING_UNREGISTER_BUFFERS:
+    case TARGET_IORING_UNREGISTER_FILES:
+        if (arg || nr_args) {
+            return -TARGET_EINVAL;
+        }
+        return get_errno(syscall(__NR_io_uring_register, fd,
+                                 opcode == TARGET_IORING_UNREGISTER_BUFFERS ?
+                                 IORING_UNREGISTER_BUFFERS :
+                                 IORING_UNREGISTER_FILES, NULL, 0));
+    default:
+        /*
+         * Eventfds in particular are not supported: the host would
+         * signal them before completions are visible in the guest.
+         */
+        return -TARGET_EINVAL;
+    }
+}
+#else
+static inline void uring_close(int fd)
+{
+}
+#endif
 
-    g_free(vec);
+static abi_long do_mmap(abi_ulong start, abi_ulong len, int prot,
+                        int flags, int fd, abi_ulong offset)
+{
+#if defined(TARGET_NR_io_uring_setup) && defined(CONFIG_IO_URING_SYSCALLS)
+    if (!(flags & MAP_ANONYMOUS) && !uring_mmap_fd(&fd, &offset, len)) {
+        errno = EINVAL;
+        return -1;
+    }
+#endif
+    return target_mmap(start, len, prot, flags, fd, offset);
 }
 
 static inline int target_to_host_sock_type(int *type)
@@ -3306,6 +4292,55 @@ static abi_long do_connect(int sockfd, abi_ulong target_addr,
 }
 
 /* do_sendrecvmsg_locked() Must return target values and target errnos. */
+/*
+ * Set up MSG's name from the guest's header MSGP, converting it into
+ * NAME, which has room for msg_namelen + 1 bytes.
+ */
+static abi_long target_to_host_msgname(int fd, struct msghdr *msg,
+                                       struct target_msghdr *msgp,
+                                       void *name)
+{
+    abi_long ret;
+
+    if (!msgp->msg_name) {
+        msg->msg_name = NULL;
+        msg->msg_namelen = 0;
+        return 0;
+    }
+
+    msg->msg_namelen = tswap32(msgp->msg_namelen);
+    msg->msg_name = name;
+    ret = target_to_host_sockaddr(fd, msg->msg_name,
+                                  tswapal(msgp->msg_name),
+                                  msg->msg_namelen);
+    if (ret == -TARGET_EFAULT) {
+        /* For connected sockets msg_name and msg_namelen must
+         * be ignored, so returning EFAULT immediately is wrong.
+         * Instead, pass a bad msg_name to the host kernel, and
+         * let it decide whether to return EFAULT or not.
+         */
+        msg->msg_name = (void *)-1;
+        return 0;
+    }
+    return ret;
+}
+
+/*
+ * Copy the name and flags resulting from a host recvmsg to MSGP; the
+ * data and control messages are up to the caller.
+ */
+static abi_long host_to_target_msghdr(struct target_msghdr *msgp,
+                                      struct msghdr *msg)
+{
+    msgp->msg_namelen = tswap32(msg->msg_namelen);
+    msgp->msg_flags = tswap32(msg->msg_flags);
+    if (msg->msg_name != NULL && msg->msg_name != (void *)-1) {
+        return host_to_target_sockaddr(tswapal(msgp->msg_name),
+                                       msg->msg_name, msg->msg_namelen);
+    }
+    return 0;
+}
+
 static abi_long do_sendrecvmsg_locked(int fd, struct target_msghdr *msgp,
                                       int flags, int send)
 {
@@ -3314,31 +4349,26 @@ static abi_long do_sendrecvmsg_locked(int fd, struct target_msghdr *msgp,
     abi_ulong count;
     struct iovec *vec;
     abi_ulong target_vec;
+    size_t namelen = msgp->msg_name ? tswap32(msgp->msg_namelen) + 1 : 0;
+    void *buf;
 
-    if (msgp->msg_name) {
-        msg.msg_namelen = tswap32(msgp->msg_namelen);
-        msg.msg_name = alloca(msg.msg_namelen+1);
-        ret = target_to_host_sockaddr(fd, msg.msg_name,
-                                      tswapal(msgp->msg_name),
-                                      msg.msg_namelen);
-        if (ret == -TARGET_EFAULT) {
-            /* For connected sockets msg_name and msg_namelen must
-             * be ignored, so returning EFAULT immediately is wrong.
-             * Instead, pass a bad msg_name to the host kernel, and
-             * let it decide whether to return EFAULT or not.
-             */
-            msg.msg_name = (void *)-1;
-        } else if (ret) {
-            goto out2;
-        }
-    } else {
-        msg.msg_name = NULL;
-        msg.msg_namelen = 0;
+    if (tswapal(msgp->msg_controllen) > INT_MAX) {
+        /* as the kernel, which also keeps this from overflowing */
+        return -TARGET_ENOBUFS;
     }
     msg.msg_controllen = 2 * tswapal(msgp->msg_controllen);
-    msg.msg_control = alloca(msg.msg_controllen);
+    buf = scratch_get(msg.msg_controllen + namelen);
+    if (!buf) {
+        return -TARGET_ENOMEM;
+    }
+    msg.msg_control = buf;
     memset(msg.msg_control, 0, msg.msg_controllen);
 
+    ret = target_to_host_msgname(fd, &msg, msgp, buf + msg.msg_controllen);
+    if (ret) {
+        goto out2;
+    }
+
     msg.msg_flags = tswap32(msgp->msg_flags);
 
     count = tswapal(msgp->msg_iovlen);
@@ -3391,24 +4421,17 @@ static abi_long do_sendrecvmsg_locked(int fd, struct target_msghdr *msgp,
                 ret = host_to_target_cmsg(msgp, &msg);
             }
             if (!is_error(ret)) {
-                msgp->msg_namelen = tswap32(msg.msg_namelen);
-                msgp->msg_flags = tswap32(msg.msg_flags);
-                if (msg.msg_name != NULL && msg.msg_name != (void *)-1) {
-                    ret = host_to_target_sockaddr(tswapal(msgp->msg_name),
-                                    msg.msg_name, msg.msg_namelen);
-                    if (ret) {
-                        goto out;
-                    }
-                }
-
+                ret = host_to_target_msghdr(msgp, &msg);
+            }
+            if (!is_error(ret)) {
                 ret = len;
             }
         }
     }
 
-out:
     unlock_iovec(vec, target_vec, count, !send);
 out2:
+    scratch_put(buf);
     return ret;
 }
 
@@ -3436,6 +4459,144 @@ static abi_long do_sendrecvmsg(int fd, abi_ulong target_msg,
 #define MSG_WAITFORONE 0x10000
 #endif
 
+#if defined(__NR_sendmmsg) && defined(__NR_recvmmsg)
+/*
+ * Return the scratch memory needed to translate all VLEN headers at
+ * once, or 0 if the messages must go through do_sendrecvmsg_locked one
+ * by one: data translated by fd_trans, or unusual iovec counts whose
+ * errors are reported by the per-message path.
+ */
+static size_t mmsg_batch_size(int fd, struct target_mmsghdr *mmsgp,
+                              unsigned int vlen, int send)
+{
+    size_t size = QEMU_ALIGN_UP(vlen * sizeof(struct host_mmsghdr), 8);
+    unsigned int i;
+
+    if (send ? fd_trans_target_to_host_data(fd)
+             : fd_trans_host_to_target_data(fd)) {
+        return 0;
+    }
+    for (i = 0; i < vlen; i++) {
+        struct target_msghdr *msgp = &mmsgp[i].msg_hdr;
+        abi_ulong count = tswapal(msgp->msg_iovlen);
+        abi_ulong controllen = tswapal(msgp->msg_controllen);
+
+        if (count == 0 || count > IOV_MAX || controllen > SCRATCH_MAX) {
+            return 0;
+        }
+        size += QEMU_ALIGN_UP(count * sizeof(struct iovec), 8);
+        size += QEMU_ALIGN_UP(2 * controllen, 8);
+        if (msgp->msg_name) {
+            size += QEMU_ALIGN_UP((size_t)tswap32(msgp->msg_namelen) + 1, 8);
+        }
+        if (size > SCRATCH_MAX) {
+            return 0;
+        }
+    }
+    return size;
+}
+
+/*
+ * Translate all of the guest's message headers up front and hand them
+ * to the host's sendmmsg/recvmmsg in one go, rather than turning one
+ * guest syscall back into VLEN host ones.
+ */
+static abi_long do_sendrecvmmsg_batch(int fd, struct target_mmsghdr *mmsgp,
+                                      unsigned int vlen, unsigned int flags,
+                                      int send, size_t size)
+{
+    struct host_mmsghdr *hmsg = scratch_get(size);
+    size_t off = QEMU_ALIGN_UP(vlen * sizeof(*hmsg), 8);
+    unsigned int i, n;
+    abi_long ret = 0;
+    int err, done = 0;
+
+    if (!hmsg) {
+        return -TARGET_ENOMEM;
+    }
+
+    for (i = 0; i < vlen; i++) {
+        struct target_msghdr *msgp = &mmsgp[i].msg_hdr;
+        struct msghdr *msg = &hmsg[i].msg_hdr;
+
+        msg->msg_iovlen = tswapal(msgp->msg_iovlen);
+        msg->msg_iov = (void *)hmsg + off;
+        off += QEMU_ALIGN_UP(msg->msg_iovlen * sizeof(struct iovec), 8);
+        msg->msg_controllen = 2 * tswapal(msgp->msg_controllen);
+        msg->msg_control = (void *)hmsg + off;
+        off += QEMU_ALIGN_UP(msg->msg_controllen, 8);
+        memset(msg->msg_control, 0, msg->msg_controllen);
+        msg->msg_flags = tswap32(msgp->msg_flags);
+
+        ret = target_to_host_msgname(fd, msg, msgp, (void *)hmsg + off);
+        if (msgp->msg_name) {
+            off += QEMU_ALIGN_UP((size_t)tswap32(msgp->msg_namelen) + 1, 8);
+        }
+        if (ret) {
+            break;
+        }
+        err = lock_iovec_into(msg->msg_iov, send ? VERIFY_READ : VERIFY_WRITE,
+                              tswapal(msgp->msg_iov), msg->msg_iovlen, send);
+        if (err) {
+            ret = -host_to_target_errno(err);
+            break;
+        }
+        if (send) {
+            ret = target_to_host_cmsg(msg, msgp);
+            if (ret) {
+                unlock_iovec_into(msg->msg_iov, tswapal(msgp->msg_iov),
+                                  msg->msg_iovlen, 0);
+                break;
+            }
+        }
+    }
+    assert(off <= size);
+
+    /*
+     * As with the kernel, an error after the first message only ends
+     * the batch early: the messages before it are still transferred.
+     */
+    n = i;
+    if (n) {
+        if (send) {
+            ret = get_errno(safe_sendmmsg(fd, hmsg, n, flags));
+        } else {
+            ret = get_errno(safe_recvmmsg(fd, hmsg, n, flags, NULL));
+        }
+        if (!is_error(ret)) {
+            done = ret;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        struct target_msghdr *msgp = &mmsgp[i].msg_hdr;
+        struct msghdr *msg = &hmsg[i].msg_hdr;
+
+        if (i < done) {
+            abi_long r = 0;
+
+            if (!send) {
+                r = host_to_target_cmsg(msgp, msg);
+                if (!is_error(r)) {
+                    r = host_to_target_msghdr(msgp, msg);
+                }
+            }
+            if (is_error(r)) {
+                ret = r;
+                done = i;
+            } else {
+                mmsgp[i].msg_len = tswap32(hmsg[i].msg_len);
+            }
+        }
+        unlock_iovec_into(msg->msg_iov, tswapal(msgp->msg_iov),
+                          msg->msg_iovlen, !send && i < done);
+    }
+    scratch_put(hmsg);
+
+    return done ? done : ret;
+}
+#endif
+
 static abi_long do_sendrecvmmsg(int fd, abi_ulong target_msgvec,
                                 unsigned int vlen, unsigned int flags,
                                 int send)
@@ -3443,6 +4604,9 @@ static abi_long do_sendrecvmmsg(int fd, abi_ulong target_msgvec,
     struct target_mmsghdr *mmsgp;
     abi_long ret = 0;
     int i;
+#if defined(__NR_sendmmsg) && defined(__NR_recvmmsg)
+    size_t size;
+#endif
 
     if (vlen > UIO_MAXIOV) {
         vlen = UIO_MAXIOV;
@@ -3453,6 +4617,16 @@ static abi_long do_sendrecvmmsg(int fd, abi_ulong target_msgvec,
         return -TARGET_EFAULT;
     }
 
+#if defined(__NR_sendmmsg) && defined(__NR_recvmmsg)
+    size = mmsg_batch_size(fd, mmsgp, vlen, send);
+    if (size) {
+        ret = do_sendrecvmmsg_batch(fd, mmsgp, vlen, flags, send, size);
+        unlock_user(mmsgp, target_msgvec,
+                    sizeof(*mmsgp) * (is_error(ret) ? 0 : ret));
+        return ret;
+    }
+#endif
+
     for (i = 0; i < vlen; i++) {
         ret = do_sendrecvmsg_locked(fd, &mmsgp[i].msg_hdr, flags, send);
         if (is_error(ret)) {
@@ -7526,60 +8700,38 @@ static int do_safe_futex(int *uaddr, int op, int val,
    futexes locally would make futexes shared between multiple processes
    tricky.  However they're probably useless because guest atomic
    operations won't work either.  */
-#if defined(TARGET_NR_futex)
-static int do_futex(target_ulong uaddr, int op, int val, target_ulong timeout,
-                    target_ulong uaddr2, int val3)
+#if defined(TARGET_NR_futex) || defined(TARGET_NR_futex_time64)
+/*
+ * The futex word is handed to the host kernel by address, so the only
+ * checks needed are that it lies within the guest address space and is
+ * aligned; both are computed without taking mmap_lock or walking the
+ * page table, so that contended guest locks scale like native ones.
+ * Whether the page is actually mapped is left to the host kernel,
+ * which reports EFAULT just as it would to the guest.
+ */
+static void *futex_addr(target_ulong addr)
 {
-    struct timespec ts, *pts;
-    int base_op;
-
-    /* ??? We assume FUTEX_* constants are the same on both host
-       and target.  */
-#ifdef FUTEX_CMD_MASK
-    base_op = op & FUTEX_CMD_MASK;
-#else
-    base_op = op;
-#endif
-    switch (base_op) {
-    case FUTEX_WAIT:
-    case FUTEX_WAIT_BITSET:
-        if (timeout) {
-            pts = &ts;
-            target_to_host_timespec(pts, timeout);
-        } else {
-            pts = NULL;
-        }
-        return do_safe_futex(g2h(uaddr), op, tswap32(val), pts, NULL, val3);
-    case FUTEX_WAKE:
-        return do_safe_futex(g2h(uaddr), op, val, NULL, NULL, 0);
-    case FUTEX_FD:
-        return do_safe_futex(g2h(uaddr), op, val, NULL, NULL, 0);
-    case FUTEX_REQUEUE:
-    case FUTEX_CMP_REQUEUE:
-    case FUTEX_WAKE_OP:
-        /* For FUTEX_REQUEUE, FUTEX_CMP_REQUEUE, and FUTEX_WAKE_OP, the
-           TIMEOUT parameter is interpreted as a uint32_t by the kernel.
-           But the prototype takes a `struct timespec *'; insert casts
-           to satisfy the compiler.  We do not need to tswap TIMEOUT
-           since it's not compared to guest memory.  */
-        pts = (struct timespec *)(uintptr_t) timeout;
-        return do_safe_futex(g2h(uaddr), op, val, pts, g2h(uaddr2),
-                             (base_op == FUTEX_CMP_REQUEUE
-                                      ? tswap32(val3)
-                                      : val3));
-    default:
-        return -TARGET_ENOSYS;
+    if (!guest_addr_valid(addr) || !guest_addr_valid(addr + 3)) {
+        return NULL;
     }
+    return g2h(addr);
 }
-#endif
 
-#if defined(TARGET_NR_futex_time64)
-static int do_futex_time64(target_ulong uaddr, int op, int val, target_ulong timeout,
-                           target_ulong uaddr2, int val3)
+static int do_futex(bool time64, target_ulong uaddr, int op, int val,
+                    target_ulong timeout, target_ulong uaddr2, int val3)
 {
-    struct timespec ts, *pts;
+    struct timespec ts, *pts = NULL;
+    int *haddr, *haddr2 = NULL;
     int base_op;
 
+    if (uaddr & 3) {
+        return -TARGET_EINVAL;
+    }
+    haddr = futex_addr(uaddr);
+    if (!haddr) {
+        return -TARGET_EFAULT;
+    }
+
     /* ??? We assume FUTEX_* constants are the same on both host
        and target.  */
 #ifdef FUTEX_CMD_MASK
@@ -7590,35 +8742,64 @@ static int do_futex_time64(target_ulong uaddr, int op, int val, target_ulong tim
     switch (base_op) {
     case FUTEX_WAIT:
     case FUTEX_WAIT_BITSET:
-        if (timeout) {
-            pts = &ts;
-            if (target_to_host_timespec64(pts, timeout)) {
-                return -TARGET_EFAULT;
-            }
-        } else {
-            pts = NULL;
-        }
-        return do_safe_futex(g2h(uaddr), op, tswap32(val), pts, NULL, val3);
+        val = tswap32(val);
+        break;
     case FUTEX_WAKE:
-        return do_safe_futex(g2h(uaddr), op, val, NULL, NULL, 0);
+    case FUTEX_WAKE_BITSET:
+        timeout = 0;
+        break;
     case FUTEX_FD:
-        return do_safe_futex(g2h(uaddr), op, val, NULL, NULL, 0);
-    case FUTEX_REQUEUE:
+        val = target_to_host_signal(val);
+        timeout = 0;
+        break;
+#if TARGET_SAME_ENDIAN
+    /*
+     * The kernel stores TIDs into the futex word of a PI lock, which is
+     * only meaningful to the guest if both sides agree on byte order.
+     */
+    case FUTEX_LOCK_PI:
+        break;
+    case FUTEX_TRYLOCK_PI:
+    case FUTEX_UNLOCK_PI:
+        timeout = 0;
+        break;
+    case FUTEX_WAIT_REQUEUE_PI:
+        val = tswap32(val);
+        if ((uaddr2 & 3) || !(haddr2 = futex_addr(uaddr2))) {
+            return -TARGET_EFAULT;
+        }
+        break;
+    case FUTEX_CMP_REQUEUE_PI:
+#endif
     case FUTEX_CMP_REQUEUE:
+        val3 = tswap32(val3);
+        /* fall through */
+    case FUTEX_REQUEUE:
     case FUTEX_WAKE_OP:
         /* For FUTEX_REQUEUE, FUTEX_CMP_REQUEUE, and FUTEX_WAKE_OP, the
            TIMEOUT parameter is interpreted as a uint32_t by the kernel.
            But the prototype takes a `struct timespec *'; insert casts
            to satisfy the compiler.  We do not need to tswap TIMEOUT
            since it's not compared to guest memory.  */
-        pts = (struct timespec *)(uintptr_t) timeout;
-        return do_safe_futex(g2h(uaddr), op, val, pts, g2h(uaddr2),
-                             (base_op == FUTEX_CMP_REQUEUE
-                                      ? tswap32(val3)
-                                      : val3));
+        pts = (struct timespec *)(uintptr_t)timeout;
+        timeout = 0;
+        if ((uaddr2 & 3) || !(haddr2 = futex_addr(uaddr2))) {
+            return -TARGET_EFAULT;
+        }
+        break;
     default:
         return -TARGET_ENOSYS;
     }
+
+    if (timeout) {
+        pts = &ts;
+        if (time64
+            ? target_to_host_timespec64(pts, timeout)
+            : target_to_host_timespec(pts, timeout)) {
+            return -TARGET_EFAULT;
+        }
+    }
+    return do_safe_futex(haddr, op, val, pts, haddr2, val3);
 }
 #endif
 
@@ -8210,6 +9391,7 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
                 do_sys_futex(g2h(ts->child_tidptr), FUTEX_WAKE, INT_MAX,
                           NULL, NULL, 0);
             }
+            free_thread_scratch();
             thread_cpu = NULL;
             g_free(ts);
             rcu_unregister_thread();
@@ -8287,6 +9469,7 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
 #endif
     case TARGET_NR_close:
         fd_trans_unregister(arg1);
+        uring_close(arg1);
         return get_errno(close(arg1));
 
     case TARGET_NR_brk:
@@ -8856,7 +10039,9 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
 #ifdef TARGET_NR_dup2
     case TARGET_NR_dup2:
         ret = get_errno(dup2(arg1, arg2));
-        if (ret >= 0) {
+        if (ret >= 0 && arg1 != arg2) {
+            /* whatever arg2 referred to has been closed */
+            uring_close(arg2);
             fd_trans_dup(arg1, arg2);
         }
         return ret;
@@ -8872,6 +10057,7 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
         host_flags = target_to_host_bitmask(arg3, fcntl_flags_tbl);
         ret = get_errno(dup3(arg1, arg2, host_flags));
         if (ret >= 0) {
+            uring_close(arg2);
             fd_trans_dup(arg1, arg2);
         }
         return ret;
@@ -9624,15 +10810,15 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
             v5 = tswapal(v[4]);
             v6 = tswapal(v[5]);
             unlock_user(v, arg1, 0);
-            ret = get_errno(target_mmap(v1, v2, v3,
-                                        target_to_host_bitmask(v4, mmap_flags_tbl),
-                                        v5, v6));
+            ret = get_errno(do_mmap(v1, v2, v3,
+                                    target_to_host_bitmask(v4, mmap_flags_tbl),
+                                    v5, v6));
         }
 #else
-        ret = get_errno(target_mmap(arg1, arg2, arg3,
-                                    target_to_host_bitmask(arg4, mmap_flags_tbl),
-                                    arg5,
-                                    arg6));
+        ret = get_errno(do_mmap(arg1, arg2, arg3,
+                                target_to_host_bitmask(arg4, mmap_flags_tbl),
+                                arg5,
+                                arg6));
 #endif
         return ret;
 #endif
@@ -9641,9 +10827,9 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
 #ifndef MMAP_SHIFT
 #define MMAP_SHIFT 12
 #endif
-        ret = target_mmap(arg1, arg2, arg3,
-                          target_to_host_bitmask(arg4, mmap_flags_tbl),
-                          arg5, arg6 << MMAP_SHIFT);
+        ret = do_mmap(arg1, arg2, arg3,
+                      target_to_host_bitmask(arg4, mmap_flags_tbl),
+                      arg5, arg6 << MMAP_SHIFT);
         return get_errno(ret);
 #endif
     case TARGET_NR_munmap:
@@ -12254,11 +13440,11 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
 #endif
 #ifdef TARGET_NR_futex
     case TARGET_NR_futex:
-        return do_futex(arg1, arg2, arg3, arg4, arg5, arg6);
+        return do_futex(false, arg1, arg2, arg3, arg4, arg5, arg6);
 #endif
 #ifdef TARGET_NR_futex_time64
     case TARGET_NR_futex_time64:
-        return do_futex_time64(arg1, arg2, arg3, arg4, arg5, arg6);
+        return do_futex(true, arg1, arg2, arg3, arg4, arg5, arg6);
 #endif
 #if defined(TARGET_NR_inotify_init) && defined(__NR_inotify_init)
     case TARGET_NR_inotify_init:
@@ -12595,13 +13781,17 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
                 if (!lock_user_struct(VERIFY_READ, target_ep, arg4, 1)) {
                     return -TARGET_EFAULT;
                 }
-                ep.events = tswap32(target_ep->events);
-                /*
-                 * The epoll_data_t union is just opaque data to the kernel,
-                 * so we transfer all 64 bits across and need not worry what
-                 * actual data type it is.
-                 */
-                ep.data.u64 = tswap64(target_ep->data.u64);
+                if (TARGET_EPOLL_EVENT_SAME) {
+                    memcpy(&ep, target_ep, sizeof(ep));
+                } else {
+                    ep.events = tswap32(target_ep->events);
+                    /*
+                     * The epoll_data_t union is just opaque data to the
+                     * kernel, so we transfer all 64 bits across and need
+                     * not worry what actual data type it is.
+                     */
+                    ep.data.u64 = tswap64(target_ep->data.u64);
+                }
                 unlock_user_struct(target_ep, arg4, 0);
             }
             /*
@@ -12639,10 +13829,15 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
             return -TARGET_EFAULT;
         }
 
-        ep = g_try_new(struct epoll_event, maxevents);
-        if (!ep) {
-            unlock_user(target_ep, arg2, 0);
-            return -TARGET_ENOMEM;
+        if (TARGET_EPOLL_EVENT_SAME) {
+            /* the host fills in the events straight into guest memory */
+            ep = (struct epoll_event *)target_ep;
+        } else {
+            ep = g_try_new(struct epoll_event, maxevents);
+            if (!ep) {
+                unlock_user(target_ep, arg2, 0);
+                return -TARGET_ENOMEM;
+            }
         }
 
         switch (num) {
@@ -12686,7 +13881,7 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
         }
         if (!is_error(ret)) {
             int i;
-            for (i = 0; i < ret; i++) {
+            for (i = 0; i < ret && !TARGET_EPOLL_EVENT_SAME; i++) {
                 target_ep[i].events = tswap32(ep[i].events);
                 target_ep[i].data.u64 = tswap64(ep[i].data.u64);
             }
@@ -12695,7 +13890,9 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
         } else {
             unlock_user(target_ep, arg2, 0);
         }
-        g_free(ep);
+        if (!TARGET_EPOLL_EVENT_SAME) {
+            g_free(ep);
+        }
         return ret;
     }
 #endif
@@ -13064,6 +14261,16 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
     case TARGET_NR_membarrier:
         return get_errno(membarrier(arg1, arg2));
 #endif
+#if defined(TARGET_NR_io_uring_setup) && defined(CONFIG_IO_URING_SYSCALLS)
+    case TARGET_NR_io_uring_setup:
+        ret = do_io_uring_setup(arg1, arg2);
+        fd_trans_unregister(ret);
+        return ret;
+    case TARGET_NR_io_uring_enter:
+        return do_io_uring_enter(arg1, arg2, arg3, arg4, arg5, arg6);
+    case TARGET_NR_io_uring_register:
+        return do_io_uring_register(arg1, arg2, arg3, arg4);
+#endif
 
     default:
         qemu_log_mask(LOG_UNIMP, "Unsupported syscall: %d\n", num);
@@ -2750,6 +2750,8 @@ struct target_drm_i915_getparam {
 #define FUTEX_TRYLOCK_PI        8
 #define FUTEX_WAIT_BITSET       9
 #define FUTEX_WAKE_BITSET       10
+#define FUTEX_WAIT_REQUEUE_PI   11
+#define FUTEX_CMP_REQUEUE_PI    12
 
 #define FUTEX_PRIVATE_FLAG      128
 #define FUTEX_CLOCK_REALTIME    256
@@ -2777,6 +2779,121 @@ struct target_epoll_event {
 #define TARGET_EP_MAX_EVENTS (INT_MAX / sizeof(struct target_epoll_event))
 
 #endif
+
+/*
+ * io_uring.  The ABI does not depend on the architecture, except for
+ * endianness; the structures only use fixed-size fields.
+ */
+#define TARGET_IORING_SETUP_CQSIZE      (1U << 3)
+#define TARGET_IORING_SETUP_CLAMP       (1U << 4)
+
+#define TARGET_IORING_FEAT_SUBMIT_STABLE (1U << 2)
+#define TARGET_IORING_FEAT_RW_CUR_POS   (1U << 3)
+
+#define TARGET_IORING_SQ_CQ_OVERFLOW    (1U << 1)
+
+#define TARGET_IORING_ENTER_GETEVENTS   (1U << 0)
+
+#define TARGET_IORING_OFF_SQ_RING       0ULL
+#define TARGET_IORING_OFF_CQ_RING       0x8000000ULL
+#define TARGET_IORING_OFF_SQES          0x10000000ULL
+
+#define TARGET_IOSQE_FIXED_FILE         (1U << 0)
+#define TARGET_IOSQE_IO_DRAIN           (1U << 1)
+#define TARGET_IOSQE_IO_LINK            (1U << 2)
+#define TARGET_IOSQE_IO_HARDLINK        (1U << 3)
+#define TARGET_IOSQE_ASYNC              (1U << 4)
+
+#define TARGET_IORING_OP_NOP            0
+#define TARGET_IORING_OP_READV          1
+#define TARGET_IORING_OP_WRITEV         2
+#define TARGET_IORING_OP_FSYNC          3
+#define TARGET_IORING_OP_READ_FIXED     4
+#define TARGET_IORING_OP_WRITE_FIXED    5
+#define TARGET_IORING_OP_POLL_ADD       6
+#define TARGET_IORING_OP_POLL_REMOVE    7
+#define TARGET_IORING_OP_SYNC_FILE_RANGE 8
+#define TARGET_IORING_OP_TIMEOUT        11
+#define TARGET_IORING_OP_TIMEOUT_REMOVE 12
+#define TARGET_IORING_OP_ASYNC_CANCEL   14
+#define TARGET_IORING_OP_LINK_TIMEOUT   15
+#define TARGET_IORING_OP_FALLOCATE      17
+#define TARGET_IORING_OP_CLOSE          19
+#define TARGET_IORING_OP_READ           22
+#define TARGET_IORING_OP_WRITE          23
+#define TARGET_IORING_OP_MADVISE        25
+#define TARGET_IORING_OP_SEND           26
+#define TARGET_IORING_OP_RECV           27
+
+/* the op_flags accepted for each opcode */
+#define TARGET_IORING_RWF_ALL           0x1fU   /* RWF_HIPRI ... RWF_APPEND */
+#define TARGET_IORING_FSYNC_DATASYNC    (1U << 0)
+#define TARGET_IORING_SYNC_RANGE_ALL    0x7U    /* SYNC_FILE_RANGE_* */
+#define TARGET_IORING_TIMEOUT_ABS       (1U << 0)
+
+#define TARGET_IORING_REGISTER_BUFFERS      0
+#define TARGET_IORING_UNREGISTER_BUFFERS    1
+#define TARGET_IORING_REGISTER_FILES        2
+#define TARGET_IORING_UNREGISTER_FILES      3
+
+struct target_io_uring_sqe {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t ioprio;
+    int32_t fd;
+    uint64_t off;
+    uint64_t addr;
+    uint32_t len;
+    uint32_t op_flags;
+    uint64_t user_data;
+    uint16_t buf_index;
+    uint16_t personality;
+    int32_t splice_fd_in;
+    uint64_t pad[2];
+};
+
+struct target_io_uring_cqe {
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+};
+
+struct target_io_sqring_offsets {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t flags;
+    uint32_t dropped;
+    uint32_t array;
+    uint32_t resv1;
+    uint64_t resv2;
+};
+
+struct target_io_cqring_offsets {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t overflow;
+    uint32_t cqes;
+    uint32_t flags;
+    uint32_t resv1;
+    uint64_t resv2;
+};
+
+struct target_io_uring_params {
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t flags;
+    uint32_t sq_thread_cpu;
+    uint32_t sq_thread_idle;
+    uint32_t features;
+    uint32_t wq_fd;
+    uint32_t resv[3];
+    struct target_io_sqring_offsets sq_off;
+    struct target_io_cqring_offsets cq_off;
+};
 struct target_rlimit64 {
     uint64_t rlim_cur;
     uint64_t rlim_max;
@@ -41,6 +41,7 @@
 #include "tcg/tcg.h"
 #include "exec/exec-all.h"
 #include "disas/disas.h"
+#include "exec/gdbstub.h"
 #include "plugin.h"
 #ifndef CONFIG_USER_ONLY
 #include "qemu/plugin-memory.h"
@@ -95,6 +96,52 @@ void qemu_plugin_register_vcpu_tb_exec_inline(struct qemu_plugin_tb *tb,
     plugin_register_inline_op(&tb->cbs[PLUGIN_CB_INLINE], 0, op, ptr, imm);
 }
 
+void qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
+    struct qemu_plugin_tb *tb,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    uint64_t imm)
+{
+    plugin_register_inline_op_on_entry(&tb->cbs[PLUGIN_CB_INLINE], 0, op,
+                                       entry, imm);
+}
+
+/*
+ * A condition that always holds is just a regular callback, and one that
+ * never does needs no code at all.
+ */
+static void register_cond_cb(GArray **cond_arr, GArray **regular_arr,
+                             qemu_plugin_vcpu_udata_cb_t cb,
+                             enum qemu_plugin_cb_flags flags,
+                             enum qemu_plugin_cond cond,
+                             qemu_plugin_u64 entry, uint64_t imm,
+                             void *udata)
+{
+    switch (cond) {
+    case QEMU_PLUGIN_COND_NEVER:
+        break;
+    case QEMU_PLUGIN_COND_ALWAYS:
+        plugin_register_dyn_cb__udata(regular_arr, cb, flags, udata);
+        break;
+    default:
+        plugin_register_dyn_cond_cb__udata(cond_arr, cb, flags, cond,
+                                           entry, imm, udata);
+        break;
+    }
+}
+
+void qemu_plugin_register_vcpu_tb_exec_cond_cb(struct qemu_plugin_tb *tb,
+                                               qemu_plugin_vcpu_udata_cb_t cb,
+                                               enum qemu_plugin_cb_flags flags,
+                                               enum qemu_plugin_cond cond,
+                                               qemu_plugin_u64 entry,
+                                               uint64_t imm,
+                                               void *udata)
+{
+    register_cond_cb(&tb->cbs[PLUGIN_CB_COND], &tb->cbs[PLUGIN_CB_REGULAR],
+                     cb, flags, cond, entry, imm, udata);
+}
+
 void qemu_plugin_register_vcpu_insn_exec_cb(struct qemu_plugin_insn *insn,
                                             qemu_plugin_vcpu_udata_cb_t cb,
                                             enum qemu_plugin_cb_flags flags,
@@ -112,6 +159,30 @@ void qemu_plugin_register_vcpu_insn_exec_inline(struct qemu_plugin_insn *insn,
                               0, op, ptr, imm);
 }
 
+void qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu(
+    struct qemu_plugin_insn *insn,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    uint64_t imm)
+{
+    plugin_register_inline_op_on_entry(
+        &insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_INLINE], 0, op, entry, imm);
+}
+
+void qemu_plugin_register_vcpu_insn_exec_cond_cb(
+    struct qemu_plugin_insn *insn,
+    qemu_plugin_vcpu_udata_cb_t cb,
+    enum qemu_plugin_cb_flags flags,
+    enum qemu_plugin_cond cond,
+    qemu_plugin_u64 entry,
+    uint64_t imm,
+    void *udata)
+{
+    register_cond_cb(&insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_COND],
+                     &insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_REGULAR],
+                     cb, flags, cond, entry, imm, udata);
+}
+
 
 
 void qemu_plugin_register_vcpu_mem_cb(struct qemu_plugin_insn *insn,
@@ -133,6 +204,42 @@ void qemu_plugin_register_vcpu_mem_inline(struct qemu_plugin_insn *insn,
         rw, op, ptr, imm);
 }
 
+void qemu_plugin_register_vcpu_mem_inline_per_vcpu(
+    struct qemu_plugin_insn *insn,
+    enum qemu_plugin_mem_rw rw,
+    enum qemu_plugin_op op,
+    qemu_plugin_u64 entry,
+    uint64_t imm)
+{
+    plugin_register_inline_op_on_entry(
+        &insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_INLINE], rw, op, entry, imm);
+}
+
+struct qemu_plugin_trace *
+qemu_plugin_trace_new(qemu_plugin_vcpu_trace_flush_cb_t cb, void *udata)
+{
+    return plugin_trace_new(cb, udata);
+}
+
+void qemu_plugin_register_vcpu_insn_exec_buffered(
+    struct qemu_plugin_insn *insn,
+    struct qemu_plugin_trace *trace,
+    uint64_t data)
+{
+    plugin_register_buffered(&insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_BUFFERED],
+                             &insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_COND],
+                             0, trace, insn->vaddr, data);
+}
+
+void qemu_plugin_register_vcpu_mem_buffered(struct qemu_plugin_insn *insn,
+                                            enum qemu_plugin_mem_rw rw,
+                                            struct qemu_plugin_trace *trace)
+{
+    plugin_register_buffered(&insn->cbs[PLUGIN_CB_MEM][PLUGIN_CB_BUFFERED],
+                             &insn->cbs[PLUGIN_CB_INSN][PLUGIN_CB_COND],
+                             rw, trace, insn->vaddr, 0);
+}
+
 void qemu_plugin_register_vcpu_tb_trans_cb(qemu_plugin_id_t id,
                                            qemu_plugin_vcpu_tb_trans_cb_t cb)
 {
@@ -333,6 +440,122 @@ int qemu_plugin_n_max_vcpus(void)
 #endif
 }
 
+/*
+ * Scoreboards
+ */
+
+struct qemu_plugin_scoreboard *qemu_plugin_scoreboard_new(size_t element_size)
+{
+    return plugin_scoreboard_new(element_size);
+}
+
+void qemu_plugin_scoreboard_free(struct qemu_plugin_scoreboard *score)
+{
+    plugin_scoreboard_free(score);
+}
+
+void *qemu_plugin_scoreboard_find(struct qemu_plugin_scoreboard *score,
+                                  unsigned int vcpu_index)
+{
+    g_assert(vcpu_index < score->data->len);
+    return score->data->data +
+           vcpu_index * g_array_get_element_size(score->data);
+}
+
+static uint64_t *plugin_u64_address(qemu_plugin_u64 entry,
+                                    unsigned int vcpu_index)
+{
+    return qemu_plugin_scoreboard_find(entry.score, vcpu_index) +
+           entry.offset;
+}
+
+void qemu_plugin_u64_add(qemu_plugin_u64 entry, unsigned int vcpu_index,
+                         uint64_t added)
+{
+    *plugin_u64_address(entry, vcpu_index) += added;
+}
+
+uint64_t qemu_plugin_u64_get(qemu_plugin_u64 entry, unsigned int vcpu_index)
+{
+    return *plugin_u64_address(entry, vcpu_index);
+}
+
+void qemu_plugin_u64_set(qemu_plugin_u64 entry, unsigned int vcpu_index,
+                         uint64_t val)
+{
+    *plugin_u64_address(entry, vcpu_index) = val;
+}
+
+uint64_t qemu_plugin_u64_sum(qemu_plugin_u64 entry)
+{
+    uint64_t total = 0;
+    unsigned int i;
+
+    for (i = 0; i < entry.score->data->len; i++) {
+        total += qemu_plugin_u64_get(entry, i);
+    }
+    return total;
+}
+
+/*
+ * Register and memory access
+ *
+ * Register handles are gdb register numbers, offset by one so that a
+ * valid handle is never NULL.
+ */
+
+static struct qemu_plugin_register *gdb_reg_to_handle(int gdb_reg)
+{
+    return GINT_TO_POINTER(gdb_reg + 1);
+}
+
+static int handle_to_gdb_reg(struct qemu_plugin_register *handle)
+{
+    return GPOINTER_TO_INT(handle) - 1;
+}
+
+GArray *qemu_plugin_get_registers(void)
+{
+    g_autoptr(GArray) regs = NULL;
+    GArray *descs;
+    guint i;
+
+    g_assert(current_cpu);
+    regs = gdb_get_register_list(current_cpu);
+    descs = g_array_sized_new(false, false,
+                              sizeof(qemu_plugin_reg_descriptor), regs->len);
+    for (i = 0; i < regs->len; i++) {
+        GDBRegDesc *reg = &g_array_index(regs, GDBRegDesc, i);
+        qemu_plugin_reg_descriptor desc = {
+            .handle = gdb_reg_to_handle(reg->gdb_reg),
+            .name = reg->name,
+            .feature = reg->feature_name,
+        };
+
+        g_array_append_val(descs, desc);
+    }
+    return descs;
+}
+
+int qemu_plugin_read_register(struct qemu_plugin_register *handle,
+                              GByteArray *buf)
+{
+    g_assert(current_cpu);
+    return gdb_read_register(current_cpu, buf, handle_to_gdb_reg(handle));
+}
+
+bool qemu_plugin_read_memory_vaddr(uint64_t addr, GByteArray *data,
+                                   size_t len)
+{
+    g_assert(current_cpu);
+
+    if (len == 0 || (target_ulong)addr != addr) {
+        return false;
+    }
+    g_byte_array_set_size(data, len);
+    return cpu_memory_rw_debug(current_cpu, addr, data->data, len, false) == 0;
+}
+
 /*
  * Plugin output
  */
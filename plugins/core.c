@@ -194,10 +194,161 @@ plugin_register_cb_udata(qemu_plugin_id_t id, enum qemu_plugin_event ev,
     do_plugin_register_cb(id, ev, func, udata);
 }
 
+static size_t plugin_scoreboard_alloc_size__locked(void)
+{
+    if (plugin.scoreboard_alloc_size == 0) {
+        /* in system mode we know up front how many vCPUs there can be */
+        plugin.scoreboard_alloc_size = MAX(qemu_plugin_n_max_vcpus(), 16);
+    }
+    return plugin.scoreboard_alloc_size;
+}
+
+/*
+ * Make room for @cpu in all scoreboards. Translated code embeds the
+ * scoreboards' addresses, so they can only move while all vCPUs are
+ * stopped, and the code cache has to be flushed afterwards.
+ *
+ * This only happens in user-mode, from the thread creating the new vCPU;
+ * in system mode the scoreboards are sized for max_cpus from the start.
+ */
+static void plugin_grow_scoreboards(CPUState *cpu)
+{
+    struct qemu_plugin_scoreboard *score;
+    size_t size;
+    bool realloc;
+
+    qemu_rec_mutex_lock(&plugin.lock);
+    size = plugin_scoreboard_alloc_size__locked();
+    if (cpu->cpu_index < size) {
+        qemu_rec_mutex_unlock(&plugin.lock);
+        return;
+    }
+    while (cpu->cpu_index >= size) {
+        size *= 2;
+    }
+    plugin.scoreboard_alloc_size = size;
+    realloc = !QLIST_EMPTY(&plugin.scoreboards);
+    qemu_rec_mutex_unlock(&plugin.lock);
+
+    if (!realloc) {
+        return;
+    }
+
+    /* do not hold plugin.lock while waiting; vCPUs might be waiting on it */
+    g_assert(current_cpu);
+    start_exclusive();
+    qemu_rec_mutex_lock(&plugin.lock);
+    QLIST_FOREACH(score, &plugin.scoreboards, entry) {
+        g_array_set_size(score->data, plugin.scoreboard_alloc_size);
+    }
+    qemu_rec_mutex_unlock(&plugin.lock);
+    tb_flush(current_cpu);
+    end_exclusive();
+}
+
+struct qemu_plugin_scoreboard *plugin_scoreboard_new(size_t element_size)
+{
+    struct qemu_plugin_scoreboard *score;
+    size_t size;
+
+    g_assert(element_size);
+    score = g_new0(struct qemu_plugin_scoreboard, 1);
+
+    QEMU_LOCK_GUARD(&plugin.lock);
+    size = plugin_scoreboard_alloc_size__locked();
+    score->data = g_array_sized_new(false, true, element_size, size);
+    g_array_set_size(score->data, size);
+    QLIST_INSERT_HEAD(&plugin.scoreboards, score, entry);
+    return score;
+}
+
+void plugin_scoreboard_free(struct qemu_plugin_scoreboard *score)
+{
+    qemu_rec_mutex_lock(&plugin.lock);
+    QLIST_REMOVE(score, entry);
+    qemu_rec_mutex_unlock(&plugin.lock);
+
+    g_array_free(score->data, true);
+    g_free(score);
+}
+
+struct qemu_plugin_trace *plugin_trace_new(qemu_plugin_vcpu_trace_flush_cb_t cb,
+                                           void *udata)
+{
+    struct qemu_plugin_trace *trace = g_new0(struct qemu_plugin_trace, 1);
+
+    trace->score = plugin_scoreboard_new(sizeof(struct plugin_trace_buf));
+    trace->cb = cb;
+    trace->udata = udata;
+
+    QEMU_LOCK_GUARD(&plugin.lock);
+    QLIST_INSERT_HEAD(&plugin.traces, trace, entry);
+    return trace;
+}
+
+static struct plugin_trace_buf *
+plugin_trace_buf(struct qemu_plugin_trace *trace, unsigned int cpu_index)
+{
+    GArray *data = trace->score->data;
+
+    return (void *)(data->data + cpu_index * g_array_get_element_size(data));
+}
+
+static void plugin_trace_flush(struct qemu_plugin_trace *trace,
+                               unsigned int cpu_index)
+{
+    struct plugin_trace_buf *buf = plugin_trace_buf(trace, cpu_index);
+    size_t n = MIN(buf->n, PLUGIN_TRACE_BUF_SLOTS);
+
+    if (n) {
+        trace->cb(cpu_index, buf->recs, n, trace->udata);
+    }
+    buf->n = 0;
+}
+
+/* called from translated code once the buffer is due for a flush */
+static void plugin_trace_flush_cb(unsigned int cpu_index, void *udata)
+{
+    plugin_trace_flush(udata, cpu_index);
+}
+
+/* append a record for an access performed from a helper */
+static void plugin_trace_append_mem(struct qemu_plugin_dyn_cb *cb,
+                                    unsigned int cpu_index,
+                                    uint64_t vaddr, uint32_t info)
+{
+    struct plugin_trace_buf *buf;
+    qemu_plugin_trace_record *rec;
+
+    buf = cb->userp + cpu_index * cb->buffered.stride;
+    if (buf->n >= PLUGIN_TRACE_BUF_FLUSH) {
+        plugin_trace_flush(cb->buffered.trace, cpu_index);
+    }
+    rec = &buf->recs[buf->n++ & (PLUGIN_TRACE_BUF_SLOTS - 1)];
+    rec->pc = cb->buffered.pc;
+    rec->vaddr = vaddr;
+    rec->info = info;
+    rec->type = QEMU_PLUGIN_TRACE_MEM;
+}
+
+static void plugin_flush_traces(unsigned int cpu_index)
+{
+    struct qemu_plugin_trace *trace;
+
+    QEMU_LOCK_GUARD(&plugin.lock);
+    QLIST_FOREACH(trace, &plugin.traces, entry) {
+        if (cpu_index < trace->score->data->len) {
+            plugin_trace_flush(trace, cpu_index);
+        }
+    }
+}
+
 void qemu_plugin_vcpu_init_hook(CPUState *cpu)
 {
     bool success;
 
+    plugin_grow_scoreboards(cpu);
+
     qemu_rec_mutex_lock(&plugin.lock);
     plugin_cpu_update__locked(&cpu->cpu_index, NULL, NULL);
     success = g_hash_table_insert(plugin.cpu_ht, &cpu->cpu_index,
@@ -212,6 +363,7 @@ void qemu_plugin_vcpu_exit_hook(CPUState *cpu)
 {
     bool success;
 
+    plugin_flush_traces(cpu->cpu_index);
     plugin_vcpu_cb__simple(cpu, QEMU_PLUGIN_EV_VCPU_EXIT);
 
     qemu_rec_mutex_lock(&plugin.lock);
@@ -276,6 +428,39 @@ void plugin_register_inline_op(GArray **arr,
     dyn_cb->rw = rw;
     dyn_cb->inline_insn.op = op;
     dyn_cb->inline_insn.imm = imm;
+    dyn_cb->inline_insn.stride = 0;
+}
+
+/*
+ * Scoreboards are only reallocated while no translation is in progress
+ * (see plugin_grow_scoreboards), so we can resolve @entry to an address
+ * here; the translated code using it is flushed upon reallocation.
+ */
+static void *plugin_u64_base(qemu_plugin_u64 entry)
+{
+    return entry.score->data->data + entry.offset;
+}
+
+static size_t plugin_u64_stride(qemu_plugin_u64 entry)
+{
+    return g_array_get_element_size(entry.score->data);
+}
+
+void plugin_register_inline_op_on_entry(GArray **arr,
+                                        enum qemu_plugin_mem_rw rw,
+                                        enum qemu_plugin_op op,
+                                        qemu_plugin_u64 entry,
+                                        uint64_t imm)
+{
+    struct qemu_plugin_dyn_cb *dyn_cb;
+
+    dyn_cb = plugin_get_dyn_cb(arr);
+    dyn_cb->userp = plugin_u64_base(entry);
+    dyn_cb->type = PLUGIN_CB_INLINE;
+    dyn_cb->rw = rw;
+    dyn_cb->inline_insn.op = op;
+    dyn_cb->inline_insn.imm = imm;
+    dyn_cb->inline_insn.stride = plugin_u64_stride(entry);
 }
 
 static inline uint32_t cb_to_tcg_flags(enum qemu_plugin_cb_flags flags)
@@ -309,6 +494,27 @@ plugin_register_dyn_cb__udata(GArray **arr,
     dyn_cb->type = PLUGIN_CB_REGULAR;
 }
 
+void
+plugin_register_dyn_cond_cb__udata(GArray **arr,
+                                   qemu_plugin_vcpu_udata_cb_t cb,
+                                   enum qemu_plugin_cb_flags flags,
+                                   enum qemu_plugin_cond cond,
+                                   qemu_plugin_u64 entry,
+                                   uint64_t imm,
+                                   void *udata)
+{
+    struct qemu_plugin_dyn_cb *dyn_cb = plugin_get_dyn_cb(arr);
+
+    dyn_cb->userp = udata;
+    dyn_cb->tcg_flags = cb_to_tcg_flags(flags);
+    dyn_cb->f.vcpu_udata = cb;
+    dyn_cb->type = PLUGIN_CB_COND;
+    dyn_cb->cond.cond = cond;
+    dyn_cb->cond.entry = plugin_u64_base(entry);
+    dyn_cb->cond.stride = plugin_u64_stride(entry);
+    dyn_cb->cond.imm = imm;
+}
+
 void plugin_register_vcpu_mem_cb(GArray **arr,
                                  void *cb,
                                  enum qemu_plugin_cb_flags flags,
@@ -325,6 +531,42 @@ void plugin_register_vcpu_mem_cb(GArray **arr,
     dyn_cb->f.generic = cb;
 }
 
+/*
+ * Besides the record itself, make sure that the instruction checks
+ * whether @trace's buffer is due for a flush before appending to it.
+ */
+void plugin_register_buffered(GArray **arr, GArray **flush_arr,
+                              enum qemu_plugin_mem_rw rw,
+                              struct qemu_plugin_trace *trace,
+                              uint64_t pc, uint64_t data)
+{
+    qemu_plugin_u64 count = qemu_plugin_scoreboard_u64_in_struct(
+        trace->score, struct plugin_trace_buf, n);
+    struct qemu_plugin_dyn_cb *dyn_cb;
+    size_t i;
+
+    dyn_cb = plugin_get_dyn_cb(arr);
+    dyn_cb->userp = plugin_u64_base(qemu_plugin_scoreboard_u64(trace->score));
+    dyn_cb->type = PLUGIN_CB_BUFFERED;
+    dyn_cb->rw = rw;
+    dyn_cb->buffered.trace = trace;
+    dyn_cb->buffered.stride = plugin_u64_stride(count);
+    dyn_cb->buffered.pc = pc;
+    dyn_cb->buffered.data = data;
+
+    for (i = 0; *flush_arr && i < (*flush_arr)->len; i++) {
+        dyn_cb = &g_array_index(*flush_arr, struct qemu_plugin_dyn_cb, i);
+        if (dyn_cb->f.vcpu_udata == plugin_trace_flush_cb &&
+            dyn_cb->userp == trace) {
+            return;
+        }
+    }
+    plugin_register_dyn_cond_cb__udata(flush_arr, plugin_trace_flush_cb,
+                                       QEMU_PLUGIN_CB_NO_REGS,
+                                       QEMU_PLUGIN_COND_GE, count,
+                                       PLUGIN_TRACE_BUF_FLUSH, trace);
+}
+
 void qemu_plugin_tb_trans_cb(CPUState *cpu, struct qemu_plugin_tb *tb)
 {
     struct qemu_plugin_cb *cb, *next;
@@ -416,14 +658,17 @@ void qemu_plugin_flush_cb(void)
     plugin_cb__simple(QEMU_PLUGIN_EV_FLUSH);
 }
 
-void exec_inline_op(struct qemu_plugin_dyn_cb *cb)
+void exec_inline_op(struct qemu_plugin_dyn_cb *cb, int cpu_index)
 {
-    uint64_t *val = cb->userp;
+    uint64_t *val = cb->userp + cpu_index * cb->inline_insn.stride;
 
     switch (cb->inline_insn.op) {
     case QEMU_PLUGIN_INLINE_ADD_U64:
         *val += cb->inline_insn.imm;
         break;
+    case QEMU_PLUGIN_INLINE_STORE_U64:
+        *val = cb->inline_insn.imm;
+        break;
     default:
         g_assert_not_reached();
     }
@@ -443,14 +688,17 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr, uint32_t info)
         int w = !!(info & TRACE_MEM_ST) + 1;
 
         if (!(w & cb->rw)) {
-                break;
+            continue;
         }
         switch (cb->type) {
         case PLUGIN_CB_REGULAR:
             cb->f.vcpu_mem(cpu->cpu_index, info, vaddr, cb->userp);
             break;
         case PLUGIN_CB_INLINE:
-            exec_inline_op(cb);
+            exec_inline_op(cb, cpu->cpu_index);
+            break;
+        case PLUGIN_CB_BUFFERED:
+            plugin_trace_append_mem(cb, cpu->cpu_index, vaddr, info);
             break;
         default:
             g_assert_not_reached();
@@ -460,6 +708,17 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr, uint32_t info)
 
 void qemu_plugin_atexit_cb(void)
 {
+    struct qemu_plugin_trace *trace;
+    unsigned int i;
+
+    qemu_rec_mutex_lock(&plugin.lock);
+    QLIST_FOREACH(trace, &plugin.traces, entry) {
+        for (i = 0; i < trace->score->data->len; i++) {
+            plugin_trace_flush(trace, i);
+        }
+    }
+    qemu_rec_mutex_unlock(&plugin.lock);
+
     plugin_cb__udata(QEMU_PLUGIN_EV_ATEXIT);
 }
 
@@ -496,6 +755,8 @@ static void __attribute__((__constructor__)) plugin_init(void)
     plugin.id_ht = g_hash_table_new(g_int64_hash, g_int64_equal);
     plugin.cpu_ht = g_hash_table_new(g_int_hash, g_int_equal);
     QTAILQ_INIT(&plugin.ctxs);
+    QLIST_INIT(&plugin.scoreboards);
+    QLIST_INIT(&plugin.traces);
     qht_init(&plugin.dyn_cb_arr_ht, plugin_dyn_cb_arr_cmp, 16,
              QHT_MODE_AUTO_RESIZE);
     atexit(qemu_plugin_atexit_cb);
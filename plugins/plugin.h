@@ -43,6 +43,15 @@ struct qemu_plugin_state {
      * the code cache is flushed.
      */
     struct qht dyn_cb_arr_ht;
+    /*
+     * All scoreboards, and the number of elements they have room for.
+     * They are resized together whenever a vCPU with a higher index
+     * is created; see plugin_grow_scoreboards().
+     */
+    QLIST_HEAD(, qemu_plugin_scoreboard) scoreboards;
+    size_t scoreboard_alloc_size;
+    /* all traces, so that they can be flushed at exit */
+    QLIST_HEAD(, qemu_plugin_trace) traces;
 };
 
 
@@ -61,6 +70,19 @@ struct qemu_plugin_ctx {
     bool resetting;
 };
 
+struct qemu_plugin_scoreboard {
+    GArray *data;
+    QLIST_ENTRY(qemu_plugin_scoreboard) entry;
+};
+
+/* the elements of @score are struct plugin_trace_buf */
+struct qemu_plugin_trace {
+    struct qemu_plugin_scoreboard *score;
+    qemu_plugin_vcpu_trace_flush_cb_t cb;
+    void *udata;
+    QLIST_ENTRY(qemu_plugin_trace) entry;
+};
+
 struct qemu_plugin_ctx *plugin_id_to_ctx_locked(qemu_plugin_id_t id);
 
 void plugin_register_inline_op(GArray **arr,
@@ -68,6 +90,12 @@ void plugin_register_inline_op(GArray **arr,
                                enum qemu_plugin_op op, void *ptr,
                                uint64_t imm);
 
+void plugin_register_inline_op_on_entry(GArray **arr,
+                                        enum qemu_plugin_mem_rw rw,
+                                        enum qemu_plugin_op op,
+                                        qemu_plugin_u64 entry,
+                                        uint64_t imm);
+
 void plugin_reset_uninstall(qemu_plugin_id_t id,
                             qemu_plugin_simple_cb_t cb,
                             bool reset);
@@ -87,6 +115,14 @@ plugin_register_dyn_cb__udata(GArray **arr,
                               qemu_plugin_vcpu_udata_cb_t cb,
                               enum qemu_plugin_cb_flags flags, void *udata);
 
+void
+plugin_register_dyn_cond_cb__udata(GArray **arr,
+                                   qemu_plugin_vcpu_udata_cb_t cb,
+                                   enum qemu_plugin_cb_flags flags,
+                                   enum qemu_plugin_cond cond,
+                                   qemu_plugin_u64 entry,
+                                   uint64_t imm,
+                                   void *udata);
 
 void plugin_register_vcpu_mem_cb(GArray **arr,
                                  void *cb,
@@ -94,6 +130,18 @@ void plugin_register_vcpu_mem_cb(GArray **arr,
                                  enum qemu_plugin_mem_rw rw,
                                  void *udata);
 
-void exec_inline_op(struct qemu_plugin_dyn_cb *cb);
+void plugin_register_buffered(GArray **arr, GArray **flush_arr,
+                              enum qemu_plugin_mem_rw rw,
+                              struct qemu_plugin_trace *trace,
+                              uint64_t pc, uint64_t data);
+
+struct qemu_plugin_scoreboard *plugin_scoreboard_new(size_t element_size);
+
+void plugin_scoreboard_free(struct qemu_plugin_scoreboard *score);
+
+struct qemu_plugin_trace *plugin_trace_new(qemu_plugin_vcpu_trace_flush_cb_t cb,
+                                           void *udata);
+
+void exec_inline_op(struct qemu_plugin_dyn_cb *cb, int cpu_index);
 
 #endif /* _PLUGIN_INTERNAL_H_ */
@@ -116,6 +116,9 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "                kernel-irqchip=on|off|split controls accelerated irqchip support (default=on)\n"
     "                kvm-shadow-mem=size of KVM shadow MMU in bytes\n"
     "                tb-size=n (TCG translation block cache size)\n"
+    "                perf-map=on|off (write a perf map of TCG generated code, default=off)\n"
+    "                jitdump=on|off (write a perf jitdump of TCG generated code, default=off)\n"
+    "                profile=file (sample TCG generated code and write a profile to file)\n"
     "                thread=single|multi (enable multi-threaded TCG)\n", QEMU_ARCH_ALL)
 SRST
 ``-accel name[,prop=value[,...]]``
@@ -143,6 +146,21 @@ SRST
     ``tb-size=n``
         Controls the size (in MiB) of the TCG translation block cache.
 
+    ``perf-map=on|off``
+        Write ``/tmp/perf-<pid>.map`` so that ``perf report`` can name
+        the translation blocks in the TCG code buffer after the guest
+        code they came from (default=off). Names can go stale once
+        the code buffer is reused, which ``jitdump`` avoids.
+
+    ``jitdump=on|off``
+        Write a jitdump of the TCG generated code for use with
+        ``perf record -k 1`` and ``perf inject --jit`` (default=off).
+
+    ``profile=file``
+        Sample the host PC with SIGPROF and write a flat profile of the
+        TCG generated code, by guest PC, to file at exit ("-" for
+        stderr). Linux hosts only.
+
     ``thread=single|multi``
         Controls number of TCG threads. When the TCG is multi-threaded
         there will be one thread per vCPU therefor taking advantage of
@@ -1298,6 +1298,8 @@ bool get_phys_addr(CPUARMState *env, target_ulong address,
                    ARMMMUFaultInfo *fi, ARMCacheAttrs *cacheattrs)
     __attribute__((nonnull));
 
+bool arm_mmu_idx_uses_stage2(CPUARMState *env, ARMMMUIdx mmu_idx);
+
 void arm_log_exception(int idx);
 
 #endif /* !CONFIG_USER_ONLY */
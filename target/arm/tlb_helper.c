@@ -167,6 +167,7 @@ bool arm_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
     MemTxAttrs attrs = {};
     ARMMMUFaultInfo fi = {};
     ARMCacheAttrs cacheattrs = {};
+    ARMMMUIdx arm_mmu_idx = core_to_arm_mmu_idx(&cpu->env, mmu_idx);
 
     /*
      * Walk the page table and (if the mapping exists) add the page
@@ -174,8 +175,7 @@ bool arm_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
      * return false.  Otherwise populate fsr with ARM DFSR/IFSR fault
      * register format, and signal the fault.
      */
-    ret = get_phys_addr(&cpu->env, address, access_type,
-                        core_to_arm_mmu_idx(&cpu->env, mmu_idx),
+    ret = get_phys_addr(&cpu->env, address, access_type, arm_mmu_idx,
                         &phys_addr, &attrs, &prot, &page_size,
                         &fi, &cacheattrs);
     if (likely(!ret)) {
@@ -193,8 +193,19 @@ bool arm_cpu_tlb_fill(CPUState *cs, vaddr address, int size,
             arm_tlb_mte_tagged(&attrs) = true;
         }
 
-        tlb_set_page_with_attrs(cs, address, phys_addr, attrs,
+        /*
+         * A single stage translation maps the whole page with one set
+         * of permissions.  After stage 2, page_size is only that of the
+         * stage 2 page and the stage 1 mapping around it is unknown.
+         */
+        if (page_size > TARGET_PAGE_SIZE &&
+            !arm_mmu_idx_uses_stage2(&cpu->env, arm_mmu_idx)) {
+            tlb_set_page_linear(cs, address, phys_addr, attrs,
                                 prot, mmu_idx, page_size);
+        } else {
+            tlb_set_page_with_attrs(cs, address, phys_addr, attrs,
+                                    prot, mmu_idx, page_size);
+        }
         return true;
     } else if (probe) {
         return false;
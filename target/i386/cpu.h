@@ -2250,6 +2250,26 @@ static inline bool hyperv_feat_enabled(X86CPU *cpu, int feat)
     defined(CONFIG_USER_ONLY) && \
     defined(CONFIG_LINUX)
 # define TARGET_VSYSCALL_PAGE  (UINT64_C(-10) << 20)
+
+/*
+ * linux-user maps a vDSO at x86_vdso_page.  Its entry points, each
+ * X86_VDSO_ENTRY_SIZE bytes long from X86_VDSO_TEXT on, are caught by
+ * the translator and emulated by helper_vdso.  Their code starts with
+ * a one byte nop, followed by the system call that implements them,
+ * which runs if helper_vdso declines.
+ */
+enum {
+    X86_VDSO_CLOCK_GETTIME,
+    X86_VDSO_GETTIMEOFDAY,
+    X86_VDSO_TIME,
+    X86_VDSO_GETCPU,
+    X86_VDSO_CLOCK_GETRES,
+    X86_VDSO_NB_ENTRIES
+};
+# define X86_VDSO_TEXT         0x800
+# define X86_VDSO_ENTRY_SIZE   16
+
+extern target_ulong x86_vdso_page;
 #endif
 
 #endif /* I386_CPU_H */
@@ -643,8 +643,19 @@ do_check_protect_pse36:
     paddr &= TARGET_PAGE_MASK;
 
     assert(prot & (1 << is_write1));
-    tlb_set_page_with_attrs(cs, vaddr, paddr, cpu_get_mem_attrs(env),
+    /*
+     * With nested paging each 4KB page goes through get_hphys separately,
+     * and a masked A20 line can fold the page onto itself, so only then
+     * is the whole large page known to be mapped linearly.
+     */
+    if (page_size > TARGET_PAGE_SIZE && a20_mask == -1 &&
+        !(env->hflags2 & HF2_NPT_MASK)) {
+        tlb_set_page_linear(cs, vaddr, paddr, cpu_get_mem_attrs(env),
                             prot, mmu_idx, page_size);
+    } else {
+        tlb_set_page_with_attrs(cs, vaddr, paddr, cpu_get_mem_attrs(env),
+                                prot, mmu_idx, page_size);
+    }
     return 0;
  do_fault_rsvd:
     error_code |= PG_ERROR_RSVD_MASK;
@@ -25,6 +25,9 @@
 #include "exec/exec-all.h"
 #include "exec/cpu_ldst.h"
 #include "exec/log.h"
+#ifdef TARGET_VSYSCALL_PAGE
+#include <sys/syscall.h>
+#endif
 
 //#define DEBUG_PCALL
 
@@ -979,6 +982,104 @@ void helper_syscall(CPUX86State *env, int next_eip_addend)
     env->exception_next_eip = env->eip + next_eip_addend;
     cpu_loop_exit(cs);
 }
+
+#ifdef TARGET_VSYSCALL_PAGE
+target_ulong x86_vdso_page;
+
+/* The clocks that the Linux vDSO reads without a system call.  */
+static bool vdso_clock_ok(target_ulong clock)
+{
+    switch (clock) {
+    case CLOCK_REALTIME:
+    case CLOCK_MONOTONIC:
+    case CLOCK_MONOTONIC_RAW:
+    case CLOCK_REALTIME_COARSE:
+    case CLOCK_MONOTONIC_COARSE:
+    case CLOCK_BOOTTIME:
+#ifdef CLOCK_TAI
+    case CLOCK_TAI:
+#endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Emulate the vDSO entry point @entry without leaving generated code.
+ * Returns 1 with the result in EAX, the caller then emulating the ret
+ * instruction, or 0 to run the entry point's system call instead.
+ */
+uint32_t helper_vdso(CPUX86State *env, uint32_t entry)
+{
+    target_ulong arg0 = env->regs[R_EDI];
+    target_ulong arg1 = env->regs[R_ESI];
+    uintptr_t ra = GETPC();
+    struct timespec ts;
+    struct timeval tv;
+    struct timezone tz;
+    unsigned int cpu, node;
+    time_t t;
+    int ret;
+
+    switch (entry) {
+    case X86_VDSO_CLOCK_GETTIME:
+    case X86_VDSO_CLOCK_GETRES:
+        if (!vdso_clock_ok(arg0)) {
+            return 0;
+        }
+        if (entry == X86_VDSO_CLOCK_GETTIME) {
+            ret = clock_gettime(arg0, &ts);
+        } else {
+            ret = clock_getres(arg0, &ts);
+        }
+        if (ret) {
+            return 0;
+        }
+        if (arg1) {
+            cpu_stq_data_ra(env, arg1, ts.tv_sec, ra);
+            cpu_stq_data_ra(env, arg1 + 8, ts.tv_nsec, ra);
+        }
+        env->regs[R_EAX] = 0;
+        return 1;
+    case X86_VDSO_GETTIMEOFDAY:
+        if (gettimeofday(&tv, &tz)) {
+            return 0;
+        }
+        if (arg0) {
+            cpu_stq_data_ra(env, arg0, tv.tv_sec, ra);
+            cpu_stq_data_ra(env, arg0 + 8, tv.tv_usec, ra);
+        }
+        if (arg1) {
+            cpu_stl_data_ra(env, arg1, tz.tz_minuteswest, ra);
+            cpu_stl_data_ra(env, arg1 + 4, tz.tz_dsttime, ra);
+        }
+        env->regs[R_EAX] = 0;
+        return 1;
+    case X86_VDSO_TIME:
+        t = time(NULL);
+        if (arg0) {
+            cpu_stq_data_ra(env, arg0, t, ra);
+        }
+        env->regs[R_EAX] = t;
+        return 1;
+    case X86_VDSO_GETCPU:
+        if (syscall(__NR_getcpu, &cpu, &node, NULL)) {
+            return 0;
+        }
+        if (arg0) {
+            cpu_stl_data_ra(env, arg0, cpu, ra);
+        }
+        if (arg1) {
+            cpu_stl_data_ra(env, arg1, node, ra);
+        }
+        env->regs[R_EAX] = 0;
+        return 1;
+    default:
+        return 0;
+    }
+}
+#endif
 #else
 void helper_syscall(CPUX86State *env, int next_eip_addend)
 {
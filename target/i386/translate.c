@@ -146,7 +146,7 @@ typedef struct DisasContext {
 } DisasContext;
 
 static void gen_eob(DisasContext *s);
-static void gen_jr(DisasContext *s, TCGv dest);
+static void gen_jr(DisasContext *s, TCGv dest, bool is_ret);
 static void gen_jmp(DisasContext *s, target_ulong eip);
 static void gen_jmp_tb(DisasContext *s, target_ulong eip, int tb_num);
 static void gen_op(DisasContext *s1, int op, MemOp ot, int d);
@@ -2222,7 +2222,7 @@ static inline void gen_goto_tb(DisasContext *s, int tb_num, target_ulong eip)
     } else {
         /* jump to another page */
         gen_jmp_im(s, eip);
-        gen_jr(s, s->tmp0);
+        gen_jr(s, s->tmp0, false);
     }
 }
 
@@ -2562,9 +2562,13 @@ static void gen_bnd_jmp(DisasContext *s)
 /* Generate an end of block. Trace exception is also generated if needed.
    If INHIBIT, set HF_INHIBIT_IRQ_MASK if it isn't already set.
    If RECHECK_TF, emit a rechecking helper for #DB, ignoring the state of
-   S->TF.  This is used by the syscall/sysret insns.  */
+   S->TF.  This is used by the syscall/sysret insns.
+   If JR, look up the next TB from generated code; if JR_DEST is not NULL,
+   it is the new EIP and the jump did not change segments, so the indirect
+   branch caches may be used.  */
 static void
-do_gen_eob_worker(DisasContext *s, bool inhibit, bool recheck_tf, bool jr)
+do_gen_eob_worker(DisasContext *s, bool inhibit, bool recheck_tf, bool jr,
+                  TCGv jr_dest, bool jr_ret)
 {
     gen_update_cc_op(s);
 
@@ -2585,6 +2589,15 @@ do_gen_eob_worker(DisasContext *s, bool inhibit, bool recheck_tf, bool jr)
         tcg_gen_exit_tb(NULL, 0);
     } else if (s->tf) {
         gen_helper_single_step(cpu_env);
+    } else if (jr && jr_dest &&
+               !(s->base.tb->flags & (HF_INHIBIT_IRQ_MASK | HF_RF_MASK |
+                                      HF_MPX_IU_MASK))) {
+        /* The flags of the next TB are known to be those of this one.  */
+        TCGv pc = tcg_temp_new();
+
+        tcg_gen_addi_tl(pc, jr_dest, s->cs_base);
+        translator_lookup_and_goto_ptr(&s->base, pc, jr_ret);
+        tcg_temp_free(pc);
     } else if (jr) {
         tcg_gen_lookup_and_goto_ptr();
     } else {
@@ -2596,7 +2609,7 @@ do_gen_eob_worker(DisasContext *s, bool inhibit, bool recheck_tf, bool jr)
 static inline void
 gen_eob_worker(DisasContext *s, bool inhibit, bool recheck_tf)
 {
-    do_gen_eob_worker(s, inhibit, recheck_tf, false);
+    do_gen_eob_worker(s, inhibit, recheck_tf, false, NULL, false);
 }
 
 /* End of block.
@@ -2612,10 +2625,11 @@ static void gen_eob(DisasContext *s)
     gen_eob_worker(s, false, false);
 }
 
-/* Jump to register */
-static void gen_jr(DisasContext *s, TCGv dest)
+/* Jump to register.  DEST is the new EIP, or NULL after a far jump.
+   IS_RET is set for near returns.  */
+static void gen_jr(DisasContext *s, TCGv dest, bool is_ret)
 {
-    do_gen_eob_worker(s, false, false, true);
+    do_gen_eob_worker(s, false, false, true, dest, is_ret);
 }
 
 /* generate a jump to eip. No segment change must happen before as a
@@ -2637,6 +2651,37 @@ static void gen_jmp(DisasContext *s, target_ulong eip)
     gen_jmp_tb(s, eip, 0);
 }
 
+#ifdef TARGET_VSYSCALL_PAGE
+/*
+ * Entry into the emulated vDSO: let the helper compute the result and
+ * return to the caller, or fall through to the entry's syscall insn.
+ */
+static void gen_vdso(DisasContext *s, int entry)
+{
+    target_ulong pc = s->base.pc_next - s->cs_base;
+    TCGLabel *slow = gen_new_label();
+    TCGv_i32 ret = tcg_temp_new_i32();
+    MemOp ot;
+
+    /* The TB covers the entry's nop, and must not be empty.  */
+    s->base.pc_next++;
+
+    gen_update_cc_op(s);
+    gen_jmp_im(s, pc);
+    gen_helper_vdso(ret, cpu_env, tcg_const_i32(entry));
+    tcg_gen_brcondi_i32(TCG_COND_EQ, ret, 0, slow);
+    tcg_temp_free_i32(ret);
+
+    ot = gen_pop_T0(s);
+    gen_pop_update(s, ot);
+    gen_op_jmp_v(s->T0);
+    gen_jr(s, s->T0, true);
+
+    gen_set_label(slow);
+    gen_jmp(s, pc + 1);
+}
+#endif
+
 static inline void gen_ldq_env_A0(DisasContext *s, int offset)
 {
     tcg_gen_qemu_ld_i64(s->tmp1_i64, s->A0, s->mem_index, MO_LEQ);
@@ -5052,9 +5097,10 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
             next_eip = s->pc - s->cs_base;
             tcg_gen_movi_tl(s->T1, next_eip);
             gen_push_v(s, s->T1);
+            translator_push_return(&s->base, s->pc);
             gen_op_jmp_v(s->T0);
             gen_bnd_jmp(s);
-            gen_jr(s, s->T0);
+            gen_jr(s, s->T0, false);
             break;
         case 3: /* lcall Ev */
             gen_op_ld_v(s, ot, s->T1, s->A0);
@@ -5072,8 +5118,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
                                       tcg_const_i32(dflag - 1),
                                       tcg_const_i32(s->pc - s->cs_base));
             }
-            tcg_gen_ld_tl(s->tmp4, cpu_env, offsetof(CPUX86State, eip));
-            gen_jr(s, s->tmp4);
+            gen_jr(s, NULL, false);
             break;
         case 4: /* jmp Ev */
             if (dflag == MO_16) {
@@ -5081,7 +5126,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
             }
             gen_op_jmp_v(s->T0);
             gen_bnd_jmp(s);
-            gen_jr(s, s->T0);
+            gen_jr(s, s->T0, false);
             break;
         case 5: /* ljmp Ev */
             gen_op_ld_v(s, ot, s->T1, s->A0);
@@ -5096,8 +5141,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
                 gen_op_movl_seg_T0_vm(s, R_CS);
                 gen_op_jmp_v(s->T1);
             }
-            tcg_gen_ld_tl(s->tmp4, cpu_env, offsetof(CPUX86State, eip));
-            gen_jr(s, s->tmp4);
+            gen_jr(s, NULL, false);
             break;
         case 6: /* push Ev */
             gen_push_v(s, s->T0);
@@ -6508,7 +6552,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
         /* Note that gen_pop_T0 uses a zero-extending load.  */
         gen_op_jmp_v(s->T0);
         gen_bnd_jmp(s);
-        gen_jr(s, s->T0);
+        gen_jr(s, s->T0, true);
         break;
     case 0xc3: /* ret */
         ot = gen_pop_T0(s);
@@ -6516,7 +6560,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
         /* Note that gen_pop_T0 uses a zero-extending load.  */
         gen_op_jmp_v(s->T0);
         gen_bnd_jmp(s);
-        gen_jr(s, s->T0);
+        gen_jr(s, s->T0, true);
         break;
     case 0xca: /* lret im */
         val = x86_ldsw_code(env, s);
@@ -6581,6 +6625,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
             }
             tcg_gen_movi_tl(s->T0, next_eip);
             gen_push_v(s, s->T0);
+            translator_push_return(&s->base, s->pc);
             gen_bnd_jmp(s);
             gen_jmp(s, tval);
         }
@@ -8564,6 +8609,16 @@ static void i386_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
         gen_exception(dc, EXCP_VSYSCALL, dc->base.pc_next);
         return;
     }
+    if (x86_vdso_page &&
+        (dc->base.pc_next & TARGET_PAGE_MASK) == x86_vdso_page) {
+        target_ulong ofs = dc->base.pc_next & ~TARGET_PAGE_MASK;
+
+        if (ofs >= X86_VDSO_TEXT && ofs % X86_VDSO_ENTRY_SIZE == 0 &&
+            (ofs - X86_VDSO_TEXT) / X86_VDSO_ENTRY_SIZE < X86_VDSO_NB_ENTRIES) {
+            gen_vdso(dc, (ofs - X86_VDSO_TEXT) / X86_VDSO_ENTRY_SIZE);
+            return;
+        }
+    }
 #endif
 
     pc_next = disas_insn(dc, cpu);
@@ -594,6 +594,255 @@ static bool swap_commutative2(TCGArg *p1, TCGArg *p2)
     return false;
 }
 
+/*
+ * Forwarding of loads and elimination of dead stores to CPU state.
+ *
+ * Frontends keep a lot of state (condition codes, flags, status words)
+ * in env fields which they access with plain tcg_gen_ld/st rather than
+ * through TCG globals.  Within a straight-line run of ops that contains
+ * no helper calls, guest memory operations or barriers, env can only be
+ * accessed through these explicit loads and stores, so a load may reuse
+ * the value last stored to or loaded from the same slot, and a store that
+ * is completely overwritten before anything could observe it is dead.
+ *
+ * Helper calls are always treated as accessing all of env: the call flags
+ * only describe TCG globals, and e.g. the gvec helpers legitimately read
+ * and write env through pointer arguments.
+ */
+
+#define MAX_ENV_SLOTS  32
+
+typedef struct {
+    intptr_t ofs;
+    int size;
+    TCGOpcode ld_opc;    /* load opcode which would produce VAL */
+    TCGTemp *val;
+} EnvValue;
+
+typedef struct {
+    intptr_t ofs;
+    int size;
+    TCGOp *op;
+} EnvStore;
+
+typedef struct {
+    EnvValue vals[MAX_ENV_SLOTS];
+    EnvStore stores[MAX_ENV_SLOTS];
+    int nb_vals;
+    int nb_stores;
+} EnvState;
+
+static inline bool env_overlap(intptr_t o1, int s1, intptr_t o2, int s2)
+{
+    return o1 < o2 + s2 && o2 < o1 + s1;
+}
+
+/* Return the number of bytes accessed by an ld/st op, or 0 if not one.  */
+static int env_ldst_size(TCGOp *op, bool *is_store)
+{
+    *is_store = false;
+    switch (op->opc) {
+    case INDEX_op_st8_i32:
+    case INDEX_op_st8_i64:
+        *is_store = true;
+        /* fall through */
+    case INDEX_op_ld8u_i32:
+    case INDEX_op_ld8s_i32:
+    case INDEX_op_ld8u_i64:
+    case INDEX_op_ld8s_i64:
+        return 1;
+    case INDEX_op_st16_i32:
+    case INDEX_op_st16_i64:
+        *is_store = true;
+        /* fall through */
+    case INDEX_op_ld16u_i32:
+    case INDEX_op_ld16s_i32:
+    case INDEX_op_ld16u_i64:
+    case INDEX_op_ld16s_i64:
+        return 2;
+    case INDEX_op_st_i32:
+    case INDEX_op_st32_i64:
+        *is_store = true;
+        /* fall through */
+    case INDEX_op_ld_i32:
+    case INDEX_op_ld32u_i64:
+    case INDEX_op_ld32s_i64:
+        return 4;
+    case INDEX_op_st_i64:
+        *is_store = true;
+        /* fall through */
+    case INDEX_op_ld_i64:
+        return 8;
+    case INDEX_op_st_vec:
+        *is_store = true;
+        /* fall through */
+    case INDEX_op_ld_vec:
+    case INDEX_op_dupm_vec:
+        return 8 << TCGOP_VECL(op);
+    default:
+        return 0;
+    }
+}
+
+static void env_forget_values(EnvState *es, intptr_t ofs, int size)
+{
+    int i, j;
+
+    for (i = j = 0; i < es->nb_vals; i++) {
+        if (!env_overlap(es->vals[i].ofs, es->vals[i].size, ofs, size)) {
+            es->vals[j++] = es->vals[i];
+        }
+    }
+    es->nb_vals = j;
+}
+
+static void env_forget_temp(EnvState *es, TCGTemp *ts)
+{
+    int i, j;
+
+    for (i = j = 0; i < es->nb_vals; i++) {
+        if (es->vals[i].val != ts) {
+            es->vals[j++] = es->vals[i];
+        }
+    }
+    es->nb_vals = j;
+}
+
+/* Mark the bytes [OFS, OFS + SIZE) as read: the stores to them are live.  */
+static void env_read_stores(EnvState *es, intptr_t ofs, int size)
+{
+    int i, j;
+
+    for (i = j = 0; i < es->nb_stores; i++) {
+        if (!env_overlap(es->stores[i].ofs, es->stores[i].size, ofs, size)) {
+            es->stores[j++] = es->stores[i];
+        }
+    }
+    es->nb_stores = j;
+}
+
+/*
+ * The bytes [OFS, OFS + SIZE) are overwritten: remove any pending store
+ * which is entirely covered, and stop tracking those partially covered.
+ */
+static void env_kill_stores(TCGContext *s, EnvState *es,
+                            intptr_t ofs, int size)
+{
+    int i, j;
+
+    for (i = j = 0; i < es->nb_stores; i++) {
+        EnvStore *p = &es->stores[i];
+
+        if (!env_overlap(p->ofs, p->size, ofs, size)) {
+            es->stores[j++] = *p;
+        } else if (p->ofs >= ofs && p->ofs + p->size <= ofs + size) {
+            tcg_op_remove(s, p->op);
+        }
+    }
+    es->nb_stores = j;
+}
+
+static void env_add_value(EnvState *es, intptr_t ofs, int size,
+                          TCGOpcode ld_opc, TCGTemp *val)
+{
+    if (es->nb_vals < MAX_ENV_SLOTS) {
+        EnvValue *v = &es->vals[es->nb_vals++];
+        v->ofs = ofs;
+        v->size = size;
+        v->ld_opc = ld_opc;
+        v->val = val;
+    }
+}
+
+static void optimize_env_ldst(TCGContext *s)
+{
+    TCGTemp *env = tcgv_ptr_temp(cpu_env);
+    TCGOp *op, *op_next;
+    EnvState es;
+
+    es.nb_vals = 0;
+    es.nb_stores = 0;
+
+    QTAILQ_FOREACH_SAFE(op, &s->ops, link, op_next) {
+        TCGOpcode opc = op->opc;
+        const TCGOpDef *def = &tcg_op_defs[opc];
+        intptr_t ofs;
+        bool is_store;
+        int i, size;
+
+        if (opc == INDEX_op_call || opc == INDEX_op_mb
+            || (def->flags & (TCG_OPF_BB_END | TCG_OPF_SIDE_EFFECTS))) {
+            es.nb_vals = 0;
+            es.nb_stores = 0;
+            continue;
+        }
+
+        size = env_ldst_size(op, &is_store);
+        if (size == 0) {
+            for (i = 0; i < def->nb_oargs; i++) {
+                env_forget_temp(&es, arg_temp(op->args[i]));
+            }
+            continue;
+        }
+
+        if (arg_temp(op->args[1]) != env) {
+            /* An access through any other pointer may alias env.  */
+            if (is_store) {
+                es.nb_vals = 0;
+            } else {
+                env_forget_temp(&es, arg_temp(op->args[0]));
+            }
+            es.nb_stores = 0;
+            continue;
+        }
+
+        ofs = (intptr_t)op->args[2];
+        if (is_store) {
+            TCGTemp *val = arg_temp(op->args[0]);
+
+            env_forget_values(&es, ofs, size);
+            env_kill_stores(s, &es, ofs, size);
+            if (es.nb_stores < MAX_ENV_SLOTS) {
+                EnvStore *p = &es.stores[es.nb_stores++];
+                p->ofs = ofs;
+                p->size = size;
+                p->op = op;
+            }
+            if (opc == INDEX_op_st_i32) {
+                env_add_value(&es, ofs, size, INDEX_op_ld_i32, val);
+            } else if (opc == INDEX_op_st_i64) {
+                env_add_value(&es, ofs, size, INDEX_op_ld_i64, val);
+            }
+        } else {
+            TCGTemp *dst = arg_temp(op->args[0]);
+            TCGTemp *val = NULL;
+
+            for (i = 0; i < es.nb_vals; i++) {
+                if (es.vals[i].ofs == ofs && es.vals[i].ld_opc == opc) {
+                    val = es.vals[i].val;
+                    break;
+                }
+            }
+
+            if (val == dst) {
+                tcg_op_remove(s, op);
+                continue;
+            }
+            env_forget_temp(&es, dst);
+            if (val) {
+                op->opc = (def->flags & TCG_OPF_64BIT
+                           ? INDEX_op_mov_i64 : INDEX_op_mov_i32);
+                op->args[1] = temp_arg(val);
+            } else {
+                env_read_stores(&es, ofs, size);
+                if (opc != INDEX_op_ld_vec && opc != INDEX_op_dupm_vec) {
+                    env_add_value(&es, ofs, size, opc, dst);
+                }
+            }
+        }
+    }
+}
+
 /* Propagate constants and copies, fold constant expressions. */
 void tcg_optimize(TCGContext *s)
 {
@@ -612,6 +861,8 @@ void tcg_optimize(TCGContext *s)
     bitmap_zero(temps_used.l, nb_temps);
     infos = tcg_malloc(sizeof(struct tcg_temp_info) * nb_temps);
 
+    optimize_env_ldst(s);
+
     QTAILQ_FOREACH_SAFE(op, &s->ops, link, op_next) {
         tcg_target_ulong mask, partmask, affected;
         int nb_oargs, nb_iargs, i;
@@ -31,6 +31,7 @@
 #undef DEBUG_JIT
 
 #include "qemu/error-report.h"
+#include "qemu/bitmap.h"
 #include "qemu/cutils.h"
 #include "qemu/host-utils.h"
 #include "qemu/qemu-print.h"
@@ -154,6 +155,9 @@ static int tcg_target_const_match(tcg_target_long val, TCGType type,
 #ifdef TCG_TARGET_NEED_LDST_LABELS
 static int tcg_out_ldst_finalize(TCGContext *s);
 #endif
+#ifdef TCG_TARGET_NEED_TB_FINALIZE
+static void tcg_out_tb_finalize(TCGContext *s);
+#endif
 
 #define TCG_HIGHWATER 1024
 
@@ -164,6 +168,8 @@ TCGv_env cpu_env = 0;
 struct tcg_region_tree {
     QemuMutex lock;
     GTree *tree;
+    /* value of region.epoch when code in this region was last looked up */
+    unsigned int epoch;
     /* padding to avoid false sharing is computed at run-time */
 };
 
@@ -172,6 +178,10 @@ struct tcg_region_tree {
  * dynamically allocate from as demand dictates. Given appropriate region
  * sizing, this minimizes flushes even when some TCG threads generate a lot
  * more code than others.
+ *
+ * When no free region is left, tcg_region_reclaim() frees the regions whose
+ * code was least recently used, so that a full flush is only needed when
+ * every region is in use for translation.
  */
 struct tcg_region_state {
     QemuMutex lock;
@@ -185,8 +195,12 @@ struct tcg_region_state {
     size_t stride; /* .size + guard size */
 
     /* fields protected by the lock */
-    size_t current; /* current region index */
+    unsigned long *free; /* regions neither holding code nor assigned */
     size_t agg_size_full; /* aggregate size of full regions */
+    unsigned int epoch; /* incremented on each region assignment */
+
+    /* regions being freed by tcg_region_reclaim(), for tcg_tc_reclaimed() */
+    unsigned long *reclaim;
 };
 
 static struct tcg_region_state region;
@@ -400,24 +414,30 @@ static void tcg_region_trees_init(void)
     }
 }
 
-static struct tcg_region_tree *tc_ptr_to_region_tree(void *p)
+static size_t tc_ptr_to_region_idx(const void *p)
 {
-    size_t region_idx;
-
     if (p < region.start_aligned) {
-        region_idx = 0;
+        return 0;
     } else {
         ptrdiff_t offset = p - region.start_aligned;
 
         if (offset > region.stride * (region.n - 1)) {
-            region_idx = region.n - 1;
-        } else {
-            region_idx = offset / region.stride;
+            return region.n - 1;
         }
+        return offset / region.stride;
     }
+}
+
+static struct tcg_region_tree *region_idx_to_tree(size_t region_idx)
+{
     return region_trees + region_idx * tree_size;
 }
 
+static struct tcg_region_tree *tc_ptr_to_region_tree(void *p)
+{
+    return region_idx_to_tree(tc_ptr_to_region_idx(p));
+}
+
 void tcg_tb_insert(TranslationBlock *tb)
 {
     struct tcg_region_tree *rt = tc_ptr_to_region_tree(tb->tc.ptr);
@@ -555,15 +575,20 @@ static void tcg_region_assign(TCGContext *s, size_t curr_region)
     s->code_gen_ptr = start;
     s->code_gen_buffer_size = end - start;
     s->code_gen_highwater = end - TCG_HIGHWATER;
+
+    qatomic_set(&region.epoch, region.epoch + 1);
+    qatomic_set(&region_idx_to_tree(curr_region)->epoch, region.epoch);
 }
 
 static bool tcg_region_alloc__locked(TCGContext *s)
 {
-    if (region.current == region.n) {
+    size_t i = find_first_bit(region.free, region.n);
+
+    if (i == region.n) {
         return true;
     }
-    tcg_region_assign(s, region.current);
-    region.current++;
+    clear_bit(i, region.free);
+    tcg_region_assign(s, i);
     return false;
 }
 
@@ -602,7 +627,7 @@ void tcg_region_reset_all(void)
     unsigned int i;
 
     qemu_mutex_lock(&region.lock);
-    region.current = 0;
+    bitmap_set(region.free, 0, region.n);
     region.agg_size_full = 0;
 
     for (i = 0; i < n_ctxs; i++) {
@@ -616,45 +641,173 @@ void tcg_region_reset_all(void)
     tcg_region_tree_reset_all();
 }
 
-#ifdef CONFIG_USER_ONLY
-static size_t tcg_n_regions(void)
+/*
+ * Record that code in the region containing @tc_ptr is in use, so that
+ * tcg_region_reclaim() prefers to free other regions.
+ */
+void tcg_region_touch(const void *tc_ptr)
 {
-    return 1;
+    struct tcg_region_tree *rt = tc_ptr_to_region_tree((void *)tc_ptr);
+    unsigned int epoch = qatomic_read(&region.epoch);
+
+    /* avoid dirtying the cache line when there is nothing to update */
+    if (qatomic_read(&rt->epoch) != epoch) {
+        qatomic_set(&rt->epoch, epoch);
+    }
 }
-#else
+
 /*
- * It is likely that some vCPUs will translate more code than others, so we
- * first try to set more regions than max_cpus, with those regions being of
- * reasonable size. If that's not possible we make do by evenly dividing
- * the code_gen_buffer among the vCPUs.
+ * Return true if @p points into a region that tcg_region_reclaim() is
+ * about to free.  Only meaningful from the callbacks of tcg_region_reclaim().
  */
-static size_t tcg_n_regions(void)
+bool tcg_tc_reclaimed(const void *p)
 {
-    size_t i;
+    if (p < region.start || p >= region.end) {
+        return false;
+    }
+    return test_bit(tc_ptr_to_region_idx(p), region.reclaim);
+}
 
-    /* Use a single region if all we have is one vCPU thread */
-#if !defined(CONFIG_USER_ONLY)
-    MachineState *ms = MACHINE(qdev_get_machine());
-    unsigned int max_cpus = ms->smp.max_cpus;
-#endif
-    if (max_cpus == 1 || !qemu_tcg_mttcg_enabled()) {
-        return 1;
+static int tcg_region_age_cmp(const void *ap, const void *bp)
+{
+    unsigned int a = region.epoch - region_idx_to_tree(*(size_t *)ap)->epoch;
+    unsigned int b = region.epoch - region_idx_to_tree(*(size_t *)bp)->epoch;
+
+    /* oldest first */
+    return a < b ? 1 : a > b ? -1 : 0;
+}
+
+/*
+ * Free the least recently used half of the regions that hold code but are
+ * not being translated into.  @evict is called for every TB in the chosen
+ * regions before they are freed; @purge is then called for every other TB,
+ * so that it can drop any pointer into them (see tcg_tc_reclaimed()).
+ *
+ * Returns the number of regions freed; 0 if there was a free region
+ * already, e.g. because another vCPU requested a reclaim at the same time;
+ * or -1 if no region could be freed, in which case the caller must fall
+ * back to a full flush.  Call from a safe-work context.
+ */
+int tcg_region_reclaim(GTraverseFunc evict, GTraverseFunc purge)
+{
+    unsigned int n_ctxs = qatomic_read(&n_tcg_ctxs);
+    unsigned long *assigned;
+    size_t *cand;
+    size_t i, n_cand = 0, n_victims;
+
+    qemu_mutex_lock(&region.lock);
+    if (!bitmap_empty(region.free, region.n)) {
+        qemu_mutex_unlock(&region.lock);
+        return 0;
+    }
+    assigned = bitmap_new(region.n);
+    cand = g_new(size_t, region.n);
+    for (i = 0; i < n_ctxs; i++) {
+        const TCGContext *s = qatomic_read(&tcg_ctxs[i]);
+
+        set_bit(tc_ptr_to_region_idx(s->code_gen_buffer), assigned);
+    }
+    for (i = 0; i < region.n; i++) {
+        if (!test_bit(i, assigned)) {
+            cand[n_cand++] = i;
+        }
+    }
+    g_free(assigned);
+    if (n_cand == 0) {
+        qemu_mutex_unlock(&region.lock);
+        g_free(cand);
+        return -1;
+    }
+    qsort(cand, n_cand, sizeof(cand[0]), tcg_region_age_cmp);
+    n_victims = DIV_ROUND_UP(n_cand, 2);
+    for (i = 0; i < n_victims; i++) {
+        set_bit(cand[i], region.reclaim);
+    }
+    qemu_mutex_unlock(&region.lock);
+
+    for (i = 0; i < n_victims; i++) {
+        struct tcg_region_tree *rt = region_idx_to_tree(cand[i]);
+
+        qemu_mutex_lock(&rt->lock);
+        g_tree_foreach(rt->tree, evict, NULL);
+        qemu_mutex_unlock(&rt->lock);
     }
 
-    /* Try to have more regions than max_cpus, with each region being >= 2 MB */
+    tcg_region_tree_lock_all();
+    for (i = 0; i < region.n; i++) {
+        struct tcg_region_tree *rt = region_idx_to_tree(i);
+
+        if (!test_bit(i, region.reclaim)) {
+            g_tree_foreach(rt->tree, purge, NULL);
+        }
+    }
+    for (i = 0; i < n_victims; i++) {
+        struct tcg_region_tree *rt = region_idx_to_tree(cand[i]);
+
+        g_tree_foreach(rt->tree, tcg_region_tree_traverse, NULL);
+        /* Increment the refcount first so that destroy acts as a reset */
+        g_tree_ref(rt->tree);
+        g_tree_destroy(rt->tree);
+    }
+    tcg_region_tree_unlock_all();
+
+    qemu_mutex_lock(&region.lock);
+    for (i = 0; i < n_victims; i++) {
+        void *start, *end;
+
+        tcg_region_bounds(cand[i], &start, &end);
+        region.agg_size_full -= end - start - TCG_HIGHWATER;
+        clear_bit(cand[i], region.reclaim);
+        set_bit(cand[i], region.free);
+    }
+    qemu_mutex_unlock(&region.lock);
+
+    g_free(cand);
+    return n_victims;
+}
+
+/*
+ * Aim for 8 regions per TCG thread, with each region being >= 2 MB.
+ * Besides letting threads translate in parallel, having more regions than
+ * threads lets tcg_region_reclaim() free cold code instead of flushing
+ * everything.  If that's not possible we make do by evenly dividing the
+ * code_gen_buffer among the threads.
+ */
+static size_t tcg_n_regions_for(size_t n_threads)
+{
+    size_t i;
+
     for (i = 8; i > 0; i--) {
         size_t regions_per_thread = i;
         size_t region_size;
 
         region_size = tcg_init_ctx.code_gen_buffer_size;
-        region_size /= max_cpus * regions_per_thread;
+        region_size /= n_threads * regions_per_thread;
 
         if (region_size >= 2 * 1024u * 1024) {
-            return max_cpus * regions_per_thread;
+            return n_threads * regions_per_thread;
         }
     }
-    /* If we can't, then just allocate one region per vCPU thread */
-    return max_cpus;
+    return n_threads;
+}
+
+#ifdef CONFIG_USER_ONLY
+static size_t tcg_n_regions(void)
+{
+    /* user-mode has a single TCG context, see tcg_region_init() */
+    return tcg_n_regions_for(1);
+}
+#else
+static size_t tcg_n_regions(void)
+{
+    MachineState *ms = MACHINE(qdev_get_machine());
+    unsigned int max_cpus = ms->smp.max_cpus;
+
+    /* A single TCG thread if all we have is one vCPU, or without MTTCG */
+    if (max_cpus == 1 || !qemu_tcg_mttcg_enabled()) {
+        return tcg_n_regions_for(1);
+    }
+    return tcg_n_regions_for(max_cpus);
 }
 #endif
 
@@ -669,18 +822,20 @@ static size_t tcg_n_regions(void)
  * code in parallel without synchronization.
  *
  * In softmmu the number of TCG threads is bounded by max_cpus, so we use at
- * least max_cpus regions in MTTCG. In !MTTCG we use a single region.
+ * least max_cpus regions in MTTCG. In !MTTCG there is a single TCG thread.
  * Note that the TCG options from the command-line (i.e. -accel accel=tcg,[...])
  * must have been parsed before calling this function, since it calls
  * qemu_tcg_mttcg_enabled().
  *
- * In user-mode we use a single region.  Having multiple regions in user-mode
- * is not supported, because the number of vCPU threads (recall that each thread
- * spawned by the guest corresponds to a vCPU thread) is only bounded by the
- * OS, and usually this number is huge (tens of thousands is not uncommon).
- * Thus, given this large bound on the number of vCPU threads and the fact
- * that code_gen_buffer is allocated at compile-time, we cannot guarantee
- * that the availability of at least one region per vCPU thread.
+ * In user-mode we use a single TCG context.  Having one context per thread
+ * in user-mode is not supported, because the number of vCPU threads (recall
+ * that each thread spawned by the guest corresponds to a vCPU thread) is only
+ * bounded by the OS, and usually this number is huge (tens of thousands is
+ * not uncommon).  Thus, given this large bound on the number of vCPU threads
+ * and the fact that code_gen_buffer is allocated at compile-time, we cannot
+ * guarantee that the availability of at least one region per vCPU thread.
+ * The single context still moves from region to region, which allows cold
+ * regions to be reclaimed.
  *
  * However, this user-mode limitation is unlikely to be a significant problem
  * in practice. Multi-threaded guests share most if not all of their translated
@@ -715,6 +870,9 @@ void tcg_region_init(void)
     /* init the region struct */
     qemu_mutex_init(&region.lock);
     region.n = n_regions;
+    region.free = bitmap_new(n_regions);
+    bitmap_set(region.free, 0, n_regions);
+    region.reclaim = bitmap_new(n_regions);
     region.size = region_size - page_size;
     region.stride = region_size;
     region.start = buf;
@@ -1310,6 +1468,9 @@ TCGv_vec tcg_temp_new_vec(TCGType type)
     case TCG_TYPE_V256:
         assert(TCG_TARGET_HAS_v256);
         break;
+    case TCG_TYPE_V512:
+        assert(TCG_TARGET_HAS_v512);
+        break;
     default:
         g_assert_not_reached();
     }
@@ -1409,7 +1570,8 @@ int tcg_check_temp_count(void)
 bool tcg_op_supported(TCGOpcode op)
 {
     const bool have_vec
-        = TCG_TARGET_HAS_v64 | TCG_TARGET_HAS_v128 | TCG_TARGET_HAS_v256;
+        = (TCG_TARGET_HAS_v64 | TCG_TARGET_HAS_v128
+           | TCG_TARGET_HAS_v256 | TCG_TARGET_HAS_v512);
 
     switch (op) {
     case INDEX_op_discard:
@@ -3152,20 +3314,38 @@ static void check_regs(TCGContext *s)
 
 static void temp_allocate_frame(TCGContext *s, TCGTemp *ts)
 {
+    tcg_target_long size, align;
+
+    switch (ts->type) {
+    case TCG_TYPE_V128:
+        size = align = 16;
+        break;
+    case TCG_TYPE_V256:
+    case TCG_TYPE_V512:
+        /*
+         * The host stack is only guaranteed 16-byte alignment, so the
+         * wide vector types are spilled with unaligned loads and stores.
+         */
+        size = ts->type == TCG_TYPE_V256 ? 32 : 64;
+        align = 16;
+        break;
+    default:
+        size = align = sizeof(tcg_target_long);
+        break;
+    }
+
 #if !(defined(__sparc__) && TCG_TARGET_REG_BITS == 64)
     /* Sparc64 stack is accessed with offset of 2047 */
-    s->current_frame_offset = (s->current_frame_offset +
-                               (tcg_target_long)sizeof(tcg_target_long) - 1) &
-        ~(sizeof(tcg_target_long) - 1);
+    s->current_frame_offset = (s->current_frame_offset + align - 1)
+                              & ~(align - 1);
 #endif
-    if (s->current_frame_offset + (tcg_target_long)sizeof(tcg_target_long) >
-        s->frame_end) {
+    if (s->current_frame_offset + size > s->frame_end) {
         tcg_abort();
     }
     ts->mem_offset = s->current_frame_offset;
     ts->mem_base = s->frame_temp;
     ts->mem_allocated = 1;
-    s->current_frame_offset += sizeof(tcg_target_long);
+    s->current_frame_offset += size;
 }
 
 static void temp_load(TCGContext *, TCGTemp *, TCGRegSet, TCGRegSet, TCGRegSet);
@@ -4314,6 +4494,9 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb)
     if (i < 0) {
         return i;
     }
+#endif
+#ifdef TCG_TARGET_NEED_TB_FINALIZE
+    tcg_out_tb_finalize(s);
 #endif
     if (!tcg_resolve_relocs(s)) {
         return -2;
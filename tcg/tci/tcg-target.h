@@ -189,6 +189,21 @@ typedef enum {
 
 void tci_disas(uint8_t opc);
 
+/*
+ * Superinstructions.  TCG never emits these; tcg_out_tb_finalize rewrites
+ * the opcode byte of an instruction to one of them when it is followed by
+ * a suitable partner.  They are numbered after the generic TCG opcodes.
+ */
+#define INDEX_op_tci_ld_add_i32         (NB_OPS + 0)
+#define INDEX_op_tci_add_st_i32         (NB_OPS + 1)
+#define INDEX_op_tci_brcondi_i32        (NB_OPS + 2)
+#define INDEX_op_tci_ld_add_i64         (NB_OPS + 3)
+#define INDEX_op_tci_add_st_i64         (NB_OPS + 4)
+#define INDEX_op_tci_brcondi_i64        (NB_OPS + 5)
+#define TCI_NB_OPS                      (NB_OPS + 6)
+
+#define TCG_TARGET_NEED_TB_FINALIZE
+
 #define HAVE_TCG_QEMU_TB_EXEC
 
 static inline void flush_icache_range(uintptr_t start, uintptr_t stop)
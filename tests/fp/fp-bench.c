@@ -14,6 +14,7 @@
 #include <math.h>
 #include <fenv.h>
 #include "qemu/timer.h"
+#include "qemu/bitops.h"
 #include "fpu/softfloat.h"
 
 /* amortize the computation of random inputs */
@@ -33,6 +34,9 @@ enum op {
     OP_FMA,
     OP_SQRT,
     OP_CMP,
+    OP_RINT,
+    OP_TO_INT,
+    OP_FROM_INT,
     OP_MAX_NR,
 };
 
@@ -44,14 +48,19 @@ static const char * const op_names[] = {
     [OP_FMA] = "mulAdd",
     [OP_SQRT] = "sqrt",
     [OP_CMP] = "cmp",
+    [OP_RINT] = "roundToInt",
+    [OP_TO_INT] = "toInt32",
+    [OP_FROM_INT] = "fromInt32",
     [OP_MAX_NR] = NULL,
 };
 
 enum precision {
     PREC_SINGLE,
     PREC_DOUBLE,
+    PREC_QUAD,
     PREC_FLOAT32,
     PREC_FLOAT64,
+    PREC_FLOAT128,
     PREC_MAX_NR,
 };
 
@@ -89,6 +98,7 @@ union fp {
     double d;
     float32 f32;
     float64 f64;
+    float128 f128;
     uint64_t u64;
 };
 
@@ -152,6 +162,7 @@ static void update_random_ops(int n_ops, enum precision prec)
             break;
         case PREC_DOUBLE:
         case PREC_FLOAT64:
+        case PREC_FLOAT128:
             do {
                 r = xorshift64star(r);
             } while (!float64_is_normal(r));
@@ -163,27 +174,62 @@ static void update_random_ops(int n_ops, enum precision prec)
     }
 }
 
+/*
+ * Conversions to int32 only take the fast path for in-range inputs, so
+ * for those operations rescale the operands to an exponent below 31.
+ * fromInt32 takes its integer operand from the operand's raw bits.
+ */
+static bool op_is_int_range(enum op op)
+{
+    return op == OP_RINT || op == OP_TO_INT || op == OP_FROM_INT;
+}
+
 static void fill_random(union fp *ops, int n_ops, enum precision prec,
-                        bool no_neg)
+                        bool no_neg, bool int_range)
 {
     int i;
 
     for (i = 0; i < n_ops; i++) {
+        uint64_t r = random_ops[i];
+
         switch (prec) {
         case PREC_SINGLE:
         case PREC_FLOAT32:
-            ops[i].f32 = make_float32(random_ops[i]);
+            if (int_range) {
+                r = deposit64(r, 23, 8, 127 + extract64(r, 23, 8) % 31);
+            }
+            ops[i].f32 = make_float32(r);
             if (no_neg && float32_is_neg(ops[i].f32)) {
                 ops[i].f32 = float32_chs(ops[i].f32);
             }
             break;
         case PREC_DOUBLE:
         case PREC_FLOAT64:
-            ops[i].f64 = make_float64(random_ops[i]);
+            if (int_range) {
+                r = deposit64(r, 52, 11, 1023 + extract64(r, 52, 11) % 31);
+            }
+            ops[i].f64 = make_float64(r);
             if (no_neg && float64_is_neg(ops[i].f64)) {
                 ops[i].f64 = float64_chs(ops[i].f64);
             }
             break;
+        case PREC_FLOAT128:
+            /*
+             * Widen the random normal float64, filling the extra
+             * fraction bits with more randomness.
+             */
+            if (int_range) {
+                r = deposit64(r, 52, 11, 1023 + extract64(r, 52, 11) % 31);
+            }
+            ops[i].f128 = make_float128(
+                (r & INT64_MIN)
+                | (extract64(r, 52, 11) + 16383 - 1023) << 48
+                | extract64(r, 4, 48),
+                r << 60 | xorshift64star(r) >> 4);
+            if (no_neg && float128_is_neg(ops[i].f128)) {
+                ops[i].f128 = float128_chs(ops[i].f128);
+            }
+            break;
         default:
             g_assert_not_reached();
         }
@@ -206,7 +252,7 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
         update_random_ops(n_ops, prec);
         switch (prec) {
         case PREC_SINGLE:
-            fill_random(ops, n_ops, prec, no_neg);
+            fill_random(ops, n_ops, prec, no_neg, op_is_int_range(op));
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float a = ops[0].f;
@@ -235,13 +281,22 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = isgreater(a, b);
                     break;
+                case OP_RINT:
+                    res.f = rintf(a);
+                    break;
+                case OP_TO_INT:
+                    res.u64 = (int32_t)rintf(a);
+                    break;
+                case OP_FROM_INT:
+                    res.f = (int32_t)(float32_val(ops[0].f32) >> 8);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
             }
             break;
         case PREC_DOUBLE:
-            fill_random(ops, n_ops, prec, no_neg);
+            fill_random(ops, n_ops, prec, no_neg, op_is_int_range(op));
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 double a = ops[0].d;
@@ -270,13 +325,22 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = isgreater(a, b);
                     break;
+                case OP_RINT:
+                    res.d = rint(a);
+                    break;
+                case OP_TO_INT:
+                    res.u64 = (int32_t)rint(a);
+                    break;
+                case OP_FROM_INT:
+                    res.d = (int32_t)(float64_val(ops[0].f64) >> 32);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
             }
             break;
         case PREC_FLOAT32:
-            fill_random(ops, n_ops, prec, no_neg);
+            fill_random(ops, n_ops, prec, no_neg, op_is_int_range(op));
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float32 a = ops[0].f32;
@@ -305,13 +369,23 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float32_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_RINT:
+                    res.f32 = float32_round_to_int(a, &soft_status);
+                    break;
+                case OP_TO_INT:
+                    res.u64 = float32_to_int32(a, &soft_status);
+                    break;
+                case OP_FROM_INT:
+                    res.f32 = int32_to_float32(float32_val(a) >> 8,
+                                               &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
             }
             break;
         case PREC_FLOAT64:
-            fill_random(ops, n_ops, prec, no_neg);
+            fill_random(ops, n_ops, prec, no_neg, op_is_int_range(op));
             t0 = get_clock();
             for (i = 0; i < OPS_PER_ITER; i++) {
                 float64 a = ops[0].f64;
@@ -340,6 +414,60 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
                 case OP_CMP:
                     res.u64 = float64_compare_quiet(a, b, &soft_status);
                     break;
+                case OP_RINT:
+                    res.f64 = float64_round_to_int(a, &soft_status);
+                    break;
+                case OP_TO_INT:
+                    res.u64 = float64_to_int32(a, &soft_status);
+                    break;
+                case OP_FROM_INT:
+                    res.f64 = int32_to_float64(float64_val(a) >> 32,
+                                               &soft_status);
+                    break;
+                default:
+                    g_assert_not_reached();
+                }
+            }
+            break;
+        case PREC_FLOAT128:
+            fill_random(ops, n_ops, prec, no_neg, op_is_int_range(op));
+            t0 = get_clock();
+            for (i = 0; i < OPS_PER_ITER; i++) {
+                float128 a = ops[0].f128;
+                float128 b = ops[1].f128;
+                float128 c = ops[2].f128;
+
+                switch (op) {
+                case OP_ADD:
+                    res.f128 = float128_add(a, b, &soft_status);
+                    break;
+                case OP_SUB:
+                    res.f128 = float128_sub(a, b, &soft_status);
+                    break;
+                case OP_MUL:
+                    res.f128 = float128_mul(a, b, &soft_status);
+                    break;
+                case OP_DIV:
+                    res.f128 = float128_div(a, b, &soft_status);
+                    break;
+                case OP_FMA:
+                    res.f128 = float128_muladd(a, b, c, 0, &soft_status);
+                    break;
+                case OP_SQRT:
+                    res.f128 = float128_sqrt(a, &soft_status);
+                    break;
+                case OP_CMP:
+                    res.u64 = float128_compare_quiet(a, b, &soft_status);
+                    break;
+                case OP_RINT:
+                    res.f128 = float128_round_to_int(a, &soft_status);
+                    break;
+                case OP_TO_INT:
+                    res.u64 = float128_to_int32(a, &soft_status);
+                    break;
+                case OP_FROM_INT:
+                    res.f128 = int32_to_float128(a.high >> 32, &soft_status);
+                    break;
                 default:
                     g_assert_not_reached();
                 }
@@ -369,7 +497,8 @@ static void bench(enum precision prec, enum op op, int n_ops, bool no_neg)
     GEN_BENCH(bench_ ## opname ## _float, float, PREC_SINGLE, op, n_ops) \
     GEN_BENCH(bench_ ## opname ## _double, double, PREC_DOUBLE, op, n_ops) \
     GEN_BENCH(bench_ ## opname ## _float32, float32, PREC_FLOAT32, op, n_ops) \
-    GEN_BENCH(bench_ ## opname ## _float64, float64, PREC_FLOAT64, op, n_ops)
+    GEN_BENCH(bench_ ## opname ## _float64, float64, PREC_FLOAT64, op, n_ops) \
+    GEN_BENCH(bench_ ## opname ## _float128, float128, PREC_FLOAT128, op, n_ops)
 
 GEN_BENCH_ALL_TYPES(add, OP_ADD, 2)
 GEN_BENCH_ALL_TYPES(sub, OP_SUB, 2)
@@ -377,13 +506,18 @@ GEN_BENCH_ALL_TYPES(mul, OP_MUL, 2)
 GEN_BENCH_ALL_TYPES(div, OP_DIV, 2)
 GEN_BENCH_ALL_TYPES(fma, OP_FMA, 3)
 GEN_BENCH_ALL_TYPES(cmp, OP_CMP, 2)
+GEN_BENCH_ALL_TYPES(rint, OP_RINT, 1)
+GEN_BENCH_ALL_TYPES(to_int, OP_TO_INT, 1)
+GEN_BENCH_ALL_TYPES(from_int, OP_FROM_INT, 1)
 #undef GEN_BENCH_ALL_TYPES
 
 #define GEN_BENCH_ALL_TYPES_NO_NEG(name, op, n)                         \
     GEN_BENCH_NO_NEG(bench_ ## name ## _float, float, PREC_SINGLE, op, n) \
     GEN_BENCH_NO_NEG(bench_ ## name ## _double, double, PREC_DOUBLE, op, n) \
     GEN_BENCH_NO_NEG(bench_ ## name ## _float32, float32, PREC_FLOAT32, op, n) \
-    GEN_BENCH_NO_NEG(bench_ ## name ## _float64, float64, PREC_FLOAT64, op, n)
+    GEN_BENCH_NO_NEG(bench_ ## name ## _float64, float64, PREC_FLOAT64, op, n) \
+    GEN_BENCH_NO_NEG(bench_ ## name ## _float128, float128, PREC_FLOAT128,   \
+                     op, n)
 
 GEN_BENCH_ALL_TYPES_NO_NEG(sqrt, OP_SQRT, 1)
 #undef GEN_BENCH_ALL_TYPES_NO_NEG
@@ -397,6 +531,7 @@ GEN_BENCH_ALL_TYPES_NO_NEG(sqrt, OP_SQRT, 1)
         [PREC_DOUBLE]    = bench_ ## opname ## _double,         \
         [PREC_FLOAT32]   = bench_ ## opname ## _float32,        \
         [PREC_FLOAT64]   = bench_ ## opname ## _float64,        \
+        [PREC_FLOAT128]  = bench_ ## opname ## _float128,       \
     }
 
 static const bench_func_t bench_funcs[OP_MAX_NR][PREC_MAX_NR] = {
@@ -407,6 +542,9 @@ static const bench_func_t bench_funcs[OP_MAX_NR][PREC_MAX_NR] = {
     GEN_BENCH_FUNCS(fma, OP_FMA),
     GEN_BENCH_FUNCS(sqrt, OP_SQRT),
     GEN_BENCH_FUNCS(cmp, OP_CMP),
+    GEN_BENCH_FUNCS(rint, OP_RINT),
+    GEN_BENCH_FUNCS(to_int, OP_TO_INT),
+    GEN_BENCH_FUNCS(from_int, OP_FROM_INT),
 };
 
 #undef GEN_BENCH_FUNCS
@@ -445,7 +583,7 @@ static void usage_complete(int argc, char *argv[])
     fprintf(stderr, " -h = show this help message.\n");
     fprintf(stderr, " -o = floating point operation (%s). Default: %s\n",
             op_list, op_names[0]);
-    fprintf(stderr, " -p = floating point precision (single, double). "
+    fprintf(stderr, " -p = floating point precision (single, double, quad). "
             "Default: single\n");
     fprintf(stderr, " -r = rounding mode (even, zero, down, up, tieaway). "
             "Default: even\n");
@@ -565,6 +703,8 @@ static void parse_args(int argc, char *argv[])
                 precision = PREC_SINGLE;
             } else if (!strcmp(optarg, "double")) {
                 precision = PREC_DOUBLE;
+            } else if (!strcmp(optarg, "quad")) {
+                precision = PREC_QUAD;
             } else {
                 fprintf(stderr, "Unsupported precision '%s'\n", optarg);
                 exit(EXIT_FAILURE);
@@ -597,6 +737,11 @@ static void parse_args(int argc, char *argv[])
     /* set precision and rounding mode based on the tester */
     switch (tester) {
     case TESTER_HOST:
+        if (precision == PREC_QUAD) {
+            fprintf(stderr, "fatal: quad precision not supported by the "
+                    "host tester\n");
+            exit(EXIT_FAILURE);
+        }
         set_host_precision(rounding);
         break;
     case TESTER_SOFT:
@@ -608,6 +753,9 @@ static void parse_args(int argc, char *argv[])
         case PREC_DOUBLE:
             precision = PREC_FLOAT64;
             break;
+        case PREC_QUAD:
+            precision = PREC_FLOAT128;
+            break;
         default:
             g_assert_not_reached();
         }
@@ -19,6 +19,8 @@ QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
 static uint64_t mem_count;
 static uint64_t io_count;
 static bool do_inline;
+static bool do_buffered;
+static struct qemu_plugin_trace *trace;
 static bool do_haddr;
 static enum qemu_plugin_mem_rw rw = QEMU_PLUGIN_MEM_RW;
 
@@ -49,6 +51,13 @@ static void vcpu_mem(unsigned int cpu_index, qemu_plugin_meminfo_t meminfo,
     }
 }
 
+static void vcpu_trace_flush(unsigned int vcpu_index,
+                             const qemu_plugin_trace_record *records,
+                             size_t n, void *udata)
+{
+    __atomic_fetch_add(&mem_count, n, __ATOMIC_RELAXED);
+}
+
 static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
 {
     size_t n = qemu_plugin_tb_n_insns(tb);
@@ -61,6 +70,8 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
             qemu_plugin_register_vcpu_mem_inline(insn, rw,
                                                  QEMU_PLUGIN_INLINE_ADD_U64,
                                                  &mem_count, 1);
+        } else if (do_buffered) {
+            qemu_plugin_register_vcpu_mem_buffered(insn, rw, trace);
         } else {
             qemu_plugin_register_vcpu_mem_cb(insn, vcpu_mem,
                                              QEMU_PLUGIN_CB_NO_REGS,
@@ -90,9 +101,17 @@ QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
         }
         if (!strcmp(argv[0], "inline")) {
             do_inline = true;
+        } else if (!strcmp(argv[0], "buffered")) {
+            do_buffered = true;
         }
     }
 
+    if (do_buffered) {
+        /* the records are gone by the time we could query their hwaddr */
+        do_haddr = false;
+        trace = qemu_plugin_trace_new(vcpu_trace_flush, NULL);
+    }
+
     qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
     qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
     return 0;
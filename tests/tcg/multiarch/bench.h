@@ -0,0 +1,96 @@
+/*
+ * Helpers for tests that double as benchmarks
+ *
+ * Such a test does a small, fixed amount of work by default and prints
+ * nothing unless it fails, so that check-tcg stays quick and its output
+ * stays stable.  Run with "-b", it takes its sizes from the remaining
+ * arguments (or larger defaults) and reports how fast it went.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef MULTIARCH_BENCH_H
+#define MULTIARCH_BENCH_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define fail_unless(x)                                          \
+do {                                                            \
+    if (!(x)) {                                                 \
+        fprintf(stderr, "FAILED at %s:%d\n", __FILE__, __LINE__); \
+        exit(EXIT_FAILURE);                                     \
+    }                                                           \
+} while (0)
+
+/* A size that "-b" lets the command line override.  */
+typedef struct {
+    const char *name;
+    int *value;
+    int bench_value;    /* used with -b when not given */
+} BenchArg;
+
+/* Set by bench_init() when running as a benchmark.  */
+static bool bench;
+static struct timespec bench_start_time;
+
+static inline void bench_usage(const char *prog, const BenchArg *args, int n)
+{
+    int i;
+
+    fprintf(stderr, "usage: %s [-b", prog);
+    for (i = 0; i < n; i++) {
+        fprintf(stderr, " [%s", args[i].name);
+    }
+    for (i = 0; i < n; i++) {
+        fputc(']', stderr);
+    }
+    fprintf(stderr, "]\n");
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * Parse "[-b [size...]]".  Without -b the sizes keep their values;
+ * with it, they are taken in order from the arguments that follow.
+ */
+static inline void bench_init(int argc, char **argv,
+                              const BenchArg *args, int n)
+{
+    int opt, i;
+
+    while ((opt = getopt(argc, argv, "b")) != -1) {
+        if (opt != 'b') {
+            bench_usage(argv[0], args, n);
+        }
+        bench = true;
+    }
+    for (i = 0; bench && i < n; i++) {
+        *args[i].value = optind < argc ? atoi(argv[optind++])
+                                       : args[i].bench_value;
+    }
+    if (optind < argc) {
+        bench_usage(argv[0], args, n);
+    }
+}
+
+static inline void bench_start(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &bench_start_time);
+}
+
+/* Return @count per second of wall time since bench_start().  */
+static inline double bench_rate(double count)
+{
+    struct timespec end;
+    double secs;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    secs = (end.tv_sec - bench_start_time.tv_sec) +
+           (end.tv_nsec - bench_start_time.tv_nsec) * 1e-9;
+    return secs > 0 ? count / secs : 0.0;
+}
+
+#endif
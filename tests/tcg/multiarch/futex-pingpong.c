@@ -0,0 +1,103 @@
+/*
+ * Contended futex wait/wake between thread pairs
+ *
+ * Two threads share a mutex and a condition variable and take strict
+ * turns incrementing a counter; a thread whose turn it is not sleeps in
+ * pthread_cond_wait, so every turn costs a futex wake and a futex wait.
+ * The counter is checked on every turn, so a lost wake-up shows up as a
+ * hang and a spurious or misdirected one as a failure.
+ *
+ * Pairs never share a futex word, which makes "-b" useful to see how
+ * the linux-user futex path scales with the number of vCPUs:
+ *
+ *   futex-pingpong -b [pairs [turns]]
+ *
+ * runs the given number of pairs and prints the turns per second.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <pthread.h>
+#include "bench.h"
+
+static int n_pairs = 2;
+static int n_turns = 1000;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int turn;
+    int count;
+} Pair;
+
+typedef struct {
+    Pair *pair;
+    int side;
+} Player;
+
+static void *player_fn(void *arg)
+{
+    Player *p = arg;
+    Pair *pair = p->pair;
+    int i;
+
+    for (i = 0; i < n_turns; i++) {
+        pthread_mutex_lock(&pair->lock);
+        while (pair->turn != p->side) {
+            pthread_cond_wait(&pair->cond, &pair->lock);
+        }
+        fail_unless(pair->count == 2 * i + p->side);
+        pair->count++;
+        pair->turn = !p->side;
+        pthread_cond_signal(&pair->cond);
+        pthread_mutex_unlock(&pair->lock);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    const BenchArg args[] = {
+        { "pairs", &n_pairs, 4 },
+        { "turns", &n_turns, 100000 },
+    };
+    pthread_t *threads;
+    Player *players;
+    Pair *pairs;
+    int i;
+
+    bench_init(argc, argv, args, 2);
+    threads = calloc(2 * n_pairs, sizeof(pthread_t));
+    players = calloc(2 * n_pairs, sizeof(Player));
+    pairs = calloc(n_pairs, sizeof(Pair));
+
+    for (i = 0; i < n_pairs; i++) {
+        pthread_mutex_init(&pairs[i].lock, NULL);
+        pthread_cond_init(&pairs[i].cond, NULL);
+    }
+
+    bench_start();
+    for (i = 0; i < 2 * n_pairs; i++) {
+        players[i].pair = &pairs[i / 2];
+        players[i].side = i & 1;
+        fail_unless(pthread_create(threads + i, NULL,
+                                   player_fn, players + i) == 0);
+    }
+    for (i = 0; i < 2 * n_pairs; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (i = 0; i < n_pairs; i++) {
+        fail_unless(pairs[i].count == 2 * n_turns);
+    }
+
+    if (bench) {
+        printf("%d pairs x %d turns: %.0f turns/s\n", n_pairs, n_turns,
+               bench_rate(2.0 * n_pairs * n_turns));
+    }
+
+    free(pairs);
+    free(players);
+    free(threads);
+    return EXIT_SUCCESS;
+}
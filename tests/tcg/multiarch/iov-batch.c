@@ -0,0 +1,157 @@
+/*
+ * sendmmsg/recvmmsg and writev/readv with scattered buffers
+ *
+ * Each datagram is gathered from many small pieces, like a packet whose
+ * headers are built separately, and a batch of them goes through a
+ * socketpair with sendmmsg and comes back with recvmmsg. The same pieces
+ * are then streamed through a pipe with writev and read back into two
+ * buffers with readv. The payload changes on every round and is compared
+ * byte for byte, so a wrong iovec, length or message count in the
+ * batched translation is caught.
+ *
+ * With "-b" it also reports the rates, with sizes from the command line:
+ *
+ *   iov-batch -b [batch [rounds [pieces]]]
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "bench.h"
+
+#define PIECE 16
+
+static int batch = 16;
+static int n_rounds = 100;
+static int n_pieces = 8;
+
+static void fill(uint8_t *buf, size_t len, int seed)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        buf[i] = seed + i;
+    }
+}
+
+static void test_mmsg(void)
+{
+    size_t msg_len = n_pieces * PIECE;
+    struct mmsghdr *smsg = calloc(batch, sizeof(*smsg));
+    struct mmsghdr *rmsg = calloc(batch, sizeof(*rmsg));
+    struct iovec *siov = calloc(batch * n_pieces, sizeof(*siov));
+    struct iovec *riov = calloc(batch, sizeof(*riov));
+    uint8_t *sbuf = malloc(batch * msg_len);
+    uint8_t *rbuf = malloc(batch * msg_len);
+    int sv[2];
+    int i, j, it;
+
+    fail_unless(socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) == 0);
+
+    for (i = 0; i < batch; i++) {
+        for (j = 0; j < n_pieces; j++) {
+            siov[i * n_pieces + j].iov_base = sbuf + i * msg_len + j * PIECE;
+            siov[i * n_pieces + j].iov_len = PIECE;
+        }
+        smsg[i].msg_hdr.msg_iov = siov + i * n_pieces;
+        smsg[i].msg_hdr.msg_iovlen = n_pieces;
+        riov[i].iov_base = rbuf + i * msg_len;
+        riov[i].iov_len = msg_len;
+        rmsg[i].msg_hdr.msg_iov = riov + i;
+        rmsg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    bench_start();
+    for (it = 0; it < n_rounds; it++) {
+        int sent = 0, rcvd = 0;
+
+        fill(sbuf, batch * msg_len, it);
+        while (sent < batch) {
+            int n = sendmmsg(sv[0], smsg + sent, batch - sent, 0);
+            fail_unless(n > 0);
+            /* a datagram socketpair may not queue the whole batch */
+            while (rcvd < sent + n) {
+                int m = recvmmsg(sv[1], rmsg + rcvd, sent + n - rcvd, 0, NULL);
+                fail_unless(m > 0);
+                for (i = rcvd; i < rcvd + m; i++) {
+                    fail_unless(rmsg[i].msg_len == msg_len);
+                }
+                rcvd += m;
+            }
+            sent += n;
+        }
+        fail_unless(memcmp(sbuf, rbuf, batch * msg_len) == 0);
+    }
+    if (bench) {
+        printf("sendmmsg/recvmmsg %d x %d pieces: %.0f msgs/s\n",
+               batch, n_pieces,
+               bench_rate((double)batch * n_rounds));
+    }
+
+    close(sv[0]);
+    close(sv[1]);
+    free(smsg);
+    free(rmsg);
+    free(siov);
+    free(riov);
+    free(sbuf);
+    free(rbuf);
+}
+
+static void test_writev(void)
+{
+    size_t len = n_pieces * PIECE;
+    struct iovec *iov = calloc(n_pieces, sizeof(*iov));
+    uint8_t *sbuf = malloc(len);
+    uint8_t *rbuf = malloc(len);
+    struct iovec riov[2];
+    int fds[2];
+    int i, it;
+
+    fail_unless(pipe(fds) == 0);
+
+    for (i = 0; i < n_pieces; i++) {
+        iov[i].iov_base = sbuf + i * PIECE;
+        iov[i].iov_len = PIECE;
+    }
+    riov[0].iov_base = rbuf;
+    riov[0].iov_len = len / 2;
+    riov[1].iov_base = rbuf + len / 2;
+    riov[1].iov_len = len - len / 2;
+
+    bench_start();
+    for (it = 0; it < n_rounds * batch; it++) {
+        fill(sbuf, len, it);
+        fail_unless(writev(fds[1], iov, n_pieces) == len);
+        fail_unless(readv(fds[0], riov, 2) == len);
+        fail_unless(memcmp(sbuf, rbuf, len) == 0);
+    }
+    if (bench) {
+        printf("writev/readv %d pieces: %.0f calls/s\n",
+               n_pieces, bench_rate(2.0 * n_rounds * batch));
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    free(iov);
+    free(sbuf);
+    free(rbuf);
+}
+
+int main(int argc, char **argv)
+{
+    const BenchArg args[] = {
+        { "batch", &batch, 32 },
+        { "rounds", &n_rounds, 2000 },
+        { "pieces", &n_pieces, 8 },
+    };
+
+    bench_init(argc, argv, args, 3);
+    test_mmsg();
+    test_writev();
+    return EXIT_SUCCESS;
+}
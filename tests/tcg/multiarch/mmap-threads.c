@@ -0,0 +1,96 @@
+/*
+ * Multi-threaded mmap/mprotect churn
+ *
+ * Every thread repeatedly maps a few pages, writes them, flips their
+ * protection, hands them to the kernel through a syscall buffer and
+ * unmaps them again. Under linux-user each of those steps walks the
+ * guest page descriptor table, so besides checking that the data
+ * survives the churn this doubles as a scaling benchmark for it:
+ *
+ *   mmap-threads -b [threads [iterations [pages]]]
+ *
+ * prints the aggregate number of map/unmap cycles per second.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "bench.h"
+
+static int n_threads = 2;
+static int n_iterations = 100;
+static int n_pages = 4;
+static size_t pagesize;
+
+static void *thread_fn(void *arg)
+{
+    uintptr_t id = (uintptr_t)arg;
+    size_t len = n_pages * pagesize;
+    int fds[2];
+    int i, j;
+
+    fail_unless(pipe(fds) == 0);
+
+    for (i = 0; i < n_iterations; i++) {
+        uint8_t *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        uint8_t tag = id + i;
+
+        fail_unless(p != MAP_FAILED);
+        for (j = 0; j < n_pages; j++) {
+            p[j * pagesize] = tag;
+        }
+
+        fail_unless(mprotect(p, len, PROT_READ) == 0);
+        for (j = 0; j < n_pages; j++) {
+            fail_unless(p[j * pagesize] == tag);
+        }
+        fail_unless(mprotect(p, len, PROT_READ | PROT_WRITE) == 0);
+
+        /* round-trip through the kernel to exercise access checks */
+        fail_unless(write(fds[1], p, 1) == 1);
+        fail_unless(read(fds[0], p + len - 1, 1) == 1);
+        fail_unless(p[len - 1] == tag);
+
+        fail_unless(munmap(p, len) == 0);
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    const BenchArg args[] = {
+        { "threads", &n_threads, 4 },
+        { "iterations", &n_iterations, 1000 },
+        { "pages", &n_pages, 4 },
+    };
+    pthread_t *threads;
+    int i;
+
+    bench_init(argc, argv, args, 3);
+    pagesize = getpagesize();
+    threads = calloc(n_threads, sizeof(pthread_t));
+
+    bench_start();
+    for (i = 0; i < n_threads; i++) {
+        pthread_create(threads + i, NULL, thread_fn, (void *)(uintptr_t)i);
+    }
+    for (i = 0; i < n_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    if (bench) {
+        printf("%d threads x %d iterations x %d pages: %.0f cycles/s\n",
+               n_threads, n_iterations, n_pages,
+               bench_rate((double)n_threads * n_iterations));
+    }
+
+    free(threads);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,15 @@
+/*
+ * Trivial program for timing process startup
+ *
+ * It exits as soon as it is entered, so running it many times measures
+ * what QEMU does before the first guest instruction: loading the image
+ * and its interpreter, and, when logging is enabled, preparing their
+ * symbol tables. See the bench-startup rule in Makefile.target.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+int main(void)
+{
+    return 0;
+}
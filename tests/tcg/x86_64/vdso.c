@@ -0,0 +1,150 @@
+/*
+ * Check the emulated vDSO against the system calls it stands for
+ *
+ * linux-user answers clock_gettime, gettimeofday, time, getcpu and
+ * clock_getres from helper_vdso when the guest's libc calls them through
+ * the vDSO, and falls back to the system call for the clocks it does not
+ * handle itself.  Each call is made through libc and compared with the
+ * same call made with syscall().
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/auxv.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define fail_unless(x)                                                  \
+    do {                                                                \
+        if (!(x)) {                                                     \
+            fprintf(stderr, "FAILED at %s:%d\n", __FILE__, __LINE__);   \
+            exit(EXIT_FAILURE);                                         \
+        }                                                               \
+    } while (0)
+
+static int64_t ts_ns(const struct timespec *ts)
+{
+    return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static int64_t tv_ns(const struct timeval *tv)
+{
+    return tv->tv_sec * 1000000000LL + tv->tv_usec * 1000LL;
+}
+
+/* A clock that never goes back must read the same from both paths.  */
+static void check_clock_gettime(clockid_t clock)
+{
+    struct timespec a, b, c;
+
+    fail_unless(clock_gettime(clock, &a) == 0);
+    fail_unless(syscall(SYS_clock_gettime, clock, &b) == 0);
+    fail_unless(clock_gettime(clock, &c) == 0);
+    fail_unless(ts_ns(&a) <= ts_ns(&b));
+    fail_unless(ts_ns(&b) <= ts_ns(&c));
+    fail_unless(c.tv_nsec >= 0 && c.tv_nsec < 1000000000);
+}
+
+static void check_clock_getres(clockid_t clock)
+{
+    struct timespec a, b;
+
+    fail_unless(clock_getres(clock, &a) == 0);
+    fail_unless(syscall(SYS_clock_getres, clock, &b) == 0);
+    fail_unless(a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec);
+}
+
+/* CLOCK_REALTIME can be stepped, so allow for a second of difference.  */
+static void check_realtime(void)
+{
+    struct timespec ts;
+    struct timeval tv;
+    struct timezone tz_a, tz_b;
+    time_t t_a, t_b, t_c;
+
+    fail_unless(clock_gettime(CLOCK_REALTIME, &ts) == 0);
+    fail_unless(syscall(SYS_gettimeofday, &tv, NULL) == 0);
+    fail_unless(llabs(ts_ns(&ts) - tv_ns(&tv)) < 1000000000LL);
+
+    fail_unless(gettimeofday(&tv, &tz_a) == 0);
+    fail_unless(syscall(SYS_gettimeofday, NULL, &tz_b) == 0);
+    fail_unless(llabs(ts_ns(&ts) - tv_ns(&tv)) < 1000000000LL);
+    fail_unless(tv.tv_usec >= 0 && tv.tv_usec < 1000000);
+    fail_unless(tz_a.tz_minuteswest == tz_b.tz_minuteswest);
+    fail_unless(tz_a.tz_dsttime == tz_b.tz_dsttime);
+    fail_unless(gettimeofday(&tv, NULL) == 0);
+
+    t_a = time(&t_b);
+    t_c = syscall(SYS_time, NULL);
+    fail_unless(t_a == t_b);
+    fail_unless(t_c - t_a >= 0 && t_c - t_a <= 1);
+    fail_unless(t_a - ts.tv_sec >= -1 && t_a - ts.tv_sec <= 1);
+}
+
+/* glibc's sched_getcpu() goes through the vDSO's getcpu.  */
+static void check_getcpu(void)
+{
+    unsigned int cpu, node;
+    long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+    int cpu_a;
+
+    cpu_a = sched_getcpu();
+    fail_unless(syscall(SYS_getcpu, &cpu, &node, NULL) == 0);
+    fail_unless(cpu_a >= 0 && cpu_a < ncpus);
+    fail_unless(cpu < ncpus);
+}
+
+/*
+ * CPU-time clocks are not handled by helper_vdso, which must decline so
+ * that the entry point's own system call runs.  So must an invalid clock.
+ */
+static void check_fallback(void)
+{
+    struct timespec ts;
+
+    check_clock_gettime(CLOCK_PROCESS_CPUTIME_ID);
+    check_clock_gettime(CLOCK_THREAD_CPUTIME_ID);
+    check_clock_getres(CLOCK_PROCESS_CPUTIME_ID);
+    check_clock_getres(CLOCK_THREAD_CPUTIME_ID);
+
+    errno = 0;
+    fail_unless(clock_gettime(12345, &ts) == -1 && errno == EINVAL);
+    errno = 0;
+    fail_unless(clock_getres(12345, &ts) == -1 && errno == EINVAL);
+}
+
+int main(void)
+{
+    static const clockid_t clocks[] = {
+        CLOCK_REALTIME, CLOCK_MONOTONIC, CLOCK_MONOTONIC_RAW,
+        CLOCK_REALTIME_COARSE, CLOCK_MONOTONIC_COARSE, CLOCK_BOOTTIME,
+        CLOCK_TAI,
+    };
+    int i, n;
+
+    /* Without a vDSO, libc would only ever make the system calls.  */
+    fail_unless(getauxval(AT_SYSINFO_EHDR) != 0);
+
+    /* Go through each entry point's translated code more than once.  */
+    for (n = 0; n < 100; n++) {
+        for (i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++) {
+            if (clocks[i] != CLOCK_REALTIME &&
+                clocks[i] != CLOCK_REALTIME_COARSE) {
+                check_clock_gettime(clocks[i]);
+            }
+            check_clock_getres(clocks[i]);
+        }
+        check_realtime();
+        check_getcpu();
+        check_fallback();
+    }
+    return EXIT_SUCCESS;
+}
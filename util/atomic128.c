@@ -0,0 +1,25 @@
+/*
+ * Run-time detection of 128-bit compare-and-swap on x86-64 hosts
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/atomic128.h"
+
+#ifdef ATOMIC128_CPUID_CX16
+
+#include "qemu/cpuid.h"
+
+bool atomic128_have_cx16;
+
+static void __attribute__((constructor)) init_atomic128_cx16(void)
+{
+    unsigned a, b, c, d;
+
+    if (__get_cpuid(1, &a, &b, &c, &d)) {
+        atomic128_have_cx16 = c & bit_CMPXCHG16B;
+    }
+}
+
+#endif